@@ -229,6 +229,7 @@ void MainWindow::updateGuiLoaded()
     sourceVideoStatus.setText(statusText);
 
     // Load and show the current frame
+    vectorscopeDialog->clearAccumulation();
     showFrame();
 
     // Update the video parameters dialogue
@@ -515,7 +516,7 @@ void MainWindow::updateOscilloscopeDialogue()
 void MainWindow::updateVectorscopeDialogue()
 {
     // Update the vectorscope dialogue
-    vectorscopeDialog->showTraceImage(tbcSource.getComponentFrame(), tbcSource.getVideoParameters());
+    vectorscopeDialog->showTraceImage(tbcSource.getComponentFrame(), tbcSource.getVideoParameters(), currentFrameNumber);
 }
 
 // Menu bar signal handlers -------------------------------------------------------------------------------------------
@@ -870,6 +871,7 @@ void MainWindow::on_sourcesPushButton_clicked()
     updateSourcesPushButton();
 
     // Show the current frame
+    vectorscopeDialog->clearAccumulation();
     showFrame();
 }
 
@@ -1070,6 +1072,7 @@ void MainWindow::videoParametersChangedSignalHandler(const LdDecodeMetaData::Vid
     updateAspectPushButton();
 
     // Update the frame views
+    vectorscopeDialog->clearAccumulation();
     updateFrame();
 }
 
@@ -1082,6 +1085,7 @@ void MainWindow::chromaDecoderConfigChangedSignalHandler()
                                      chromaDecoderConfigDialog->getOutputConfiguration());
 
     // Update the frame views
+    vectorscopeDialog->clearAccumulation();
     updateFrame();
 }
 
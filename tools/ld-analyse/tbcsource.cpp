@@ -27,18 +27,36 @@
 
 #include "sourcefield.h"
 
+#include <QThread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 TbcSource::TbcSource(QObject *parent) : QObject(parent)
 {
+    // Set up the decoded frame cache and the prefetch workers
+    decodedFrameCache.setMaxCost(DECODED_CACHE_FRAMES);
+    prefetchPool.setMaxThreadCount(qMin(QThread::idealThreadCount(), 2 * PREFETCH_DISTANCE));
+    prefetchDecodersConfigured = false;
+
     resetState();
 
     // Configure the chroma decoder
     palConfiguration = palColour.getConfiguration();
     palConfiguration.chromaFilter = PalColour::transform2DFilter;
+    palConfiguration.transformThreads = QThread::idealThreadCount();
     ntscConfiguration = ntscColour.getConfiguration();
     outputConfiguration.pixelFormat = OutputWriter::PixelFormat::RGB48;
     outputConfiguration.paddingAmount = 1;
 }
 
+TbcSource::~TbcSource()
+{
+    // Wait for any background decoding to finish
+    clearDecodedFrames();
+}
+
 // Public methods -----------------------------------------------------------------------------------------------------
 
 // Method to load a TBC source file
@@ -66,6 +84,7 @@ void TbcSource::loadSource(QString sourceFilename)
 // Method to unload a TBC source file
 void TbcSource::unloadSource()
 {
+    clearDecodedFrames();
     sourceVideo.close();
     if (sourceMode != ONE_SOURCE) chromaSourceVideo.close();
     resetState();
@@ -124,6 +143,7 @@ void TbcSource::setChromaDecoder(bool _state)
 void TbcSource::setFieldOrder(bool _state)
 {
     invalidateFrameCache();
+    clearDecodedFrames();
     reverseFoOn = _state;
 
     if (reverseFoOn) ldDecodeMetaData.setIsFirstFieldFirst(false);
@@ -160,6 +180,7 @@ void TbcSource::setSourceMode(TbcSource::SourceMode _sourceMode)
     if (sourceMode == ONE_SOURCE) return;
 
     invalidateFrameCache();
+    clearDecodedFrames();
     sourceMode = _sourceMode;
 }
 
@@ -344,8 +365,7 @@ bool TbcSource::getIsDropoutPresent()
 // Get the decoded ComponentFrame for the current frame
 const ComponentFrame &TbcSource::getComponentFrame()
 {
-    // Load and decode SourceFields for the current frame
-    loadInputFields();
+    // Decode the current frame (loading its SourceFields if needed)
     decodeFrame();
 
     return componentFrames[0];
@@ -361,6 +381,7 @@ const LdDecodeMetaData::VideoParameters &TbcSource::getVideoParameters()
 void TbcSource::setVideoParameters(const LdDecodeMetaData::VideoParameters &videoParameters)
 {
     invalidateFrameCache();
+    clearDecodedFrames();
 
     // Update the metadata
     ldDecodeMetaData.setVideoParameters(videoParameters);
@@ -517,6 +538,7 @@ void TbcSource::setChromaConfiguration(const PalColour::Configuration &_palConfi
                                        const OutputWriter::Configuration &_outputConfiguration)
 {
     invalidateFrameCache();
+    clearDecodedFrames();
 
     palConfiguration = _palConfiguration;
     ntscConfiguration = _ntscConfiguration;
@@ -590,6 +612,8 @@ qint32 TbcSource::startOfChapter(qint32 currentFrameNumber)
 // Re-initialise state for a new source video
 void TbcSource::resetState()
 {
+    clearDecodedFrames();
+
     // Default frame image options
     chromaOn = false;
     dropoutsOn = false;
@@ -599,6 +623,7 @@ void TbcSource::resetState()
 
     // Cache state
     loadedFrameNumber = -1;
+    prefetchCentre = -1;
     inputFieldsValid = false;
     decodedFrameValid = false;
     frameCacheValid = false;
@@ -614,6 +639,19 @@ void TbcSource::invalidateFrameCache()
     frameCacheValid = false;
 }
 
+// Discard all decoded frames, stopping any background decoding first.
+// This must be called before changing anything the decoders depend on.
+void TbcSource::clearDecodedFrames()
+{
+    prefetchPool.clear();
+    prefetchPool.waitForDone();
+
+    QMutexLocker locker(&decodedCacheMutex);
+    decodedFrameCache.clear();
+    prefetchPending.clear();
+    prefetchDecodersConfigured = false;
+}
+
 // Configure the chroma decoder for its settings and the VideoParameters
 void TbcSource::configureChromaDecoder()
 {
@@ -630,11 +668,39 @@ void TbcSource::configureChromaDecoder()
     outputWriter.updateConfiguration(videoParameters, outputConfiguration);
 }
 
-// Ensure the SourceFields for the current frame are loaded
-void TbcSource::loadInputFields()
+// Configure the prefetch workers' chroma decoders to match the main one.
+// The workers must not be running.
+void TbcSource::configurePrefetchDecoders()
 {
-    if (inputFieldsValid) return;
+    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
+
+    // The workers already decode several frames in parallel, so each
+    // decoder's transform filter only needs one thread
+    PalColour::Configuration prefetchPalConfiguration = palConfiguration;
+    prefetchPalConfiguration.transformThreads = 1;
+
+    QMutexLocker locker(&decodedCacheMutex);
+    freeDecoders.clear();
+    while (static_cast<qint32>(prefetchDecoders.size()) < prefetchPool.maxThreadCount()) {
+        prefetchDecoders.emplace_back(new FrameDecoder);
+    }
+    for (auto &decoder : prefetchDecoders) {
+        if (videoParameters.system == PAL || videoParameters.system == PAL_M) {
+            decoder->palColour.updateConfiguration(videoParameters, prefetchPalConfiguration);
+        } else {
+            decoder->ntscColour.updateConfiguration(videoParameters, ntscConfiguration);
+        }
+        freeDecoders.append(decoder.get());
+    }
 
+    prefetchDecodersConfigured = true;
+}
+
+// Load the SourceFields needed to decode a frame.
+// This is also called by the prefetch workers, so it only uses the source and
+// configuration, not the state of the loaded frame.
+void TbcSource::loadSourceFields(qint32 frameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
+{
     // Work out how many frames ahead/behind we need to fetch
     qint32 lookBehind, lookAhead;
     if (getSystem() == PAL || getSystem() == PAL_M) {
@@ -645,31 +711,35 @@ void TbcSource::loadInputFields()
         lookAhead = ntscConfiguration.getLookAhead();
     }
 
+    QMutexLocker locker(&sourceMutex);
+
     if (sourceMode == CHROMA_SOURCE) {
-        // Load chroma directly into inputFields
+        // Load chroma directly into fields
         SourceField::loadFields(chromaSourceVideo, ldDecodeMetaData,
-                                loadedFrameNumber, 1, lookBehind, lookAhead,
-                                inputFields, inputStartIndex, inputEndIndex);
+                                frameNumber, 1, lookBehind, lookAhead,
+                                fields, startIndex, endIndex);
     } else {
-        // Load the only source, or luma, into inputFields
+        // Load the only source, or luma, into fields
         SourceField::loadFields(sourceVideo, ldDecodeMetaData,
-                                loadedFrameNumber, 1, lookBehind, lookAhead,
-                                inputFields, inputStartIndex, inputEndIndex);
+                                frameNumber, 1, lookBehind, lookAhead,
+                                fields, startIndex, endIndex);
     }
 
     if (sourceMode == BOTH_SOURCES) {
-        // Load chroma into chromaInputFields
+        // Load chroma into chromaFields
+        QVector<SourceField> chromaFields;
         SourceField::loadFields(chromaSourceVideo, ldDecodeMetaData,
-                                loadedFrameNumber, 1, lookBehind, lookAhead,
-                                chromaInputFields, inputStartIndex, inputEndIndex);
+                                frameNumber, 1, lookBehind, lookAhead,
+                                chromaFields, startIndex, endIndex);
+        locker.unlock();
 
         // Separate chroma is offset (see chroma_to_u16 in vhsdecode/chroma.py)
         static constexpr qint32 CHROMA_OFFSET = 32767;
 
         // Add chroma to luma, removing the offset
-        for (qint32 fieldIndex = inputStartIndex; fieldIndex < inputEndIndex; fieldIndex++) {
-            auto &sourceData = inputFields[fieldIndex].data;
-            const auto &chromaData = chromaInputFields[fieldIndex].data;
+        for (qint32 fieldIndex = startIndex; fieldIndex < endIndex; fieldIndex++) {
+            auto &sourceData = fields[fieldIndex].data;
+            const auto &chromaData = chromaFields[fieldIndex].data;
 
             for (qint32 i = 0; i < sourceData.size(); i++) {
                 qint32 sum = static_cast<qint32>(sourceData[i]) + static_cast<qint32>(chromaData[i]) - CHROMA_OFFSET;
@@ -677,6 +747,14 @@ void TbcSource::loadInputFields()
             }
         }
     }
+}
+
+// Ensure the SourceFields for the current frame are loaded
+void TbcSource::loadInputFields()
+{
+    if (inputFieldsValid) return;
+
+    loadSourceFields(loadedFrameNumber, inputFields, inputStartIndex, inputEndIndex);
 
     inputFieldsValid = true;
 }
@@ -686,19 +764,134 @@ void TbcSource::decodeFrame()
 {
     if (decodedFrameValid) return;
 
-    loadInputFields();
-
-    // Decode the current frame to components
     componentFrames.resize(1);
+
+    // If the frame is already in the cache, use that, waiting for the
+    // prefetch workers if they're decoding it now
+    bool cached = false;
+    {
+        QMutexLocker locker(&decodedCacheMutex);
+        prefetchCentre = loadedFrameNumber;
+        while (prefetchPending.contains(loadedFrameNumber)) {
+            prefetchFinished.wait(&decodedCacheMutex);
+        }
+
+        const ComponentFrame *cachedFrame = decodedFrameCache.object(loadedFrameNumber);
+        if (cachedFrame != nullptr) {
+            componentFrames[0] = *cachedFrame;
+            cached = true;
+        }
+    }
+
+    if (!cached) {
+        loadInputFields();
+
+        // Decode the current frame to components
+        if (getSystem() == PAL || getSystem() == PAL_M) {
+            // PAL source
+            palColour.decodeFrames(inputFields, inputStartIndex, inputEndIndex, componentFrames);
+        } else {
+            // NTSC source
+            ntscColour.decodeFrames(inputFields, inputStartIndex, inputEndIndex, componentFrames);
+        }
+
+        QMutexLocker locker(&decodedCacheMutex);
+        decodedFrameCache.insert(loadedFrameNumber, new ComponentFrame(componentFrames[0]));
+    }
+
+    decodedFrameValid = true;
+
+    // Start decoding the frames the user is likely to look at next
+    prefetchNearbyFrames();
+}
+
+// Queue background decoding of the frames either side of the loaded frame
+void TbcSource::prefetchNearbyFrames()
+{
+    if (!prefetchDecodersConfigured) configurePrefetchDecoders();
+
+    const qint32 numberOfFrames = getNumberOfFrames();
+
+    QMutexLocker locker(&decodedCacheMutex);
+
+    // Queue the nearest frames first, ahead before behind
+    for (qint32 distance = 1; distance <= PREFETCH_DISTANCE; distance++) {
+        for (qint32 frameNumber : {loadedFrameNumber + distance, loadedFrameNumber - distance}) {
+            if (frameNumber < 1 || frameNumber > numberOfFrames) continue;
+            if (decodedFrameCache.contains(frameNumber) || prefetchPending.contains(frameNumber)) continue;
+
+            prefetchPending.insert(frameNumber);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+            QtConcurrent::run(&prefetchPool, this, &TbcSource::prefetchFrame, frameNumber);
+#else
+            QtConcurrent::run(&prefetchPool, &TbcSource::prefetchFrame, this, frameNumber);
+#endif
+        }
+    }
+}
+
+// Decode a frame into the cache (called by the prefetch workers)
+void TbcSource::prefetchFrame(qint32 frameNumber)
+{
+    FrameDecoder *decoder = nullptr;
+    {
+        QMutexLocker locker(&decodedCacheMutex);
+
+        // If the user has moved away from this frame since it was queued, don't bother
+        if (qAbs(frameNumber - prefetchCentre) > PREFETCH_DISTANCE || freeDecoders.isEmpty()) {
+            prefetchPending.remove(frameNumber);
+            prefetchFinished.wakeAll();
+            return;
+        }
+
+        decoder = freeDecoders.takeLast();
+    }
+
+    QVector<SourceField> fields;
+    qint32 startIndex, endIndex;
+    loadSourceFields(frameNumber, fields, startIndex, endIndex);
+
+    QVector<ComponentFrame> frames(1);
     if (getSystem() == PAL || getSystem() == PAL_M) {
-        // PAL source
-        palColour.decodeFrames(inputFields, inputStartIndex, inputEndIndex, componentFrames);
+        decoder->palColour.decodeFrames(fields, startIndex, endIndex, frames);
     } else {
-        // NTSC source
-        ntscColour.decodeFrames(inputFields, inputStartIndex, inputEndIndex, componentFrames);
+        decoder->ntscColour.decodeFrames(fields, startIndex, endIndex, frames);
     }
 
-    decodedFrameValid = true;
+    QMutexLocker locker(&decodedCacheMutex);
+    decodedFrameCache.insert(frameNumber, new ComponentFrame(std::move(frames[0])));
+    freeDecoders.append(decoder);
+    prefetchPending.remove(frameNumber);
+    prefetchFinished.wakeAll();
+}
+
+// Convert a line of 16-bit greyscale samples to RGB888, taking just the MSB
+static void greyLineToRgb888(const quint16 *input, uchar *output, qint32 width)
+{
+    qint32 x = 0;
+#if defined(__SSE2__)
+    // Reduce 16 samples at a time to 8 bits, then spread them into RGB
+    for (; x + 16 <= width; x += 16) {
+        const __m128i lo = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + x)), 8);
+        const __m128i hi = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + x + 8)), 8);
+        alignas(16) uchar grey[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(grey), _mm_packus_epi16(lo, hi));
+
+        uchar *outPixel = output + (x * 3);
+        for (qint32 i = 0; i < 16; i++) {
+            outPixel[i * 3]     = grey[i];
+            outPixel[i * 3 + 1] = grey[i];
+            outPixel[i * 3 + 2] = grey[i];
+        }
+    }
+#endif
+
+    for (; x < width; x++) {
+        const uchar pixelValue = static_cast<uchar>(input[x] / 256);
+        output[x * 3]     = pixelValue; // R
+        output[x * 3 + 1] = pixelValue; // G
+        output[x * 3 + 2] = pixelValue; // B
+    }
 }
 
 // Method to create a QImage for a source video frame
@@ -726,29 +919,13 @@ QImage TbcSource::generateQImage()
         // Chroma decode the current frame
         decodeFrame();
 
-        // Convert component video to RGB
-        OutputFrame outputFrame;
-        outputWriter.convert(componentFrames[0], outputFrame);
-
-        // Get a pointer to the RGB data
-        const quint16 *rgbPointer = outputFrame.data();
-
         // Fill the QImage with black
         frameImage.fill(Qt::black);
 
-        // Copy the RGB16-16-16 data into the RGB888 QImage
-        const qint32 activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
-        const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
-        for (qint32 y = 0; y < activeHeight; y++) {
-            const quint16 *inputLine = rgbPointer + (y * activeWidth * 3);
-            uchar *outputLine = frameImage.scanLine(y + videoParameters.firstActiveFrameLine)
-                                + (videoParameters.activeVideoStart * 3);
-
-            // Take just the MSB of the RGB input data
-            for (qint32 i = 0; i < activeWidth * 3; i++) {
-                *outputLine++ = static_cast<uchar>((*inputLine++) / 256);
-            }
-        }
+        // Convert component video straight into the active area of the RGB888 QImage
+        uchar *activeArea = frameImage.scanLine(videoParameters.firstActiveFrameLine)
+                            + (videoParameters.activeVideoStart * 3);
+        outputWriter.convertRgb888(componentFrames[0], activeArea, frameImage.bytesPerLine());
     } else {
         // Load SourceFields for the current frame
         loadInputFields();
@@ -757,23 +934,14 @@ QImage TbcSource::generateQImage()
         const quint16 *firstFieldPointer = inputFields[inputStartIndex].data.data();
         const quint16 *secondFieldPointer = inputFields[inputStartIndex + 1].data.data();
 
-        // Copy the raw 16-bit grayscale data into the RGB888 QImage
+        // Copy the raw 16-bit grayscale data into the RGB888 QImage,
+        // interleaving the lines of the two fields
+        uchar *imageData = frameImage.bits();
+        const qint32 bytesPerLine = frameImage.bytesPerLine();
         for (qint32 y = 0; y < frameHeight; y++) {
-            for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
-                // Take just the MSB of the input data
-                qint32 pixelOffset = (videoParameters.fieldWidth * (y / 2)) + x;
-                uchar pixelValue;
-                if (y % 2) {
-                    pixelValue = static_cast<uchar>(secondFieldPointer[pixelOffset] / 256);
-                } else {
-                    pixelValue = static_cast<uchar>(firstFieldPointer[pixelOffset] / 256);
-                }
-
-                qint32 xpp = x * 3;
-                *(frameImage.scanLine(y) + xpp + 0) = static_cast<uchar>(pixelValue); // R
-                *(frameImage.scanLine(y) + xpp + 1) = static_cast<uchar>(pixelValue); // G
-                *(frameImage.scanLine(y) + xpp + 2) = static_cast<uchar>(pixelValue); // B
-            }
+            const quint16 *fieldPointer = (y % 2) ? secondFieldPointer : firstFieldPointer;
+            greyLineToRgb888(fieldPointer + (videoParameters.fieldWidth * (y / 2)),
+                             imageData + (y * bytesPerLine), videoParameters.fieldWidth);
         }
     }
 
@@ -31,6 +31,14 @@
 #include <QPainter>
 #include <QtConcurrent/QtConcurrent>
 #include <QDebug>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <memory>
+#include <vector>
 
 // TBC library includes
 #include "sourcevideo.h"
@@ -51,6 +59,7 @@ class TbcSource : public QObject
     Q_OBJECT
 public:
     explicit TbcSource(QObject *parent = nullptr);
+    ~TbcSource();
 
     struct ScanLineData {
         QString systemDescription;
@@ -191,7 +200,6 @@ private:
 
     // Source fields needed to decode the loaded frame
     QVector<SourceField> inputFields;
-    QVector<SourceField> chromaInputFields;
     qint32 inputStartIndex, inputEndIndex;
     bool inputFieldsValid;
 
@@ -211,11 +219,44 @@ private:
     // Chapter map
     QVector<qint32> chapterMap;
 
+    // Decoded frames are kept in an LRU cache, so stepping back and forth
+    // doesn't decode the same frames again. Frames near the loaded frame are
+    // decoded in the background, each worker using its own decoder.
+    static constexpr qint32 DECODED_CACHE_FRAMES = 8;
+    static constexpr qint32 PREFETCH_DISTANCE = 2;
+
+    struct FrameDecoder {
+        PalColour palColour;
+        Comb ntscColour;
+    };
+
+    // Guards sourceVideo and chromaSourceVideo
+    QMutex sourceMutex;
+
+    // Guards the cache and prefetch state below
+    QMutex decodedCacheMutex;
+    QWaitCondition prefetchFinished;
+    QCache<qint32, ComponentFrame> decodedFrameCache;
+    QSet<qint32> prefetchPending;
+    qint32 prefetchCentre;
+    std::vector<std::unique_ptr<FrameDecoder>> prefetchDecoders;
+    QVector<FrameDecoder *> freeDecoders;
+    bool prefetchDecodersConfigured;
+
+    // Declared last, so it's destroyed (waiting for any running workers)
+    // before the state the workers use
+    QThreadPool prefetchPool;
+
     void resetState();
     void invalidateFrameCache();
+    void clearDecodedFrames();
     void configureChromaDecoder();
+    void configurePrefetchDecoders();
+    void loadSourceFields(qint32 frameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
     void loadInputFields();
     void decodeFrame();
+    void prefetchNearbyFrames();
+    void prefetchFrame(qint32 frameNumber);
     QImage generateQImage();
     void generateData();
     bool startBackgroundLoad(QString sourceFilename);
@@ -31,6 +31,25 @@
 
 #include <QDebug>
 #include <QPainter>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+// Scope size and scale
+static constexpr qint32 SIZE = 1024;
+static constexpr qint32 SCALE = 65536 / SIZE;
+static constexpr qint32 HALF_SIZE = SIZE / 2;
+
+// Size of the tiles that band histograms track changes in
+static constexpr qint32 TILE_SIZE = 32;
+static constexpr qint32 TILES = SIZE / TILE_SIZE;
+
+// Smallest number of samples worth giving a band of its own
+static constexpr qint64 MIN_BAND_SAMPLES = 64 * 1024;
+
+VectorscopeDialog::BandHistogram::BandHistogram()
+    : counts(SIZE * SIZE, 0), touchedTiles(TILES * TILES, 0)
+{
+}
 
 VectorscopeDialog::VectorscopeDialog(QWidget *parent) :
     QDialog(parent),
@@ -38,141 +57,294 @@ VectorscopeDialog::VectorscopeDialog(QWidget *parent) :
 {
     ui->setupUi(this);
     setWindowFlags(Qt::Window);
+
+    requestPending = false;
+    clearPending = false;
+    connect(&watcher, &QFutureWatcher<QImage>::finished, this, &VectorscopeDialog::finishTraceImage);
 }
 
 VectorscopeDialog::~VectorscopeDialog()
 {
+    // Wait for the worker, since it uses our state
+    watcher.waitForFinished();
+
     delete ui;
 }
 
-void VectorscopeDialog::showTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters)
+void VectorscopeDialog::showTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters,
+                                       qint32 frameNumber)
 {
     qDebug() << "VectorscopeDialog::showTraceImage(): Called";
 
-    // Draw the image
-    QImage traceImage = getTraceImage(componentFrame, videoParameters);
+    // Collect the settings from the GUI, as the worker can't use it
+    pendingRequest.componentFrame = componentFrame;
+    pendingRequest.videoParameters = videoParameters;
+    pendingRequest.frameNumber = frameNumber;
+    pendingRequest.accumulateFrames = ui->accumulateSpinBox->value();
+    pendingRequest.defocus = ui->defocusCheckBox->isChecked();
+    pendingRequest.showGraticule = !ui->graticuleNoneRadioButton->isChecked();
+    pendingRequest.graticulePercent = ui->graticule75RadioButton->isChecked() ? 0.75 : 1.0;
+    requestPending = true;
+
+    // If the worker's busy, this will be picked up when it finishes
+    if (!watcher.isRunning()) startTraceImage();
+}
+
+// Discard the histograms of previous frames, because the decoded frames have changed
+void VectorscopeDialog::clearAccumulation()
+{
+    clearPending = true;
+}
+
+// Start the worker drawing the scope for the pending request
+void VectorscopeDialog::startTraceImage()
+{
+    // The worker isn't running, so it's safe to change its state
+    if (clearPending) {
+        frameHistograms.clear();
+        clearPending = false;
+    }
 
+    const TraceRequest request = pendingRequest;
+    requestPending = false;
+
+    watcher.setFuture(QtConcurrent::run([this, request]() {
+        return getTraceImage(request);
+    }));
+}
+
+// Show the image once the worker has finished
+void VectorscopeDialog::finishTraceImage()
+{
     // Add the QImage to the QLabel in the dialogue
     ui->scopeLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     ui->scopeLabel->setAlignment(Qt::AlignCenter);
     ui->scopeLabel->setScaledContents(true);
-    ui->scopeLabel->setPixmap(QPixmap::fromImage(traceImage));
+    ui->scopeLabel->setPixmap(QPixmap::fromImage(watcher.result()));
 
     // QT Bug workaround for some macOS versions
     #if defined(Q_OS_MACOS)
     	repaint();
     #endif
+
+    // Start on the next frame, if one arrived while we were busy
+    if (requestPending) startTraceImage();
 }
 
-QImage VectorscopeDialog::getTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters)
+// Draw the scope image (called by the worker)
+QImage VectorscopeDialog::getTraceImage(const TraceRequest &request)
 {
-    // Scope size and scale
-    constexpr qint32 SIZE = 1024;
-    constexpr qint32 SCALE = 65536 / SIZE;
-    constexpr qint32 HALF_SIZE = SIZE / 2;
+    // Get the histogram for this frame, and keep it along with those of the
+    // frames shown just before it. This accumulates the frames the dialog has
+    // actually been given, which aren't necessarily consecutive (e.g. after
+    // seeking, or when frames are skipped during playback). If this frame
+    // was already being shown, its old histogram is replaced.
+    for (qint32 i = 0; i < frameHistograms.size(); i++) {
+        if (frameHistograms[i].frameNumber == request.frameNumber) {
+            frameHistograms.remove(i);
+            break;
+        }
+    }
+    frameHistograms.append({request.frameNumber, getFrameHistogram(request)});
+    while (frameHistograms.size() > request.accumulateFrames) frameHistograms.removeFirst();
+
+    // Sum the histograms, starting from the current frame's
+    Histogram total = frameHistograms.last().histogram;
+    for (qint32 frame = 0; frame < frameHistograms.size() - 1; frame++) {
+        const quint32 *in = frameHistograms[frame].histogram.constData();
+        quint32 *out = total.data();
+        for (qint32 i = 0; i < SIZE * SIZE; i++) {
+            out[i] += in[i];
+        }
+    }
 
-    // Define image with width, height and format
+    // Plot the density of samples at each point in green, on a log scale
+    // normalised by the number of frames, so that a point hit once in a
+    // single frame is mid-green
     QImage scopeImage(SIZE, SIZE, QImage::Format_RGB888);
-    QPainter scopePainter;
+    const double numFrames = frameHistograms.size();
+    for (qint32 y = 0; y < SIZE; y++) {
+        const quint32 *counts = total.constData() + (y * SIZE);
+        uchar *outputLine = scopeImage.scanLine(y);
+
+        for (qint32 x = 0; x < SIZE; x++) {
+            uchar level = 0;
+            if (counts[x] != 0) {
+                const double density = counts[x] / numFrames;
+                level = static_cast<uchar>(qBound(32, static_cast<qint32>(128.0 + (32.0 * std::log2(density))), 255));
+            }
+            outputLine[(x * 3) + 0] = 0;
+            outputLine[(x * 3) + 1] = level;
+            outputLine[(x * 3) + 2] = 0;
+        }
+    }
 
-    // Set the background to black
-    scopeImage.fill(Qt::black);
+    // Overlay the graticule, unless it's disabled
+    if (request.showGraticule) drawGraticule(scopeImage, request);
 
-    // Attach the scope image to the painter
-    scopePainter.begin(&scopeImage);
+    return scopeImage;
+}
+
+// Count the U/V values of the samples in active lines [firstLine, lastLine),
+// adding to the band's histogram and marking the tiles that were touched
+void VectorscopeDialog::accumulateLines(const TraceRequest &request, qint32 firstLine, qint32 lastLine, BandHistogram &band)
+{
+    const LdDecodeMetaData::VideoParameters &videoParameters = request.videoParameters;
 
     // Initialise a cheap, predictable random number generator, for defocussing
-    std::minstd_rand randomEngine(12345);
+    std::minstd_rand randomEngine(12345 + firstLine);
     std::normal_distribution<double> normalDist(0.0, 100.0);
 
-    // For each sample in the active area, plot its U/V values on the chart
-    scopePainter.setPen(Qt::green);
-    bool defocus = ui->defocusCheckBox->isChecked();
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
-        const auto &uLine = componentFrame.u(lineNumber);
-        const auto &vLine = componentFrame.v(lineNumber);
+    quint32 *counts = band.counts.data();
+    quint8 *touchedTiles = band.touchedTiles.data();
+    for (qint32 lineNumber = firstLine; lineNumber < lastLine; lineNumber++) {
+        const double *uLine = request.componentFrame.u(lineNumber);
+        const double *vLine = request.componentFrame.v(lineNumber);
 
         for (qint32 xPosition = videoParameters.activeVideoStart; xPosition < videoParameters.activeVideoEnd; xPosition++) {
             // If defocussing, add a random (but normally-distributed) value to U/V
-            double uOffset = defocus ? normalDist(randomEngine) : 0.0;
-            double vOffset = defocus ? normalDist(randomEngine) : 0.0;
+            double uOffset = request.defocus ? normalDist(randomEngine) : 0.0;
+            double vOffset = request.defocus ? normalDist(randomEngine) : 0.0;
 
             // On a real vectorscope, U is positive to the right, and V is positive *upwards*
             qint32 x = HALF_SIZE + (static_cast<qint32>(uLine[xPosition] + uOffset) / SCALE);
             qint32 y = HALF_SIZE - (static_cast<qint32>(vLine[xPosition] + vOffset) / SCALE);
 
-            scopePainter.drawPoint(x, y);
+            if (x >= 0 && x < SIZE && y >= 0 && y < SIZE) {
+                counts[(y * SIZE) + x]++;
+                touchedTiles[((y / TILE_SIZE) * TILES) + (x / TILE_SIZE)] = 1;
+            }
         }
     }
+}
 
-    // Overlay the graticule, unless it's disabled
-    if (!ui->graticuleNoneRadioButton->isChecked()) {
-        scopePainter.setPen(Qt::white);
-
-        // Draw the vertical/horizontal graticule lines and circle
-        scopePainter.drawLine(HALF_SIZE, 0, HALF_SIZE, SIZE - 1);
-        scopePainter.drawLine(0, HALF_SIZE, SIZE - 1, HALF_SIZE);
-        scopePainter.drawEllipse(0, 0, SIZE - 1, SIZE - 1);
-
-        // For NTSC: draw I/Q graticule lines, 33 degrees offset from the axes
-        if (videoParameters.system == NTSC) {
-            double theta = (-33.0 * M_PI) / 180;
-            for (qint32 i = 0; i < 4; i++) {
-                scopePainter.drawLine(HALF_SIZE + (0.2 * HALF_SIZE * cos(theta)),
-                                      HALF_SIZE + (0.2 * HALF_SIZE * sin(theta)),
-                                      HALF_SIZE + (HALF_SIZE * cos(theta)),
-                                      HALF_SIZE + (HALF_SIZE * sin(theta)));
-                theta += M_PI / 2.0;
+// Count the U/V values of the samples in the active area of a frame.
+// The lines are split into bands, each counted into its own histogram on a
+// separate thread, and then the tiles the bands touched are merged.
+VectorscopeDialog::Histogram VectorscopeDialog::getFrameHistogram(const TraceRequest &request)
+{
+    const LdDecodeMetaData::VideoParameters &videoParameters = request.videoParameters;
+    const qint32 firstLine = videoParameters.firstActiveFrameLine;
+    const qint32 numLines = videoParameters.lastActiveFrameLine - firstLine;
+    const qint64 numSamples = static_cast<qint64>(qMax(numLines, 0))
+                              * qMax(videoParameters.activeVideoEnd - videoParameters.activeVideoStart, 0);
+
+    // Only split the frame up as far as there are samples to keep each band busy
+    const qint32 numBands = static_cast<qint32>(qBound<qint64>(1, qMin<qint64>(QThread::idealThreadCount(),
+                                                                                numSamples / MIN_BAND_SAMPLES),
+                                                               qMax(numLines, 1)));
+    if (bandHistograms.size() < numBands) bandHistograms.resize(numBands);
+
+    auto countBand = [&](qint32 band) {
+        accumulateLines(request, firstLine + ((numLines * band) / numBands),
+                        firstLine + ((numLines * (band + 1)) / numBands), bandHistograms[band]);
+    };
+
+    // Run the other bands in the pool, and the first on this thread
+    QVector<QFuture<void>> futures;
+    for (qint32 band = 1; band < numBands; band++) {
+        futures.append(QtConcurrent::run(&bandPool, [&countBand, band] { countBand(band); }));
+    }
+    countBand(0);
+    for (QFuture<void> &future : futures) future.waitForFinished();
+
+    // Merge the touched tiles of each band, clearing them ready for the next frame
+    Histogram histogram(SIZE * SIZE, 0);
+    quint32 *out = histogram.data();
+    for (qint32 band = 0; band < numBands; band++) {
+        quint32 *in = bandHistograms[band].counts.data();
+        quint8 *touchedTiles = bandHistograms[band].touchedTiles.data();
+
+        for (qint32 tile = 0; tile < TILES * TILES; tile++) {
+            if (touchedTiles[tile] == 0) continue;
+            touchedTiles[tile] = 0;
+
+            const qint32 tileStart = ((tile / TILES) * TILE_SIZE * SIZE) + ((tile % TILES) * TILE_SIZE);
+            for (qint32 row = 0; row < TILE_SIZE; row++) {
+                const qint32 rowStart = tileStart + (row * SIZE);
+                for (qint32 i = rowStart; i < rowStart + TILE_SIZE; i++) {
+                    out[i] += in[i];
+                    in[i] = 0;
+                }
             }
         }
+    }
 
-        // Scaling factor for which graticule
-        const double percent = ui->graticule75RadioButton->isChecked() ? 0.75 : 1.0;
-
-        // Draw graticule targets for the six colour bars
-        for (qint32 rgb = 1; rgb < 7; rgb++) {
-            // R'G'B' for this bar
-            const double R = percent * static_cast<double>((rgb >> 2) & 1);
-            const double G = percent * static_cast<double>((rgb >> 1) & 1);
-            const double B = percent * static_cast<double>(rgb & 1);
-
-            // Convert R'G'B' to Y'UV [Poynton p337 eq 28.5]
-            const double U = (R * -0.147141) + (G * -0.288869) + (B * 0.436010);
-            const double V = (R * 0.614975)  + (G * -0.514965) + (B * -0.100010);
-
-            // Convert to angle and magnitude, scaled to match scope coords
-            const double barTheta = atan2(-V, U);
-            const double barMag = sqrt((V * V) + (U * U)) * (videoParameters.white16bIre - videoParameters.black16bIre) / SCALE;
-
-            // Draw the target grid, with 10 degree angle and 10% magnitude steps
-            const double stepTheta = (10.0 * M_PI) / 180.0;
-            const double stepMag = 0.1 * barMag;
-            for (qint32 step = -1; step < 2; step++) {
-                // XXX These should really be curved lines
-                const double theta = barTheta + (step * stepTheta);
-                scopePainter.drawLine(HALF_SIZE + ((barMag - stepMag) * cos(theta)), HALF_SIZE + ((barMag - stepMag) * sin(theta)),
-                                      HALF_SIZE + ((barMag + stepMag) * cos(theta)), HALF_SIZE + ((barMag + stepMag) * sin(theta)));
-            }
-            for (qint32 step = -1; step < 2; step++) {
-                const double mag = barMag + (step * stepMag);
-                scopePainter.drawLine(HALF_SIZE + (mag * cos(barTheta - stepTheta)), HALF_SIZE + (mag * sin(barTheta - stepTheta)),
-                                      HALF_SIZE + (mag * cos(barTheta + stepTheta)), HALF_SIZE + (mag * sin(barTheta + stepTheta)));
+    return histogram;
+}
 
-            }
+// Draw the graticule over the scope image
+void VectorscopeDialog::drawGraticule(QImage &scopeImage, const TraceRequest &request)
+{
+    const LdDecodeMetaData::VideoParameters &videoParameters = request.videoParameters;
+
+    QPainter scopePainter;
+    scopePainter.begin(&scopeImage);
+    scopePainter.setPen(Qt::white);
+
+    // Draw the vertical/horizontal graticule lines and circle
+    scopePainter.drawLine(HALF_SIZE, 0, HALF_SIZE, SIZE - 1);
+    scopePainter.drawLine(0, HALF_SIZE, SIZE - 1, HALF_SIZE);
+    scopePainter.drawEllipse(0, 0, SIZE - 1, SIZE - 1);
+
+    // For NTSC: draw I/Q graticule lines, 33 degrees offset from the axes
+    if (videoParameters.system == NTSC) {
+        double theta = (-33.0 * M_PI) / 180;
+        for (qint32 i = 0; i < 4; i++) {
+            scopePainter.drawLine(HALF_SIZE + (0.2 * HALF_SIZE * cos(theta)),
+                                  HALF_SIZE + (0.2 * HALF_SIZE * sin(theta)),
+                                  HALF_SIZE + (HALF_SIZE * cos(theta)),
+                                  HALF_SIZE + (HALF_SIZE * sin(theta)));
+            theta += M_PI / 2.0;
+        }
+    }
+
+    // Scaling factor for which graticule
+    const double percent = request.graticulePercent;
+
+    // Draw graticule targets for the six colour bars
+    for (qint32 rgb = 1; rgb < 7; rgb++) {
+        // R'G'B' for this bar
+        const double R = percent * static_cast<double>((rgb >> 2) & 1);
+        const double G = percent * static_cast<double>((rgb >> 1) & 1);
+        const double B = percent * static_cast<double>(rgb & 1);
+
+        // Convert R'G'B' to Y'UV [Poynton p337 eq 28.5]
+        const double U = (R * -0.147141) + (G * -0.288869) + (B * 0.436010);
+        const double V = (R * 0.614975)  + (G * -0.514965) + (B * -0.100010);
+
+        // Convert to angle and magnitude, scaled to match scope coords
+        const double barTheta = atan2(-V, U);
+        const double barMag = sqrt((V * V) + (U * U)) * (videoParameters.white16bIre - videoParameters.black16bIre) / SCALE;
+
+        // Draw the target grid, with 10 degree angle and 10% magnitude steps
+        const double stepTheta = (10.0 * M_PI) / 180.0;
+        const double stepMag = 0.1 * barMag;
+        for (qint32 step = -1; step < 2; step++) {
+            // XXX These should really be curved lines
+            const double theta = barTheta + (step * stepTheta);
+            scopePainter.drawLine(HALF_SIZE + ((barMag - stepMag) * cos(theta)), HALF_SIZE + ((barMag - stepMag) * sin(theta)),
+                                  HALF_SIZE + ((barMag + stepMag) * cos(theta)), HALF_SIZE + ((barMag + stepMag) * sin(theta)));
         }
+        for (qint32 step = -1; step < 2; step++) {
+            const double mag = barMag + (step * stepMag);
+            scopePainter.drawLine(HALF_SIZE + (mag * cos(barTheta - stepTheta)), HALF_SIZE + (mag * sin(barTheta - stepTheta)),
+                                  HALF_SIZE + (mag * cos(barTheta + stepTheta)), HALF_SIZE + (mag * sin(barTheta + stepTheta)));
 
-        // XXX Draw a line for the colourburst -- we don't decode it at the moment
+        }
     }
 
-    // Return the QImage
+    // XXX Draw a line for the colourburst -- we don't decode it at the moment
+
     scopePainter.end();
-    return scopeImage;
 }
 
 // GUI signal handlers ------------------------------------------------------------------------------------------------
 
 void VectorscopeDialog::on_defocusCheckBox_clicked()
 {
+    // The previous frames' histograms were plotted with the old setting
+    clearAccumulation();
     emit scopeChanged();
 }
 
@@ -181,3 +353,9 @@ void VectorscopeDialog::on_graticuleButtonGroup_buttonClicked(QAbstractButton *b
     (void) button;
     emit scopeChanged();
 }
+
+void VectorscopeDialog::on_accumulateSpinBox_valueChanged(int arg1)
+{
+    (void) arg1;
+    emit scopeChanged();
+}
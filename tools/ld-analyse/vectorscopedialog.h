@@ -28,6 +28,10 @@
 #include <QAbstractButton>
 #include <QGraphicsPixmapItem>
 #include <QDialog>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QThreadPool>
+#include <QVector>
 
 #include "componentframe.h"
 #include "lddecodemetadata.h"
@@ -44,7 +48,9 @@ public:
     explicit VectorscopeDialog(QWidget *parent = nullptr);
     ~VectorscopeDialog();
 
-    void showTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters);
+    void showTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters,
+                        qint32 frameNumber);
+    void clearAccumulation();
 
 signals:
     void scopeChanged();
@@ -52,11 +58,60 @@ signals:
 private slots:
     void on_defocusCheckBox_clicked();
     void on_graticuleButtonGroup_buttonClicked(QAbstractButton *button);
+    void on_accumulateSpinBox_valueChanged(int arg1);
+    void finishTraceImage();
 
 private:
     Ui::VectorscopeDialog *ui;
 
-    QImage getTraceImage(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters);
+    // Number of samples plotted at each point of the scope
+    using Histogram = QVector<quint32>;
+
+    // Everything the worker needs to draw the scope for a frame.
+    // (ComponentFrame shares its data, so this is cheap to copy.)
+    struct TraceRequest {
+        ComponentFrame componentFrame;
+        LdDecodeMetaData::VideoParameters videoParameters;
+        qint32 frameNumber;
+        qint32 accumulateFrames;
+        bool defocus;
+        bool showGraticule;
+        double graticulePercent;
+    };
+
+    // The scope is drawn by a background worker. While it's busy, only the
+    // most recent request is kept, so the display can't fall behind.
+    QFutureWatcher<QImage> watcher;
+    TraceRequest pendingRequest;
+    bool requestPending;
+
+    // Histograms for the most recently shown frames, oldest first, for
+    // accumulating over several frames. Only used by the worker while it's
+    // running.
+    struct FrameHistogram {
+        qint32 frameNumber;
+        Histogram histogram;
+    };
+    QVector<FrameHistogram> frameHistograms;
+    bool clearPending;
+
+    // A frame's lines are counted in bands, in parallel. Each band has its
+    // own histogram, which is kept between frames; it records which tiles
+    // of the histogram it has touched, so only those need merging and
+    // clearing afterwards. Only used by the worker while it's running.
+    struct BandHistogram {
+        BandHistogram();
+        Histogram counts;
+        QVector<quint8> touchedTiles;
+    };
+    QVector<BandHistogram> bandHistograms;
+    QThreadPool bandPool;
+
+    void startTraceImage();
+    QImage getTraceImage(const TraceRequest &request);
+    static void accumulateLines(const TraceRequest &request, qint32 firstLine, qint32 lastLine, BandHistogram &band);
+    Histogram getFrameHistogram(const TraceRequest &request);
+    static void drawGraticule(QImage &scopeImage, const TraceRequest &request);
 };
 
 #endif // VECTORSCOPEDIALOG_H
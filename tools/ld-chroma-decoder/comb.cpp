@@ -29,6 +29,7 @@
 
 #include "framecanvas.h"
 
+#include "coringfilter.h"
 #include "deemp.h"
 #include "firfilter.h"
 
@@ -36,7 +37,6 @@
 #include <cmath>
 #include <memory>
 #include <utility>
-#include <vector>
 
 // Indexes for the candidates considered in 3D adaptive mode
 enum CandidateIndex : qint32 {
@@ -638,23 +638,16 @@ void Comb::FrameBuffer::splitIQ()
 // Filter the IQ from the component frame
 void Comb::FrameBuffer::filterIQ()
 {
-    auto iqFilter = makeFIRFilter(c_colorlp_b);
+    static constexpr auto iqFilter = makeFIRFilter(c_colorlp_b);
 
-    // Temporary output buffer for the filter
     const int width = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
-    std::vector<double> tempBuf(width);
-
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         double *I = componentFrame->u(lineNumber) + videoParameters.activeVideoStart;
         double *Q = componentFrame->v(lineNumber) + videoParameters.activeVideoStart;
 
-        // Apply filter to I
-        iqFilter.apply(I, tempBuf.data(), width);
-        std::copy(tempBuf.begin(), tempBuf.end(), I);
-
-        // Apply filter to Q
-        iqFilter.apply(Q, tempBuf.data(), width);
-        std::copy(tempBuf.begin(), tempBuf.end(), Q);
+        // Apply filter to I and Q in place
+        iqFilter.apply(I, width);
+        iqFilter.apply(Q, width);
     }
 }
 
@@ -702,53 +695,13 @@ void Comb::FrameBuffer::doCNR()
     // nr_c is the coring level
     const double nr_c = configuration.cNRLevel * irescale;
 
-    // High-pass filters for I/Q
-    auto iFilter(f_nrc);
-    auto qFilter(f_nrc);
-
-    // Filter delay (since it's a symmetric FIR filter)
-    const qint32 delay = c_nrc_b.size() / 2;
-
-    // High-pass result
-    // TODO: Cache arrays instead of reallocating every field.
-    std::vector<double> hpI(videoParameters.activeVideoEnd + delay);
-    std::vector<double> hpQ(videoParameters.activeVideoEnd + delay);
-
+    // High-pass filter for I/Q
+    static constexpr auto iqFilter = makeCoringFilter(c_nrc_b);
 
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
-        double *I = componentFrame->u(lineNumber);
-        double *Q = componentFrame->v(lineNumber);
-
-        // Feed zeros into the filter outside the active area
-        for (qint32 h = videoParameters.activeVideoStart - delay; h < videoParameters.activeVideoStart; h++) {
-            iFilter.feed(0.0);
-            qFilter.feed(0.0);
-        }
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            hpI[h] = iFilter.feed(I[h]);
-            hpQ[h] = qFilter.feed(Q[h]);
-        }
-        for (qint32 h = videoParameters.activeVideoEnd; h < videoParameters.activeVideoEnd + delay; h++) {
-            hpI[h] = iFilter.feed(0.0);
-            hpQ[h] = qFilter.feed(0.0);
-        }
-
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            // Offset to cover the filter delay
-            double ai = hpI[h + delay];
-            double aq = hpQ[h + delay];
-
-            // Clip the filter strength
-            if (fabs(ai) > nr_c) {
-                ai = (ai > 0) ? nr_c : -nr_c;
-            }
-            if (fabs(aq) > nr_c) {
-                aq = (aq > 0) ? nr_c : -nr_c;
-            }
-
-            I[h] -= ai;
-            Q[h] -= aq;
-        }
+        iqFilter.apply(componentFrame->u(lineNumber) + videoParameters.activeVideoStart, activeWidth, nr_c);
+        iqFilter.apply(componentFrame->v(lineNumber) + videoParameters.activeVideoStart, activeWidth, nr_c);
     }
 }
 
@@ -760,39 +713,11 @@ void Comb::FrameBuffer::doYNR()
     double nr_y = configuration.yNRLevel * irescale;
 
     // High-pass filter for Y
-    auto yFilter(f_nr);
-
-    // Filter delay (since it's a symmetric FIR filter)
-    const qint32 delay = c_nr_b.size() / 2;
-
-    // High-pass result
-    std::vector<double> hpY(videoParameters.activeVideoEnd + delay);
+    static constexpr auto yFilter = makeCoringFilter(c_nr_b);
 
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
-        double *Y = componentFrame->y(lineNumber);
-
-        // Feed zeros into the filter outside the active area
-        for (qint32 h = videoParameters.activeVideoStart - delay; h < videoParameters.activeVideoStart; h++) {
-            yFilter.feed(0.0);
-        }
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            hpY[h] = yFilter.feed(Y[h]);
-        }
-        for (qint32 h = videoParameters.activeVideoEnd; h < videoParameters.activeVideoEnd + delay; h++) {
-            hpY[h] = yFilter.feed(0.0);
-        }
-
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            // Offset to cover the filter delay
-            double a = hpY[h + delay];
-
-            // Clip the filter strength
-            if (fabs(a) > nr_y) {
-                a = (a > 0) ? nr_y : -nr_y;
-            }
-
-            Y[h] -= a;
-        }
+        yFilter.apply(componentFrame->y(lineNumber) + videoParameters.activeVideoStart, activeWidth, nr_y);
     }
 }
 
@@ -64,6 +64,15 @@ void DecoderThread::run()
         // Decode the fields to component frames
         decodeFrames(inputFields, startIndex, endIndex, componentFrames);
 
+        if (decoderPool.isWritingToSharedMemory()) {
+            // Convert the frames into the shared memory output
+            if (!decoderPool.putSharedFrames(startFrameNumber, componentFrames, outputFrames)) {
+                abort = true;
+                break;
+            }
+            continue;
+        }
+
         // Convert the component frames to the output format
         for (qint32 i = 0; i < numFrames; i++) {
             outputWriter.convert(componentFrames[i], outputFrames[i]);
@@ -26,13 +26,17 @@
 
 #include "decoderpool.h"
 
-DecoderPool::DecoderPool(Decoder &_decoder, QString _inputFileName,
+#include <cstring>
+
+DecoderPool::DecoderPool(Decoder &_decoder, QString _decoderDescription, QString _inputFileName,
                          LdDecodeMetaData &_ldDecodeMetaData,
                          OutputWriter::Configuration &_outputConfig, QString _outputFileName,
-                         qint32 _startFrame, qint32 _length, qint32 _maxThreads)
-    : decoder(_decoder), inputFileName(_inputFileName),
+                         qint32 _startFrame, qint32 _length, qint32 _maxThreads, bool _resume,
+                         QString _sharedMemoryKey)
+    : decoder(_decoder), decoderDescription(_decoderDescription), inputFileName(_inputFileName),
       outputConfig(_outputConfig), outputFileName(_outputFileName),
-      startFrame(_startFrame), length(_length), maxThreads(_maxThreads),
+      startFrame(_startFrame), length(_length), maxThreads(_maxThreads), resume(_resume),
+      sharedMemoryKey(_sharedMemoryKey),
       abort(false), ldDecodeMetaData(_ldDecodeMetaData)
 {
 }
@@ -79,8 +83,48 @@ bool DecoderPool::process()
         }
     }
 
+    // Periodically save a checkpoint when writing to a file, so an
+    // interrupted run can be resumed
+    useCheckpoints = (outputFileName != "-") && sharedMemoryKey.isEmpty();
+    checkpointFileName = Checkpoint::getCheckpointFileName(outputFileName);
+    firstOutputFrameNumber = startFrame;
+    bool resumed = false;
+
+    // Once the ring has been created, the consumer must always be told that
+    // the stream has ended, or it will wait forever. If we return before
+    // finishing the stream normally, this tells it that we gave up.
+    struct RingFinisher {
+        SharedFrameRing *ring = nullptr;
+        ~RingFinisher() {
+            if (ring != nullptr) ring->abort();
+        }
+        bool finish() {
+            SharedFrameRing *finishing = ring;
+            ring = nullptr;
+            return finishing->finish();
+        }
+    } ringFinisher;
+
     // Open the output file
-    if (outputFileName == "-") {
+    if (!sharedMemoryKey.isEmpty()) {
+        // Publish frames through shared memory; the stream and frame headers
+        // go in the ring's header for the consumer to use
+        SharedFrameRing::Format format;
+        format.width = outputWriter.getOutputWidth();
+        format.height = outputWriter.getOutputHeight();
+        format.pixelFormat = outputWriter.getPixelFormat();
+        format.frameSize = outputWriter.getFrameSize() * static_cast<qint32>(sizeof(quint16));
+        format.streamHeader = outputWriter.getStreamHeader();
+        format.frameHeader = outputWriter.getFrameHeader();
+
+        sharedRing.reset(new SharedFrameRing(sharedMemoryKey));
+        if (!sharedRing->create(format)) {
+            sourceVideo.close();
+            return false;
+        }
+        ringFinisher.ring = sharedRing.get();
+        qInfo() << "Writing output to shared memory" << sharedMemoryKey;
+    } else if (outputFileName == "-") {
         // No output filename, use stdout instead
         if (!targetVideo.open(stdout, QIODevice::WriteOnly)) {
             // Failed to open stdout
@@ -89,7 +133,29 @@ bool DecoderPool::process()
             return false;
         }
         qInfo() << "Writing output to stdout";
+    } else if (resume && QFile::exists(checkpointFileName)) {
+        // Continue the output file from the last checkpoint
+        targetVideo.setFileName(outputFileName);
+        Checkpoint checkpoint;
+        if (!checkpoint.read(checkpointFileName)) {
+            sourceVideo.close();
+            return false;
+        }
+        if (checkpoint.job != getCheckpointJob()) {
+            qCritical() << "Checkpoint" << checkpointFileName << "is for a different job - cannot resume";
+            sourceVideo.close();
+            return false;
+        }
+        if (!checkpoint.openOutput(targetVideo)) {
+            sourceVideo.close();
+            return false;
+        }
+        firstOutputFrameNumber = checkpoint.nextNumber;
+        resumed = true;
+        qInfo() << "Resuming from frame #" << firstOutputFrameNumber;
     } else {
+        if (resume) qInfo() << "No checkpoint found, starting from the beginning";
+
         // Open output file
         targetVideo.setFileName(outputFileName);
         if (!targetVideo.open(QIODevice::WriteOnly)) {
@@ -100,9 +166,9 @@ bool DecoderPool::process()
         }
     }
 
-    // Write the stream header (if there is one)
+    // Write the stream header (if there is one, and we're not resuming after it)
     const QByteArray streamHeader = outputWriter.getStreamHeader();
-    if (streamHeader.size() != 0 && targetVideo.write(streamHeader) == -1) {
+    if (!sharedRing && !resumed && streamHeader.size() != 0 && targetVideo.write(streamHeader) == -1) {
         qCritical() << "Writing to the output video file failed";
         return false;
     }
@@ -111,10 +177,11 @@ bool DecoderPool::process()
     qInfo() << "Processing from start frame #" << startFrame << "with a length of" << length << "frames";
 
     // Initialise processing state
-    inputFrameNumber = startFrame;
-    outputFrameNumber = startFrame;
+    inputFrameNumber = firstOutputFrameNumber;
+    outputFrameNumber = firstOutputFrameNumber;
     lastFrameNumber = length + (startFrame - 1);
     totalTimer.start();
+    checkpointTimer.start();
 
     // Start a vector of filtering threads to process the video
     QVector<QThread *> threads;
@@ -130,6 +197,13 @@ bool DecoderPool::process()
         delete threads[i];
     }
 
+    // Tell the consumer there are no more frames (if a thread aborted,
+    // ringFinisher will tell it that the stream is incomplete instead)
+    if (sharedRing && !abort && !ringFinisher.finish()) {
+        qCritical() << "Finishing the shared memory output failed";
+        abort = true;
+    }
+
     // Did any of the threads abort?
     if (abort) {
         sourceVideo.close();
@@ -146,9 +220,10 @@ bool DecoderPool::process()
         return false;
     }
 
+    const qint32 processedFrames = lastFrameNumber + 1 - firstOutputFrameNumber;
     double totalSecs = (static_cast<double>(totalTimer.elapsed()) / 1000.0);
-    qInfo() << "Processing complete -" << length << "frames in" << totalSecs << "seconds (" <<
-               length / totalSecs << "FPS )";
+    qInfo() << "Processing complete -" << processedFrames << "frames in" << totalSecs << "seconds (" <<
+               processedFrames / totalSecs << "FPS )";
 
     // Close the source video
     sourceVideo.close();
@@ -156,6 +231,9 @@ bool DecoderPool::process()
     // Close the target video
     targetVideo.close();
 
+    // The output is complete, so the checkpoint is no longer needed
+    if (useCheckpoints && !Checkpoint::remove(checkpointFileName)) return false;
+
     return true;
 }
 
@@ -233,14 +311,121 @@ bool DecoderPool::putOutputFrame(qint32 frameNumber, const OutputFrame &outputFr
 
         pendingOutputFrames.remove(outputFrameNumber);
         outputFrameNumber++;
+        showProgress();
+    }
+
+    // Save a checkpoint if it's time for another one
+    if (useCheckpoints && checkpointTimer.hasExpired(Checkpoint::INTERVAL)) {
+        if (!writeCheckpoint()) return false;
+    }
+
+    return true;
+}
+
+bool DecoderPool::putSharedFrames(qint32 startFrameNumber, const QVector<ComponentFrame> &componentFrames,
+                                  QVector<OutputFrame> &outputFrames)
+{
+    // The ring is filled in order, so only the thread whose batch is next may
+    // write to it. If this batch is next already, its frames can be converted
+    // straight into the ring. Otherwise, convert them into this thread's own
+    // buffers while the earlier batches are still being decoded, so the
+    // threads aren't converting one at a time, and copy them in later.
+    outputMutex.lock();
+    const bool isNext = (outputFrameNumber == startFrameNumber);
+    outputMutex.unlock();
+
+    if (!isNext) {
+        for (qint32 i = 0; i < componentFrames.size(); i++) {
+            outputWriter.convert(componentFrames[i], outputFrames[i]);
+        }
+
+        QMutexLocker locker(&outputMutex);
+        while (outputFrameNumber != startFrameNumber) {
+            if (abort) return false;
+            outputWritten.wait(&outputMutex);
+        }
+    }
+
+    // Nothing else touches the ring until outputFrameNumber moves past this
+    // batch, so write to it without holding outputMutex; the other threads
+    // can carry on while we wait for the consumer
+    for (qint32 i = 0; i < componentFrames.size(); i++) {
+        char *slot = sharedRing->beginWrite();
+        if (slot == nullptr) {
+            QMutexLocker locker(&outputMutex);
+            abortOutput();
+            return false;
+        }
 
-        const qint32 outputCount = outputFrameNumber - startFrame;
-        if ((outputCount % 32) == 0) {
-            // Show an update to the user
-            double fps = outputCount / (static_cast<double>(totalTimer.elapsed()) / 1000.0);
-            qInfo() << outputCount << "frames processed -" << fps << "FPS";
+        if (isNext) {
+            outputWriter.convert(componentFrames[i], reinterpret_cast<quint16 *>(slot));
+        } else {
+            std::memcpy(slot, outputFrames[i].constData(), outputFrames[i].size() * sizeof(quint16));
         }
+
+        if (!sharedRing->endWrite()) {
+            qCritical() << "Writing to the shared memory output failed";
+            QMutexLocker locker(&outputMutex);
+            abortOutput();
+            return false;
+        }
+    }
+
+    // Let the thread with the next batch go ahead
+    QMutexLocker locker(&outputMutex);
+    for (qint32 i = 0; i < componentFrames.size(); i++) {
+        outputFrameNumber++;
+        showProgress();
+    }
+    outputWritten.wakeAll();
+
+    return true;
+}
+
+// Stop the other threads waiting in putSharedFrames after a failure. You must
+// hold outputMutex to call this.
+void DecoderPool::abortOutput()
+{
+    abort = true;
+    outputWritten.wakeAll();
+}
+
+// Show an update to the user every so often. You must hold outputMutex to
+// call this.
+void DecoderPool::showProgress()
+{
+    const qint32 outputCount = outputFrameNumber - firstOutputFrameNumber;
+    if ((outputCount % 32) == 0) {
+        double fps = outputCount / (static_cast<double>(totalTimer.elapsed()) / 1000.0);
+        qInfo() << outputCount << "frames processed -" << fps << "FPS";
+    }
+}
+
+// Return a description of the job, to check a checkpoint belongs to it
+QString DecoderPool::getCheckpointJob() const
+{
+    return QString("ld-chroma-decoder %1 start %2 length %3 decoder %4 output %5 y4m %6 padding %7")
+        .arg(inputFileName).arg(startFrame).arg(length).arg(decoderDescription)
+        .arg(outputWriter.getPixelName()).arg(outputConfig.outputY4m).arg(outputConfig.paddingAmount);
+}
+
+// Save a checkpoint of the frames that have been written so far. You must
+// hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool DecoderPool::writeCheckpoint()
+{
+    if (!targetVideo.flush()) {
+        qCritical() << "Writing to the output video file failed";
+        return false;
     }
 
+    Checkpoint checkpoint;
+    checkpoint.job = getCheckpointJob();
+    checkpoint.nextNumber = outputFrameNumber;
+    checkpoint.outputSize = targetVideo.pos();
+    if (!checkpoint.write(checkpointFileName)) return false;
+
+    checkpointTimer.restart();
     return true;
 }
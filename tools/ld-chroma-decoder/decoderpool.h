@@ -32,21 +32,28 @@
 #include <QMutex>
 #include <QThread>
 #include <QVector>
+#include <QWaitCondition>
+#include <memory>
 
+#include "checkpoint.h"
 #include "lddecodemetadata.h"
 #include "sourcevideo.h"
 
 #include "decoder.h"
 #include "outputwriter.h"
+#include "sharedframering.h"
 #include "sourcefield.h"
 
 class DecoderPool
 {
 public:
-    explicit DecoderPool(Decoder &decoder, QString inputFileName,
+    // decoderDescription names the decoder and any options that change its
+    // output; it's recorded in checkpoints so --resume can check it matches.
+    explicit DecoderPool(Decoder &decoder, QString decoderDescription, QString inputFileName,
                          LdDecodeMetaData &ldDecodeMetaData,
                          OutputWriter::Configuration &outputConfig, QString outputFileName,
-                         qint32 startFrame, qint32 length, qint32 maxThreads);
+                         qint32 startFrame, qint32 length, qint32 maxThreads, bool resume = false,
+                         QString sharedMemoryKey = QString());
 
     // Decode fields to frames as specified by the constructor args.
     // Returns true on success; on failure, prints a message and returns false.
@@ -75,26 +82,49 @@ public:
 
     // For worker threads: return decoded frames to write to the output file.
     //
-    // outputFrames should contain RGB48, YUV444P16, or GRAY16 output frames,
+    // outputFrames should contain output frames in the OutputWriter's format,
     // with the first frame being startFrameNumber.
     //
     // Returns true on success, false on failure.
     bool putOutputFrames(qint32 startFrameNumber, const QVector<OutputFrame> &outputFrames);
 
+    // For worker threads: true if frames should be returned with
+    // putSharedFrames rather than putOutputFrames
+    bool isWritingToSharedMemory() const {
+        return !sharedMemoryKey.isEmpty();
+    }
+
+    // For worker threads: write decoded frames to the shared memory output,
+    // with the first frame being startFrameNumber. The ring must be filled in
+    // order, so this waits for earlier frames first; if there are any still
+    // to come, the frames are converted into outputFrames while waiting, and
+    // copied into the ring afterwards.
+    //
+    // Returns true on success, false on failure.
+    bool putSharedFrames(qint32 startFrameNumber, const QVector<ComponentFrame> &componentFrames,
+                         QVector<OutputFrame> &outputFrames);
+
 private:
     bool putOutputFrame(qint32 frameNumber, const OutputFrame &outputFrame);
+    void abortOutput();
+    void showProgress();
+    QString getCheckpointJob() const;
+    bool writeCheckpoint();
 
     // Default batch size, in frames
     static constexpr qint32 DEFAULT_BATCH_SIZE = 16;
 
     // Parameters
     Decoder &decoder;
+    QString decoderDescription;
     QString inputFileName;
     OutputWriter::Configuration outputConfig;
     QString outputFileName;
     qint32 startFrame;
     qint32 length;
     qint32 maxThreads;
+    bool resume;
+    QString sharedMemoryKey;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
     // down as soon as possible if it becomes true
@@ -111,11 +141,19 @@ private:
 
     // Output stream information (all guarded by outputMutex while threads are running)
     QMutex outputMutex;
+    QWaitCondition outputWritten;
     qint32 outputFrameNumber;
     QMap<qint32, OutputFrame> pendingOutputFrames;
     OutputWriter outputWriter;
     QFile targetVideo;
+    std::unique_ptr<SharedFrameRing> sharedRing;
+    qint32 firstOutputFrameNumber;
     QElapsedTimer totalTimer;
+
+    // Checkpoint information (guarded by outputMutex while threads are running)
+    bool useCheckpoints;
+    QString checkpointFileName;
+    QElapsedTimer checkpointTimer;
 };
 
 #endif // DECODERPOOL_H
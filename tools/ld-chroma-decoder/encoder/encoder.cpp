@@ -48,10 +48,17 @@
 
 #include "encoder.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+
 Encoder::Encoder(QFile &_inputFile, QFile &_tbcFile, QFile &_chromaFile, LdDecodeMetaData &_metaData,
-                 int _fieldOffset, bool _isComponent)
+                 int _fieldOffset, bool _isComponent, qint32 _numThreads)
     : inputFile(_inputFile), tbcFile(_tbcFile), chromaFile(_chromaFile), metaData(_metaData),
-      fieldOffset(_fieldOffset), isComponent(_isComponent)
+      fieldOffset(_fieldOffset), isComponent(_isComponent), numThreads(_numThreads)
 {
 }
 
@@ -60,26 +67,153 @@ bool Encoder::encode()
     // Store video parameters
     metaData.setVideoParameters(videoParameters);
 
+    // Frames are read into a ring of slots. A fixed set of worker threads
+    // encodes fields from a queue, while this thread reads the following
+    // frames and writes out the encoded fields in order.
+    const qint32 workerCount = qMax(1, numThreads);
+    const qint32 slotCount = workerCount * 2;
+    const qint32 fieldSize = videoParameters.fieldWidth * videoParameters.fieldHeight;
+    std::vector<FrameSlot> slots(slotCount);
+    for (FrameSlot &slot : slots) {
+        slot.inputFrame.resize(inputFrameSize);
+        for (qint32 i = 0; i < 2; i++) {
+            slot.tbcFields[i].resize(fieldSize);
+            if (chromaFile.isOpen()) {
+                slot.chromaFields[i].resize(fieldSize);
+            }
+        }
+    }
+
+    // Field numbers waiting to be encoded, and the condition variables used
+    // to signal new work and finished fields
+    QMutex mutex;
+    QWaitCondition fieldQueued;
+    QWaitCondition fieldEncoded;
+    std::deque<qint32> fieldQueue;
+    bool stopping = false;
+
+    auto worker = [&]() {
+        // Working space and output for the encoder
+        LineBuffers buffers(videoParameters.fieldWidth);
+        std::vector<double> outputC(videoParameters.fieldWidth);
+        std::vector<double> outputVBS(videoParameters.fieldWidth);
+
+        QMutexLocker locker(&mutex);
+        while (true) {
+            while (fieldQueue.empty() && !stopping) {
+                fieldQueued.wait(&mutex);
+            }
+            if (fieldQueue.empty()) break;
+            const qint32 fieldNo = fieldQueue.front();
+            fieldQueue.pop_front();
+            locker.unlock();
+
+            FrameSlot &slot = slots[(fieldNo / 2) % slotCount];
+            std::vector<quint16> &tbcField = slot.tbcFields[fieldNo % 2];
+            std::vector<quint16> &chromaField = chromaFile.isOpen() ? slot.chromaFields[fieldNo % 2] : tbcField;
+            encodeField(fieldNo, slot.inputFrame, tbcField, chromaField, buffers, outputC, outputVBS);
+
+            locker.relock();
+            slot.fieldsEncoded++;
+            fieldEncoded.wakeAll();
+        }
+    };
+
+    std::vector<QThread *> threads(workerCount);
+    for (QThread *&thread : threads) {
+        thread = QThread::create(worker);
+        thread->start();
+    }
+
+    // Wait for the frame in a slot to be encoded, then write out its fields.
+    // Returns false if writing fails.
+    auto writeFrame = [&](qint32 frameNo) {
+        FrameSlot &slot = slots[frameNo % slotCount];
+        {
+            QMutexLocker locker(&mutex);
+            while (slot.fieldsEncoded < 2) {
+                fieldEncoded.wait(&mutex);
+            }
+        }
+
+        // Write two fields for each frame -- even-numbered lines, then
+        // odd-numbered lines. In a TBC file, the first field is always the
+        // one that starts with the half-line (i.e. frame line 44 for PAL or
+        // 39 for NTSC, counting from 0).
+        for (qint32 i = 0; i < 2; i++) {
+            if (!writeField(slot.tbcFields[i], tbcFile)) return false;
+            if (chromaFile.isOpen() && !writeField(slot.chromaFields[i], chromaFile)) return false;
+
+            // Generate field metadata
+            LdDecodeMetaData::Field fieldData;
+            getFieldMetadata((frameNo * 2) + i, fieldData);
+            metaData.appendField(fieldData);
+        }
+        return true;
+    };
+
     // Process frames until EOF
+    bool success = true;
     qint32 numFrames = 0;
+    qint32 numWritten = 0;
     while (true) {
-        qint32 result = encodeFrame(numFrames);
+        // If the next slot is still in use, write out the frame in it first
+        if (numFrames - numWritten == slotCount) {
+            if (!writeFrame(numWritten)) {
+                success = false;
+                break;
+            }
+            numWritten++;
+        }
+
+        // Read the input frame into the slot
+        FrameSlot &slot = slots[numFrames % slotCount];
+        const qint32 result = readFrame(slot.inputFrame);
         if (result == -1) {
-            return false;
+            success = false;
+            break;
         } else if (result == 0) {
             break;
         }
+
+        // Queue its fields for encoding
+        {
+            QMutexLocker locker(&mutex);
+            slot.fieldsEncoded = 0;
+            fieldQueue.push_back(numFrames * 2);
+            fieldQueue.push_back((numFrames * 2) + 1);
+            fieldQueued.wakeAll();
+        }
         numFrames++;
     }
 
-    return true;
+    // Write out the remaining frames
+    while (success && numWritten < numFrames) {
+        if (!writeFrame(numWritten)) {
+            success = false;
+        }
+        numWritten++;
+    }
+
+    // Stop the workers, dropping any fields that haven't been started
+    {
+        QMutexLocker locker(&mutex);
+        fieldQueue.clear();
+        stopping = true;
+        fieldQueued.wakeAll();
+    }
+    for (QThread *thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    return success;
 }
 
-// Read one frame from the input, and write two fields to the output.
+// Read one frame from the input.
 // Returns 0 on EOF, 1 on success; on failure, prints an error and returns -1.
-qint32 Encoder::encodeFrame(qint32 frameNo)
+qint32 Encoder::readFrame(QByteArray &inputFrame)
 {
-    // Read the input frame
     qint64 remainBytes = inputFrame.size();
     qint64 posBytes = 0;
     while (remainBytes > 0) {
@@ -98,37 +232,19 @@ qint32 Encoder::encodeFrame(qint32 frameNo)
         posBytes += count;
     }
 
-    // Write the two fields -- even-numbered lines, then odd-numbered lines.
-    // In a TBC file, the first field is always the one that starts with the
-    // half-line (i.e. frame line 44 for PAL or 39 for NTSC, counting from 0).
-    if (!encodeField(frameNo * 2)) {
-        return -1;
-    }
-    if (!encodeField((frameNo * 2) + 1)) {
-        return -1;
-    }
-
     return 1;
 }
 
-// Encode one field from inputFrame to the output.
-// Returns true on success; on failure, prints an error and returns false.
-bool Encoder::encodeField(qint32 fieldNo)
+// Encode one field from inputFrame into tbcField (and chromaField, if
+// there's a separate chroma output).
+void Encoder::encodeField(qint32 fieldNo, const QByteArray &inputFrame, std::vector<quint16> &tbcField,
+                          std::vector<quint16> &chromaField, LineBuffers &buffers,
+                          std::vector<double> &outputC, std::vector<double> &outputVBS) const
 {
     const qint32 lineOffset = fieldNo % 2;
 
-    // Output from the encoder
-    std::vector<double> outputC(videoParameters.fieldWidth);
-    std::vector<double> outputVBS(videoParameters.fieldWidth);
-
-    // Buffer for conversion
-    std::vector<quint16> outputBuffer(videoParameters.fieldWidth);
-
-    for (qint32 frameLine = 0; frameLine < 2 * videoParameters.fieldHeight; frameLine++) {
-        // Skip lines that aren't in this field
-        if ((frameLine % 2) != lineOffset) {
-            continue;
-        }
+    for (qint32 fieldLine = 0; fieldLine < videoParameters.fieldHeight; fieldLine++) {
+        const qint32 frameLine = (fieldLine * 2) + lineOffset;
 
         // Encode the line
         const quint16 *inputData = nullptr;
@@ -139,30 +255,24 @@ bool Encoder::encodeField(qint32 fieldNo)
                 inputData = reinterpret_cast<const quint16 *>(inputFrame.data()) + ((frameLine - activeTop) * activeWidth * 3);
             }
         }
-        encodeLine(fieldNo, frameLine, inputData, outputC, outputVBS);
+        encodeLine(fieldNo, frameLine, inputData, buffers, outputC, outputVBS);
 
+        quint16 *tbcLine = tbcField.data() + (fieldLine * videoParameters.fieldWidth);
         if (chromaFile.isOpen()) {
-            // Write C and VBS to separate output files
-            if (!writeLine(outputC, outputBuffer, true, chromaFile)) return false;
-            if (!writeLine(outputVBS, outputBuffer, false, tbcFile)) return false;
+            // Write C and VBS to separate output fields
+            scaleLine(outputC, true, chromaField.data() + (fieldLine * videoParameters.fieldWidth));
+            scaleLine(outputVBS, false, tbcLine);
         } else {
-            // Combine C and VBS into a single output file
+            // Combine C and VBS into a single output field
             for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
                 outputVBS[x] += outputC[x];
             }
-            if (!writeLine(outputVBS, outputBuffer, false, tbcFile)) return false;
+            scaleLine(outputVBS, false, tbcLine);
         }
     }
-
-    // Generate field metadata
-    LdDecodeMetaData::Field fieldData;
-    getFieldMetadata(fieldNo, fieldData);
-    metaData.appendField(fieldData);
-
-    return true;
 }
 
-bool Encoder::writeLine(const std::vector<double> &input, std::vector<quint16> &buffer, bool isChroma, QFile &file)
+void Encoder::scaleLine(const std::vector<double> &input, bool isChroma, quint16 *output) const
 {
     // Scale to a 16-bit output sample and limit the excursion to the
     // permitted sample values. [EBU p6] [SMPTE p6]
@@ -176,13 +286,16 @@ bool Encoder::writeLine(const std::vector<double> &input, std::vector<quint16> &
     const double offset = isChroma ? 0x7FFF : videoParameters.black16bIre;
     for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
         const double scaled = qBound(static_cast<double>(0x0100), (input[x] * scale) + offset, static_cast<double>(0xFEFF));
-        buffer[x] = static_cast<quint16>(scaled);
+        output[x] = static_cast<quint16>(scaled);
     }
+}
 
-    // Write the converted line to the output file.
+bool Encoder::writeField(const std::vector<quint16> &field, QFile &file)
+{
+    // Write the converted field to the output file.
     // TBC data is unsigned 16-bit values in native byte order.
-    const char *outputData = reinterpret_cast<const char *>(buffer.data());
-    qint64 remainBytes = buffer.size() * 2;
+    const char *outputData = reinterpret_cast<const char *>(field.data());
+    qint64 remainBytes = field.size() * 2;
     qint64 posBytes = 0;
     while (remainBytes > 0) {
         qint64 count = file.write(outputData + posBytes, remainBytes);
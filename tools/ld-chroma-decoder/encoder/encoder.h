@@ -60,36 +60,65 @@ enum SyncPulseType {
     BROAD
 };
 
+// Working buffers for encoding a line. Each thread encoding lines has its
+// own set, so encodeLine doesn't need to allocate.
+struct LineBuffers {
+    explicit LineBuffers(qint32 fieldWidth)
+        : Y(fieldWidth), C1(fieldWidth), C2(fieldWidth)
+    {
+    }
+
+    // Luma and the two chroma components (U/V, or I/Q for NTSC)
+    std::vector<double> Y;
+    std::vector<double> C1;
+    std::vector<double> C2;
+};
+
 class Encoder
 {
 public:
     // Constructor.
     // This only sets the member variables it takes as parameters; subclasses
     // must initialise the VideoParameters, compute the active region and
-    // resize inputFrame.
+    // set inputFrameSize.
     Encoder(QFile &inputFile, QFile &tbcFile, QFile &chromaFile, LdDecodeMetaData &metaData,
-            int fieldOffset, bool isComponent);
+            int fieldOffset, bool isComponent, qint32 numThreads);
 
     // Encode input RGB/YCbCr stream to TBC.
     // Returns true on success; on failure, prints an error and returns false.
     bool encode();
 
 protected:
-    qint32 encodeFrame(qint32 frameNo);
-    bool encodeField(qint32 fieldNo);
+    // An input frame and its encoded fields
+    struct FrameSlot {
+        QByteArray inputFrame;
+        std::vector<quint16> tbcFields[2];
+        std::vector<quint16> chromaFields[2];
+        qint32 fieldsEncoded = 0;
+    };
+
+    qint32 readFrame(QByteArray &inputFrame);
+    void encodeField(qint32 fieldNo, const QByteArray &inputFrame, std::vector<quint16> &tbcField,
+                     std::vector<quint16> &chromaField, LineBuffers &buffers, std::vector<double> &outputC,
+                     std::vector<double> &outputVBS) const;
 
     // Fill in the metadata for a generated field
     virtual void getFieldMetadata(qint32 fieldNo, LdDecodeMetaData::Field &fieldData) = 0;
 
     // Encode one line of a field into composite video.
+    // buffers is used as working space.
     // outputC includes the chroma signal and burst.
     // outputVBS includes the luma signal, blanking and syncs.
-    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData,
-                            std::vector<double> &outputC, std::vector<double> &outputVBS) = 0;
+    // This may be called from several threads at once, each with its own buffers.
+    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData, LineBuffers &buffers,
+                            std::vector<double> &outputC, std::vector<double> &outputVBS) const = 0;
+
+    // Scale a line of data to 16-bit output samples
+    void scaleLine(const std::vector<double> &input, bool isChroma, quint16 *output) const;
 
-    // Scale and write a line of data to one of the output files.
+    // Write a field of data to one of the output files.
     // Returns true on success; on failure, prints an error and returns false.
-    bool writeLine(const std::vector<double> &input, std::vector<quint16> &buffer, bool isChroma, QFile &file);
+    bool writeField(const std::vector<quint16> &field, QFile &file);
 
     QFile &inputFile;
     QFile &tbcFile;
@@ -97,6 +126,7 @@ protected:
     LdDecodeMetaData &metaData;
     int fieldOffset;
     bool isComponent;
+    qint32 numThreads;
 
     LdDecodeMetaData::VideoParameters videoParameters;
     qint32 activeWidth;
@@ -104,7 +134,8 @@ protected:
     qint32 activeLeft;
     qint32 activeTop;
 
-    QByteArray inputFrame;
+    // Size of an input frame, in bytes
+    qint32 inputFrameSize;
 };
 
 // Generate a gate waveform with raised-cosine transitions, with 50% points at given start and end times
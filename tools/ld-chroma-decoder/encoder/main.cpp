@@ -27,6 +27,7 @@
 #include <QFile>
 #include <QtGlobal>
 #include <QCommandLineParser>
+#include <QThread>
 #include <cstdio>
 
 #ifdef _WIN32
@@ -91,6 +92,12 @@ int main(int argc, char *argv[])
                                          QCoreApplication::translate("main", "offset"));
     parser.addOption(fieldOffsetOption);
 
+    // Option to select the number of threads (-t)
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads",
+                                     QCoreApplication::translate("main", "Specify the number of concurrent threads (default number of logical CPUs)"),
+                                     QCoreApplication::translate("main", "number"));
+    parser.addOption(threadsOption);
+
     // -- NTSC options --
 
     // Option to select chroma mode (--chroma-mode)
@@ -156,6 +163,16 @@ int main(int argc, char *argv[])
 
     bool addSetup = !parser.isSet(setupOption);
 
+    qint32 maxThreads = QThread::idealThreadCount();
+    if (parser.isSet(threadsOption)) {
+        maxThreads = parser.value(threadsOption).toInt();
+        if (maxThreads < 1) {
+            // Quit with error
+            qCritical("Specified number of threads must be greater than zero");
+            return -1;
+        }
+    }
+
     // Select the input format
     bool isComponent = false;
     QString inputFormatName;
@@ -246,12 +263,12 @@ int main(int argc, char *argv[])
     // Encode the data
     LdDecodeMetaData metaData;
     if (system == NTSC) {
-        NTSCEncoder encoder(inputFile, tbcFile, chromaFile, metaData, fieldOffset, isComponent, chromaMode, addSetup);
+        NTSCEncoder encoder(inputFile, tbcFile, chromaFile, metaData, fieldOffset, isComponent, chromaMode, addSetup, maxThreads);
         if (!encoder.encode()) {
             return -1;
         }
     } else {
-        PALEncoder encoder(inputFile, tbcFile, chromaFile, metaData, fieldOffset, isComponent, scLocked);
+        PALEncoder encoder(inputFile, tbcFile, chromaFile, metaData, fieldOffset, isComponent, scLocked, maxThreads);
         if (!encoder.encode()) {
             return -1;
         }
@@ -41,8 +41,9 @@
 #include <cmath>
 
 NTSCEncoder::NTSCEncoder(QFile &_inputFile, QFile &_tbcFile, QFile &_chromaFile, LdDecodeMetaData &_metaData,
-                         int _fieldOffset, bool _isComponent, ChromaMode _chromaMode, bool _addSetup)
-    : Encoder(_inputFile, _tbcFile, _chromaFile, _metaData, _fieldOffset, _isComponent),
+                         int _fieldOffset, bool _isComponent, ChromaMode _chromaMode, bool _addSetup,
+                         qint32 _numThreads)
+    : Encoder(_inputFile, _tbcFile, _chromaFile, _metaData, _fieldOffset, _isComponent, _numThreads),
       chromaMode(_chromaMode), addSetup(_addSetup)
 {
     // NTSC subcarrier frequency [Poynton p511]
@@ -101,13 +102,8 @@ NTSCEncoder::NTSCEncoder(QFile &_inputFile, QFile &_tbcFile, QFile &_chromaFile,
     activeTop = 39;
     activeHeight = 525 - activeTop;
 
-    // Resize the RGB48/YUV444P16 input buffer.
-    inputFrame.resize(activeWidth * activeHeight * 3 * 2);
-
-    // Resize the output buffers.
-    Y.resize(videoParameters.fieldWidth);
-    C1.resize(videoParameters.fieldWidth);
-    C2.resize(videoParameters.fieldWidth);
+    // Size of an RGB48/YUV444P16 input frame, in bytes.
+    inputFrameSize = activeWidth * activeHeight * 3 * 2;
 }
 
 void NTSCEncoder::getFieldMetadata(qint32 fieldNo, LdDecodeMetaData::Field &fieldData)
@@ -166,8 +162,8 @@ static constexpr auto qFilter = makeFIRFilter(qFilterCoeffs);
 static const double SIN_33 = sin(33.0 * M_PI / 180.0);
 static const double COS_33 = cos(33.0 * M_PI / 180.0);
 
-void NTSCEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData,
-                             std::vector<double> &outputC, std::vector<double> &outputVBS)
+void NTSCEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData, LineBuffers &buffers,
+                             std::vector<double> &outputC, std::vector<double> &outputVBS) const
 {
     if (frameLine == 525) {
         // Dummy last line, filled with blanking
@@ -251,8 +247,11 @@ void NTSCEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *in
         burstAmplitude = 0.0;
     }
 
-    // Clear output buffers. Values in these are scaled so that 0.0 is black and
-    // 1.0 is white.
+    // Output buffers, cleared to 0. Values in these are scaled so that 0.0 is
+    // black and 1.0 is white.
+    std::vector<double> &Y = buffers.Y;
+    std::vector<double> &C1 = buffers.C1;
+    std::vector<double> &C2 = buffers.C2;
     std::fill(Y.begin(), Y.end(), 0.0);
     std::fill(C1.begin(), C1.end(), 0.0);
     std::fill(C2.begin(), C2.end(), 0.0);
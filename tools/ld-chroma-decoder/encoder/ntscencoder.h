@@ -43,22 +43,18 @@ class NTSCEncoder : public Encoder
 {
 public:
     NTSCEncoder(QFile &inputFile, QFile &tbcFile, QFile &chromaFile, LdDecodeMetaData &metaData,
-                int fieldOffset, bool isComponent, ChromaMode chromaMode, bool addSetup);
+                int fieldOffset, bool isComponent, ChromaMode chromaMode, bool addSetup, qint32 numThreads);
 
 protected:
     virtual void getFieldMetadata(qint32 fieldNo, LdDecodeMetaData::Field &fieldData);
-    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData,
-                            std::vector<double> &outputC, std::vector<double> &outputVBS);
+    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData, LineBuffers &buffers,
+                            std::vector<double> &outputC, std::vector<double> &outputVBS) const;
 
     const qint32 blankingIre = 0x3C00;
     const qint32 setupIreOffset = 0x0A80; // 10.5 * 256
 
     ChromaMode chromaMode;
     bool addSetup;
-
-    std::vector<double> Y;
-    std::vector<double> C1;
-    std::vector<double> C2;
 };
 
 #endif
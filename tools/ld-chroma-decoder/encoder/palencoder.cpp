@@ -40,8 +40,8 @@
 #include <cmath>
 
 PALEncoder::PALEncoder(QFile &_inputFile, QFile &_tbcFile, QFile &_chromaFile, LdDecodeMetaData &_metaData,
-                       int _fieldOffset, bool _isComponent, bool _scLocked)
-    : Encoder(_inputFile, _tbcFile, _chromaFile, _metaData, _fieldOffset, _isComponent), scLocked(_scLocked)
+                       int _fieldOffset, bool _isComponent, bool _scLocked, qint32 _numThreads)
+    : Encoder(_inputFile, _tbcFile, _chromaFile, _metaData, _fieldOffset, _isComponent, _numThreads), scLocked(_scLocked)
 {
     // PAL subcarrier frequency [Poynton p529] [EBU p5]
     videoParameters.fSC = 4433618.75;
@@ -116,13 +116,8 @@ PALEncoder::PALEncoder(QFile &_inputFile, QFile &_tbcFile, QFile &_chromaFile, L
     activeTop = 44;
     activeHeight = 620 - activeTop;
 
-    // Resize the RGB48/YUV444P16 input buffer.
-    inputFrame.resize(activeWidth * activeHeight * 3 * 2);
-
-    // Resize the output buffers.
-    Y.resize(videoParameters.fieldWidth);
-    U.resize(videoParameters.fieldWidth);
-    V.resize(videoParameters.fieldWidth);
+    // Size of an RGB48/YUV444P16 input frame, in bytes.
+    inputFrameSize = activeWidth * activeHeight * 3 * 2;
 }
 
 void PALEncoder::getFieldMetadata(qint32 fieldNo, LdDecodeMetaData::Field &fieldData)
@@ -170,8 +165,8 @@ static constexpr std::array<double, 13> uvFilterCoeffs {
 };
 static constexpr auto uvFilter = makeFIRFilter(uvFilterCoeffs);
 
-void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData,
-                            std::vector<double> &outputC, std::vector<double> &outputVBS)
+void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData, LineBuffers &buffers,
+                            std::vector<double> &outputC, std::vector<double> &outputVBS) const
 {
     if (frameLine == 625) {
         // Dummy last line, filled with black
@@ -257,8 +252,11 @@ void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inp
         burstAmplitude = 0.0;
     }
 
-    // Clear Y'UV buffers. Values in these are scaled so that 0.0 is black and
-    // 1.0 is white.
+    // Y'UV buffers, cleared to 0. Values in these are scaled so that 0.0 is
+    // black and 1.0 is white.
+    std::vector<double> &Y = buffers.Y;
+    std::vector<double> &U = buffers.C1;
+    std::vector<double> &V = buffers.C2;
     std::fill(Y.begin(), Y.end(), 0.0);
     std::fill(U.begin(), U.end(), 0.0);
     std::fill(V.begin(), V.end(), 0.0);
@@ -36,18 +36,14 @@ class PALEncoder : public Encoder
 {
 public:
     PALEncoder(QFile &inputFile, QFile &tbcFile, QFile &chromaFile, LdDecodeMetaData &metaData,
-               int fieldOffset, bool isComponent, bool scLocked);
+               int fieldOffset, bool isComponent, bool scLocked, qint32 numThreads);
 
 private:
     virtual void getFieldMetadata(qint32 fieldNo, LdDecodeMetaData::Field &fieldData);
-    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData,
-                            std::vector<double> &outputC, std::vector<double> &outputVBS);
+    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *inputData, LineBuffers &buffers,
+                            std::vector<double> &outputC, std::vector<double> &outputVBS) const;
 
     bool scLocked;
-
-    std::vector<double> Y;
-    std::vector<double> U;
-    std::vector<double> V;
 };
 
 #endif
@@ -167,7 +167,7 @@ int main(int argc, char *argv[])
 
     // Option to select the output format (-p)
     QCommandLineOption outputFormatOption(QStringList() << "p" << "output-format",
-                                       QCoreApplication::translate("main", "Output format (rgb, yuv, y4m; default rgb); RGB48, YUV444P16, GRAY16 pixel formats are supported"),
+                                       QCoreApplication::translate("main", "Output format (rgb, yuv, y4m, yuv422p10, y4m422p10, yuv420p, y4m420p; default rgb); RGB48, YUV444P16, GRAY16, YUV422P10, YUV420P pixel formats are supported"),
                                        QCoreApplication::translate("main", "output-format"));
     parser.addOption(outputFormatOption);
 
@@ -194,6 +194,17 @@ int main(int argc, char *argv[])
                                      QCoreApplication::translate("main", "number"));
     parser.addOption(threadsOption);
 
+    // Option to resume from the last checkpoint (--resume)
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Resume an interrupted run from the checkpoint saved with the output file"));
+    parser.addOption(resumeOption);
+
+    // Option to write output to shared memory (--output-shm)
+    QCommandLineOption outputShmOption(QStringList() << "output-shm",
+                                       QCoreApplication::translate("main", "Write output frames to a shared memory ring buffer with this name, instead of a file (see ld-chroma-shm-reader)"),
+                                       QCoreApplication::translate("main", "name"));
+    parser.addOption(outputShmOption);
+
     // Option to override calculated firstActiveFieldLine in our video parameters (-ffll)
     QCommandLineOption firstFieldLineOption(QStringList() << "ffll" << "first_active_field_line",
                                             QCoreApplication::translate("main", "The first visible line of a field. Range 1-259 for NTSC (default: 20), 2-308 for PAL (default: 22)"),
@@ -306,6 +317,21 @@ int main(int argc, char *argv[])
         qCritical("Input and output files cannot be the same");
         return -1;
     }
+    bool resume = parser.isSet(resumeOption);
+    if (resume && outputFileName == "-") {
+        // Quit with error
+        qCritical("Cannot resume with piped output");
+        return -1;
+    }
+    QString sharedMemoryKey;
+    if (parser.isSet(outputShmOption)) {
+        sharedMemoryKey = parser.value(outputShmOption);
+        if (sharedMemoryKey.isEmpty() || positionalArguments.count() == 2) {
+            // Quit with error
+            qCritical("With --output-shm, you must specify a name and no output file");
+            return -1;
+        }
+    }
 
     qint32 startFrame = -1;
     qint32 length = -1;
@@ -523,6 +549,12 @@ int main(int argc, char *argv[])
         } else {
             outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV444P16;
         }
+    } else if (outputFormatName == "yuv422p10" || outputFormatName == "y4m422p10") {
+        outputConfig.outputY4m = outputFormatName.startsWith("y4m");
+        outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV422P10;
+    } else if (outputFormatName == "yuv420p" || outputFormatName == "y4m420p") {
+        outputConfig.outputY4m = outputFormatName.startsWith("y4m");
+        outputConfig.pixelFormat = OutputWriter::PixelFormat::YUV420P;
     } else if (outputFormatName == "rgb") {
         outputConfig.pixelFormat = OutputWriter::PixelFormat::RGB48;
     } else {
@@ -538,8 +570,22 @@ int main(int argc, char *argv[])
         }
     }
     
+    // Describe the decoder and the options that change its output, so that
+    // --resume can refuse a checkpoint made with different settings
+    QString decoderDescription = decoderName;
+    for (const QCommandLineOption *option : {&inputJsonOption, &setReverseOption, &chromaGainOption, &chromaPhaseOption,
+                                             &setBwModeOption, &firstFieldLineOption, &lastFieldLineOption,
+                                             &firstFrameLineOption, &lastFrameLineOption, &showMapOption, &chromaNROption,
+                                             &lumaNROption, &ntscPhaseCompOption, &simplePALOption, &transformThresholdOption,
+                                             &transformThresholdsOption, &showFFTsOption}) {
+        if (!parser.isSet(*option)) continue;
+        decoderDescription += " --" + option->names().last();
+        if (!option->valueName().isEmpty()) decoderDescription += " " + parser.value(*option);
+    }
+
     // Perform the processing
-    DecoderPool decoderPool(*decoder, inputFileName, metaData, outputConfig, outputFileName, startFrame, length, maxThreads);
+    DecoderPool decoderPool(*decoder, decoderDescription, inputFileName, metaData, outputConfig, outputFileName,
+                            startFrame, length, maxThreads, resume, sharedMemoryKey);
     if (!decoderPool.process()) {
         return -1;
     }
@@ -28,6 +28,14 @@
 
 #include "componentframe.h"
 
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Limits, zero points and scaling factors (from 0-1) for Y'CbCr colour representations
 // [Poynton ch25 p305] [BT.601-7 sec 2.5.3]
 static constexpr double Y_MIN   = 1.0    * 256.0;
@@ -50,6 +58,90 @@ static constexpr double ONE_MINUS_Kr = 1.0 - 0.299;
 static constexpr double kB = 0.49211104112248356308804691718185;
 static constexpr double kR = 0.87728321993817866838972487283129;
 
+// Coefficients for converting Y'UV to R'G'B' [Poynton eq 28.6 p337]
+static constexpr double R_V = 1.139883;
+static constexpr double G_U = -0.394642;
+static constexpr double G_V = -0.580622;
+static constexpr double B_U = 2.032062;
+
+// Reduce a sample on the 16-bit Y'CbCr scale to the given number of bits,
+// rounding to the nearest code and clamping to the same limits
+static inline quint16 reduceSample(double value, qint32 bits, double min, double max)
+{
+    const double scale = 1.0 / (1 << (16 - bits));
+    const double lo = std::ceil(min * scale);
+    const double hi = std::floor(max * scale);
+    return static_cast<quint16>(qBound(lo, (value * scale) + 0.5, hi));
+}
+
+#if defined(__SSE2__)
+// The SSE2 kernels below convert 8 samples at a time, as four pairs of
+// doubles. They do the same arithmetic in the same order as the scalar code,
+// so the results are identical.
+
+// Clamp values to the range [lo, hi], as qBound does
+static inline __m128d clampPd(__m128d value, __m128d lo, __m128d hi)
+{
+    return _mm_max_pd(lo, _mm_min_pd(value, hi));
+}
+
+// Truncate 8 values in the range 0-65535 to 16-bit unsigned integers.
+// SSE2 can only pack with signed saturation, so bias the values into the
+// signed range and back.
+static inline __m128i packU16(const __m128d values[4])
+{
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i lo = _mm_unpacklo_epi64(_mm_cvttpd_epi32(values[0]), _mm_cvttpd_epi32(values[1]));
+    const __m128i hi = _mm_unpacklo_epi64(_mm_cvttpd_epi32(values[2]), _mm_cvttpd_epi32(values[3]));
+    const __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias));
+    return _mm_xor_si128(packed, _mm_set1_epi16(static_cast<short>(0x8000)));
+}
+
+// Compute qBound(min, ((in[i] - offset) * scale) + zero, max) for 8 samples
+static inline __m128i scaleToU16(const double *in, double offset, double scale, double zero, double min, double max)
+{
+    const __m128d offsetV = _mm_set1_pd(offset);
+    const __m128d scaleV = _mm_set1_pd(scale);
+    const __m128d zeroV = _mm_set1_pd(zero);
+    const __m128d minV = _mm_set1_pd(min);
+    const __m128d maxV = _mm_set1_pd(max);
+
+    __m128d values[4];
+    for (qint32 i = 0; i < 4; i++) {
+        const __m128d value = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(in + (2 * i)), offsetV), scaleV);
+        values[i] = clampPd(_mm_add_pd(value, zeroV), minV, maxV);
+    }
+    return packU16(values);
+}
+
+// Convert 8 samples of Y'UV to full-range R'G'B', clamped to 0-65535
+static inline void yuvToRgbPd(const double *inY, const double *inU, const double *inV,
+                              double yOffset, double yScale, double uvScale,
+                              __m128d r[4], __m128d g[4], __m128d b[4])
+{
+    const __m128d yOffsetV = _mm_set1_pd(yOffset);
+    const __m128d yScaleV = _mm_set1_pd(yScale);
+    const __m128d uvScaleV = _mm_set1_pd(uvScale);
+    const __m128d zeroV = _mm_setzero_pd();
+    const __m128d maxV = _mm_set1_pd(65535.0);
+
+    for (qint32 i = 0; i < 4; i++) {
+        const qint32 pos = 2 * i;
+
+        // Scale Y'UV to 0-65535
+        const __m128d rY = clampPd(_mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(inY + pos), yOffsetV), yScaleV), zeroV, maxV);
+        const __m128d rU = _mm_mul_pd(_mm_loadu_pd(inU + pos), uvScaleV);
+        const __m128d rV = _mm_mul_pd(_mm_loadu_pd(inV + pos), uvScaleV);
+
+        // Convert Y'UV to R'G'B'
+        r[i] = clampPd(_mm_add_pd(rY, _mm_mul_pd(_mm_set1_pd(R_V), rV)), zeroV, maxV);
+        g[i] = clampPd(_mm_add_pd(_mm_add_pd(rY, _mm_mul_pd(_mm_set1_pd(G_U), rU)),
+                                  _mm_mul_pd(_mm_set1_pd(G_V), rV)), zeroV, maxV);
+        b[i] = clampPd(_mm_add_pd(rY, _mm_mul_pd(_mm_set1_pd(B_U), rU)), zeroV, maxV);
+    }
+}
+#endif
+
 void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_videoParameters,
                                        const OutputWriter::Configuration &_config)
 {
@@ -62,14 +154,25 @@ void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_video
     activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
     outputHeight = activeHeight;
 
-    if (config.paddingAmount > 1) {
+    // Chroma-subsampled formats need the width to be even, and 4:2:0 needs
+    // each field to have an even number of lines, so round the padding
+    // amount up to a multiple of that
+    qint32 paddingAmount = config.paddingAmount;
+    qint32 paddingMultiple = 1;
+    if (config.pixelFormat == YUV422P10) paddingMultiple = 2;
+    if (config.pixelFormat == YUV420P) paddingMultiple = 4;
+    while ((paddingAmount % paddingMultiple) != 0) {
+        paddingAmount += config.paddingAmount;
+    }
+
+    if (paddingAmount > 1) {
         // Some video codecs require the width and height of a video to be divisible by
         // a given number of samples on each axis.
-        
+
         // Expand horizontal active region so the width is divisible by the specified padding factor.
         while (true) {
             activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
-            if ((activeWidth % config.paddingAmount) == 0) {
+            if ((activeWidth % paddingAmount) == 0) {
                 break;
             }
 
@@ -84,7 +187,7 @@ void OutputWriter::updateConfiguration(LdDecodeMetaData::VideoParameters &_video
         // Insert empty padding lines so the height is divisible by by the specified padding factor.
         while (true) {
             outputHeight = topPadLines + activeHeight + bottomPadLines;
-            if ((outputHeight % config.paddingAmount) == 0) {
+            if ((outputHeight % paddingAmount) == 0) {
                 break;
             }
 
@@ -110,6 +213,10 @@ const char *OutputWriter::getPixelName() const
         return "YUV444P16";
     case GRAY16:
         return "GRAY16";
+    case YUV422P10:
+        return "YUV422P10";
+    case YUV420P:
+        return "YUV420P";
     default:
         return "unknown";
     }
@@ -178,6 +285,12 @@ QByteArray OutputWriter::getStreamHeader() const
     case GRAY16:
         str << " Cmono16 XCOLORRANGE=LIMITED";
         break;
+    case YUV422P10:
+        str << " C422p10 XCOLORRANGE=LIMITED";
+        break;
+    case YUV420P:
+        str << " C420mpeg2 XCOLORRANGE=LIMITED";
+        break;
     default:
         qFatal("pixel format not supported in yuv4mpeg header");
         break;
@@ -197,9 +310,8 @@ QByteArray OutputWriter::getFrameHeader() const
     return QStringLiteral("FRAME\n").toUtf8();
 }
 
-void OutputWriter::convert(const ComponentFrame &componentFrame, OutputFrame &outputFrame) const
+qint32 OutputWriter::getFrameSize() const
 {
-    // Work out the number of output values, and resize the vector accordingly
     qint32 totalSize = activeWidth * outputHeight;
     switch (config.pixelFormat) {
     case RGB48:
@@ -208,9 +320,29 @@ void OutputWriter::convert(const ComponentFrame &componentFrame, OutputFrame &ou
         break;
     case GRAY16:
         break;
+    case YUV422P10:
+        // Two chroma planes of half the width
+        totalSize *= 2;
+        break;
+    case YUV420P:
+        // Two chroma planes of half the width and height, with two 8-bit
+        // samples per element
+        totalSize = (totalSize + (totalSize / 2)) / 2;
+        break;
     }
-    outputFrame.resize(totalSize);
+    return totalSize;
+}
 
+void OutputWriter::convert(const ComponentFrame &componentFrame, OutputFrame &outputFrame) const
+{
+    // Work out the number of output values, and resize the vector accordingly
+    outputFrame.resize(getFrameSize());
+
+    convert(componentFrame, outputFrame.data());
+}
+
+void OutputWriter::convert(const ComponentFrame &componentFrame, quint16 *outputFrame) const
+{
     // Clear padding
     clearPadLines(0, topPadLines, outputFrame);
     clearPadLines(outputHeight - bottomPadLines, bottomPadLines, outputFrame);
@@ -219,14 +351,70 @@ void OutputWriter::convert(const ComponentFrame &componentFrame, OutputFrame &ou
     for (qint32 y = 0; y < activeHeight; y++) {
         convertLine(y, componentFrame, outputFrame);
     }
+
+    // 4:2:0 chroma lines are made from several input lines, so they're
+    // converted separately, including the padding
+    if (config.pixelFormat == YUV420P) {
+        convertChroma420(componentFrame, outputFrame);
+    }
 }
 
-void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame &outputFrame) const
+void OutputWriter::convertRgb888(const ComponentFrame &componentFrame, quint8 *out, qint32 bytesPerLine) const
+{
+    const double yOffset = videoParameters.black16bIre;
+    const double yRange = videoParameters.white16bIre - videoParameters.black16bIre;
+    const double yScale = 65535.0 / yRange;
+    const double uvScale = 65535.0 / yRange;
+
+    for (qint32 lineNumber = 0; lineNumber < activeHeight; lineNumber++) {
+        const qint32 inputLine = videoParameters.firstActiveFrameLine + lineNumber;
+        const double *inY = componentFrame.y(inputLine) + videoParameters.activeVideoStart;
+        const double *inU = componentFrame.u(inputLine) + videoParameters.activeVideoStart;
+        const double *inV = componentFrame.v(inputLine) + videoParameters.activeVideoStart;
+        quint8 *outLine = out + (static_cast<qint64>(lineNumber) * bytesPerLine);
+
+        qint32 x = 0;
+#if defined(__SSE2__)
+        for (; x + 8 <= activeWidth; x += 8) {
+            __m128d r[4], g[4], b[4];
+            yuvToRgbPd(inY + x, inU + x, inV + x, yOffset, yScale, uvScale, r, g, b);
+
+            // Keep the MSB of each component, then interleave them
+            alignas(16) quint8 rgOut[16], bOut[16];
+            _mm_store_si128(reinterpret_cast<__m128i *>(rgOut),
+                            _mm_packus_epi16(_mm_srli_epi16(packU16(r), 8), _mm_srli_epi16(packU16(g), 8)));
+            _mm_store_si128(reinterpret_cast<__m128i *>(bOut),
+                            _mm_packus_epi16(_mm_srli_epi16(packU16(b), 8), _mm_setzero_si128()));
+            quint8 *outPixel = outLine + (x * 3);
+            for (qint32 i = 0; i < 8; i++) {
+                outPixel[i * 3]     = rgOut[i];
+                outPixel[i * 3 + 1] = rgOut[i + 8];
+                outPixel[i * 3 + 2] = bOut[i];
+            }
+        }
+#endif
+
+        for (; x < activeWidth; x++) {
+            // Scale Y'UV to 0-65535
+            const double rY = qBound(0.0, (inY[x] - yOffset) * yScale, 65535.0);
+            const double rU = inU[x] * uvScale;
+            const double rV = inV[x] * uvScale;
+
+            // Convert Y'UV to R'G'B', keeping the MSB
+            const qint32 pos = x * 3;
+            outLine[pos]     = static_cast<quint8>(static_cast<quint16>(qBound(0.0, rY               + (R_V * rV),  65535.0)) >> 8);
+            outLine[pos + 1] = static_cast<quint8>(static_cast<quint16>(qBound(0.0, rY + (G_U * rU) + (G_V * rV), 65535.0)) >> 8);
+            outLine[pos + 2] = static_cast<quint8>(static_cast<quint16>(qBound(0.0, rY + (B_U * rU),               65535.0)) >> 8);
+        }
+    }
+}
+
+void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, quint16 *outputFrame) const
 {
     switch (config.pixelFormat) {
         case RGB48: {
             // Fill with RGB black
-            quint16 *out = outputFrame.data() + (activeWidth * firstLine * 3);
+            quint16 *out = outputFrame + (activeWidth * firstLine * 3);
 
             for (qint32 i = 0; i < numLines * activeWidth * 3; i++) {
                 out[i] = 0;
@@ -236,7 +424,7 @@ void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame
         }
         case YUV444P16: {
             // Fill Y with black, no chroma
-            quint16 *outY  = outputFrame.data() + (activeWidth * firstLine);
+            quint16 *outY  = outputFrame + (activeWidth * firstLine);
             quint16 *outCB = outY + (activeWidth * outputHeight);
             quint16 *outCR = outCB + (activeWidth * outputHeight);
 
@@ -250,27 +438,53 @@ void OutputWriter::clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame
         }
         case GRAY16: {
             // Fill with black
-            quint16 *out = outputFrame.data() + (activeWidth * firstLine);
+            quint16 *out = outputFrame + (activeWidth * firstLine);
 
             for (qint32 i = 0; i < numLines * activeWidth; i++) {
                 out[i] = static_cast<quint16>(Y_ZERO);
             }
 
+            break;
+        }
+        case YUV422P10: {
+            // Fill Y with black, no chroma
+            const qint32 chromaWidth = activeWidth / 2;
+            quint16 *outY  = outputFrame + (activeWidth * firstLine);
+            quint16 *outCB = outputFrame + (activeWidth * outputHeight) + (chromaWidth * firstLine);
+            quint16 *outCR = outCB + (chromaWidth * outputHeight);
+
+            for (qint32 i = 0; i < numLines * activeWidth; i++) {
+                outY[i] = static_cast<quint16>(Y_ZERO / 64.0);
+            }
+            for (qint32 i = 0; i < numLines * chromaWidth; i++) {
+                outCB[i] = static_cast<quint16>(C_ZERO / 64.0);
+                outCR[i] = static_cast<quint16>(C_ZERO / 64.0);
+            }
+
+            break;
+        }
+        case YUV420P: {
+            // Fill Y with black; chroma is done by convertChroma420
+            quint8 *outY = reinterpret_cast<quint8 *>(outputFrame) + (activeWidth * firstLine);
+
+            for (qint32 i = 0; i < numLines * activeWidth; i++) {
+                outY[i] = static_cast<quint8>(Y_ZERO / 256.0);
+            }
+
             break;
         }
     }
 }
 
-void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, OutputFrame &outputFrame) const
+void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, quint16 *outputFrame) const
 {
     // Get pointers to the component data for the active region
     const qint32 inputLine = videoParameters.firstActiveFrameLine + lineNumber;
     const double *inY = componentFrame.y(inputLine) + videoParameters.activeVideoStart;
-    // Not used if output is GRAY16
-    const double *inU = (config.pixelFormat != GRAY16) ?
-                            componentFrame.u(inputLine) + videoParameters.activeVideoStart : nullptr;
-    const double *inV = (config.pixelFormat != GRAY16) ?
-                            componentFrame.v(inputLine) + videoParameters.activeVideoStart : nullptr;
+    // Not used if output is GRAY16 or YUV420P
+    const bool needUV = config.pixelFormat != GRAY16 && config.pixelFormat != YUV420P;
+    const double *inU = needUV ? componentFrame.u(inputLine) + videoParameters.activeVideoStart : nullptr;
+    const double *inV = needUV ? componentFrame.v(inputLine) + videoParameters.activeVideoStart : nullptr;
 
     const qint32 outputLine = topPadLines + lineNumber;
 
@@ -281,12 +495,32 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
     switch (config.pixelFormat) {
         case RGB48: {
             // Convert Y'UV to full-range R'G'B' [Poynton eq 28.6 p337]
-            quint16 *out = outputFrame.data() + (activeWidth * outputLine * 3);
+            quint16 *out = outputFrame + (activeWidth * outputLine * 3);
 
             const double yScale = 65535.0 / yRange;
             const double uvScale = 65535.0 / uvRange;
 
-            for (qint32 x = 0; x < activeWidth; x++) {
+            qint32 x = 0;
+#if defined(__SSE2__)
+            for (; x + 8 <= activeWidth; x += 8) {
+                __m128d r[4], g[4], b[4];
+                yuvToRgbPd(inY + x, inU + x, inV + x, yOffset, yScale, uvScale, r, g, b);
+
+                // Interleave the components
+                alignas(16) quint16 rOut[8], gOut[8], bOut[8];
+                _mm_store_si128(reinterpret_cast<__m128i *>(rOut), packU16(r));
+                _mm_store_si128(reinterpret_cast<__m128i *>(gOut), packU16(g));
+                _mm_store_si128(reinterpret_cast<__m128i *>(bOut), packU16(b));
+                quint16 *outPixel = out + (x * 3);
+                for (qint32 i = 0; i < 8; i++) {
+                    outPixel[i * 3]     = rOut[i];
+                    outPixel[i * 3 + 1] = gOut[i];
+                    outPixel[i * 3 + 2] = bOut[i];
+                }
+            }
+#endif
+
+            for (; x < activeWidth; x++) {
                 // Scale Y'UV to 0-65535
                 const double rY = qBound(0.0, (inY[x] - yOffset) * yScale, 65535.0);
                 const double rU = inU[x] * uvScale;
@@ -294,16 +528,16 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
 
                 // Convert Y'UV to R'G'B'
                 const qint32 pos = x * 3;
-                out[pos]     = static_cast<quint16>(qBound(0.0, rY                    + (1.139883 * rV),  65535.0));
-                out[pos + 1] = static_cast<quint16>(qBound(0.0, rY + (-0.394642 * rU) + (-0.580622 * rV), 65535.0));
-                out[pos + 2] = static_cast<quint16>(qBound(0.0, rY + (2.032062 * rU),                     65535.0));
+                out[pos]     = static_cast<quint16>(qBound(0.0, rY               + (R_V * rV),  65535.0));
+                out[pos + 1] = static_cast<quint16>(qBound(0.0, rY + (G_U * rU) + (G_V * rV), 65535.0));
+                out[pos + 2] = static_cast<quint16>(qBound(0.0, rY + (B_U * rU),               65535.0));
             }
 
             break;
         }
         case YUV444P16: {
             // Convert Y'UV to Y'CbCr [Poynton eq 25.5 p307]
-            quint16 *outY  = outputFrame.data() + (activeWidth * outputLine);
+            quint16 *outY  = outputFrame + (activeWidth * outputLine);
             quint16 *outCB = outY + (activeWidth * outputHeight);
             quint16 *outCR = outCB + (activeWidth * outputHeight);
 
@@ -311,7 +545,16 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
             const double cbScale = (C_SCALE / (ONE_MINUS_Kb * kB)) / uvRange;
             const double crScale = (C_SCALE / (ONE_MINUS_Kr * kR)) / uvRange;
 
-            for (qint32 x = 0; x < activeWidth; x++) {
+            qint32 x = 0;
+#if defined(__SSE2__)
+            for (; x + 8 <= activeWidth; x += 8) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(outY + x),  scaleToU16(inY + x, yOffset, yScale,  Y_ZERO, Y_MIN, Y_MAX));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(outCB + x), scaleToU16(inU + x, 0.0,     cbScale, C_ZERO, C_MIN, C_MAX));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(outCR + x), scaleToU16(inV + x, 0.0,     crScale, C_ZERO, C_MIN, C_MAX));
+            }
+#endif
+
+            for (; x < activeWidth; x++) {
                 outY[x]  = static_cast<quint16>(qBound(Y_MIN, ((inY[x] - yOffset) * yScale)  + Y_ZERO, Y_MAX));
                 outCB[x] = static_cast<quint16>(qBound(C_MIN, (inU[x]             * cbScale) + C_ZERO, C_MAX));
                 outCR[x] = static_cast<quint16>(qBound(C_MIN, (inV[x]             * crScale) + C_ZERO, C_MAX));
@@ -321,15 +564,134 @@ void OutputWriter::convertLine(qint32 lineNumber, const ComponentFrame &componen
         }
         case GRAY16: {
             // Throw away UV and just convert Y' to the same scale as Y'CbCr
-            quint16 *out = outputFrame.data() + (activeWidth * outputLine);
+            quint16 *out = outputFrame + (activeWidth * outputLine);
 
             const double yScale = Y_SCALE / yRange;
 
-            for (qint32 x = 0; x < activeWidth; x++) {
+            qint32 x = 0;
+#if defined(__SSE2__)
+            for (; x + 8 <= activeWidth; x += 8) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), scaleToU16(inY + x, yOffset, yScale, Y_ZERO, Y_MIN, Y_MAX));
+            }
+#endif
+
+            for (; x < activeWidth; x++) {
                 out[x] = static_cast<quint16>(qBound(Y_MIN, ((inY[x] - yOffset) * yScale) + Y_ZERO, Y_MAX));
             }
 
             break;
         }
+        case YUV422P10: {
+            // Convert Y'UV to 10-bit Y'CbCr, with chroma filtered and
+            // subsampled horizontally
+            const qint32 chromaWidth = activeWidth / 2;
+            quint16 *outY  = outputFrame + (activeWidth * outputLine);
+            quint16 *outCB = outputFrame + (activeWidth * outputHeight) + (chromaWidth * outputLine);
+            quint16 *outCR = outCB + (chromaWidth * outputHeight);
+
+            const double yScale = Y_SCALE / yRange;
+            const double cbScale = (C_SCALE / (ONE_MINUS_Kb * kB)) / uvRange;
+            const double crScale = (C_SCALE / (ONE_MINUS_Kr * kR)) / uvRange;
+
+            for (qint32 x = 0; x < activeWidth; x++) {
+                outY[x] = reduceSample(((inY[x] - yOffset) * yScale) + Y_ZERO, 10, Y_MIN, Y_MAX);
+            }
+
+            QVarLengthArray<double, 1024> subU(chromaWidth), subV(chromaWidth);
+            subsampleChromaLine(inU, subU.data());
+            subsampleChromaLine(inV, subV.data());
+            for (qint32 x = 0; x < chromaWidth; x++) {
+                outCB[x] = reduceSample((subU[x] * cbScale) + C_ZERO, 10, C_MIN, C_MAX);
+                outCR[x] = reduceSample((subV[x] * crScale) + C_ZERO, 10, C_MIN, C_MAX);
+            }
+
+            break;
+        }
+        case YUV420P: {
+            // Convert Y' to 8-bit; chroma is done by convertChroma420
+            quint8 *outY = reinterpret_cast<quint8 *>(outputFrame) + (activeWidth * outputLine);
+
+            const double yScale = Y_SCALE / yRange;
+
+            for (qint32 x = 0; x < activeWidth; x++) {
+                outY[x] = static_cast<quint8>(reduceSample(((inY[x] - yOffset) * yScale) + Y_ZERO, 8, Y_MIN, Y_MAX));
+            }
+
+            break;
+        }
+    }
+}
+
+// Filter a line of chroma with a [1 2 1] / 4 kernel and keep the even
+// samples, so the chroma is co-sited with the even luma samples as in BT.601.
+// in points to the start of the active region; the output is activeWidth / 2
+// samples.
+void OutputWriter::subsampleChromaLine(const double *in, double *out) const
+{
+    const qint32 chromaWidth = activeWidth / 2;
+
+    // At the left edge, repeat the first sample rather than looking outside
+    // the active region
+    out[0] = (0.75 * in[0]) + (0.25 * in[1]);
+    for (qint32 x = 1; x < chromaWidth; x++) {
+        const qint32 pos = x * 2;
+        out[x] = (0.25 * in[pos - 1]) + (0.5 * in[pos]) + (0.25 * in[pos + 1]);
+    }
+}
+
+// Convert the chroma for a 4:2:0 frame.
+//
+// Each chroma line is made from two lines of the same field, with the
+// interlaced vertical siting MPEG-2 uses: in each group of four frame lines,
+// the first field's chroma sample sits a quarter of the way from its first
+// line to its second, and the second field's three quarters of the way.
+// Padding lines are treated as having no chroma.
+void OutputWriter::convertChroma420(const ComponentFrame &componentFrame, quint16 *outputFrame) const
+{
+    const qint32 chromaWidth = activeWidth / 2;
+    const qint32 chromaHeight = outputHeight / 2;
+    quint8 *outCB = reinterpret_cast<quint8 *>(outputFrame) + (activeWidth * outputHeight);
+    quint8 *outCR = outCB + (chromaWidth * chromaHeight);
+
+    const double uvRange = videoParameters.white16bIre - videoParameters.black16bIre;
+    const double cbScale = (C_SCALE / (ONE_MINUS_Kb * kB)) / uvRange;
+    const double crScale = (C_SCALE / (ONE_MINUS_Kr * kR)) / uvRange;
+
+    QVarLengthArray<double, 1024> subU[2], subV[2];
+    for (qint32 i = 0; i < 2; i++) {
+        subU[i].resize(chromaWidth);
+        subV[i].resize(chromaWidth);
+    }
+
+    for (qint32 chromaLine = 0; chromaLine < chromaHeight; chromaLine++) {
+        // Frame lines 4n + field and 4n + field + 2
+        const qint32 field = chromaLine % 2;
+        const qint32 firstLine = ((chromaLine / 2) * 4) + field;
+        const double weights[2] = {
+            field == 0 ? 0.75 : 0.25,
+            field == 0 ? 0.25 : 0.75,
+        };
+
+        for (qint32 i = 0; i < 2; i++) {
+            const qint32 activeLine = firstLine + (i * 2) - topPadLines;
+            if (activeLine < 0 || activeLine >= activeHeight) {
+                std::fill(subU[i].begin(), subU[i].end(), 0.0);
+                std::fill(subV[i].begin(), subV[i].end(), 0.0);
+                continue;
+            }
+
+            const qint32 inputLine = videoParameters.firstActiveFrameLine + activeLine;
+            subsampleChromaLine(componentFrame.u(inputLine) + videoParameters.activeVideoStart, subU[i].data());
+            subsampleChromaLine(componentFrame.v(inputLine) + videoParameters.activeVideoStart, subV[i].data());
+        }
+
+        quint8 *lineCB = outCB + (chromaWidth * chromaLine);
+        quint8 *lineCR = outCR + (chromaWidth * chromaLine);
+        for (qint32 x = 0; x < chromaWidth; x++) {
+            const double u = (weights[0] * subU[0][x]) + (weights[1] * subU[1][x]);
+            const double v = (weights[0] * subV[0][x]) + (weights[1] * subV[1][x]);
+            lineCB[x] = static_cast<quint8>(reduceSample((u * cbScale) + C_ZERO, 8, C_MIN, C_MAX));
+            lineCR[x] = static_cast<quint8>(reduceSample((v * crScale) + C_ZERO, 8, C_MIN, C_MAX));
+        }
     }
 }
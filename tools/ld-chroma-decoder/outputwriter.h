@@ -35,8 +35,9 @@
 class ComponentFrame;
 
 // A frame (two interlaced fields), converted to one of the supported output formats.
-// Since all the formats currently supported use 16-bit samples, this is just a
-// vector of 16-bit numbers.
+// This is a vector of 16-bit numbers. Formats with 10- or 16-bit samples store one
+// sample per element; 8-bit formats pack two samples into each element, in the
+// order they should be written out.
 using OutputFrame = QVector<quint16>;
 
 class OutputWriter {
@@ -45,7 +46,9 @@ public:
     enum PixelFormat {
         RGB48 = 0,
         YUV444P16,
-        GRAY16
+        GRAY16,
+        YUV422P10,
+        YUV420P
     };
 
     // Output settings
@@ -71,10 +74,34 @@ public:
     // For worker threads: convert a component frame to the configured output format
     void convert(const ComponentFrame &componentFrame, OutputFrame &outputFrame) const;
 
+    // As above, but convert into getFrameSize() elements at outputFrame, so
+    // the frame can go straight into its final buffer
+    void convert(const ComponentFrame &componentFrame, quint16 *outputFrame) const;
+
+    // Convert the active area of a component frame straight to 8-bit R'G'B'
+    // for display, ignoring the configured pixel format and pad lines.
+    // Each line is written to out + (line * bytesPerLine), and matches the
+    // most significant bytes of the RGB48 conversion.
+    void convertRgb888(const ComponentFrame &componentFrame, quint8 *out, qint32 bytesPerLine) const;
+
     PixelFormat getPixelFormat() const {
         return config.pixelFormat;
     }
 
+    // Get a string representing the pixel format
+    const char *getPixelName() const;
+
+    // Get the size of the output frames
+    qint32 getOutputWidth() const {
+        return activeWidth;
+    }
+    qint32 getOutputHeight() const {
+        return outputHeight;
+    }
+
+    // Get the number of elements in each OutputFrame
+    qint32 getFrameSize() const;
+
 private:
     // Configuration parameters
     Configuration config;
@@ -89,14 +116,17 @@ private:
     qint32 activeHeight;
     qint32 outputHeight;
 
-    // Get a string representing the pixel format
-    const char *getPixelName() const;
-
     // Clear padding lines
-    void clearPadLines(qint32 firstLine, qint32 numLines, OutputFrame &outputFrame) const;
+    void clearPadLines(qint32 firstLine, qint32 numLines, quint16 *outputFrame) const;
 
     // Convert one line
-    void convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, OutputFrame &outputFrame) const;
+    void convertLine(qint32 lineNumber, const ComponentFrame &componentFrame, quint16 *outputFrame) const;
+
+    // Filter and subsample one line of chroma horizontally
+    void subsampleChromaLine(const double *in, double *out) const;
+
+    // Convert the chroma for the whole frame, for 4:2:0 formats
+    void convertChroma420(const ComponentFrame &componentFrame, quint16 *outputFrame) const;
 };
 
 #endif // OUTPUTWRITER_H
@@ -35,6 +35,7 @@
 #include "transformpal2d.h"
 #include "transformpal3d.h"
 
+#include "coringfilter.h"
 #include "firfilter.h"
 
 #include "deemp.h"
@@ -43,6 +44,10 @@
 #include <cassert>
 #include <cmath>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*!
     \class PalColour
 
@@ -115,10 +120,15 @@ void PalColour::updateConfiguration(const LdDecodeMetaData::VideoParameters &_vi
     // Build the look-up tables
     buildLookUpTables();
 
+    // Compute the rotation for the chroma phase adjustment
+    const double theta = (configuration.chromaPhase * M_PI) / 180;
+    chromaPhaseCos = cos(theta);
+    chromaPhaseSin = sin(theta);
+
     if (configuration.chromaFilter == transform2DFilter || configuration.chromaFilter == transform3DFilter) {
         // Create the Transform PAL filter
         if (configuration.chromaFilter == transform2DFilter) {
-            transformPal = std::make_unique<TransformPal2D>();
+            transformPal = std::make_unique<TransformPal2D>(configuration.transformThreads);
         } else {
             transformPal = std::make_unique<TransformPal3D>();
         }
@@ -295,9 +305,8 @@ void PalColour::decodeField(const SourceField &inputField, const double *chromaD
 
         // Rotate and scale line.bp/line.bq to apply gain and phase adjustment
         const double oldBp = line.bp, oldBq = line.bq;
-        const double theta = (configuration.chromaPhase * M_PI) / 180;
-        line.bp = (oldBp * cos(theta) - oldBq * sin(theta)) * configuration.chromaGain;
-        line.bq = (oldBp * sin(theta) + oldBq * cos(theta)) * configuration.chromaGain;
+        line.bp = (oldBp * chromaPhaseCos - oldBq * chromaPhaseSin) * configuration.chromaGain;
+        line.bq = (oldBp * chromaPhaseSin + oldBq * chromaPhaseCos) * configuration.chromaGain;
 
         if (configuration.chromaFilter == palColourFilter) {
             // Decode chroma and luma from the composite signal
@@ -390,37 +399,10 @@ void PalColour::doYNR(double *Yline)
     const double irescale = (videoParameters.white16bIre - videoParameters.black16bIre) / 100;
     double nr_y = configuration.yNRLevel * irescale;
 
-    // High-pass filter for Y
-    auto yFilter(f_nrpal);
-
-    // Filter delay (since it's a symmetric FIR filter)
-    const qint32 delay = c_nrpal_b.size() / 2;
-
-    // High-pass result
-    std::vector<double> hpY(videoParameters.activeVideoEnd + delay);
-
-    // Feed zeros into the filter outside the active area
-    for (qint32 h = videoParameters.activeVideoStart - delay; h < videoParameters.activeVideoStart; h++) {
-        yFilter.feed(0.0);
-    }
-    for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-        hpY[h] = yFilter.feed(Yline[h]);
-    }
-    for (qint32 h = videoParameters.activeVideoEnd; h < videoParameters.activeVideoEnd + delay; h++) {
-        hpY[h] = yFilter.feed(0.0);
-    }
-
-    for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-        // Offset to cover the filter delay
-        double a = hpY[h + delay];
-
-        // Clip the filter strength
-        if (fabs(a) > nr_y) {
-            a = (a > 0) ? nr_y : -nr_y;
-        }
-
-        Yline[h] -= a;
-    }
+    // Core the active part of the line using a high-pass filter for Y
+    static constexpr auto yFilter = makeCoringFilter(c_nrpal_b);
+    yFilter.apply(Yline + videoParameters.activeVideoStart,
+                  videoParameters.activeVideoEnd - videoParameters.activeVideoStart, nr_y);
 }
 
 // Decode one line into componentFrame.
@@ -529,7 +511,53 @@ void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *ch
         // NB: Multiline averaging/filtering assumes perfect
         //     inter-line phase registration...
 
-        for (qint32 i = videoParameters.activeVideoStart; i < videoParameters.activeVideoEnd; i++) {
+        qint32 i = videoParameters.activeVideoStart;
+#if defined(__SSE2__)
+        // Filter two samples at a time. This does the same arithmetic in the
+        // same order as the scalar loop below, so the results are identical.
+        for (; i + 2 <= videoParameters.activeVideoEnd; i += 2) {
+            __m128d PU = _mm_setzero_pd(), QU = _mm_setzero_pd(), PV = _mm_setzero_pd(), QV = _mm_setzero_pd();
+            __m128d PY = _mm_setzero_pd(), QY = _mm_setzero_pd();
+
+            for (qint32 b = 0; b <= FILTER_SIZE; b++) {
+                const qint32 l = i - b;
+                const qint32 r = i + b;
+
+                // Sums of the samples either side of i
+                __m128d mSum[4], nSum[4];
+                for (qint32 k = 0; k < 4; k++) {
+                    mSum[k] = _mm_add_pd(_mm_loadu_pd(&m[k][r]), _mm_loadu_pd(&m[k][l]));
+                    nSum[k] = _mm_add_pd(_mm_loadu_pd(&n[k][r]), _mm_loadu_pd(&n[k][l]));
+                }
+
+                const __m128d y0 = _mm_set1_pd(yfilt[b][0]), y1 = _mm_set1_pd(yfilt[b][1]);
+                PY = _mm_add_pd(PY, _mm_add_pd(_mm_mul_pd(mSum[0], y0), _mm_mul_pd(mSum[1], y1)));
+                QY = _mm_add_pd(QY, _mm_add_pd(_mm_mul_pd(nSum[0], y0), _mm_mul_pd(nSum[1], y1)));
+
+                // Taps 0 and 1 are the same for U and V
+                const __m128d c0 = _mm_set1_pd(cfilt[b][0]), c1 = _mm_set1_pd(cfilt[b][1]);
+                const __m128d c2 = _mm_set1_pd(cfilt[b][2]), c3 = _mm_set1_pd(cfilt[b][3]);
+                const __m128d mTaps01 = _mm_add_pd(_mm_mul_pd(mSum[0], c0), _mm_mul_pd(mSum[1], c1));
+                const __m128d nTaps01 = _mm_add_pd(_mm_mul_pd(nSum[0], c0), _mm_mul_pd(nSum[1], c1));
+                const __m128d m2 = _mm_mul_pd(mSum[2], c2), m3 = _mm_mul_pd(mSum[3], c3);
+                const __m128d n2 = _mm_mul_pd(nSum[2], c2), n3 = _mm_mul_pd(nSum[3], c3);
+
+                PU = _mm_add_pd(PU, _mm_add_pd(_mm_add_pd(mTaps01, n2), n3));
+                QU = _mm_add_pd(QU, _mm_sub_pd(_mm_sub_pd(nTaps01, m2), m3));
+                PV = _mm_add_pd(PV, _mm_sub_pd(_mm_sub_pd(mTaps01, n2), n3));
+                QV = _mm_add_pd(QV, _mm_add_pd(_mm_add_pd(nTaps01, m2), m3));
+            }
+
+            _mm_storeu_pd(&pu[i], PU);
+            _mm_storeu_pd(&qu[i], QU);
+            _mm_storeu_pd(&pv[i], PV);
+            _mm_storeu_pd(&qv[i], QV);
+            _mm_storeu_pd(&py[i], PY);
+            _mm_storeu_pd(&qy[i], QY);
+        }
+#endif
+
+        for (; i < videoParameters.activeVideoEnd; i++) {
             double PU = 0, QU = 0, PV = 0, QV = 0, PY = 0, QY = 0;
 
             // Carry out 2D filtering. P and Q are the two arbitrary SINE & COS
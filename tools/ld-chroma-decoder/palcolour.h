@@ -62,6 +62,8 @@ public:
         ChromaFilterMode chromaFilter = palColourFilter;
         double transformThreshold = 0.4;
         QVector<double> transformThresholds;
+        // Number of threads the 2D Transform PAL filter uses within each field
+        qint32 transformThreads = 1;
         bool showFFTs = false;
         qint32 showPositionX = 200;
         qint32 showPositionY = 200;
@@ -110,6 +112,9 @@ private:
     // Transform PAL filter
     std::unique_ptr<TransformPal> transformPal;
 
+    // Rotation for the chroma phase adjustment
+    double chromaPhaseCos, chromaPhaseSin;
+
     // The subcarrier reference signal
     double sine[MAX_WIDTH], cosine[MAX_WIDTH];
 
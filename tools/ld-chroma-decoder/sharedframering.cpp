@@ -0,0 +1,265 @@
+/************************************************************************
+
+    sharedframering.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "sharedframering.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <cstring>
+
+// Identifies a frame ring, and the version of its layout
+static const char RING_MAGIC[8] = {'L', 'D', 'F', 'R', 'I', 'N', 'G', '\0'};
+static constexpr quint32 RING_VERSION = 2;
+
+SharedFrameRing::SharedFrameRing(const QString &_key)
+    : key(_key), memory(_key), numSlots(0), slotSize(0), frameCount(0)
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    if (memory.isAttached()) memory.detach();
+}
+
+SharedFrameRing::Header *SharedFrameRing::header()
+{
+    return static_cast<Header *>(memory.data());
+}
+
+char *SharedFrameRing::slot(quint64 frameNumber)
+{
+    return static_cast<char *>(memory.data()) + SLOT_ALIGNMENT + ((frameNumber % numSlots) * slotSize);
+}
+
+bool SharedFrameRing::create(const Format &_format, qint32 _numSlots)
+{
+    static_assert(sizeof(Header) <= SLOT_ALIGNMENT, "Header must fit before the first slot");
+
+    format = _format;
+    numSlots = _numSlots;
+    slotSize = ((format.frameSize + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT) * SLOT_ALIGNMENT;
+    frameCount = 0;
+
+    if (format.streamHeader.size() > static_cast<qint32>(sizeof(Header::streamHeader))
+        || format.frameHeader.size() > static_cast<qint32>(sizeof(Header::frameHeader))) {
+        qCritical() << "Stream headers are too long for shared memory output";
+        return false;
+    }
+
+    // Create the semaphores first, so they exist by the time a consumer can
+    // see a valid header
+    freeSlots.reset(new QSystemSemaphore(key + ".free", numSlots, QSystemSemaphore::Create));
+    usedSlots.reset(new QSystemSemaphore(key + ".used", 0, QSystemSemaphore::Create));
+    if (freeSlots->error() != QSystemSemaphore::NoError || usedSlots->error() != QSystemSemaphore::NoError) {
+        qCritical() << "Could not create semaphores for shared memory output" << key;
+        return false;
+    }
+
+    const qint64 totalSize = SLOT_ALIGNMENT + (static_cast<qint64>(numSlots) * slotSize);
+    if (!memory.create(static_cast<int>(totalSize))) {
+        // A segment left behind by a process that crashed can be cleaned up
+        // by attaching and detaching, as long as nothing else is using it
+        if (memory.error() == QSharedMemory::AlreadyExists && memory.attach()) {
+            memory.detach();
+        }
+        if (!memory.create(static_cast<int>(totalSize))) {
+            qCritical() << "Could not create shared memory output" << key << "-" << memory.errorString();
+            return false;
+        }
+    }
+
+    memory.lock();
+    Header *h = header();
+    std::memset(h, 0, sizeof(Header));
+    h->version = RING_VERSION;
+    h->numSlots = static_cast<quint32>(numSlots);
+    h->slotSize = static_cast<quint32>(slotSize);
+    h->width = format.width;
+    h->height = format.height;
+    h->pixelFormat = format.pixelFormat;
+    h->frameSize = format.frameSize;
+    h->streamHeaderSize = static_cast<quint32>(format.streamHeader.size());
+    std::memcpy(h->streamHeader, format.streamHeader.constData(), format.streamHeader.size());
+    h->frameHeaderSize = static_cast<quint32>(format.frameHeader.size());
+    std::memcpy(h->frameHeader, format.frameHeader.constData(), format.frameHeader.size());
+    std::memcpy(h->magic, RING_MAGIC, sizeof(RING_MAGIC));
+    memory.unlock();
+
+    return true;
+}
+
+char *SharedFrameRing::beginWrite()
+{
+    if (!freeSlots->acquire()) {
+        qCritical() << "Waiting for shared memory output failed:" << freeSlots->errorString();
+        return nullptr;
+    }
+
+    return slot(frameCount);
+}
+
+bool SharedFrameRing::endWrite()
+{
+    frameCount++;
+
+    memory.lock();
+    header()->framesWritten = frameCount;
+    memory.unlock();
+
+    return usedSlots->release();
+}
+
+bool SharedFrameRing::finish(qint32 timeoutMs)
+{
+    memory.lock();
+    header()->finished = 1;
+    memory.unlock();
+
+    if (!usedSlots->release()) {
+        qCritical() << "Finishing shared memory output failed:" << usedSlots->errorString();
+        return false;
+    }
+
+    // Wait for the consumer to read every frame, so the ring isn't removed
+    // while it still needs it. This polls the read count rather than waiting
+    // on the semaphore, so it can give up if the consumer has gone away.
+    QElapsedTimer timer;
+    timer.start();
+    while (true) {
+        memory.lock();
+        const bool drained = header()->framesRead >= header()->framesWritten;
+        memory.unlock();
+
+        if (drained) return true;
+        if (timer.hasExpired(timeoutMs)) {
+            qCritical() << "Timed out waiting for the shared memory output to be read";
+            return false;
+        }
+        QThread::msleep(10);
+    }
+}
+
+void SharedFrameRing::abort()
+{
+    memory.lock();
+    header()->finished = 1;
+    header()->aborted = 1;
+    memory.unlock();
+
+    // Wake the consumer if it's waiting for a frame
+    usedSlots->release();
+}
+
+bool SharedFrameRing::attach(qint32 timeoutMs)
+{
+    // Wait for the producer to create the segment and fill in the header
+    QElapsedTimer timer;
+    timer.start();
+    bool ready = false;
+    while (!ready) {
+        if (memory.isAttached() || memory.attach()) {
+            memory.lock();
+            ready = std::memcmp(header()->magic, RING_MAGIC, sizeof(RING_MAGIC)) == 0;
+            memory.unlock();
+        }
+
+        if (!ready) {
+            if (timer.hasExpired(timeoutMs)) {
+                qCritical() << "Timed out waiting for shared memory output" << key;
+                return false;
+            }
+            QThread::msleep(100);
+        }
+    }
+
+    const Header *h = header();
+    if (h->version != RING_VERSION) {
+        qCritical() << "Shared memory output" << key << "has an unsupported version";
+        return false;
+    }
+
+    numSlots = static_cast<qint32>(h->numSlots);
+    slotSize = static_cast<qint32>(h->slotSize);
+    format.width = h->width;
+    format.height = h->height;
+    format.pixelFormat = h->pixelFormat;
+    format.frameSize = h->frameSize;
+    format.streamHeader = QByteArray(h->streamHeader, static_cast<int>(h->streamHeaderSize));
+    format.frameHeader = QByteArray(h->frameHeader, static_cast<int>(h->frameHeaderSize));
+    frameCount = 0;
+
+    freeSlots.reset(new QSystemSemaphore(key + ".free", 0, QSystemSemaphore::Open));
+    usedSlots.reset(new QSystemSemaphore(key + ".used", 0, QSystemSemaphore::Open));
+    if (freeSlots->error() != QSystemSemaphore::NoError || usedSlots->error() != QSystemSemaphore::NoError) {
+        qCritical() << "Could not open semaphores for shared memory output" << key;
+        return false;
+    }
+
+    return true;
+}
+
+const char *SharedFrameRing::beginRead()
+{
+    // If this fails, the producer may have finished and removed the
+    // semaphore, which isFinished will show
+    if (!usedSlots->acquire()) return nullptr;
+
+    memory.lock();
+    const bool available = frameCount < header()->framesWritten && header()->aborted == 0;
+    memory.unlock();
+
+    if (!available) return nullptr;
+    return slot(frameCount);
+}
+
+bool SharedFrameRing::endRead()
+{
+    frameCount++;
+
+    memory.lock();
+    header()->framesRead = frameCount;
+    memory.unlock();
+
+    return freeSlots->release();
+}
+
+bool SharedFrameRing::isFinished()
+{
+    memory.lock();
+    const bool finished = header()->finished != 0 && frameCount >= header()->framesWritten;
+    memory.unlock();
+
+    return finished;
+}
+
+bool SharedFrameRing::isAborted()
+{
+    memory.lock();
+    const bool aborted = header()->aborted != 0;
+    memory.unlock();
+
+    return aborted;
+}
@@ -0,0 +1,153 @@
+/************************************************************************
+
+    sharedframering.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QSharedMemory>
+#include <QString>
+#include <QSystemSemaphore>
+
+#include <memory>
+
+// A ring buffer of output frames in shared memory, for passing frames from
+// ld-chroma-decoder to another process on the same machine without copying
+// them through a pipe.
+//
+// The shared memory segment starts with a fixed-size Header describing the
+// stream, followed by numSlots frame slots of slotSize bytes each. Frames are
+// written to slots in order, wrapping around. Two system semaphores, named
+// after the key with ".free" and ".used" appended, count the free and filled
+// slots; the producer waits on .free before writing a slot and releases .used
+// afterwards, and the consumer does the opposite. At the end of the stream,
+// the producer sets the finished flag and releases .used once more; if it
+// gives up part way through, it sets the aborted flag too, and the consumer
+// should treat the output as incomplete.
+//
+// There is exactly one producer and one consumer. The consumer must keep
+// reading until the end of the stream, or the producer will block; when the
+// stream finishes cleanly, the producer waits (for a limited time) for the
+// consumer to read every frame before removing the ring.
+class SharedFrameRing
+{
+public:
+    // Default number of frame slots
+    static constexpr qint32 DEFAULT_SLOTS = 8;
+
+    // Default time for finish to wait for the consumer, in milliseconds
+    static constexpr qint32 DEFAULT_DRAIN_TIMEOUT = 30000;
+
+    // Description of the frames in the ring
+    struct Format {
+        qint32 width = 0;
+        qint32 height = 0;
+        qint32 pixelFormat = 0;     // OutputWriter::PixelFormat
+        qint32 frameSize = 0;       // bytes
+        QByteArray streamHeader;    // written once before the first frame
+        QByteArray frameHeader;     // written before each frame
+    };
+
+    explicit SharedFrameRing(const QString &key);
+    ~SharedFrameRing();
+
+    // Producer: create the ring. Returns true on success; on failure, prints
+    // a message and returns false.
+    bool create(const Format &format, qint32 numSlots = DEFAULT_SLOTS);
+
+    // Producer: wait for a free slot, and return a pointer to it, or nullptr
+    // on failure. Fill in the frame, then call endWrite.
+    char *beginWrite();
+    bool endWrite();
+
+    // Producer: mark the end of the stream, and wait up to timeoutMs for the
+    // consumer to read the remaining frames. Returns true on success; on
+    // failure or timeout, prints a message and returns false.
+    bool finish(qint32 timeoutMs = DEFAULT_DRAIN_TIMEOUT);
+
+    // Producer: mark the stream as ended early because of an error. This
+    // doesn't wait for the consumer.
+    void abort();
+
+    // Consumer: attach to an existing ring, waiting up to timeoutMs for the
+    // producer to create it. Returns true on success; on failure, prints a
+    // message and returns false.
+    bool attach(qint32 timeoutMs);
+
+    // Consumer: wait for a filled slot, and return a pointer to it, or
+    // nullptr at the end of the stream or on failure (check isFinished to
+    // tell which). Once the frame has been used, call endRead.
+    const char *beginRead();
+    bool endRead();
+    bool isFinished();
+    bool isAborted();
+
+    // Get the format of the frames (after create or attach)
+    const Format &getFormat() const {
+        return format;
+    }
+
+private:
+    // Layout of the start of the shared memory segment
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 numSlots;
+        quint32 slotSize;
+        qint32 width;
+        qint32 height;
+        qint32 pixelFormat;
+        qint32 frameSize;
+        quint32 streamHeaderSize;
+        char streamHeader[256];
+        quint32 frameHeaderSize;
+        char frameHeader[32];
+
+        // Guarded by the QSharedMemory lock
+        quint64 framesWritten;
+        quint64 framesRead;
+        quint32 finished;
+        quint32 aborted;
+    };
+
+    // Offset of the first slot; slots are aligned to this too
+    static constexpr qint32 SLOT_ALIGNMENT = 4096;
+
+    QString key;
+    QSharedMemory memory;
+    std::unique_ptr<QSystemSemaphore> freeSlots;
+    std::unique_ptr<QSystemSemaphore> usedSlots;
+    Format format;
+    qint32 numSlots;
+    qint32 slotSize;
+
+    // The number of frames this side has written or read
+    quint64 frameCount;
+
+    Header *header();
+    char *slot(quint64 frameNumber);
+};
+
+#endif // SHAREDFRAMERING_H
@@ -0,0 +1,176 @@
+/************************************************************************
+
+    main.cpp
+
+    ld-chroma-shm-reader - Reference reader for shared memory output
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-shm-reader is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QtGlobal>
+#include <QCommandLineParser>
+#include <cstdio>
+
+#ifdef _WIN32
+	#include <io.h>
+	#include <fcntl.h>
+#endif
+
+#include "logging.h"
+
+#include "sharedframering.h"
+
+int main(int argc, char *argv[])
+{
+	#ifdef _WIN32
+	_setmode(_fileno(stdout), O_BINARY);
+	#endif
+    // Install the local debug message handler
+    setDebug(true);
+    qInstallMessageHandler(debugOutputHandler);
+
+    QCoreApplication a(argc, argv);
+
+    // Set application name and version
+    QCoreApplication::setApplicationName("ld-chroma-shm-reader");
+    QCoreApplication::setApplicationVersion(QString("Branch: %1 / Commit: %2").arg(APP_BRANCH, APP_COMMIT));
+    QCoreApplication::setOrganizationDomain("domesday86.com");
+
+    // Set up the command line parser
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+                "ld-chroma-shm-reader - Reference reader for ld-chroma-decoder shared memory output\n"
+                "\n"
+                "Reads frames from ld-chroma-decoder --output-shm, and writes them out\n"
+                "exactly as ld-chroma-decoder would have written them to a file.\n"
+                "\n"
+                "(c)2026 ld-decode-tools contributors\n"
+                "GPLv3 Open-Source - github: https://github.com/happycube/ld-decode");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    // Add the standard debug options --debug and --quiet
+    addStandardDebugOptions(parser);
+
+    // Option to set how long to wait for the decoder (--timeout)
+    QCommandLineOption timeoutOption(QStringList() << "timeout",
+                                     QCoreApplication::translate("main", "Seconds to wait for the decoder to start (default 30)"),
+                                     QCoreApplication::translate("main", "seconds"));
+    parser.addOption(timeoutOption);
+
+    // Positional argument to specify the shared memory name
+    parser.addPositionalArgument("name", QCoreApplication::translate("main", "Specify the name given to ld-chroma-decoder --output-shm"));
+
+    // Positional argument to specify output video file
+    parser.addPositionalArgument("output", QCoreApplication::translate("main", "Specify output file (omit or - for piped output)"));
+
+    // Process the command line options and arguments given by the user
+    parser.process(a);
+
+    // Standard logging options
+    processStandardDebugOptions(parser);
+
+    // Get the arguments from the parser
+    QString key;
+    QString outputFileName = "-";
+    QStringList positionalArguments = parser.positionalArguments();
+    if (positionalArguments.count() == 2) {
+        key = positionalArguments.at(0);
+        outputFileName = positionalArguments.at(1);
+    } else if (positionalArguments.count() == 1) {
+        key = positionalArguments.at(0);
+    } else {
+        // Quit with error
+        qCritical("You must specify the shared memory name");
+        return -1;
+    }
+
+    qint32 timeoutSecs = 30;
+    if (parser.isSet(timeoutOption)) {
+        timeoutSecs = parser.value(timeoutOption).toInt();
+        if (timeoutSecs < 0) {
+            // Quit with error
+            qCritical("Timeout must be at least 0");
+            return -1;
+        }
+    }
+
+    // Open the output file
+    QFile outputFile;
+    if (outputFileName == "-") {
+        if (!outputFile.open(stdout, QIODevice::WriteOnly)) {
+            qCritical() << "Could not open stdout for output";
+            return -1;
+        }
+    } else {
+        outputFile.setFileName(outputFileName);
+        if (!outputFile.open(QIODevice::WriteOnly)) {
+            qCritical() << "Could not open" << outputFileName << "for output";
+            return -1;
+        }
+    }
+
+    // Attach to the ring
+    SharedFrameRing ring(key);
+    if (!ring.attach(timeoutSecs * 1000)) {
+        return -1;
+    }
+    const SharedFrameRing::Format &format = ring.getFormat();
+    qInfo() << "Reading" << format.width << "x" << format.height << "frames from shared memory" << key;
+
+    if (format.streamHeader.size() != 0 && outputFile.write(format.streamHeader) == -1) {
+        qCritical() << "Writing to the output file failed";
+        return -1;
+    }
+
+    // Copy frames until the decoder says it's finished
+    qint32 frameCount = 0;
+    while (true) {
+        const char *frame = ring.beginRead();
+        if (frame == nullptr) {
+            if (ring.isAborted()) {
+                qCritical() << "The decoder stopped before the end of the stream, after" << frameCount << "frames";
+                return -1;
+            }
+            if (ring.isFinished()) break;
+
+            qCritical() << "Reading from shared memory failed";
+            return -1;
+        }
+
+        const bool written = (format.frameHeader.size() == 0 || outputFile.write(format.frameHeader) != -1)
+                             && outputFile.write(frame, format.frameSize) != -1;
+
+        // Always hand the slot back, so the decoder isn't left waiting for it
+        ring.endRead();
+        if (!written) {
+            qCritical() << "Writing to the output file failed";
+            return -1;
+        }
+        frameCount++;
+    }
+
+    outputFile.close();
+    qInfo() << "Read" << frameCount << "frames";
+
+    // Quit with success
+    return 0;
+}
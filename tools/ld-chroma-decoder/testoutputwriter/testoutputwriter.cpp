@@ -0,0 +1,422 @@
+/************************************************************************
+
+    testoutputwriter.cpp
+
+    Unit tests for OutputWriter
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::cerr;
+
+#include "componentframe.h"
+#include "outputwriter.h"
+
+// This is the original scalar conversion code from OutputWriter::convertLine,
+// converting one sample of the given component.
+static quint16 referenceConvert(OutputWriter::PixelFormat pixelFormat, qint32 component,
+                                double y, double u, double v, double yOffset, double yRange)
+{
+    static constexpr double Y_MIN   = 1.0    * 256.0;
+    static constexpr double Y_ZERO  = 16.0   * 256.0;
+    static constexpr double Y_SCALE = 219.0  * 256.0;
+    static constexpr double Y_MAX   = 254.75 * 256.0;
+    static constexpr double C_MIN   = 1.0    * 256.0;
+    static constexpr double C_ZERO  = 128.0  * 256.0;
+    static constexpr double C_SCALE = 112.0  * 256.0;
+    static constexpr double C_MAX   = 254.75 * 256.0;
+    static constexpr double ONE_MINUS_Kb = 1.0 - 0.114;
+    static constexpr double ONE_MINUS_Kr = 1.0 - 0.299;
+    static constexpr double kB = 0.49211104112248356308804691718185;
+    static constexpr double kR = 0.87728321993817866838972487283129;
+
+    const double uvRange = yRange;
+
+    if (pixelFormat == OutputWriter::RGB48) {
+        const double yScale = 65535.0 / yRange;
+        const double uvScale = 65535.0 / uvRange;
+        const double rY = qBound(0.0, (y - yOffset) * yScale, 65535.0);
+        const double rU = u * uvScale;
+        const double rV = v * uvScale;
+
+        switch (component) {
+        case 0:
+            return static_cast<quint16>(qBound(0.0, rY                    + (1.139883 * rV),  65535.0));
+        case 1:
+            return static_cast<quint16>(qBound(0.0, rY + (-0.394642 * rU) + (-0.580622 * rV), 65535.0));
+        default:
+            return static_cast<quint16>(qBound(0.0, rY + (2.032062 * rU),                     65535.0));
+        }
+    }
+
+    const double yScale = Y_SCALE / yRange;
+    const double cbScale = (C_SCALE / (ONE_MINUS_Kb * kB)) / uvRange;
+    const double crScale = (C_SCALE / (ONE_MINUS_Kr * kR)) / uvRange;
+
+    switch (component) {
+    case 0:
+        return static_cast<quint16>(qBound(Y_MIN, ((y - yOffset) * yScale)  + Y_ZERO, Y_MAX));
+    case 1:
+        return static_cast<quint16>(qBound(C_MIN, (u             * cbScale) + C_ZERO, C_MAX));
+    default:
+        return static_cast<quint16>(qBound(C_MIN, (v             * crScale) + C_ZERO, C_MAX));
+    }
+}
+
+// Set up VideoParameters for a PAL 4fsc frame with the given active width
+static LdDecodeMetaData::VideoParameters palVideoParameters(qint32 activeWidth)
+{
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = PAL;
+    videoParameters.fieldWidth = 1135;
+    videoParameters.fieldHeight = 313;
+    videoParameters.activeVideoStart = 185;
+    videoParameters.activeVideoEnd = 185 + activeWidth;
+    videoParameters.firstActiveFrameLine = 44;
+    videoParameters.lastActiveFrameLine = 620;
+    videoParameters.white16bIre = 54016;
+    videoParameters.black16bIre = 16384;
+    return videoParameters;
+}
+
+// Fill a frame with random samples, including out-of-range values
+static void fillRandom(ComponentFrame &componentFrame, quint32 seed)
+{
+    std::mt19937 randomEngine(seed);
+    std::uniform_real_distribution<double> yDistribution(0.0, 70000.0);
+    std::uniform_real_distribution<double> uvDistribution(-50000.0, 50000.0);
+    for (qint32 line = 0; line < componentFrame.getHeight(); line++) {
+        double *y = componentFrame.y(line);
+        double *u = componentFrame.u(line);
+        double *v = componentFrame.v(line);
+        for (qint32 x = 0; x < componentFrame.getWidth(); x++) {
+            y[x] = yDistribution(randomEngine);
+            u[x] = uvDistribution(randomEngine);
+            v[x] = uvDistribution(randomEngine);
+        }
+    }
+}
+
+// Convert a frame of random samples (including out-of-range values) with
+// OutputWriter, and check the result against the scalar conversion
+void testConvert(OutputWriter::PixelFormat pixelFormat, qint32 activeWidth)
+{
+    cerr << "Testing pixel format " << pixelFormat << " with width " << activeWidth << "\n";
+
+    // PAL video, with no padding so the output is exactly the active area
+    LdDecodeMetaData::VideoParameters videoParameters = palVideoParameters(activeWidth);
+
+    OutputWriter::Configuration config;
+    config.paddingAmount = 1;
+    config.pixelFormat = pixelFormat;
+    OutputWriter outputWriter;
+    outputWriter.updateConfiguration(videoParameters, config);
+
+    // Fill the frame with random samples
+    ComponentFrame componentFrame;
+    componentFrame.init(videoParameters);
+    fillRandom(componentFrame, activeWidth);
+
+    OutputFrame outputFrame;
+    outputWriter.convert(componentFrame, outputFrame);
+
+    const qint32 activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
+    const qint32 numComponents = (pixelFormat == OutputWriter::GRAY16) ? 1 : 3;
+    if (outputFrame.size() != activeWidth * activeHeight * numComponents) {
+        cerr << "Output frame has the wrong size\n";
+        exit(1);
+    }
+
+    const double yOffset = videoParameters.black16bIre;
+    const double yRange = videoParameters.white16bIre - videoParameters.black16bIre;
+
+    for (qint32 line = 0; line < activeHeight; line++) {
+        const qint32 inputLine = videoParameters.firstActiveFrameLine + line;
+        const double *y = componentFrame.y(inputLine) + videoParameters.activeVideoStart;
+        const double *u = componentFrame.u(inputLine) + videoParameters.activeVideoStart;
+        const double *v = componentFrame.v(inputLine) + videoParameters.activeVideoStart;
+
+        for (qint32 x = 0; x < activeWidth; x++) {
+            for (qint32 component = 0; component < numComponents; component++) {
+                qint32 pos;
+                if (pixelFormat == OutputWriter::RGB48) {
+                    // Interleaved
+                    pos = (((line * activeWidth) + x) * 3) + component;
+                } else {
+                    // Planar
+                    pos = (component * activeWidth * activeHeight) + (line * activeWidth) + x;
+                }
+
+                // Allow 1 LSB of difference, in case the compiler has
+                // contracted the scalar code into fused multiply-adds
+                const qint32 expected = referenceConvert(pixelFormat, component, y[x], u[x], v[x], yOffset, yRange);
+                if (qAbs(outputFrame[pos] - expected) > 1) {
+                    cerr << "Mismatch at line " << line << " x " << x << " component " << component
+                         << ": got " << outputFrame[pos] << ", expected " << expected << "\n";
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+// Work out one subsampled chroma sample the straightforward way. Horizontally,
+// each sample is the [1 2 1] / 4 filtered value at an even luma position, with
+// the edge sample repeated outside the active region. For 4:2:0, each chroma
+// line is interpolated from the two nearest lines of its own field at the
+// interlaced MPEG-2 siting: frame line 4n + 0.5 for the first field's chroma,
+// and 4n + 2.5 for the second field's.
+static void referenceSubsample(const ComponentFrame &componentFrame, const LdDecodeMetaData::VideoParameters &videoParameters,
+                               bool is420, qint32 chromaLine, qint32 chromaX, double &u, double &v)
+{
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+
+    auto filter = [&](const double *in) {
+        const qint32 pos = chromaX * 2;
+        const double left = in[qMax(pos - 1, 0)];
+        const double right = in[qMin(pos + 1, activeWidth - 1)];
+        return (left + (2.0 * in[pos]) + right) / 4.0;
+    };
+    auto filterLine = [&](qint32 activeLine, double &lineU, double &lineV) {
+        const qint32 inputLine = videoParameters.firstActiveFrameLine + activeLine;
+        lineU = filter(componentFrame.u(inputLine) + videoParameters.activeVideoStart);
+        lineV = filter(componentFrame.v(inputLine) + videoParameters.activeVideoStart);
+    };
+
+    if (!is420) {
+        filterLine(chromaLine, u, v);
+        return;
+    }
+
+    const qint32 field = chromaLine % 2;
+    const qint32 upperLine = ((chromaLine / 2) * 4) + field;
+    const double siting = ((chromaLine / 2) * 4) + (field == 0 ? 0.5 : 2.5);
+    const double lowerWeight = (siting - upperLine) / 2.0;
+
+    double upperU, upperV, lowerU, lowerV;
+    filterLine(upperLine, upperU, upperV);
+    filterLine(upperLine + 2, lowerU, lowerV);
+    u = ((1.0 - lowerWeight) * upperU) + (lowerWeight * lowerU);
+    v = ((1.0 - lowerWeight) * upperV) + (lowerWeight * lowerV);
+}
+
+// Convert a frame with random luma and chroma to a subsampled format, and
+// check the result against the scalar conversion of the reference-subsampled
+// chroma, reduced to 10 or 8 bits
+void testSubsampled(OutputWriter::PixelFormat pixelFormat, qint32 activeWidth)
+{
+    cerr << "Testing pixel format " << pixelFormat << " with width " << activeWidth << "\n";
+
+    const bool is420 = (pixelFormat == OutputWriter::YUV420P);
+    const qint32 shift = is420 ? 8 : 6;
+
+    LdDecodeMetaData::VideoParameters videoParameters = palVideoParameters(activeWidth);
+
+    OutputWriter::Configuration config;
+    config.paddingAmount = 1;
+    config.pixelFormat = pixelFormat;
+    OutputWriter outputWriter;
+    outputWriter.updateConfiguration(videoParameters, config);
+
+    // The writer must have made the width even
+    const qint32 outputWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+    if ((outputWidth % 2) != 0) {
+        cerr << "Output width " << outputWidth << " is not even\n";
+        exit(1);
+    }
+
+    // Fill the chroma with random samples small enough that few of them are
+    // clipped after filtering, so errors in the filter show up
+    ComponentFrame componentFrame;
+    componentFrame.init(videoParameters);
+    fillRandom(componentFrame, activeWidth);
+    std::mt19937 randomEngine(activeWidth);
+    std::uniform_real_distribution<double> uvDistribution(-15000.0, 15000.0);
+    for (qint32 line = 0; line < componentFrame.getHeight(); line++) {
+        double *u = componentFrame.u(line);
+        double *v = componentFrame.v(line);
+        for (qint32 x = 0; x < componentFrame.getWidth(); x++) {
+            u[x] = uvDistribution(randomEngine);
+            v[x] = uvDistribution(randomEngine);
+        }
+    }
+
+    OutputFrame outputFrame;
+    outputWriter.convert(componentFrame, outputFrame);
+
+    const qint32 activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
+    const qint32 chromaWidth = outputWidth / 2;
+    const qint32 chromaHeight = is420 ? activeHeight / 2 : activeHeight;
+    const qint32 totalSamples = (outputWidth * activeHeight) + (2 * chromaWidth * chromaHeight);
+    if (outputFrame.size() != (is420 ? totalSamples / 2 : totalSamples)) {
+        cerr << "Output frame has the wrong size\n";
+        exit(1);
+    }
+
+    // Read a sample, whether the format uses 8- or 16-bit elements
+    const quint8 *bytes = reinterpret_cast<const quint8 *>(outputFrame.constData());
+    auto sample = [&](qint32 pos) -> qint32 {
+        return is420 ? bytes[pos] : outputFrame[pos];
+    };
+
+    const double yOffset = videoParameters.black16bIre;
+    const double yRange = videoParameters.white16bIre - videoParameters.black16bIre;
+    auto check = [&](qint32 pos, qint32 expected16, const char *what) {
+        // Allow 1 LSB of difference for rounding
+        const qint32 expected = (expected16 + (1 << (shift - 1))) >> shift;
+        if (qAbs(sample(pos) - expected) > 1) {
+            cerr << "Mismatch in " << what << " at " << pos << ": got " << sample(pos) << ", expected " << expected << "\n";
+            exit(1);
+        }
+    };
+
+    for (qint32 line = 0; line < activeHeight; line++) {
+        const double *y = componentFrame.y(videoParameters.firstActiveFrameLine + line) + videoParameters.activeVideoStart;
+        for (qint32 x = 0; x < outputWidth; x++) {
+            check((line * outputWidth) + x, referenceConvert(OutputWriter::YUV444P16, 0, y[x], 0.0, 0.0, yOffset, yRange), "Y");
+        }
+    }
+
+    const qint32 cbStart = outputWidth * activeHeight;
+    const qint32 crStart = cbStart + (chromaWidth * chromaHeight);
+    for (qint32 chromaLine = 0; chromaLine < chromaHeight; chromaLine++) {
+        for (qint32 x = 0; x < chromaWidth; x++) {
+            double u, v;
+            referenceSubsample(componentFrame, videoParameters, is420, chromaLine, x, u, v);
+
+            const qint32 pos = (chromaLine * chromaWidth) + x;
+            check(cbStart + pos, referenceConvert(OutputWriter::YUV444P16, 1, 0.0, u, v, yOffset, yRange), "Cb");
+            check(crStart + pos, referenceConvert(OutputWriter::YUV444P16, 2, 0.0, u, v, yOffset, yRange), "Cr");
+        }
+    }
+}
+
+// Convert a frame straight to 8-bit RGB, and check the result is the MSB of
+// the RGB48 conversion
+void testRgb888(qint32 activeWidth)
+{
+    cerr << "Testing 8-bit RGB with width " << activeWidth << "\n";
+
+    LdDecodeMetaData::VideoParameters videoParameters = palVideoParameters(activeWidth);
+    OutputWriter::Configuration config;
+    config.paddingAmount = 1;
+    config.pixelFormat = OutputWriter::RGB48;
+    OutputWriter outputWriter;
+    outputWriter.updateConfiguration(videoParameters, config);
+
+    ComponentFrame componentFrame;
+    componentFrame.init(videoParameters);
+    fillRandom(componentFrame, activeWidth);
+
+    OutputFrame outputFrame;
+    outputWriter.convert(componentFrame, outputFrame);
+
+    // Leave some spare bytes at the end of each line, which shouldn't be touched
+    const qint32 activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
+    const qint32 bytesPerLine = (activeWidth * 3) + 5;
+    std::vector<quint8> rgb888(bytesPerLine * activeHeight, 0xAA);
+    outputWriter.convertRgb888(componentFrame, rgb888.data(), bytesPerLine);
+
+    for (qint32 line = 0; line < activeHeight; line++) {
+        for (qint32 i = 0; i < bytesPerLine; i++) {
+            const qint32 expected = (i < activeWidth * 3) ? (outputFrame[(line * activeWidth * 3) + i] >> 8) : 0xAA;
+            const qint32 got = rgb888[(line * bytesPerLine) + i];
+            if (got != expected) {
+                cerr << "Mismatch at line " << line << " byte " << i << ": got " << got << ", expected " << expected << "\n";
+                exit(1);
+            }
+        }
+    }
+}
+
+// Report how long it takes to convert a full PAL 4fsc frame for display,
+// through RGB48 as ld-analyse used to, and straight to 8-bit RGB
+void benchmarkRgb888()
+{
+    using std::chrono::steady_clock;
+
+    LdDecodeMetaData::VideoParameters videoParameters = palVideoParameters(922);
+    OutputWriter::Configuration config;
+    config.paddingAmount = 1;
+    config.pixelFormat = OutputWriter::RGB48;
+    OutputWriter outputWriter;
+    outputWriter.updateConfiguration(videoParameters, config);
+
+    ComponentFrame componentFrame;
+    componentFrame.init(videoParameters);
+    fillRandom(componentFrame, 1);
+
+    const qint32 activeWidth = outputWriter.getOutputWidth();
+    const qint32 activeHeight = outputWriter.getOutputHeight();
+    std::vector<quint8> rgb888(activeWidth * 3 * activeHeight);
+    const qint32 numFrames = 200;
+
+    auto report = [&](const char *name, steady_clock::time_point startTime) {
+        const double seconds = std::chrono::duration<double>(steady_clock::now() - startTime).count();
+        cerr << name << ": " << (seconds * 1000.0 / numFrames) << " ms/frame\n";
+    };
+
+    auto startTime = steady_clock::now();
+    OutputFrame outputFrame;
+    for (qint32 i = 0; i < numFrames; i++) {
+        outputWriter.convert(componentFrame, outputFrame);
+        const quint16 *in = outputFrame.constData();
+        for (qint32 j = 0; j < activeWidth * 3 * activeHeight; j++) {
+            rgb888[j] = static_cast<quint8>(in[j] / 256);
+        }
+    }
+    report("RGB48 then MSB", startTime);
+
+    startTime = steady_clock::now();
+    for (qint32 i = 0; i < numFrames; i++) {
+        outputWriter.convertRgb888(componentFrame, rgb888.data(), activeWidth * 3);
+    }
+    report("Direct 8-bit RGB", startTime);
+}
+
+int main(int argc, char *argv[])
+{
+    // Try widths that do and don't fill whole SIMD blocks
+    for (OutputWriter::PixelFormat pixelFormat : {OutputWriter::RGB48, OutputWriter::YUV444P16, OutputWriter::GRAY16}) {
+        for (qint32 activeWidth : {922, 928, 931}) {
+            testConvert(pixelFormat, activeWidth);
+        }
+    }
+    for (OutputWriter::PixelFormat pixelFormat : {OutputWriter::YUV422P10, OutputWriter::YUV420P}) {
+        for (qint32 activeWidth : {922, 931}) {
+            testSubsampled(pixelFormat, activeWidth);
+        }
+    }
+    for (qint32 activeWidth : {922, 928, 931}) {
+        testRgb888(activeWidth);
+    }
+
+    // Run the benchmark if asked to
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkRgb888();
+    }
+
+    return 0;
+}
@@ -0,0 +1,324 @@
+/************************************************************************
+
+    testpalcolour.cpp
+
+    Unit tests for PalColour
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using std::cerr;
+
+#include "componentframe.h"
+#include "deemp.h"
+#include "palcolour.h"
+#include "sourcefield.h"
+
+// This is the original scalar implementation of PalColour's 2D filter
+// decoder, used as a reference for the optimised version.
+class ReferencePalColour
+{
+public:
+    ReferencePalColour(const LdDecodeMetaData::VideoParameters &_videoParameters,
+                       const PalColour::Configuration &_configuration)
+        : videoParameters(_videoParameters), configuration(_configuration)
+    {
+        for (qint32 i = 0; i < videoParameters.fieldWidth; i++) {
+            const double rad = 2 * M_PI * i * videoParameters.fSC / videoParameters.sampleRate;
+            sine[i] = sin(rad);
+            cosine[i] = cos(rad);
+        }
+
+        const double chromaBandwidthHz = 1100000.0 / 0.93;
+        const double ca = 0.5 * videoParameters.sampleRate / chromaBandwidthHz;
+        const double ya = 0.5 * videoParameters.sampleRate / chromaBandwidthHz;
+
+        double cdiv = 0, ydiv = 0;
+        for (qint32 f = 0; f <= FILTER_SIZE; f++) {
+            const double fc   = qMin(ca, static_cast<double>(f));
+            const double ff   = qMin(ca, sqrt(f * f + 2 * 2));
+            const double fff  = qMin(ca, sqrt(f * f + 4 * 4));
+            const double ffff = qMin(ca, sqrt(f * f + 6 * 6));
+            const qint32 d = (f == 0) ? 2 : 1;
+            cfilt[f][0] = (1 + cos(M_PI * fc   / ca)) / d;
+            cfilt[f][2] = (1 + cos(M_PI * ff   / ca)) / d;
+            cfilt[f][1] = (1 + cos(M_PI * fff  / ca)) / d;
+            cfilt[f][3] = (1 + cos(M_PI * ffff / ca)) / d;
+            cdiv += 2 * (1 * cfilt[f][0] + 2 * cfilt[f][2] + 2 * cfilt[f][1] + 2 * cfilt[f][3]);
+
+            const double fy   = qMin(ya, static_cast<double>(f));
+            const double fffy = qMin(ya, sqrt(f * f + 4 * 4));
+            yfilt[f][0] =       (1 + cos(M_PI * fy   / ya)) / d;
+            yfilt[f][1] = 0.2 * (1 + cos(M_PI * fffy / ya)) / d;
+            ydiv += 2 * (1 * yfilt[f][0] + 2 * 0 + 2 * yfilt[f][1] + 2 * 0);
+        }
+        for (qint32 f = 0; f <= FILTER_SIZE; f++) {
+            for (qint32 i = 0; i < 4; i++) cfilt[f][i] /= cdiv;
+            for (qint32 i = 0; i < 2; i++) yfilt[f][i] /= ydiv;
+        }
+    }
+
+    void decodeField(const SourceField &inputField, ComponentFrame &componentFrame)
+    {
+        const quint16 *compPtr = inputField.data.data();
+        const qint32 firstLine = inputField.getFirstActiveLine(videoParameters);
+        const qint32 lastLine = inputField.getLastActiveLine(videoParameters);
+        for (qint32 fieldLine = firstLine; fieldLine < lastLine; fieldLine++) {
+            double bp, bq, Vsw;
+            detectBurst(fieldLine, compPtr, bp, bq, Vsw);
+
+            const double theta = (configuration.chromaPhase * M_PI) / 180;
+            const double rotBp = (bp * cos(theta) - bq * sin(theta)) * configuration.chromaGain;
+            const double rotBq = (bp * sin(theta) + bq * cos(theta)) * configuration.chromaGain;
+
+            decodeLine(inputField, fieldLine, rotBp, rotBq, Vsw, componentFrame);
+        }
+    }
+
+private:
+    static constexpr qint32 MAX_WIDTH = PalColour::MAX_WIDTH;
+    static constexpr qint32 FILTER_SIZE = 7;
+
+    LdDecodeMetaData::VideoParameters videoParameters;
+    PalColour::Configuration configuration;
+    double sine[MAX_WIDTH], cosine[MAX_WIDTH];
+    double cfilt[FILTER_SIZE + 1][4];
+    double yfilt[FILTER_SIZE + 1][2];
+
+    void detectBurst(qint32 number, const quint16 *inputData, double &outBp, double &outBq, double &outVsw)
+    {
+        static constexpr quint16 blackLine[MAX_WIDTH] = {0};
+        const qint32 w = videoParameters.fieldWidth;
+        const quint16 *in0 = inputData + (number * w);
+        const quint16 *in1 = (number - 1) <  0                           ? blackLine : (inputData + ((number - 1) * w));
+        const quint16 *in2 = (number + 1) >= videoParameters.fieldHeight ? blackLine : (inputData + ((number + 1) * w));
+        const quint16 *in3 = (number - 2) <  0                           ? blackLine : (inputData + ((number - 2) * w));
+        const quint16 *in4 = (number + 2) >= videoParameters.fieldHeight ? blackLine : (inputData + ((number + 2) * w));
+
+        double bp = 0, bq = 0, bpo = 0, bqo = 0;
+        for (qint32 i = videoParameters.colourBurstStart; i < videoParameters.colourBurstEnd; i++) {
+            bp += ((in0[i] - ((in3[i] + in4[i]) / 2.0)) / 2.0) * sine[i];
+            bq += ((in0[i] - ((in3[i] + in4[i]) / 2.0)) / 2.0) * cosine[i];
+            bpo += ((in2[i] - in1[i]) / 2.0) * sine[i];
+            bqo += ((in2[i] - in1[i]) / 2.0) * cosine[i];
+        }
+        const qint32 colourBurstLength = videoParameters.colourBurstEnd - videoParameters.colourBurstStart;
+        bp /= colourBurstLength;
+        bq /= colourBurstLength;
+        bpo /= colourBurstLength;
+        bqo /= colourBurstLength;
+
+        outVsw = -1;
+        if ((((bp - bpo) * (bp - bpo) + (bq - bqo) * (bq - bqo)) < (bp * bp + bq * bq) * 2)) {
+            outVsw = 1;
+        }
+        outBp = (bp - bqo) / 2;
+        outBq = (bq + bpo) / 2;
+        const double burstNorm = qMax(sqrt(outBp * outBp + outBq * outBq), 130000.0 / 128);
+        outBp /= burstNorm;
+        outBq /= burstNorm;
+    }
+
+    void decodeLine(const SourceField &inputField, qint32 number, double bp, double bq, double Vsw,
+                    ComponentFrame &componentFrame)
+    {
+        static constexpr quint16 blackLine[MAX_WIDTH] = {0};
+        const quint16 *chromaData = inputField.data.data();
+        const qint32 w = videoParameters.fieldWidth;
+        const qint32 firstLine = inputField.getFirstActiveLine(videoParameters);
+        const qint32 lastLine = inputField.getLastActiveLine(videoParameters);
+        const quint16 *in0 = chromaData + (number * w);
+        const quint16 *in1 = (number - 1) <  firstLine ? blackLine : (chromaData + ((number - 1) * w));
+        const quint16 *in2 = (number + 1) >= lastLine  ? blackLine : (chromaData + ((number + 1) * w));
+        const quint16 *in3 = (number - 2) <  firstLine ? blackLine : (chromaData + ((number - 2) * w));
+        const quint16 *in4 = (number + 2) >= lastLine  ? blackLine : (chromaData + ((number + 2) * w));
+        const quint16 *in5 = (number - 2) <  firstLine ? blackLine : (chromaData + ((number - 3) * w));
+        const quint16 *in6 = (number + 3) >= lastLine  ? blackLine : (chromaData + ((number + 3) * w));
+
+        static double m[4][MAX_WIDTH], n[4][MAX_WIDTH];
+        for (qint32 i = videoParameters.activeVideoStart - FILTER_SIZE; i < videoParameters.activeVideoEnd + FILTER_SIZE + 1; i++) {
+            m[0][i] =  in0[i] * sine[i];
+            m[2][i] =  in1[i] * sine[i] - in2[i] * sine[i];
+            m[1][i] = -in3[i] * sine[i] - in4[i] * sine[i];
+            m[3][i] = -in5[i] * sine[i] + in6[i] * sine[i];
+            n[0][i] =  in0[i] * cosine[i];
+            n[2][i] =  in1[i] * cosine[i] - in2[i] * cosine[i];
+            n[1][i] = -in3[i] * cosine[i] - in4[i] * cosine[i];
+            n[3][i] = -in5[i] * cosine[i] + in6[i] * cosine[i];
+        }
+
+        const qint32 lineNumber = (number * 2) + inputField.getOffset();
+        double *outY = componentFrame.y(lineNumber);
+        double *outU = componentFrame.u(lineNumber);
+        double *outV = componentFrame.v(lineNumber);
+        const quint16 *comp = inputField.data.data() + (number * w);
+
+        for (qint32 i = videoParameters.activeVideoStart; i < videoParameters.activeVideoEnd; i++) {
+            double PU = 0, QU = 0, PV = 0, QV = 0, PY = 0, QY = 0;
+            for (qint32 b = 0; b <= FILTER_SIZE; b++) {
+                const qint32 l = i - b;
+                const qint32 r = i + b;
+                PY += (m[0][r] + m[0][l]) * yfilt[b][0] + (m[1][r] + m[1][l]) * yfilt[b][1];
+                QY += (n[0][r] + n[0][l]) * yfilt[b][0] + (n[1][r] + n[1][l]) * yfilt[b][1];
+                PU += (m[0][r] + m[0][l]) * cfilt[b][0] + (m[1][r] + m[1][l]) * cfilt[b][1]
+                        + (n[2][r] + n[2][l]) * cfilt[b][2] + (n[3][r] + n[3][l]) * cfilt[b][3];
+                QU += (n[0][r] + n[0][l]) * cfilt[b][0] + (n[1][r] + n[1][l]) * cfilt[b][1]
+                        - (m[2][r] + m[2][l]) * cfilt[b][2] - (m[3][r] + m[3][l]) * cfilt[b][3];
+                PV += (m[0][r] + m[0][l]) * cfilt[b][0] + (m[1][r] + m[1][l]) * cfilt[b][1]
+                        - (n[2][r] + n[2][l]) * cfilt[b][2] - (n[3][r] + n[3][l]) * cfilt[b][3];
+                QV += (n[0][r] + n[0][l]) * cfilt[b][0] + (n[1][r] + n[1][l]) * cfilt[b][1]
+                        + (m[2][r] + m[2][l]) * cfilt[b][2] + (m[3][r] + m[3][l]) * cfilt[b][3];
+            }
+
+            outY[i] = comp[i] - ((PY * sine[i] + QY * cosine[i]) * 2.0);
+            outU[i] =       -(PU * bp + QU * bq) * 2.0;
+            outV[i] = Vsw * -(QV * bp - PV * bq) * 2.0;
+        }
+
+        if (configuration.yNRLevel > 0.0) {
+            doYNR(outY);
+        }
+    }
+
+    void doYNR(double *Yline)
+    {
+        const double irescale = (videoParameters.white16bIre - videoParameters.black16bIre) / 100;
+        double nr_y = configuration.yNRLevel * irescale;
+        auto yFilter(f_nrpal);
+        const qint32 delay = c_nrpal_b.size() / 2;
+        std::vector<double> hpY(videoParameters.activeVideoEnd + delay);
+        for (qint32 h = videoParameters.activeVideoStart - delay; h < videoParameters.activeVideoStart; h++) {
+            yFilter.feed(0.0);
+        }
+        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+            hpY[h] = yFilter.feed(Yline[h]);
+        }
+        for (qint32 h = videoParameters.activeVideoEnd; h < videoParameters.activeVideoEnd + delay; h++) {
+            hpY[h] = yFilter.feed(0.0);
+        }
+        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+            double a = hpY[h + delay];
+            if (fabs(a) > nr_y) {
+                a = (a > 0) ? nr_y : -nr_y;
+            }
+            Yline[h] -= a;
+        }
+    }
+};
+
+// Compare two decoded frames over the active area
+static void compareFrames(const LdDecodeMetaData::VideoParameters &videoParameters,
+                          const ComponentFrame &expected, const ComponentFrame &actual)
+{
+    // The optimised code does the same operations in the same order, so the
+    // results should match to within rounding of the final few bits
+    const double tolerance = 1e-6;
+
+    for (qint32 line = videoParameters.firstActiveFrameLine; line < videoParameters.lastActiveFrameLine; line++) {
+        for (qint32 x = videoParameters.activeVideoStart; x < videoParameters.activeVideoEnd; x++) {
+            const double diffs[3] = {
+                expected.y(line)[x] - actual.y(line)[x],
+                expected.u(line)[x] - actual.u(line)[x],
+                expected.v(line)[x] - actual.v(line)[x],
+            };
+            for (qint32 c = 0; c < 3; c++) {
+                if (std::fabs(diffs[c]) > tolerance) {
+                    cerr << "Mismatch at line " << line << " x " << x << " component " << c
+                         << ": difference " << diffs[c] << "\n";
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+// Decode a frame of synthetic composite video with PalColour, and check the
+// result against the reference implementation
+void testDecode(double chromaGain, double chromaPhase, double yNRLevel)
+{
+    cerr << "Testing with gain " << chromaGain << ", phase " << chromaPhase << ", NR " << yNRLevel << "\n";
+
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = PAL;
+    videoParameters.fSC = 4433618.75;
+    videoParameters.sampleRate = 4 * videoParameters.fSC;
+    videoParameters.fieldWidth = 1135;
+    videoParameters.fieldHeight = 313;
+    videoParameters.colourBurstStart = 98;
+    videoParameters.colourBurstEnd = 138;
+    videoParameters.activeVideoStart = 185;
+    videoParameters.activeVideoEnd = 1107;
+    videoParameters.firstActiveFrameLine = 44;
+    videoParameters.lastActiveFrameLine = 620;
+    videoParameters.white16bIre = 54016;
+    videoParameters.black16bIre = 16384;
+
+    PalColour::Configuration configuration;
+    configuration.chromaGain = chromaGain;
+    configuration.chromaPhase = chromaPhase;
+    configuration.yNRLevel = yNRLevel;
+
+    // Generate two fields with a subcarrier-frequency signal whose amplitude
+    // and phase drift across the field, plus noise
+    std::mt19937 randomEngine(12345);
+    std::uniform_real_distribution<double> noise(-500.0, 500.0);
+    QVector<SourceField> fields(2);
+    for (qint32 f = 0; f < 2; f++) {
+        fields[f].field.isFirstField = (f == 0);
+        fields[f].data.resize(videoParameters.fieldWidth * videoParameters.fieldHeight);
+        for (qint32 line = 0; line < videoParameters.fieldHeight; line++) {
+            for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
+                const double rad = 2 * M_PI * x * videoParameters.fSC / videoParameters.sampleRate;
+                const double phase = ((line % 2) == 0 ? 0.75 : -0.75) + (x / 400.0);
+                const double value = 30000.0 + (8000.0 * sin(rad + phase)) + (line * 20.0) + noise(randomEngine);
+                fields[f].data[(line * videoParameters.fieldWidth) + x] = static_cast<quint16>(qBound(0.0, value, 65535.0));
+            }
+        }
+    }
+
+    // Decode with PalColour
+    PalColour palColour;
+    palColour.updateConfiguration(videoParameters, configuration);
+    QVector<ComponentFrame> actual(1);
+    palColour.decodeFrames(fields, 0, 2, actual);
+
+    // Decode with the reference
+    ReferencePalColour reference(videoParameters, configuration);
+    ComponentFrame expected;
+    expected.init(videoParameters);
+    reference.decodeField(fields[0], expected);
+    reference.decodeField(fields[1], expected);
+
+    compareFrames(videoParameters, expected, actual[0]);
+}
+
+int main()
+{
+    testDecode(1.0, 0.0, 0.0);
+    testDecode(1.5, 10.0, 0.0);
+    testDecode(1.0, 0.0, 0.5);
+    testDecode(0.8, -20.0, 2.0);
+
+    return 0;
+}
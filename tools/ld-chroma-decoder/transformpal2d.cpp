@@ -27,9 +27,13 @@
 
 #include "transformpal2d.h"
 
+#include <QAtomicInteger>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QtMath>
 #include <cassert>
 #include <cmath>
+#include <functional>
 
 /*!
     \class TransformPal2D
@@ -51,9 +55,24 @@ static double computeWindow(qint32 element, qint32 limit)
     return 0.5 - (0.5 * cos((2 * M_PI * (element + 0.5)) / limit));
 }
 
-TransformPal2D::TransformPal2D()
-    : TransformPal(XCOMPLEX, YCOMPLEX, 1)
+// Run a function on a QThreadPool thread (QRunnable::create needs Qt 5.15)
+class FunctionRunnable : public QRunnable
 {
+public:
+    explicit FunctionRunnable(std::function<void()> _function) : function(std::move(_function)) {}
+    void run() override { function(); }
+
+private:
+    std::function<void()> function;
+};
+
+TransformPal2D::TransformPal2D(qint32 _numThreads)
+    : TransformPal(XCOMPLEX, YCOMPLEX, 1), numThreads(qMax(_numThreads, 1))
+{
+    // Keep the helper threads running between fields
+    threadPool.setMaxThreadCount(qMax(numThreads - 1, 1));
+    threadPool.setExpiryTimeout(-1);
+
     // Compute the window function.
     for (qint32 y = 0; y < YTILE; y++) {
         const double windowY = computeWindow(y, YTILE);
@@ -63,15 +82,20 @@ TransformPal2D::TransformPal2D()
         }
     }
 
-    // Allocate buffers for FFTW. These must be allocated using FFTW's own
-    // functions so they're properly aligned for SIMD operations.
-    fftReal = fftw_alloc_real(YTILE * XTILE);
-    fftComplexIn = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
-    fftComplexOut = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
+    // Allocate buffers for FFTW, one set per thread. These must be allocated
+    // using FFTW's own functions so they're properly aligned for SIMD
+    // operations (which also means any set can be used with the plans).
+    fftBuffers.resize(numThreads);
+    for (FFTBuffers &buffers : fftBuffers) {
+        buffers.fftReal = fftw_alloc_real(YTILE * XTILE);
+        buffers.fftComplexIn = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
+        buffers.fftComplexOut = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
+    }
 
     // Plan FFTW operations
-    forwardPlan = fftw_plan_dft_r2c_2d(YTILE, XTILE, fftReal, fftComplexIn, FFTW_MEASURE);
-    inversePlan = fftw_plan_dft_c2r_2d(YTILE, XTILE, fftComplexOut, fftReal, FFTW_MEASURE);
+    const FFTBuffers &buffers = fftBuffers[0];
+    forwardPlan = fftw_plan_dft_r2c_2d(YTILE, XTILE, buffers.fftReal, buffers.fftComplexIn, FFTW_MEASURE);
+    inversePlan = fftw_plan_dft_c2r_2d(YTILE, XTILE, buffers.fftComplexOut, buffers.fftReal, FFTW_MEASURE);
 }
 
 TransformPal2D::~TransformPal2D()
@@ -79,9 +103,11 @@ TransformPal2D::~TransformPal2D()
     // Free FFTW plans and buffers
     fftw_destroy_plan(forwardPlan);
     fftw_destroy_plan(inversePlan);
-    fftw_free(fftReal);
-    fftw_free(fftComplexIn);
-    fftw_free(fftComplexOut);
+    for (FFTBuffers &buffers : fftBuffers) {
+        fftw_free(buffers.fftReal);
+        fftw_free(buffers.fftComplexIn);
+        fftw_free(buffers.fftComplexOut);
+    }
 }
 
 qint32 TransformPal2D::getThresholdsSize()
@@ -121,31 +147,80 @@ void TransformPal2D::filterField(const SourceField& inputField, qint32 outputInd
 {
     const qint32 firstFieldLine = inputField.getFirstActiveLine(videoParameters);
     const qint32 lastFieldLine = inputField.getLastActiveLine(videoParameters);
+    double *outputPtr = chromaBuf[outputIndex].data();
 
-    // Iterate through the overlapping tile positions, covering the active area.
+    // Work out the overlapping tile positions, covering the active area.
     // (See TransformPal2D member variable documentation for how the tiling works.)
-    for (qint32 tileY = firstFieldLine - HALFYTILE; tileY < lastFieldLine; tileY += HALFYTILE) {
-        // Work out which lines of these tiles are within the active region
-        const qint32 startY = qMax(firstFieldLine - tileY, 0);
-        const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
+    const qint32 firstTileY = firstFieldLine - HALFYTILE;
+    const qint32 numTileRows = (lastFieldLine - firstTileY + HALFYTILE - 1) / HALFYTILE;
+
+    // Each row of tiles only overlaps the rows immediately above and below
+    // it, so process the even rows and then the odd rows. Within each pass,
+    // the rows don't overlap, so they can be divided between threads and
+    // accumulated straight into the output without locking. This is done
+    // regardless of the number of threads, so the result doesn't depend on
+    // it.
+    for (qint32 pass = 0; pass < 2; pass++) {
+        const qint32 numPassRows = (numTileRows - pass + 1) / 2;
+        QAtomicInteger<qint32> nextRow(0);
+
+        auto worker = [&](FFTBuffers &buffers) {
+            while (true) {
+                const qint32 row = nextRow.fetchAndAddRelaxed(1);
+                if (row >= numPassRows) break;
+
+                filterTileRow(firstTileY + (((row * 2) + pass) * HALFYTILE), inputField, outputPtr, buffers);
+            }
+        };
+
+        // Hand work to the helper threads, and do some on this thread too.
+        // (QThreadPool::waitForDone would stop the pool's threads, so the
+        // helpers signal when they've finished instead.)
+        const qint32 threadCount = qMin(numThreads, numPassRows);
+        QSemaphore helpersDone;
+        qint32 numHelpers = 0;
+        for (qint32 i = 1; i < threadCount; i++) {
+            FFTBuffers &buffers = fftBuffers[i];
+            threadPool.start(new FunctionRunnable([&worker, &buffers, &helpersDone] {
+                worker(buffers);
+                helpersDone.release();
+            }));
+            numHelpers++;
+        }
+        worker(fftBuffers[0]);
+        helpersDone.acquire(numHelpers);
+    }
+}
 
-        for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
-            // Compute the forward FFT
-            forwardFFTTile(tileX, tileY, startY, endY, inputField);
+// Process one row of tiles starting at field line tileY, accumulating the
+// result into outputPtr
+void TransformPal2D::filterTileRow(qint32 tileY, const SourceField &inputField, double *outputPtr, FFTBuffers &buffers)
+{
+    const qint32 firstFieldLine = inputField.getFirstActiveLine(videoParameters);
+    const qint32 lastFieldLine = inputField.getLastActiveLine(videoParameters);
+
+    // Work out which lines of these tiles are within the active region
+    const qint32 startY = qMax(firstFieldLine - tileY, 0);
+    const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
-            // Apply the frequency-domain filter
-            applyFilter();
+    for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
+        // Compute the forward FFT
+        forwardFFTTile(tileX, tileY, startY, endY, inputField, buffers);
 
-            // Compute the inverse FFT
-            inverseFFTTile(tileX, tileY, startY, endY, outputIndex);
-        }
+        // Apply the frequency-domain filter
+        applyFilter(buffers);
+
+        // Compute the inverse FFT
+        inverseFFTTile(tileX, tileY, startY, endY, outputPtr, buffers);
     }
 }
 
-// Apply the forward FFT to an input tile, populating fftComplexIn
-void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField)
+// Apply the forward FFT to an input tile, populating buffers.fftComplexIn
+void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField,
+                                    FFTBuffers &buffers)
 {
     // Copy the input signal into fftReal, applying the window function
+    double *fftReal = buffers.fftReal;
     const quint16 *inputPtr = inputField.data.data();
     for (qint32 y = 0; y < YTILE; y++) {
         // If this frame line is above/below the active region, fill it with
@@ -164,21 +239,22 @@ void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, q
     }
 
     // Convert time domain in fftReal to frequency domain in fftComplexIn
-    fftw_execute(forwardPlan);
+    fftw_execute_dft_r2c(forwardPlan, fftReal, buffers.fftComplexIn);
 }
 
-// Apply the inverse FFT to fftComplexOut, overlaying the result into chromaBuf[outputIndex]
-void TransformPal2D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex)
+// Apply the inverse FFT to buffers.fftComplexOut, overlaying the result into outputPtr
+void TransformPal2D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, double *outputPtr,
+                                    FFTBuffers &buffers)
 {
     // Work out what X range of this tile is inside the active area
     const qint32 startX = qMax(videoParameters.activeVideoStart - tileX, 0);
     const qint32 endX = qMin(videoParameters.activeVideoEnd - tileX, XTILE);
 
     // Convert frequency domain in fftComplexOut back to time domain in fftReal
-    fftw_execute(inversePlan);
+    const double *fftReal = buffers.fftReal;
+    fftw_execute_dft_c2r(inversePlan, buffers.fftComplexOut, buffers.fftReal);
 
-    // Overlay the result, normalising the FFTW output, into chromaBuf
-    double *outputPtr = chromaBuf[outputIndex].data();
+    // Overlay the result, normalising the FFTW output, into the output field
     for (qint32 y = startY; y < endY; y++) {
         double *b = outputPtr + ((tileY + y) * videoParameters.fieldWidth);
         for (qint32 x = startX; x < endX; x++) {
@@ -193,11 +269,15 @@ static inline double fftwAbsSq(const fftw_complex &value)
     return (value[0] * value[0]) + (value[1] * value[1]);
 }
 
-// Apply the frequency-domain filter.
-void TransformPal2D::applyFilter()
+// Apply the frequency-domain filter, from buffers.fftComplexIn to buffers.fftComplexOut.
+void TransformPal2D::applyFilter(FFTBuffers &buffers)
 {
-    // Get pointer to squared threshold values
-    const double *thresholdsPtr = thresholds.data();
+    const fftw_complex *fftComplexIn = buffers.fftComplexIn;
+    fftw_complex *fftComplexOut = buffers.fftComplexOut;
+
+    // Get pointer to squared threshold values. (constData, as this may be
+    // called from several threads at once.)
+    const double *thresholdsPtr = thresholds.constData();
 
     // Clear fftComplexOut. We discard values by default; the filter only
     // copies values that look like chroma.
@@ -270,7 +350,7 @@ void TransformPal2D::applyFilter()
         }
     }
 
-    assert(thresholdsPtr == thresholds.data() + thresholds.size());
+    assert(thresholdsPtr == thresholds.constData() + thresholds.size());
 }
 
 void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
@@ -292,10 +372,11 @@ void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
     // Compute the forward FFT
-    forwardFFTTile(positionX, tileY, startY, endY, inputField);
+    FFTBuffers &buffers = fftBuffers[0];
+    forwardFFTTile(positionX, tileY, startY, endY, inputField, buffers);
 
     // Apply the frequency-domain filter
-    applyFilter();
+    applyFilter(buffers);
 
     // Create a canvas
     FrameCanvas canvas(componentFrame, videoParameters);
@@ -305,5 +386,5 @@ void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     canvas.drawRectangle(positionX - 1, positionY + inputField.getOffset() - 1, XTILE + 1, (YTILE * 2) + 1, green);
 
     // Draw the arrays
-    overlayFFTArrays(fftComplexIn, fftComplexOut, canvas);
+    overlayFFTArrays(buffers.fftComplexIn, buffers.fftComplexOut, canvas);
 }
@@ -28,6 +28,7 @@
 #ifndef TRANSFORMPAL2D_H
 #define TRANSFORMPAL2D_H
 
+#include <QThreadPool>
 #include <QVector>
 #include <fftw3.h>
 
@@ -38,7 +39,10 @@
 
 class TransformPal2D : public TransformPal {
 public:
-    TransformPal2D();
+    // numThreads is the number of threads to use when filtering each field.
+    // The tiles within a field are divided between the threads, which
+    // reduces the time taken to filter a single field.
+    explicit TransformPal2D(qint32 numThreads = 1);
     virtual ~TransformPal2D();
 
     // Return the expected size of the thresholds array.
@@ -48,10 +52,21 @@ public:
                       QVector<const double *> &outputFields) override;
 
 protected:
+    // FFT input/output buffers. Each thread has its own set, so the threads
+    // can share the same plans using FFTW's new-array execute functions.
+    struct FFTBuffers {
+        double *fftReal;
+        fftw_complex *fftComplexIn;
+        fftw_complex *fftComplexOut;
+    };
+
     void filterField(const SourceField& inputField, qint32 outputIndex);
-    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField);
-    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex);
-    void applyFilter();
+    void filterTileRow(qint32 tileY, const SourceField &inputField, double *outputPtr, FFTBuffers &buffers);
+    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField,
+                        FFTBuffers &buffers);
+    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, double *outputPtr,
+                        FFTBuffers &buffers);
+    void applyFilter(FFTBuffers &buffers);
     void overlayFFTFrame(qint32 positionX, qint32 positionY,
                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
                          ComponentFrame &componentFrame) override;
@@ -74,10 +89,16 @@ protected:
     // Window function applied before the FFT
     double windowFunction[YTILE][XTILE];
 
-    // FFT input/output buffers
-    double *fftReal;
-    fftw_complex *fftComplexIn;
-    fftw_complex *fftComplexOut;
+    // Number of threads to use within each field
+    qint32 numThreads;
+
+    // FFT buffers for each thread
+    QVector<FFTBuffers> fftBuffers;
+
+    // Helper threads for filtering each field, kept for the life of the
+    // object. The calling thread does some of the work too, so this only
+    // needs numThreads - 1 threads.
+    QThreadPool threadPool;
 
     // FFT plans
     fftw_plan forwardPlan, inversePlan;
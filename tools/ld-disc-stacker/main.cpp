@@ -99,6 +99,11 @@ int main(int argc, char *argv[])
                                          "main", "Pass-through dropouts present on every source"));
     parser.addOption(passthroughOption);
 
+    // Option to resume from the last checkpoint (--resume)
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Resume an interrupted run from the checkpoint saved with the output file"));
+    parser.addOption(resumeOption);
+
     // Positional argument to specify input video file
     parser.addPositionalArgument("inputs", QCoreApplication::translate(
                                      "main", "Specify input TBC files (- as first source for piped input)"));
@@ -117,6 +122,7 @@ int main(int argc, char *argv[])
     bool reverse = parser.isSet(setReverseOption);
     bool noDiffDod = parser.isSet(noDiffDodOption);
     bool passThrough = parser.isSet(passthroughOption);
+    bool resume = parser.isSet(resumeOption);
 
     // Get the arguments from the parser
     qint32 maxThreads = QThread::idealThreadCount();
@@ -200,10 +206,16 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Check that the output file does not already exist
+    if (resume && outputFilename == "-") {
+        // Quit with error
+        qCritical("Cannot resume with piped output");
+        return -1;
+    }
+
+    // Check that the output file does not already exist (unless it's being resumed)
     if (outputFilename != "-") {
         QFileInfo outputFileInfo(outputFilename);
-        if (outputFileInfo.exists()) {
+        if (outputFileInfo.exists() && !(resume && QFile::exists(Checkpoint::getCheckpointFileName(outputFilename)))) {
             // Quit with error
             qCritical("Specified output file already exists - will not overwrite");
             return -1;
@@ -314,8 +326,8 @@ int main(int argc, char *argv[])
     // Perform the disc stacking processes ----------------------------------------------------------------------------
     qInfo() << "Initial source checks are ok and sources are loaded";
     qint32 result = 0;
-    StackingPool stackingPool(outputFilename, outputJsonFilename, maxThreads,
-                                ldDecodeMetaData, sourceVideos, reverse, noDiffDod, passThrough);
+    StackingPool stackingPool(inputFilenames, outputFilename, outputJsonFilename, maxThreads,
+                                ldDecodeMetaData, sourceVideos, reverse, noDiffDod, passThrough, resume);
     if (!stackingPool.process()) result = 1;
 
     // Close open source video files
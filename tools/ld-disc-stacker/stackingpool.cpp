@@ -23,20 +23,32 @@
 ************************************************************************/
 
 #include "stackingpool.h"
+#include "metadatajournal.h"
 #include "vbidecoder.h"
 
-StackingPool::StackingPool(QString _outputFilename, QString _outputJsonFilename,
+#include <QFileInfo>
+
+StackingPool::StackingPool(QVector<QString> _inputFilenames, QString _outputFilename, QString _outputJsonFilename,
                              qint32 _maxThreads, QVector<LdDecodeMetaData *> &_ldDecodeMetaData, QVector<SourceVideo *> &_sourceVideos,
-                             bool _reverse, bool _noDiffDod, bool _passThrough, QObject *parent)
-    : QObject(parent), outputFilename(_outputFilename), outputJsonFilename(_outputJsonFilename),
+                             bool _reverse, bool _noDiffDod, bool _passThrough, bool _resume,
+                             QObject *parent)
+    : QObject(parent), inputFilenames(_inputFilenames), outputFilename(_outputFilename), outputJsonFilename(_outputJsonFilename),
       maxThreads(_maxThreads), reverse(_reverse), noDiffDod(_noDiffDod), passThrough(_passThrough),
-      abort(false), ldDecodeMetaData(_ldDecodeMetaData), sourceVideos(_sourceVideos)
+      resume(_resume), abort(false), ldDecodeMetaData(_ldDecodeMetaData), sourceVideos(_sourceVideos)
 {
 }
 
 bool StackingPool::process()
 {
     qInfo() << "Performing final sanity checks...";
+    // Periodically save a checkpoint when writing to a file, so an
+    // interrupted run can be resumed. The stacked drop-outs written so far
+    // are kept in a journal for the output metadata.
+    useCheckpoints = (outputFilename != "-");
+    checkpointFileName = Checkpoint::getCheckpointFileName(outputFilename);
+    Checkpoint checkpoint;
+    bool resumed = false;
+
     // Open the target video
     targetVideo.setFileName(outputFilename);
     if (outputFilename == "-") {
@@ -45,12 +57,48 @@ bool StackingPool::process()
                 qInfo() << "Unable to open stdout";
                 return false;
         }
+    } else if (resume && QFile::exists(checkpointFileName)) {
+        // Continue the target video and metadata from the last checkpoint
+        if (!checkpoint.read(checkpointFileName)) return false;
+        if (checkpoint.job != getCheckpointJob()) {
+            qCritical() << "Checkpoint" << checkpointFileName << "is for a different job - cannot resume";
+            return false;
+        }
+        if (!checkpoint.openOutput(targetVideo)) return false;
+
+        // Drop-outs journalled after the checkpoint would be used as input
+        // when their frames are stacked again, so discard them
+        const QString journalFileName = MetaDataJournal::getJournalFileName(outputJsonFilename);
+        if (!QFile::resize(journalFileName, checkpoint.counters.value("journalSize", 0))) {
+            qCritical() << "Unable to truncate metadata journal" << journalFileName;
+            targetVideo.close();
+            return false;
+        }
+        if (!ldDecodeMetaData[0]->applyJournal(outputJsonFilename)) {
+            targetVideo.close();
+            return false;
+        }
+        resumed = true;
+        qInfo() << "Resuming from frame" << checkpoint.nextNumber;
     } else {
+        if (resume) qInfo() << "No checkpoint found, starting from the beginning";
+
         if (!targetVideo.open(QIODevice::WriteOnly)) {
                 // Could not open target video file
                 qInfo() << "Unable to open output video file";
                 return false;
         }
+
+        // Discard the journal from any earlier run
+        const QString journalFileName = MetaDataJournal::getJournalFileName(outputJsonFilename);
+        if (useCheckpoints && QFile::exists(journalFileName) && !QFile::remove(journalFileName)) {
+            qCritical() << "Unable to remove old metadata journal" << journalFileName;
+            return false;
+        }
+    }
+    if (useCheckpoints && !ldDecodeMetaData[0]->openJournal(outputJsonFilename)) {
+        targetVideo.close();
+        return false;
     }
 
     // If there is a leading field in the TBC which is out of field order, we need to copy it
@@ -59,7 +107,7 @@ bool StackingPool::process()
     qint32 firstFieldNumber = ldDecodeMetaData[0]->getFirstFieldNumber(1);
     qint32 secondFieldNumber = ldDecodeMetaData[0]->getSecondFieldNumber(1);
 
-    if (firstFieldNumber != 1 && secondFieldNumber != 1) {
+    if (!resumed && firstFieldNumber != 1 && secondFieldNumber != 1) {
         SourceVideo::Data sourceField = sourceVideos[0]->getVideoField(1);
         if (!writeOutputField(sourceField)) {
             // Could not write to target TBC file
@@ -80,10 +128,11 @@ bool StackingPool::process()
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData[0]->getNumberOfFrames() << "frames";
 
     // Initialise processing state
-    inputFrameNumber = 1;
-    outputFrameNumber = 1;
+    inputFrameNumber = checkpoint.nextNumber;
+    outputFrameNumber = checkpoint.nextNumber;
     lastFrameNumber = ldDecodeMetaData[0]->getNumberOfFrames();
     totalTimer.start();
+    checkpointTimer.start();
 
     // Start a vector of decoding threads to process the video
     qInfo() << "Beginning multi-threaded disc stacking process...";
@@ -111,12 +160,21 @@ bool StackingPool::process()
     qInfo() << "Disc stacking complete -" << lastFrameNumber << "frames in" << totalSecs << "seconds (" <<
                lastFrameNumber / totalSecs << "FPS )";
 
+    // The full metadata is written below, which replaces the journal
+    if (!ldDecodeMetaData[0]->closeJournal()) {
+        targetVideo.close();
+        return false;
+    }
+
     qInfo() << "Creating JSON metadata file for stacked TBC...";
     correctMetaData().write(outputJsonFilename);
 
     // Close the target video
     targetVideo.close();
 
+    // The output is complete, so the checkpoint is no longer needed
+    if (useCheckpoints && !Checkpoint::remove(checkpointFileName)) return false;
+
     return true;
 }
 
@@ -276,11 +334,7 @@ bool StackingPool::setOutputFrame(qint32 frameNumber,
             return false;
         }
 
-        // Clear any existing dropout data
-        ldDecodeMetaData[0]->clearFieldDropOuts(outputFrame.firstFieldSeqNo);
-        ldDecodeMetaData[0]->clearFieldDropOuts(outputFrame.secondFieldSeqNo);
-
-        // Write the new dropout data into the LdDecodeMetaData output
+        // Write the new dropout data into the LdDecodeMetaData output (replacing any existing dropout data)
         ldDecodeMetaData[0]->updateFieldDropOuts(outputFrame.firstTargetFieldDropOuts, outputFrame.firstFieldSeqNo);
         ldDecodeMetaData[0]->updateFieldDropOuts(outputFrame.secondTargetFieldDropOuts, outputFrame.secondFieldSeqNo);
 
@@ -295,6 +349,46 @@ bool StackingPool::setOutputFrame(qint32 frameNumber,
         outputFrameNumber++;
     }
 
+    // Save a checkpoint if it's time for another one
+    if (useCheckpoints && checkpointTimer.hasExpired(Checkpoint::INTERVAL)) {
+        if (!writeCheckpoint()) return false;
+    }
+
+    return true;
+}
+
+// Return a description of the job, to check a checkpoint belongs to it
+QString StackingPool::getCheckpointJob() const
+{
+    QString job = "ld-disc-stacker input";
+    for (const QString &inputFilename : inputFilenames) job += " " + inputFilename;
+    job += QString(" output %1 %2").arg(outputFilename, outputJsonFilename);
+    job += QString(" reverse %1 no-diffdod %2 passthrough %3 frames")
+               .arg(static_cast<int>(reverse)).arg(static_cast<int>(noDiffDod)).arg(static_cast<int>(passThrough));
+    for (LdDecodeMetaData *metaData : ldDecodeMetaData) job += QString(" %1").arg(metaData->getNumberOfFrames());
+    return job;
+}
+
+// Save a checkpoint of the frames (and their drop-out metadata) that have
+// been written so far. You must hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool StackingPool::writeCheckpoint()
+{
+    if (!targetVideo.flush()) {
+        qCritical() << "Writing to the output TBC file failed";
+        return false;
+    }
+    if (!ldDecodeMetaData[0]->flushJournal()) return false;
+
+    Checkpoint checkpoint;
+    checkpoint.job = getCheckpointJob();
+    checkpoint.nextNumber = outputFrameNumber;
+    checkpoint.outputSize = targetVideo.pos();
+    checkpoint.counters.insert("journalSize", QFileInfo(MetaDataJournal::getJournalFileName(outputJsonFilename)).size());
+    if (!checkpoint.write(checkpointFileName)) return false;
+
+    checkpointTimer.restart();
     return true;
 }
 
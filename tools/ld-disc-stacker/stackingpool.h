@@ -31,6 +31,7 @@
 #include <QMutex>
 #include <QThread>
 
+#include "checkpoint.h"
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
 #include "stacker.h"
@@ -39,9 +40,10 @@ class StackingPool : public QObject
 {
     Q_OBJECT
 public:
-    explicit StackingPool(QString _outputFilename, QString _outputJsonFilename,
+    explicit StackingPool(QVector<QString> _inputFilenames, QString _outputFilename, QString _outputJsonFilename,
                            qint32 _maxThreads, QVector<LdDecodeMetaData *> &_ldDecodeMetaData, QVector<SourceVideo *> &_sourceVideos,
-                           bool _reverse, bool _noDiffDod, bool _passThrough, QObject *parent = nullptr);
+                           bool _reverse, bool _noDiffDod, bool _passThrough, bool _resume = false,
+                           QObject *parent = nullptr);
 
     bool process();
 
@@ -58,12 +60,14 @@ public:
                         DropOuts firstTargetFieldDropOuts, DropOuts secondTargetFieldDropouts);
 
 private:
+    QVector<QString> inputFilenames;
     QString outputFilename;
     QString outputJsonFilename;
     qint32 maxThreads;
     bool reverse;
     bool noDiffDod;
     bool passThrough;
+    bool resume;
     QElapsedTimer totalTimer;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
@@ -93,6 +97,11 @@ private:
     QMap<qint32, OutputFrame> pendingOutputFrames;
     QFile targetVideo;
 
+    // Checkpoint information (guarded by outputMutex while threads are running)
+    bool useCheckpoints;
+    QString checkpointFileName;
+    QElapsedTimer checkpointTimer;
+
     // Local source information
     QVector<bool> sourceDiscTypeCav;
     QVector<qint32> sourceMinimumVbiFrame;
@@ -103,6 +112,8 @@ private:
     qint32 convertVbiFrameNumberToSequential(qint32 vbiFrameNumber, qint32 sourceNumber);
     QVector<qint32> getAvailableSourcesForFrame(qint32 vbiFrameNumber);
     bool writeOutputField(const SourceVideo::Data &fieldData);
+    QString getCheckpointJob() const;
+    bool writeCheckpoint();
     void correctPhaseIDs();
     template<int field>
     void replaceFieldMetaData(qint32 frameNumber);
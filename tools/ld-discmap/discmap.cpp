@@ -339,6 +339,35 @@ DiscMap::DiscMap(const QFileInfo &metadataFileInfo, const bool reverseFieldOrder
 
 }
 
+// Construct a disc map directly from a list of frames (used for testing the
+// mapping passes without a source TBC)
+DiscMap::DiscMap(const std::vector<Frame> &frames, const bool isDiscPal, const bool isDiscCav)
+            : m_reverseFieldOrder(false), m_noStrict(false), m_frames(frames)
+{
+    m_tbcValid = true;
+    m_numberOfFrames = m_frames.size();
+    m_isDiscPal = isDiscPal;
+    m_isDiscCav = isDiscCav;
+    m_discType = m_isDiscCav ? "CAV" : "CLV";
+    m_videoSystemDescription = m_isDiscPal ? "PAL" : "NTSC";
+
+    // Use the nominal field sizes for the video system
+    if (m_isDiscPal) {
+        m_videoFieldLength = 1135 * 313;
+        m_audioFieldByteLength = 3528;
+        m_audioFieldSampleLength = 882;
+    } else {
+        m_videoFieldLength = 910 * 263;
+        m_audioFieldByteLength = 2944;
+        m_audioFieldSampleLength = 736;
+    }
+
+    m_numberOfPulldowns = 0;
+    for (const Frame &frame : m_frames) {
+        if (frame.isPullDown()) m_numberOfPulldowns++;
+    }
+}
+
 DiscMap::~DiscMap()
 {
     delete ldDecodeMetaData;
@@ -626,21 +655,37 @@ bool DiscMap::isNtscAmendment2ClvFrameNumber(qint32 frameNumber)
 }
 
 // Method to add padding frames to the disc map
-// Note: padding is appended to the end of the disc map - so the
-// disc map must be sorted afterwards.
-void DiscMap::addPadding(qint32 startFrame, qint32 numberOfFrames)
-{
-    m_frames.reserve(m_frames.size() + numberOfFrames);
-    qint32 currentVbi = m_frames[startFrame].vbiFrameNumber() + 1;
-    for (qint32 i = 0; i < numberOfFrames; i++) {
-        Frame paddingFrame;
-        paddingFrame.vbiFrameNumber(currentVbi + i);
-        paddingFrame.seqFrameNumber(-1);
-        paddingFrame.isPadded(true);
-
-        m_frames.push_back(paddingFrame);
+// Note: the disc map must already be sorted.  The padding for every gap is
+// built in one pass and merged into place, so no further sort is required.
+void DiscMap::addPadding(const QVector<qint32> &startFrames, const QVector<qint32> &numbersOfFrames)
+{
+    qint32 totalPadding = 0;
+    for (qint32 i = 0; i < numbersOfFrames.size(); i++) totalPadding += qMax(numbersOfFrames[i], 0);
+    if (totalPadding == 0) return;
+
+    // The gaps are listed in disc map order, so the padding frames are
+    // generated in ascending VBI frame number order
+    std::vector<Frame> paddingFrames;
+    paddingFrames.reserve(totalPadding);
+    for (qint32 gap = 0; gap < startFrames.size(); gap++) {
+        qint32 currentVbi = m_frames[startFrames[gap]].vbiFrameNumber() + 1;
+        for (qint32 i = 0; i < numbersOfFrames[gap]; i++) {
+            Frame paddingFrame;
+            paddingFrame.vbiFrameNumber(currentVbi + i);
+            paddingFrame.seqFrameNumber(-1);
+            paddingFrame.isPadded(true);
+
+            paddingFrames.push_back(paddingFrame);
+        }
     }
 
+    // Merge the padding into the disc map (using the same ordering as sort())
+    std::vector<Frame> mergedFrames;
+    mergedFrames.reserve(m_frames.size() + paddingFrames.size());
+    std::merge(m_frames.begin(), m_frames.end(), paddingFrames.begin(), paddingFrames.end(),
+               std::back_inserter(mergedFrames));
+    m_frames.swap(mergedFrames);
+
     m_numberOfFrames = m_frames.size();
 }
 
@@ -29,6 +29,7 @@
 #include <QDebug>
 #include <QFileInfo>
 #include <QtMath>
+#include <QVector>
 
 // TBC library includes
 #include "lddecodemetadata.h"
@@ -45,6 +46,7 @@ public:
     DiscMap &operator=(const DiscMap &) = default;
 
     DiscMap(const QFileInfo &metadataFileInfo, const bool reverseFieldOrder, const bool noStrict);
+    DiscMap(const std::vector<Frame> &frames, const bool isDiscPal, const bool isDiscCav);
 
     QString filename() const;
     bool valid() const;
@@ -71,7 +73,7 @@ public:
     qint32 flush();
     void sort();
     void debugFrameDetails(qint32 frameNumber);
-    void addPadding(qint32 startFrame, qint32 numberOfFrames);
+    void addPadding(const QVector<qint32> &startFrames, const QVector<qint32> &numbersOfFrames);
     qint32 getVideoFieldLength();
     qint32 getApproximateAudioFieldLength();
 
@@ -104,7 +106,7 @@ private:
     QString m_videoSystemDescription;
 
     std::vector<Frame> m_frames;
-    LdDecodeMetaData *ldDecodeMetaData;
+    LdDecodeMetaData *ldDecodeMetaData = nullptr;
 
     bool isNtscAmendment2ClvFrameNumber(qint32 frameNumber);
     qint32 convertFrameToVbi(qint32 frameNumber);
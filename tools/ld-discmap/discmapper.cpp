@@ -195,6 +195,7 @@ void DiscMapper::correctVbiFrameNumbersUsingSequenceAnalysis(DiscMap &discMap)
 
     qint32 scanDistance = 10;
     qint32 corrections = 0;
+    QVector<bool> vbiGood(scanDistance);
 
     for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames() - scanDistance; frameNumber++) {
         // Don't start on a pulldown or a frame with no VBI frame number
@@ -202,8 +203,6 @@ void DiscMapper::correctVbiFrameNumbersUsingSequenceAnalysis(DiscMap &discMap)
             qint32 startOfSequence = discMap.vbiFrameNumber(frameNumber);
             qint32 expectedIncrement = 1;
 
-            QVector<bool> vbiGood;
-            vbiGood.resize(scanDistance);
             bool sequenceIsGood = true;
 
             for (qint32 i = 0; i < scanDistance; i++) {
@@ -326,65 +325,59 @@ void DiscMapper::correctVbiFrameNumbersUsingSequenceAnalysis(DiscMap &discMap)
 void DiscMapper::removeDuplicateNumberedFrames(DiscMap &discMap)
 {
     qInfo() << "Searching for duplicate frames";
-    qDebug() << "Building list of VBIs that have more than one entry in the discmap...";
-    QVector<qint32> duplicatedFrameList;
-    duplicatedFrameList.reserve(discMap.numberOfFrames()); // just to speed things up a little
+    qDebug() << "Building an index of the discmap sorted by VBI frame number...";
+
+    // Sorting (VBI frame number, discmap address) pairs puts all entries for a VBI
+    // frame number next to each other, with the addresses in ascending order
+    std::vector<std::pair<qint32, qint32>> vbiIndex;
+    vbiIndex.reserve(discMap.numberOfFrames());
     for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames(); frameNumber++) {
-        if (!discMap.isPulldown(frameNumber)) {
-            for (qint32 i = frameNumber + 1; i < discMap.numberOfFrames(); i++) {
-                // Does the current frameNumber have a duplicate?
-                if (discMap.vbiFrameNumber(frameNumber) == discMap.vbiFrameNumber(i) && !discMap.isPulldown(i)) {
-                    duplicatedFrameList.append(discMap.vbiFrameNumber(frameNumber));
-                }
-            }
-        }
+        vbiIndex.emplace_back(discMap.vbiFrameNumber(frameNumber), frameNumber);
     }
+    std::sort(vbiIndex.begin(), vbiIndex.end());
+
+    // Find the VBI frame numbers that are used by more than one (non-pulldown) frame
+    // and record the start and end of their entries in the index
+    QVector<qint32> duplicatedFrameStart;
+    QVector<qint32> duplicatedFrameEnd;
+    qint32 indexEnd = 0;
+    for (qint32 indexStart = 0; indexStart < static_cast<qint32>(vbiIndex.size()); indexStart = indexEnd) {
+        qint32 numberedFrames = 0;
+        for (indexEnd = indexStart; indexEnd < static_cast<qint32>(vbiIndex.size()) &&
+             vbiIndex[indexEnd].first == vbiIndex[indexStart].first; indexEnd++) {
+            if (!discMap.isPulldown(vbiIndex[indexEnd].second)) numberedFrames++;
+        }
 
-    qDebug() << "Sorting the duplicated frame list into numerical order...";
-    std::sort(duplicatedFrameList.begin(), duplicatedFrameList.end());
-    qDebug() << "Removing any repeated frame numbers from the duplicated frame list...";
-    auto last = std::unique(duplicatedFrameList.begin(), duplicatedFrameList.end());
-    duplicatedFrameList.erase(last, duplicatedFrameList.end());
-
-    qDebug() << "Found" << duplicatedFrameList.size() << "VBI frame numbers with more than 1 entry in the discmap";
+        if (numberedFrames > 1) {
+            duplicatedFrameStart.append(indexStart);
+            duplicatedFrameEnd.append(indexEnd);
+        }
+    }
 
-    // The duplicated frame list is a list of VBI frame numbers that have duplicates
+    qDebug() << "Found" << duplicatedFrameStart.size() << "VBI frame numbers with more than 1 entry in the discmap";
 
     // Process the list of duplications one by one
-    for (qint32 i = 0; i < duplicatedFrameList.size(); i++) {
-        if (duplicatedFrameList[i] != -1) {
-            qDebug() << "VBI Frame number" << duplicatedFrameList[i] << "has duplicates; searching for them...";
-            QVector<qint32> discMapDuplicateAddress;
-            for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames(); frameNumber++) {
-                // Does the current frameNumber's VBI match the VBI in the duplicated frame list?
-                if (discMap.vbiFrameNumber(frameNumber) == duplicatedFrameList[i]) {
-                    // Add the frame number ot the duplicate disc map address list
-                    discMapDuplicateAddress.append(frameNumber);
-//                    qDebug() << "  Seq frame" << discMap.seqFrameNumber(frameNumber) << "is a duplicate of" <<
-//                                duplicatedFrameList[i] <<
-//                                "with a quality of" << discMap.frameQuality(frameNumber);
-                }
-            }
+    for (qint32 i = 0; i < duplicatedFrameStart.size(); i++) {
+        qint32 vbiFrameNumber = vbiIndex[duplicatedFrameStart[i]].first;
 
-            // Show the number of duplicates in the discMap that were found
-            qDebug() << "  Found" << discMapDuplicateAddress.size() << "duplicates of VBI frame" << duplicatedFrameList[i];
+        if (vbiFrameNumber != -1) {
+            qDebug() << "  Found" << duplicatedFrameEnd[i] - duplicatedFrameStart[i] << "duplicates of VBI frame" << vbiFrameNumber;
 
             // Pick the sequential frame duplicate with the best quality
-            qint32 bestDiscMapFrame = discMapDuplicateAddress.first();
-            for (qint32 i = 0; i < discMapDuplicateAddress.size(); i++) {
-                if (discMap.frameQuality(bestDiscMapFrame) < discMap.frameQuality(discMapDuplicateAddress[i])) {
-                    bestDiscMapFrame = discMapDuplicateAddress[i];
+            qint32 bestDiscMapFrame = vbiIndex[duplicatedFrameStart[i]].second;
+            for (qint32 j = duplicatedFrameStart[i]; j < duplicatedFrameEnd[i]; j++) {
+                if (discMap.frameQuality(bestDiscMapFrame) < discMap.frameQuality(vbiIndex[j].second)) {
+                    bestDiscMapFrame = vbiIndex[j].second;
                 }
             }
 
-            qDebug() << "  Highest quality duplicate of VBI" << duplicatedFrameList[i] << "is sequential frame" <<
+            qDebug() << "  Highest quality duplicate of VBI" << vbiFrameNumber << "is sequential frame" <<
                         discMap.seqFrameNumber(bestDiscMapFrame) << "with a quality of" << discMap.frameQuality(bestDiscMapFrame);
 
             // Delete all duplicates except the best sequential frame
-            for (qint32 i = 0; i < discMapDuplicateAddress.size(); i++) {
-                if (discMapDuplicateAddress[i] != bestDiscMapFrame) {
-                    discMap.setMarkedForDeletion(discMapDuplicateAddress[i]);
-                    //qDebug() << " Seq. frame" << discMap.seqFrameNumber(discMapDuplicateAddress[i]) << "marked for deletion";
+            for (qint32 j = duplicatedFrameStart[i]; j < duplicatedFrameEnd[i]; j++) {
+                if (vbiIndex[j].second != bestDiscMapFrame) {
+                    discMap.setMarkedForDeletion(vbiIndex[j].second);
                 }
             }
         } else {
@@ -561,15 +554,9 @@ void DiscMapper::padDiscMap(DiscMap &discMap)
         }
     }
 
-    // Apply the padding
-    for (qint32 i = 0; i < startFrame.size(); i++) {
-        discMap.addPadding(startFrame[i], paddingLength[i]);
-    }
-
-    if (totalMissingFrames > 0) {
-        // Sort the disc map to put the padding frames in the correct place
-        discMap.sort();
-    }
+    // Apply the padding (the padding frames are merged into place, so the
+    // disc map remains sorted)
+    discMap.addPadding(startFrame, paddingLength);
 
     // Report the result to the user
     if (numberOfGaps > 0) {
@@ -640,8 +627,12 @@ void DiscMapper::deleteUnmappableFrames(DiscMap &discMap)
 bool DiscMapper::saveDiscMap(DiscMap &discMap)
 {
     // Open the input video file
-    SourceVideo sourceVideo;
-    sourceVideo.open(inputFileInfo.filePath(), discMap.getVideoFieldLength());
+    QFile sourceVideo(inputFileInfo.filePath());
+    if (!sourceVideo.open(QIODevice::ReadOnly)) {
+        // Could not open source video file
+        qInfo() << "Cannot open source video file:" << inputFileInfo.filePath();
+        return false;
+    }
 
     // Open the output video file
     QFile targetVideo(outputFileInfo.filePath());
@@ -653,16 +644,16 @@ bool DiscMapper::saveDiscMap(DiscMap &discMap)
     }
 
     // Initialise the input audio file
-    SourceAudio sourceAudio;
+    QFile sourceAudio;
     QFile targetAudio;
 
     if (!noAudio) {
         // Open the input audio file
-        if (!sourceAudio.open(inputFileInfo)) {
+        sourceAudio.setFileName(inputFileInfo.absolutePath() + "/" + inputFileInfo.completeBaseName() + ".pcm");
+        if (!sourceAudio.open(QIODevice::ReadOnly)) {
             // Could not open input audio file
-            qInfo() << "Cannot open source audio file:" << inputFileInfo.absolutePath() + "/" + inputFileInfo.completeBaseName() + ".pcm";
+            qInfo() << "Cannot open source audio file:" << sourceAudio.fileName();
             sourceVideo.close();
-            sourceAudio.close();
             return false;
         }
 
@@ -683,48 +674,32 @@ bool DiscMapper::saveDiscMap(DiscMap &discMap)
         }
     }
 
-    // Make a dummy video field to use when outputting padded frames
-    SourceVideo::Data missingFieldData;
-    missingFieldData.fill(0, discMap.getVideoFieldLength());
-
-    // Make a dummy audio field to use when outputting padded frames
-    SourceAudio::Data missingFieldAudioData;
-    missingFieldAudioData.fill(0, discMap.getApproximateAudioFieldLength());
+    // Field sizes in bytes (video is 16-bit samples, audio is 16-bit stereo sample pairs)
+    const qint64 videoFieldByteLength = static_cast<qint64>(discMap.getVideoFieldLength()) * 2;
+    const qint64 missingAudioFieldByteLength = static_cast<qint64>(discMap.getApproximateAudioFieldLength()) * 2;
 
-    // Create the output video file
-    SourceVideo::Data sourceFirstField;
-    SourceVideo::Data sourceSecondField;
-    SourceAudio::Data sourceAudioFirstField;
-    SourceAudio::Data sourceAudioSecondField;
-
-    qInfo() << "Saving target video frames...";
-    qint32 notifyInterval = discMap.numberOfFrames() / 50;
-    if (notifyInterval < 1) notifyInterval = 1;
+    // Describe the target files as ranges of the source files; the padded frames are
+    // filled with zeros when the target is written
+    qInfo() << "Mapping target video frames...";
+    ExtentWriter videoExtents;
+    ExtentWriter audioExtents;
 
     for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames(); frameNumber++) {
-        bool writeFail = false;
-
         // Is the current frameNumber a real frame or a padded frame?
         if (!discMap.isPadded(frameNumber)) {
             // Real frame
             qint32 firstFieldNumber = discMap.getFirstFieldNumber(frameNumber);
             qint32 secondFieldNumber = discMap.getSecondFieldNumber(frameNumber);
-            sourceFirstField = sourceVideo.getVideoField(firstFieldNumber);
-            sourceSecondField = sourceVideo.getVideoField(secondFieldNumber);
+            qint64 firstFieldOffset = static_cast<qint64>(firstFieldNumber - 1) * videoFieldByteLength;
+            qint64 secondFieldOffset = static_cast<qint64>(secondFieldNumber - 1) * videoFieldByteLength;
 
             // Write the fields into the output TBC file in the same order as the source file
             if (firstFieldNumber < secondFieldNumber) {
-                // Save the first field and then second field to the output file
-                if (!targetVideo.write(reinterpret_cast<const char *>(sourceFirstField.data()),
-                                       sourceFirstField.size() * 2)) writeFail = true;
-                if (!targetVideo.write(reinterpret_cast<const char *>(sourceSecondField.data()),
-                                       sourceSecondField.size() * 2)) writeFail = true;
+                videoExtents.addExtent(firstFieldOffset, videoFieldByteLength);
+                videoExtents.addExtent(secondFieldOffset, videoFieldByteLength);
             } else {
-                // Save the second field and then first field to the output file
-                if (!targetVideo.write(reinterpret_cast<const char *>(sourceSecondField.data()),
-                                       sourceSecondField.size() * 2)) writeFail = true;
-                if (!targetVideo.write(reinterpret_cast<const char *>(sourceFirstField.data()),
-                                       sourceFirstField.size() * 2)) writeFail = true;
+                videoExtents.addExtent(secondFieldOffset, videoFieldByteLength);
+                videoExtents.addExtent(firstFieldOffset, videoFieldByteLength);
             }
 
             // Save the audio (not field order dependent)
@@ -732,17 +707,10 @@ bool DiscMapper::saveDiscMap(DiscMap &discMap)
                 // Ensure there is audio to read from the first and second fields
                 if ((discMap.getFirstFieldAudioDataLength(frameNumber) > 0) &&
                         (discMap.getSecondFieldAudioDataLength(frameNumber) > 0)) {
-                    // Read the audio
-                    sourceAudioFirstField = sourceAudio.getAudioData(discMap.getFirstFieldAudioDataStart(frameNumber),
-                                                                     discMap.getFirstFieldAudioDataLength(frameNumber));
-                    sourceAudioSecondField = sourceAudio.getAudioData(discMap.getSecondFieldAudioDataStart(frameNumber),
-                                                                      discMap.getSecondFieldAudioDataLength(frameNumber));
-
-                    // Write the audio
-                    if (!targetAudio.write(reinterpret_cast<const char *>(sourceAudioFirstField.data()),
-                                           sourceAudioFirstField.size() * 2)) writeFail = true;
-                    if (!targetAudio.write(reinterpret_cast<const char *>(sourceAudioSecondField.data()),
-                                           sourceAudioSecondField.size() * 2)) writeFail = true;
+                    audioExtents.addExtent(static_cast<qint64>(discMap.getFirstFieldAudioDataStart(frameNumber)) * 4,
+                                           static_cast<qint64>(discMap.getFirstFieldAudioDataLength(frameNumber)) * 4);
+                    audioExtents.addExtent(static_cast<qint64>(discMap.getSecondFieldAudioDataStart(frameNumber)) * 4,
+                                           static_cast<qint64>(discMap.getSecondFieldAudioDataLength(frameNumber)) * 4);
                 } else {
                     if (discMap.getFirstFieldAudioDataLength(frameNumber) < 1) {
                         qInfo() << "Warning: Input file seems to have zero audio data in the first field of frame number #" << frameNumber;
@@ -755,34 +723,20 @@ bool DiscMapper::saveDiscMap(DiscMap &discMap)
                 }
             }
         } else {
-            // Padded frame - write two dummy fields
-            if (!targetVideo.write(reinterpret_cast<const char *>(missingFieldData.data()),
-                                   missingFieldData.size() * 2)) writeFail = true;
-            if (!targetVideo.write(reinterpret_cast<const char *>(missingFieldData.data()),
-                                   missingFieldData.size() * 2)) writeFail = true;
-
-            if (!noAudio) {
-                // Write the padded audio
-                if (!targetAudio.write(reinterpret_cast<const char *>(missingFieldAudioData.data()),
-                                       missingFieldAudioData.size() * 2)) writeFail = true;
-                if (!targetAudio.write(reinterpret_cast<const char *>(missingFieldAudioData.data()),
-                                       missingFieldAudioData.size() * 2)) writeFail = true;
-            }
-        }
-
-        // Notify user
-        if (frameNumber % notifyInterval == 0) {
-            qInfo() << "Written frame" << frameNumber << "of" << discMap.numberOfFrames();
+            // Padded frame - two dummy fields
+            videoExtents.addPadding(videoFieldByteLength * 2);
+            if (!noAudio) audioExtents.addPadding(missingAudioFieldByteLength * 2);
         }
+    }
 
-        // Was the write successful?
-        if (writeFail) {
-            // Could not write to target TBC file
-            qWarning() << "Writing fields to the target TBC file failed on frame number" << frameNumber;
-            targetVideo.close();
-            sourceVideo.close();
-            return false;
-        }
+    // Write the target video
+    qInfo() << "Saving target video frames (" << videoExtents.numberOfExtents() << "extents)...";
+    if (!videoExtents.write(sourceVideo, targetVideo)) {
+        // Could not write to target TBC file
+        qWarning() << "Writing fields to the target TBC file failed";
+        targetVideo.close();
+        sourceVideo.close();
+        return false;
     }
     qInfo() << discMap.numberOfFrames() << "video frames saved";
 
@@ -790,9 +744,18 @@ bool DiscMapper::saveDiscMap(DiscMap &discMap)
     targetVideo.close();
     sourceVideo.close();
 
-    // Close the source and target audio files
+    // Write the target audio
     if (!noAudio) {
+        qInfo() << "Saving target audio frames (" << audioExtents.numberOfExtents() << "extents)...";
+        if (!audioExtents.write(sourceAudio, targetAudio)) {
+            qWarning() << "Writing the target audio file failed";
+            targetAudio.close();
+            sourceAudio.close();
+            return false;
+        }
         qInfo() << "Target audio frames saved";
+
+        // Close the source and target audio files
         targetAudio.close();
         sourceAudio.close();
     }
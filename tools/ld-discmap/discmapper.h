@@ -31,11 +31,10 @@
 #include <QFile>
 
 // TBC library includes
-#include "sourcevideo.h"
-#include "sourceaudio.h"
 #include "lddecodemetadata.h"
 
 #include "discmap.h"
+#include "extentwriter.h"
 
 class DiscMapper
 {
@@ -46,16 +45,7 @@ public:
                  QFileInfo _outputFileInfo, bool _reverse, bool _mapOnly, bool _noStrict,
                  bool _deleteUnmappable, bool _noAudio);
 
-private:
-    QFileInfo inputFileInfo;
-    QFileInfo inputMetadataFileInfo;
-    QFileInfo outputFileInfo;
-    bool reverse;
-    bool mapOnly;
-    bool noStrict;
-    bool deleteUnmappable;
-    bool noAudio;
-
+    // Individual mapping passes
     void removeLeadInOut(DiscMap &discMap);
     void removeInvalidFramesByPhase(DiscMap &discMap);
     void correctVbiFrameNumbersUsingSequenceAnalysis(DiscMap &discMap);
@@ -67,6 +57,16 @@ private:
     void rewriteFrameNumbers(DiscMap &discMap);
     void deleteUnmappableFrames(DiscMap &discMap);
 
+private:
+    QFileInfo inputFileInfo;
+    QFileInfo inputMetadataFileInfo;
+    QFileInfo outputFileInfo;
+    bool reverse;
+    bool mapOnly;
+    bool noStrict;
+    bool deleteUnmappable;
+    bool noAudio;
+
     bool saveDiscMap(DiscMap &discMap);
 };
 
@@ -0,0 +1,235 @@
+/************************************************************************
+
+    extentwriter.cpp
+
+    ld-discmap - TBC and VBI alignment and correction
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-discmap is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "extentwriter.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+// Size of the buffer used for zero padding and for copies that the kernel cannot do
+static constexpr qint64 BUFFER_SIZE = 1024 * 1024;
+
+// Add a range of the source file to the end of the target
+void ExtentWriter::addExtent(qint64 sourceOffset, qint64 length)
+{
+    if (length <= 0) return;
+
+    // Extend the previous extent if this range follows on from it
+    if (!extents.empty() && extents.back().sourceOffset != -1 &&
+            extents.back().sourceOffset + extents.back().length == sourceOffset) {
+        extents.back().length += length;
+    } else {
+        extents.push_back({sourceOffset, length});
+    }
+
+    m_totalLength += length;
+}
+
+// Add zero padding to the end of the target
+void ExtentWriter::addPadding(qint64 length)
+{
+    if (length <= 0) return;
+
+    if (!extents.empty() && extents.back().sourceOffset == -1) {
+        extents.back().length += length;
+    } else {
+        extents.push_back({-1, length});
+    }
+
+    m_totalLength += length;
+}
+
+// Get the number of (merged) extents in the target
+qint32 ExtentWriter::numberOfExtents() const
+{
+    return static_cast<qint32>(extents.size());
+}
+
+// Get the total length of the target in bytes
+qint64 ExtentWriter::totalLength() const
+{
+    return m_totalLength;
+}
+
+// Write the extents to the target file (both files must already be open)
+bool ExtentWriter::write(QFile &sourceFile, QFile &targetFile)
+{
+    qint64 notifyInterval = m_totalLength / 50;
+    if (notifyInterval < 1) notifyInterval = 1;
+    qint64 bytesWritten = 0;
+    qint64 nextNotify = notifyInterval;
+
+    for (const Extent &extent : extents) {
+        if (extent.sourceOffset == -1) {
+            if (!writePadding(targetFile, extent.length)) return false;
+        } else {
+            if (!copyExtent(sourceFile, targetFile, extent.sourceOffset, extent.length)) return false;
+        }
+
+        // Notify user
+        bytesWritten += extent.length;
+        if (bytesWritten >= nextNotify) {
+            qInfo() << "Written" << (bytesWritten * 100) / m_totalLength << "% of" << targetFile.fileName();
+            nextNotify = bytesWritten + notifyInterval;
+        }
+    }
+
+    return true;
+}
+
+#ifdef Q_OS_LINUX
+// Write a whole buffer to a file descriptor
+static bool writeAll(int fd, const char *data, qint64 length)
+{
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+
+    return true;
+}
+#endif
+
+// Copy a range of the source file to the end of the target file
+bool ExtentWriter::copyExtent(QFile &sourceFile, QFile &targetFile, qint64 sourceOffset, qint64 length)
+{
+#ifdef Q_OS_LINUX
+    const int sourceFd = sourceFile.handle();
+    const int targetFd = targetFile.handle();
+    off_t offset = sourceOffset;
+
+    // copy_file_range lets the filesystem share the blocks (reflink) or copy them
+    // without passing the data through userspace.  Older kernels refuse copies
+    // between filesystems, in which case fall back to sendfile.
+    while (length > 0 && useCopyFileRange) {
+        ssize_t copied = copy_file_range(sourceFd, &offset, targetFd, nullptr, static_cast<size_t>(length), 0);
+        if (copied > 0) {
+            length -= copied;
+        } else if (copied == 0) {
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF) {
+            useCopyFileRange = false;
+        } else {
+            qWarning() << "copy_file_range to" << targetFile.fileName() << "failed:" << strerror(errno);
+            return false;
+        }
+    }
+
+    while (length > 0 && useSendfile && !useCopyFileRange) {
+        ssize_t copied = sendfile(targetFd, sourceFd, &offset, static_cast<size_t>(length));
+        if (copied > 0) {
+            length -= copied;
+        } else if (copied == 0) {
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EINVAL || errno == ENOSYS) {
+            useSendfile = false;
+        } else {
+            qWarning() << "sendfile to" << targetFile.fileName() << "failed:" << strerror(errno);
+            return false;
+        }
+    }
+
+    // Copy anything that remains through a buffer
+    std::vector<char> buffer;
+    while (length > 0 && !useCopyFileRange && !useSendfile) {
+        if (buffer.empty()) buffer.resize(BUFFER_SIZE);
+        ssize_t bytesRead = pread(sourceFd, buffer.data(), static_cast<size_t>(qMin(length, BUFFER_SIZE)), offset);
+        if (bytesRead < 0) {
+            if (errno == EINTR) continue;
+            qWarning() << "Reading from" << sourceFile.fileName() << "failed:" << strerror(errno);
+            return false;
+        }
+        if (bytesRead == 0) break;
+        if (!writeAll(targetFd, buffer.data(), bytesRead)) {
+            qWarning() << "Writing to" << targetFile.fileName() << "failed:" << strerror(errno);
+            return false;
+        }
+        offset += bytesRead;
+        length -= bytesRead;
+    }
+#else
+    if (!sourceFile.seek(sourceOffset)) {
+        qWarning() << "Could not seek to position" << sourceOffset << "in" << sourceFile.fileName();
+        return false;
+    }
+
+    QByteArray buffer;
+    while (length > 0) {
+        buffer = sourceFile.read(qMin(length, BUFFER_SIZE));
+        if (buffer.isEmpty()) break;
+        if (targetFile.write(buffer) != buffer.size()) {
+            qWarning() << "Writing to" << targetFile.fileName() << "failed";
+            return false;
+        }
+        length -= buffer.size();
+    }
+#endif
+
+    // If the source ended early, pad the rest of the extent so the target stays aligned
+    if (length > 0) {
+        qWarning() << sourceFile.fileName() << "ended" << length << "bytes before the end of an extent - padding the target";
+        return writePadding(targetFile, length);
+    }
+
+    return true;
+}
+
+// Write zero padding to the end of the target file
+bool ExtentWriter::writePadding(QFile &targetFile, qint64 length)
+{
+    // All padding is written from the same buffer of zeros
+    static const std::vector<char> zeroBuffer(BUFFER_SIZE, 0);
+
+    while (length > 0) {
+        qint64 chunk = qMin(length, BUFFER_SIZE);
+#ifdef Q_OS_LINUX
+        if (!writeAll(targetFile.handle(), zeroBuffer.data(), chunk)) {
+            qWarning() << "Writing to" << targetFile.fileName() << "failed:" << strerror(errno);
+            return false;
+        }
+#else
+        if (targetFile.write(zeroBuffer.data(), chunk) != chunk) {
+            qWarning() << "Writing to" << targetFile.fileName() << "failed";
+            return false;
+        }
+#endif
+        length -= chunk;
+    }
+
+    return true;
+}
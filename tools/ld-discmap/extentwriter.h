@@ -0,0 +1,65 @@
+/************************************************************************
+
+    extentwriter.h
+
+    ld-discmap - TBC and VBI alignment and correction
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-discmap is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef EXTENTWRITER_H
+#define EXTENTWRITER_H
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+
+#include <vector>
+
+// Builds a target file as a list of extents (byte ranges of a source file, or
+// runs of zero padding) and then writes it in one pass.  Contiguous source
+// ranges are merged, so a mostly in-order remap becomes a handful of large
+// kernel-side copies rather than a read and write per field.
+class ExtentWriter
+{
+public:
+    ExtentWriter() = default;
+
+    void addExtent(qint64 sourceOffset, qint64 length);
+    void addPadding(qint64 length);
+    qint32 numberOfExtents() const;
+    qint64 totalLength() const;
+
+    bool write(QFile &sourceFile, QFile &targetFile);
+
+private:
+    struct Extent {
+        qint64 sourceOffset;    // -1 for padding
+        qint64 length;
+    };
+
+    std::vector<Extent> extents;
+    qint64 m_totalLength = 0;
+    bool useCopyFileRange = true;
+    bool useSendfile = true;
+
+    bool copyExtent(QFile &sourceFile, QFile &targetFile, qint64 sourceOffset, qint64 length);
+    bool writePadding(QFile &targetFile, qint64 length);
+};
+
+#endif // EXTENTWRITER_H
@@ -0,0 +1,313 @@
+/************************************************************************
+
+    testdiscmap.cpp
+
+    Unit tests and benchmark for the disc mapping passes
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "discmap.h"
+#include "discmapper.h"
+#include "extentwriter.h"
+
+using std::cerr;
+
+// Description of a synthetic disc map
+struct SyntheticDisc {
+    std::vector<Frame> frames;
+
+    // For each VBI frame number, the sequential frame number of its best copy
+    std::map<qint32, qint32> bestSeqFrame;
+
+    qint32 duplicateFrames = 0;
+    qint32 missingFrames = 0;
+};
+
+// Generate a synthetic PAL CAV disc map of the requested size.  The player
+// periodically skips back a few frames (producing out-of-order duplicates of
+// varying quality) and periodically skips forward (producing sequence gaps).
+SyntheticDisc makeSyntheticDisc(qint32 numberOfFrames)
+{
+    SyntheticDisc disc;
+    disc.frames.reserve(numberOfFrames);
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> quality(0.0, 1.0);
+    std::map<qint32, double> bestQuality;
+
+    qint32 vbi = 1;
+    while (static_cast<qint32>(disc.frames.size()) < numberOfFrames) {
+        qint32 seq = static_cast<qint32>(disc.frames.size()) + 1;
+
+        if (seq % 1000 == 500) {
+            // Skip back and repeat the last 4 frames
+            vbi -= 4;
+            disc.duplicateFrames += 4;
+        } else if (seq % 1000 == 0) {
+            // Skip forward, leaving a gap of 1 to 3 frames
+            qint32 gap = 1 + (seq / 1000) % 3;
+            vbi += gap;
+            disc.missingFrames += gap;
+        }
+
+        Frame frame(seq, vbi);
+        frame.frameQuality(quality(rng));
+        frame.firstFieldPhase(1);
+        frame.secondFieldPhase(2);
+        disc.frames.push_back(frame);
+
+        // Track the best copy (the first copy wins a tie, as in the mapper)
+        auto it = bestQuality.find(vbi);
+        if (it == bestQuality.end() || it->second < frame.frameQuality()) {
+            bestQuality[vbi] = frame.frameQuality();
+            disc.bestSeqFrame[vbi] = seq;
+        }
+
+        vbi++;
+    }
+
+    return disc;
+}
+
+// The original quadratic duplicate search, used as a timing and correctness reference.
+// Returns the sequential frame numbers that should be deleted.
+std::vector<qint32> referenceDuplicateSearch(const std::vector<Frame> &frames)
+{
+    std::vector<qint32> duplicatedFrameList;
+    for (size_t frameNumber = 0; frameNumber < frames.size(); frameNumber++) {
+        if (!frames[frameNumber].isPullDown()) {
+            for (size_t i = frameNumber + 1; i < frames.size(); i++) {
+                if (frames[frameNumber].vbiFrameNumber() == frames[i].vbiFrameNumber() && !frames[i].isPullDown()) {
+                    duplicatedFrameList.push_back(frames[frameNumber].vbiFrameNumber());
+                }
+            }
+        }
+    }
+    std::sort(duplicatedFrameList.begin(), duplicatedFrameList.end());
+    duplicatedFrameList.erase(std::unique(duplicatedFrameList.begin(), duplicatedFrameList.end()),
+                              duplicatedFrameList.end());
+
+    std::vector<qint32> deleted;
+    for (qint32 vbi : duplicatedFrameList) {
+        std::vector<size_t> address;
+        for (size_t frameNumber = 0; frameNumber < frames.size(); frameNumber++) {
+            if (frames[frameNumber].vbiFrameNumber() == vbi) address.push_back(frameNumber);
+        }
+
+        size_t best = address.front();
+        for (size_t i : address) {
+            if (frames[best].frameQuality() < frames[i].frameQuality()) best = i;
+        }
+        for (size_t i : address) {
+            if (i != best) deleted.push_back(frames[i].seqFrameNumber());
+        }
+    }
+    std::sort(deleted.begin(), deleted.end());
+
+    return deleted;
+}
+
+// Check the result of removing duplicates against the reference implementation
+void testRemoveDuplicates()
+{
+    cerr << "Testing removeDuplicateNumberedFrames against the reference implementation\n";
+
+    SyntheticDisc disc = makeSyntheticDisc(10000);
+    DiscMap discMap(disc.frames, true, true);
+    DiscMapper discMapper;
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<qint32> expected = referenceDuplicateSearch(disc.frames);
+    qint64 referenceTime = timer.nsecsElapsed();
+
+    timer.restart();
+    discMapper.removeDuplicateNumberedFrames(discMap);
+    qint64 newTime = timer.nsecsElapsed();
+
+    cerr << "  " << disc.frames.size() << " frames: reference " << referenceTime / 1000000 << " ms, "
+         << "sorted index " << newTime / 1000000 << " ms\n";
+
+    // Work out which frames were deleted
+    std::vector<bool> kept(disc.frames.size() + 1, false);
+    for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames(); frameNumber++) {
+        kept[discMap.seqFrameNumber(frameNumber)] = true;
+    }
+    std::vector<qint32> deleted;
+    for (const Frame &frame : disc.frames) {
+        if (!kept[frame.seqFrameNumber()]) deleted.push_back(frame.seqFrameNumber());
+    }
+
+    if (deleted != expected) {
+        cerr << "Mismatch: deleted " << deleted.size() << " frames, expected " << expected.size() << "\n";
+        exit(1);
+    }
+}
+
+// Run the mapping passes over a large disc map and check the result
+void testMappingPasses(qint32 numberOfFrames)
+{
+    cerr << "Testing mapping passes on a synthetic " << numberOfFrames << " frame disc map\n";
+
+    SyntheticDisc disc = makeSyntheticDisc(numberOfFrames);
+    DiscMap discMap(disc.frames, true, true);
+    DiscMapper discMapper;
+    QElapsedTimer timer;
+
+    timer.start();
+    discMapper.removeDuplicateNumberedFrames(discMap);
+    cerr << "  removeDuplicateNumberedFrames: " << timer.nsecsElapsed() / 1000000 << " ms\n";
+
+    if (discMap.numberOfFrames() != numberOfFrames - disc.duplicateFrames) {
+        cerr << "Expected " << numberOfFrames - disc.duplicateFrames << " frames after removing duplicates, got "
+             << discMap.numberOfFrames() << "\n";
+        exit(1);
+    }
+
+    timer.restart();
+    discMapper.reorderFrames(discMap);
+    cerr << "  reorderFrames: " << timer.nsecsElapsed() / 1000000 << " ms\n";
+
+    timer.restart();
+    discMapper.padDiscMap(discMap);
+    cerr << "  padDiscMap: " << timer.nsecsElapsed() / 1000000 << " ms\n";
+
+    if (discMap.numberOfFrames() != numberOfFrames - disc.duplicateFrames + disc.missingFrames) {
+        cerr << "Expected " << numberOfFrames - disc.duplicateFrames + disc.missingFrames
+             << " frames after padding, got " << discMap.numberOfFrames() << "\n";
+        exit(1);
+    }
+
+    // The map should now be a continuous VBI sequence, with the best copy of each frame
+    qint32 paddedFrames = 0;
+    for (qint32 frameNumber = 0; frameNumber < discMap.numberOfFrames(); frameNumber++) {
+        if (discMap.vbiFrameNumber(frameNumber) != frameNumber + 1) {
+            cerr << "Frame " << frameNumber << " has VBI " << discMap.vbiFrameNumber(frameNumber)
+                 << ", expected " << frameNumber + 1 << "\n";
+            exit(1);
+        }
+
+        if (discMap.isPadded(frameNumber)) {
+            paddedFrames++;
+        } else if (discMap.seqFrameNumber(frameNumber) != disc.bestSeqFrame[frameNumber + 1]) {
+            cerr << "VBI " << frameNumber + 1 << " uses sequential frame " << discMap.seqFrameNumber(frameNumber)
+                 << ", expected " << disc.bestSeqFrame[frameNumber + 1] << "\n";
+            exit(1);
+        }
+    }
+
+    if (paddedFrames != disc.missingFrames) {
+        cerr << "Expected " << disc.missingFrames << " padded frames, got " << paddedFrames << "\n";
+        exit(1);
+    }
+}
+
+// Exit with an error if a file operation failed
+void checkFileOperation(bool success, const QFile &file)
+{
+    if (!success) {
+        cerr << "File operation failed on " << file.fileName().toStdString() << "\n";
+        exit(1);
+    }
+}
+
+// Check that ExtentWriter reproduces the requested ranges and padding
+void testExtentWriter()
+{
+    cerr << "Testing ExtentWriter\n";
+
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid()) {
+        cerr << "Cannot create a temporary directory\n";
+        exit(1);
+    }
+
+    // Make a source file of pseudo-random bytes
+    QByteArray sourceData(3000000, 0);
+    std::mt19937 rng(54321);
+    for (qint32 i = 0; i < sourceData.size(); i++) sourceData[i] = static_cast<char>(rng());
+
+    QFile sourceFile(tempDir.filePath("source.bin"));
+    checkFileOperation(sourceFile.open(QIODevice::WriteOnly), sourceFile);
+    checkFileOperation(sourceFile.write(sourceData) == sourceData.size(), sourceFile);
+    sourceFile.close();
+
+    // Build a target from in-order runs, out-of-order ranges and padding
+    ExtentWriter extentWriter;
+    QByteArray expected;
+    auto addExtent = [&](qint64 offset, qint64 length) {
+        extentWriter.addExtent(offset, length);
+        expected.append(sourceData.mid(offset, length));
+    };
+    auto addPadding = [&](qint64 length) {
+        extentWriter.addPadding(length);
+        expected.append(QByteArray(length, 0));
+    };
+
+    addExtent(0, 1000);
+    addExtent(1000, 1000);
+    addExtent(500, 250000);
+    addPadding(10);
+    addPadding(1500000);
+    addExtent(2000000, 999999);
+    addExtent(2999999, 1);
+    addExtent(3, 5);
+
+    // Contiguous ranges and adjacent padding should have been merged
+    assert(extentWriter.numberOfExtents() == 5);
+    assert(extentWriter.totalLength() == expected.size());
+
+    QFile targetFile(tempDir.filePath("target.bin"));
+    checkFileOperation(sourceFile.open(QIODevice::ReadOnly), sourceFile);
+    checkFileOperation(targetFile.open(QIODevice::WriteOnly), targetFile);
+    checkFileOperation(extentWriter.write(sourceFile, targetFile), targetFile);
+    sourceFile.close();
+    targetFile.close();
+
+    checkFileOperation(targetFile.open(QIODevice::ReadOnly), targetFile);
+    if (targetFile.readAll() != expected) {
+        cerr << "Target file does not match the requested extents\n";
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // The passes report every duplicate and gap at debug level
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+    testRemoveDuplicates();
+    testMappingPasses(100000);
+    testExtentWriter();
+
+    return 0;
+}
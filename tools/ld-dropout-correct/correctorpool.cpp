@@ -26,18 +26,26 @@
 #include "correctorpool.h"
 #include "vbidecoder.h"
 
-CorrectorPool::CorrectorPool(QString _outputFilename, QString _outputJsonFilename,
+CorrectorPool::CorrectorPool(QVector<QString> _inputFilenames, QString _outputFilename, QString _outputJsonFilename,
                              qint32 _maxThreads, QVector<LdDecodeMetaData *> &_ldDecodeMetaData, QVector<SourceVideo *> &_sourceVideos,
-                             bool _reverse, bool _intraField, bool _overCorrect, QObject *parent)
-    : QObject(parent), outputFilename(_outputFilename), outputJsonFilename(_outputJsonFilename),
+                             bool _reverse, bool _intraField, bool _overCorrect, bool _resume,
+                             QObject *parent)
+    : QObject(parent), inputFilenames(_inputFilenames), outputFilename(_outputFilename), outputJsonFilename(_outputJsonFilename),
       maxThreads(_maxThreads), reverse(_reverse), intraField(_intraField), overCorrect(_overCorrect),
-      abort(false), ldDecodeMetaData(_ldDecodeMetaData), sourceVideos(_sourceVideos)
+      resume(_resume), abort(false), ldDecodeMetaData(_ldDecodeMetaData), sourceVideos(_sourceVideos)
 {
 }
 
 bool CorrectorPool::process()
 {
     qInfo() << "Performing final sanity checks...";
+    // Periodically save a checkpoint when writing to a file, so an
+    // interrupted run can be resumed
+    useCheckpoints = (outputFilename != "-");
+    checkpointFileName = Checkpoint::getCheckpointFileName(outputFilename);
+    Checkpoint checkpoint;
+    bool resumed = false;
+
     // Open the target video
     targetVideo.setFileName(outputFilename);
     if (outputFilename == "-") {
@@ -46,7 +54,19 @@ bool CorrectorPool::process()
                 qInfo() << "Unable to open stdout";
                 return false;
         }
+    } else if (resume && QFile::exists(checkpointFileName)) {
+        // Continue the target video from the last checkpoint
+        if (!checkpoint.read(checkpointFileName)) return false;
+        if (checkpoint.job != getCheckpointJob()) {
+            qCritical() << "Checkpoint" << checkpointFileName << "is for a different job - cannot resume";
+            return false;
+        }
+        if (!checkpoint.openOutput(targetVideo)) return false;
+        resumed = true;
+        qInfo() << "Resuming from frame" << checkpoint.nextNumber;
     } else {
+        if (resume) qInfo() << "No checkpoint found, starting from the beginning";
+
         if (!targetVideo.open(QIODevice::WriteOnly)) {
                 // Could not open target video file
                 qInfo() << "Unable to open output video file";
@@ -60,7 +80,7 @@ bool CorrectorPool::process()
     qint32 firstFieldNumber = ldDecodeMetaData[0]->getFirstFieldNumber(1);
     qint32 secondFieldNumber = ldDecodeMetaData[0]->getSecondFieldNumber(1);
 
-    if (firstFieldNumber != 1 && secondFieldNumber != 1) {
+    if (!resumed && firstFieldNumber != 1 && secondFieldNumber != 1) {
         SourceVideo::Data sourceField = sourceVideos[0]->getVideoField(1);
         if (!writeOutputField(sourceField)) {
             // Could not write to target TBC file
@@ -83,16 +103,17 @@ bool CorrectorPool::process()
     // Show some information for the user
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData[0]->getNumberOfFrames() << "frames";
 
-    // Initialise reporting
-    sameSourceConcealmentTotal = 0;
-    multiSourceConcealmentTotal = 0;
-    multiSourceCorrectionTotal = 0;
+    // Initialise reporting (continuing the totals from the checkpoint, if resuming)
+    sameSourceConcealmentTotal = checkpoint.counters.value("sameSourceConcealment", 0);
+    multiSourceConcealmentTotal = checkpoint.counters.value("multiSourceConcealment", 0);
+    multiSourceCorrectionTotal = checkpoint.counters.value("multiSourceCorrection", 0);
 
     // Initialise processing state
-    inputFrameNumber = 1;
-    outputFrameNumber = 1;
+    inputFrameNumber = checkpoint.nextNumber;
+    outputFrameNumber = checkpoint.nextNumber;
     lastFrameNumber = ldDecodeMetaData[0]->getNumberOfFrames();
     totalTimer.start();
+    checkpointTimer.start();
 
     // Start a vector of decoding threads to process the video
     qInfo() << "Beginning multi-threaded dropout correction process...";
@@ -126,6 +147,9 @@ bool CorrectorPool::process()
     // Close the target video
     targetVideo.close();
 
+    // The output is complete, so the checkpoint is no longer needed
+    if (useCheckpoints && !Checkpoint::remove(checkpointFileName)) return false;
+
     return true;
 }
 
@@ -325,6 +349,11 @@ bool CorrectorPool::setOutputFrame(qint32 frameNumber,
         outputFrameNumber++;
     }
 
+    // Save a checkpoint if it's time for another one
+    if (useCheckpoints && checkpointTimer.hasExpired(Checkpoint::INTERVAL)) {
+        if (!writeCheckpoint()) return false;
+    }
+
     return true;
 }
 
@@ -459,6 +488,42 @@ bool CorrectorPool::writeOutputField(const SourceVideo::Data &fieldData)
     return targetVideo.write(reinterpret_cast<const char *>(fieldData.data()), 2 * fieldData.size());
 }
 
+// Return a description of the job, to check a checkpoint belongs to it
+QString CorrectorPool::getCheckpointJob() const
+{
+    QString job = "ld-dropout-correct input";
+    for (const QString &inputFilename : inputFilenames) job += " " + inputFilename;
+    job += QString(" output %1 %2").arg(outputFilename, outputJsonFilename);
+    job += QString(" reverse %1 intra %2 overcorrect %3 frames")
+               .arg(static_cast<int>(reverse)).arg(static_cast<int>(intraField)).arg(static_cast<int>(overCorrect));
+    for (LdDecodeMetaData *metaData : ldDecodeMetaData) job += QString(" %1").arg(metaData->getNumberOfFrames());
+    return job;
+}
+
+// Save a checkpoint of the frames that have been written so far. You must
+// hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool CorrectorPool::writeCheckpoint()
+{
+    if (!targetVideo.flush()) {
+        qCritical() << "Writing to the output TBC file failed";
+        return false;
+    }
+
+    Checkpoint checkpoint;
+    checkpoint.job = getCheckpointJob();
+    checkpoint.nextNumber = outputFrameNumber;
+    checkpoint.outputSize = targetVideo.pos();
+    checkpoint.counters.insert("sameSourceConcealment", sameSourceConcealmentTotal);
+    checkpoint.counters.insert("multiSourceConcealment", multiSourceConcealmentTotal);
+    checkpoint.counters.insert("multiSourceCorrection", multiSourceCorrectionTotal);
+    if (!checkpoint.write(checkpointFileName)) return false;
+
+    checkpointTimer.restart();
+    return true;
+}
+
 // Getters for reporting
 qint32 CorrectorPool::getSameSourceConcealmentTotal()
 {
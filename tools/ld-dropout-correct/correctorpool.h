@@ -32,6 +32,7 @@
 #include <QMutex>
 #include <QThread>
 
+#include "checkpoint.h"
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
 #include "dropoutcorrect.h"
@@ -40,9 +41,10 @@ class CorrectorPool : public QObject
 {
     Q_OBJECT
 public:
-    explicit CorrectorPool(QString _outputFilename, QString _outputJsonFilename,
+    explicit CorrectorPool(QVector<QString> _inputFilenames, QString _outputFilename, QString _outputJsonFilename,
                            qint32 _maxThreads, QVector<LdDecodeMetaData *> &_ldDecodeMetaData, QVector<SourceVideo *> &_sourceVideos,
-                           bool _reverse, bool _intraField, bool _overCorrect, QObject *parent = nullptr);
+                           bool _reverse, bool _intraField, bool _overCorrect, bool _resume = false,
+                           QObject *parent = nullptr);
 
     bool process();
 
@@ -64,12 +66,14 @@ public:
     qint32 getMultiSourceCorrectionTotal();
 
 private:
+    QVector<QString> inputFilenames;
     QString outputFilename;
     QString outputJsonFilename;
     qint32 maxThreads;
     bool reverse;
     bool intraField;
     bool overCorrect;
+    bool resume;
     QElapsedTimer totalTimer;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
@@ -103,6 +107,11 @@ private:
     QMap<qint32, OutputFrame> pendingOutputFrames;
     QFile targetVideo;
 
+    // Checkpoint information (guarded by outputMutex while threads are running)
+    bool useCheckpoints;
+    QString checkpointFileName;
+    QElapsedTimer checkpointTimer;
+
     // Local source information
     QVector<bool> sourceDiscTypeCav;
     QVector<qint32> sourceMinimumVbiFrame;
@@ -118,6 +127,8 @@ private:
     qint32 convertVbiFrameNumberToSequential(qint32 vbiFrameNumber, qint32 sourceNumber);
     QVector<qint32> getAvailableSourcesForFrame(qint32 vbiFrameNumber);
     bool writeOutputField(const SourceVideo::Data &fieldData);
+    QString getCheckpointJob() const;
+    bool writeCheckpoint();
 };
 
 #endif // CORRECTORPOOL_H
@@ -96,6 +96,11 @@ int main(int argc, char *argv[])
                                         QCoreApplication::translate("main", "number"));
     parser.addOption(threadsOption);
 
+    // Option to resume from the last checkpoint (--resume)
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Resume an interrupted run from the checkpoint saved with the output file"));
+    parser.addOption(resumeOption);
+
     // Positional argument to specify input video file
     parser.addPositionalArgument("inputs", QCoreApplication::translate(
                                      "main", "Specify input TBC files (- as first source for piped input)"));
@@ -114,6 +119,7 @@ int main(int argc, char *argv[])
     bool reverse = parser.isSet(setReverseOption);
     bool intraField = parser.isSet(setIntrafieldOption);
     bool overCorrect = parser.isSet(setOverCorrectOption);
+    bool resume = parser.isSet(resumeOption);
 
     // Get the arguments from the parser
     qint32 maxThreads = QThread::idealThreadCount();
@@ -192,10 +198,16 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Check that the output file does not already exist
+    if (resume && outputFilename == "-") {
+        // Quit with error
+        qCritical("Cannot resume with piped output");
+        return -1;
+    }
+
+    // Check that the output file does not already exist (unless it's being resumed)
     if (outputFilename != "-") {
         QFileInfo outputFileInfo(outputFilename);
-        if (outputFileInfo.exists()) {
+        if (outputFileInfo.exists() && !(resume && QFile::exists(Checkpoint::getCheckpointFileName(outputFilename)))) {
             // Quit with error
             qCritical("Specified output file already exists - will not overwrite");
             return -1;
@@ -307,9 +319,9 @@ int main(int argc, char *argv[])
     // Perform the DOC process ----------------------------------------------------------------------------------------
     qInfo() << "Initial source checks are ok and sources are loaded";
     qint32 result = 0;
-    CorrectorPool correctorPool(outputFilename, outputJsonFilename, maxThreads,
+    CorrectorPool correctorPool(inputFilenames, outputFilename, outputJsonFilename, maxThreads,
                                 ldDecodeMetaData, sourceVideos,
-                                reverse, intraField, overCorrect);
+                                reverse, intraField, overCorrect, resume);
     if (!correctorPool.process()) result = 1;
 
     // Report on the result of the correction process
@@ -94,10 +94,24 @@ int main(int argc, char *argv[])
                                              QCoreApplication::translate("main", "file"));
     parser.addOption(writeClosedCaptionsOption);
 
+    QCommandLineOption writeJsonOption("json",
+                                       QCoreApplication::translate("main", "Write the metadata as JSON"),
+                                       QCoreApplication::translate("main", "file"));
+    parser.addOption(writeJsonOption);
+
+    QCommandLineOption writeBinaryOption("binary",
+                                         QCoreApplication::translate("main", "Write the metadata in the binary column format (.ldmeta)"),
+                                         QCoreApplication::translate("main", "file"));
+    parser.addOption(writeBinaryOption);
+
+    QCommandLineOption compactOption("compact",
+                                     QCoreApplication::translate("main", "Merge any journal of updates into the input file"));
+    parser.addOption(compactOption);
+
     // -- Positional arguments --
 
     // Positional argument to specify input video file
-    parser.addPositionalArgument("input", QCoreApplication::translate("main", "Specify input JSON file"));
+    parser.addPositionalArgument("input", QCoreApplication::translate("main", "Specify input JSON or binary metadata file"));
 
     // Process the command line options and arguments given by the user
     parser.process(a);
@@ -159,6 +173,28 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(writeJsonOption)) {
+        const QString &fileName = parser.value(writeJsonOption);
+        if (!metaData.writeJson(fileName)) {
+            qCritical() << "Failed to write output file:" << fileName;
+            return 1;
+        }
+    }
+    if (parser.isSet(writeBinaryOption)) {
+        const QString &fileName = parser.value(writeBinaryOption);
+        if (!metaData.writeBinary(fileName)) {
+            qCritical() << "Failed to write output file:" << fileName;
+            return 1;
+        }
+    }
+
+    if (parser.isSet(compactOption)) {
+        if (!metaData.write(inputFileName)) {
+            qCritical() << "Failed to write output file:" << inputFileName;
+            return 1;
+        }
+    }
+
     // Quit with success
     return 0;
 }
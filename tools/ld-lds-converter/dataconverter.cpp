@@ -24,6 +24,10 @@
 
 #include "dataconverter.h"
 
+#include <QThread>
+
+#include "ldspacking.h"
+
 DataConverter::DataConverter(QString inputFileNameParam, QString outputFileNameParam, bool isPackingParam, bool isRIFFParam, QObject *parent) : QObject(parent)
 {
     // Store the configuration parameters
@@ -49,8 +53,9 @@ bool DataConverter::process(void)
     }
 
     // Packing or unpacking?
-    if (isPacking) packFile();
-    else unpackFile();
+    bool success;
+    if (isPacking) success = packFile();
+    else success = unpackFile();
 
     // Close the input file
     closeInputFile();
@@ -58,8 +63,7 @@ bool DataConverter::process(void)
     // Close the output file
     closeOutputFile();
 
-    // Exit with success
-    return true;
+    return success;
 }
 
 // Method to open the input file for reading
@@ -148,85 +152,99 @@ void DataConverter::closeOutputFile(void)
     outputFileHandle = nullptr;
 }
 
-// Method to pack 16-bit data into 10-bit data
-void DataConverter::packFile(void)
+// Method to fill a buffer from the input file, stopping early only at the
+// end of the input. Returns the number of bytes read.
+qint64 DataConverter::readBuffer(QByteArray &buffer)
 {
-    qDebug() << "DataConverter::packFile(): Packing";
-    QByteArray inputBuffer;
+    qint64 receivedBytes = 0;
+    qint64 totalReceivedBytes = 0;
+    do {
+        receivedBytes = inputFileHandle->read(buffer.data() + totalReceivedBytes, buffer.size() - totalReceivedBytes);
+        if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
+    } while (receivedBytes > 0 && totalReceivedBytes < buffer.size());
+
+    return totalReceivedBytes;
+}
+
+// Method to convert the input file a buffer at a time. Two input buffers are
+// used, so the next buffer can be read by another thread while the current
+// one is being converted and written.
+bool DataConverter::convertFile(qint32 inputBufferSize, qint32 inputUnitSize, qint32 outputUnitSize)
+{
+    QByteArray inputBuffers[2];
+    qint64 receivedBytes[2] = {0, 0};
+    for (QByteArray &inputBuffer : inputBuffers) {
+        inputBuffer.resize(inputBufferSize);
+    }
     QByteArray outputBuffer;
-    bool isComplete = false;
-
-    while(!isComplete) {
-        // Input buffer must be divisible by 5 bytes due to 10-bit data format
-        qint32 bufferSizeInBytes = (20 * 1024 * 1024); // = 20MiBytes
-        inputBuffer.resize(bufferSizeInBytes);
-
-        // Every 4 input words (8 bytes) is 5 output bytes
-        outputBuffer.resize((bufferSizeInBytes / 8) * 5);
-
-        // Fill the input buffer with data
-        qint64 receivedBytes = 0;
-        qint32 totalReceivedBytes = 0;
-        do {
-            receivedBytes = inputFileHandle->read(reinterpret_cast<char *>(inputBuffer.data() + totalReceivedBytes), inputBuffer.size() - totalReceivedBytes);
-            if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
-        } while (receivedBytes > 0 && totalReceivedBytes < bufferSizeInBytes);
-
-        // Check for end of file
-        if (receivedBytes == 0) isComplete = true;
-
-        if (totalReceivedBytes != 0) {
-            // If we didn't fill the input buffer, resize it
-            if (bufferSizeInBytes != totalReceivedBytes) {
-                inputBuffer.resize(totalReceivedBytes);
-                outputBuffer.resize((totalReceivedBytes / 8) * 5);
-            }
-            qDebug() << "DataConverter::packFile(): Got" << totalReceivedBytes << "bytes from input file";
-
-            qint32 word0, word1, word2, word3;
-            qint32 outputBufferPointer = 0;
-
-            qint16 *input = reinterpret_cast<qint16 *>(inputBuffer.data());
-
-            for (qint32 wordPointer = 0; wordPointer < (totalReceivedBytes / 2); wordPointer += 4) {
-
-                word0 = (input[wordPointer + 0] / 64) + 512;
-                word1 = (input[wordPointer + 1] / 64) + 512;
-                word2 = (input[wordPointer + 2] / 64) + 512;
-                word3 = (input[wordPointer + 3] / 64) + 512;
-
-                outputBuffer[outputBufferPointer + 0]  = static_cast<char>((word0 & 0x03FC) >> 2);
-                outputBuffer[outputBufferPointer + 1]  = static_cast<char>(((word0 & 0x0003) << 6) + ((word1 & 0x03F0) >> 4));
-                outputBuffer[outputBufferPointer + 2]  = static_cast<char>(((word1 & 0x000F) << 4) + ((word2 & 0x03C0) >> 6));
-                outputBuffer[outputBufferPointer + 3]  = static_cast<char>(((word2 & 0x003F) << 2) + ((word3 & 0x0300) >> 8));
-                outputBuffer[outputBufferPointer + 4]  = static_cast<char>(word3 & 0x00FF);
-
-                // Increment the packed sample buffer pointer
-                outputBufferPointer += 5;
-            }
-
-            // Write the output buffer to the output file
-            if (!outputFileHandle->write(reinterpret_cast<char *>(outputBuffer.data()),
-                                         outputBuffer.size())) {
-                // File write failed
-                qCritical("Could not write to output file!");
-            }
-            qDebug() << "DataConverter::packFile(): Wrote" << outputBuffer.size() << "bytes to output file";
+    outputBuffer.resize((inputBufferSize / inputUnitSize) * outputUnitSize);
+
+    qint32 current = 0;
+    receivedBytes[current] = readBuffer(inputBuffers[current]);
+
+    while (receivedBytes[current] != 0) {
+        const qint32 next = 1 - current;
+        qDebug() << "DataConverter::convertFile(): Got" << receivedBytes[current] << "bytes from input file";
+
+        // If this buffer is full, start reading the next one
+        QThread *readThread = nullptr;
+        receivedBytes[next] = 0;
+        if (receivedBytes[current] == inputBufferSize) {
+            readThread = QThread::create([this, &inputBuffers, &receivedBytes, next] {
+                receivedBytes[next] = readBuffer(inputBuffers[next]);
+            });
+            readThread->start();
+        }
+
+        // Convert the complete units in this buffer
+        const qint64 numUnits = receivedBytes[current] / inputUnitSize;
+        if (isPacking) {
+            packLds(reinterpret_cast<const qint16 *>(inputBuffers[current].constData()),
+                    reinterpret_cast<quint8 *>(outputBuffer.data()), numUnits);
         } else {
-            // Input file is empty
-            qDebug() << "DataConverter::packFile(): Got zero bytes from input file";
-            isComplete = true;
+            unpackLds(reinterpret_cast<const quint8 *>(inputBuffers[current].constData()),
+                      reinterpret_cast<qint16 *>(outputBuffer.data()), numUnits);
+        }
+
+        // Write the output buffer to the output file
+        const qint64 outputBytes = numUnits * outputUnitSize;
+        bool writeOK = outputFileHandle->write(outputBuffer.constData(), outputBytes) == outputBytes;
+        if (writeOK) {
+            qDebug() << "DataConverter::convertFile(): Wrote" << outputBytes << "bytes to output file";
+        }
+
+        if (readThread != nullptr) {
+            readThread->wait();
+            delete readThread;
         }
+
+        if (!writeOK) {
+            // File write failed
+            qCritical("Could not write to output file!");
+            return false;
+        }
+
+        current = next;
     }
+
+    // Input file is empty
+    qDebug() << "DataConverter::convertFile(): Got zero bytes from input file";
+    return true;
+}
+
+// Method to pack 16-bit data into 10-bit data
+bool DataConverter::packFile(void)
+{
+    qDebug() << "DataConverter::packFile(): Packing";
+
+    // Every 4 input words (8 bytes) is 5 output bytes
+    return convertFile(BUFFER_SIZE, LDS_GROUP_SAMPLES * 2, LDS_GROUP_BYTES);
 }
 
 // Method to unpack 10-bit data into 16-bit data
-void DataConverter::unpackFile(void)
+bool DataConverter::unpackFile(void)
 {
     qDebug() << "DataConversion::unpackFile(): Unpacking";
-    QByteArray inputBuffer;
-    QByteArray outputBuffer;
-    bool isComplete = false;
 
     // Are we writing a RIFF header?
     if (isRIFF) {
@@ -235,82 +253,7 @@ void DataConverter::unpackFile(void)
             QByteArray riffArray = QByteArray::fromHex(riffHex.toLatin1());
             outputFileHandle->write(riffArray);
         }
-        
-
-    while(!isComplete) {
-        // Input buffer must be divisible by 5 bytes due to 10-bit data format
-        qint32 bufferSizeInBytes = (5 * 1024 * 1024) * 4; // 5MiB * 4 = 20MiBytes
-        inputBuffer.fill(0, bufferSizeInBytes);
-
-        // Every 5 input bytes is 4 output words (8 bytes)
-        outputBuffer.resize((bufferSizeInBytes / 5) * 8);
-
-        // Fill the input buffer with data
-        qint64 receivedBytes = 0;
-        qint32 totalReceivedBytes = 0;
-        do {
-            receivedBytes = inputFileHandle->read(reinterpret_cast<char *>(inputBuffer.data() + totalReceivedBytes), bufferSizeInBytes - totalReceivedBytes);
-            if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
-        } while (receivedBytes > 0 && totalReceivedBytes < bufferSizeInBytes);
-
-        // Check for end of file
-        if (receivedBytes == 0) isComplete = true;
-
-        if (totalReceivedBytes != 0) {
-            // If we didn't fill the input buffer, resize it
-            if (bufferSizeInBytes != totalReceivedBytes) {
-                inputBuffer.resize(totalReceivedBytes);
-                outputBuffer.resize((totalReceivedBytes / 5) * 8);
-            }
-            qDebug() << "DataConverter::unpackFile(): Got" << totalReceivedBytes << "bytes from input file";
-
-            char byte0, byte1, byte2, byte3, byte4;
-            qint32 word0, word1, word2, word3;
-            qint32 outputBufferPointer = 0;
-
-            qint16 *output = reinterpret_cast<qint16 *>(outputBuffer.data());
-
-            for (qint32 bytePointer = 0; bytePointer < totalReceivedBytes; bytePointer += 5) {
-                // Unpack the 5 bytes into 4x 10-bit values
-
-                // Unpacked:                 Packed:
-                // 0: xxxx xx00 0000 0000    0: 0000 0000 0011 1111
-                // 1: xxxx xx11 1111 1111    2: 1111 2222 2222 2233
-                // 2: xxxx xx22 2222 2222    4: 3333 3333
-                // 3: xxxx xx33 3333 3333
-
-                byte0 = inputBuffer[bytePointer + 0];
-                byte1 = inputBuffer[bytePointer + 1];
-                byte2 = inputBuffer[bytePointer + 2];
-                byte3 = inputBuffer[bytePointer + 3];
-                byte4 = inputBuffer[bytePointer + 4];
-
-                // Use multiplication instead of left-shift to avoid implicit conversion issues
-                word0  = ((byte0 & 0xFF) *   4) + ((byte1 & 0xC0) >> 6);
-                word1  = ((byte1 & 0x3F) *  16) + ((byte2 & 0xF0) >> 4);
-                word2  = ((byte2 & 0x0F) *  64) + ((byte3 & 0xFC) >> 2);
-                word3  = ((byte3 & 0x03) * 256) + ((byte4 & 0xFF)     );
-
-                output[outputBufferPointer + 0] = static_cast<qint16>((word0 - 512) * 64);
-                output[outputBufferPointer + 1] = static_cast<qint16>((word1 - 512) * 64);
-                output[outputBufferPointer + 2] = static_cast<qint16>((word2 - 512) * 64);
-                output[outputBufferPointer + 3] = static_cast<qint16>((word3 - 512) * 64);
-
-                // Increment the sample buffer pointer
-                outputBufferPointer += 4;
-            }
-
-            // Write the output buffer to the output file
-            if (!outputFileHandle->write(reinterpret_cast<char *>(outputBuffer.data()),
-                                         outputBuffer.size())) {
-                // File write failed
-                qCritical("Could not write to output file!");
-            }
-            qDebug() << "DataConverter::unpackFile(): Wrote" << outputBuffer.size() << "bytes to output file";
-        } else {
-            // Input file is empty
-            qDebug() << "DataConverter::unpackFile(): Got zero bytes from input file";
-            isComplete = true;
-        }
-    }
+
+    // Every 5 input bytes is 4 output words (8 bytes)
+    return convertFile(BUFFER_SIZE, LDS_GROUP_BYTES, LDS_GROUP_SAMPLES * 2);
 }
@@ -49,13 +49,19 @@ private:
     QFile *inputFileHandle;
     QFile *outputFileHandle;
 
+    // Input buffer size; this must be divisible by both 5 and 8 bytes, due to
+    // the 10-bit data format
+    static constexpr qint32 BUFFER_SIZE = 20 * 1024 * 1024; // = 20MiBytes
+
     // Private methods
     bool openInputFile(void);
     void closeInputFile(void);
     bool openOutputFile(void);
     void closeOutputFile(void);
-    void packFile(void);
-    void unpackFile(void);
+    qint64 readBuffer(QByteArray &buffer);
+    bool convertFile(qint32 inputBufferSize, qint32 inputUnitSize, qint32 outputUnitSize);
+    bool packFile(void);
+    bool unpackFile(void);
 };
 
 #endif // DATACONVERTER_H
@@ -0,0 +1,182 @@
+/************************************************************************
+
+    ldspacking.cpp
+
+    ld-lds-converter - 10-bit to 16-bit .lds converter for ld-decode
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-lds-converter is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "ldspacking.h"
+
+#include <QtEndian>
+#include <cstring>
+
+// The scalar code treats each group as a 40-bit big-endian number, which
+// can be loaded or stored with a single byte swap. The SSSE3 code does the
+// same for two groups at once, using a byte shuffle for the swap.
+//
+// Default x86 builds only assume SSE2, so unless the compiler has been told
+// SSSE3 is always available, the SSSE3 code is compiled for that target
+// alone and used if the CPU supports it.
+#if defined(__SSSE3__)
+#define LDS_HAVE_SSSE3
+#define LDS_SSSE3_TARGET
+static inline bool cpuHasSsse3()
+{
+    return true;
+}
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LDS_HAVE_SSSE3
+#define LDS_SSSE3_TARGET __attribute__((target("ssse3")))
+static inline bool cpuHasSsse3()
+{
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+#endif
+
+#if defined(LDS_HAVE_SSSE3)
+#include <tmmintrin.h>
+#endif
+
+// Reduce a sample to 10 bits. The division truncates towards zero, as the
+// original converter did, so this isn't the same as a right shift.
+static inline quint64 reduceSample(qint16 sample)
+{
+    return static_cast<quint64>((sample / 64) + 512);
+}
+
+#if defined(LDS_HAVE_SSSE3)
+// Pack as many groups as possible, 8 samples into 10 bytes at a time.
+// Returns the number of groups packed.
+LDS_SSSE3_TARGET static qint64 packGroupsSsse3(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    qint64 group = 0;
+
+    const __m128i bias = _mm_set1_epi16(512);
+    const __m128i roundMask = _mm_set1_epi16(63);
+    const __m128i pairMultipliers = _mm_set_epi16(1, 1024, 1, 1024, 1, 1024, 1, 1024);
+    const __m128i low32Mask = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i swapBytes = _mm_set_epi8(-1, -1, -1, -1, -1, -1, 8, 9, 10, 11, 12, 0, 1, 2, 3, 4);
+
+    // Each iteration stores 16 bytes, so stop while there's still room for
+    // the extra 6
+    for (; group + 4 <= numGroups; group += 2) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + (group * LDS_GROUP_SAMPLES)));
+
+        // Divide by 64, rounding towards zero, and add 512
+        samples = _mm_add_epi16(samples, _mm_and_si128(_mm_srai_epi16(samples, 15), roundMask));
+        const __m128i words = _mm_add_epi16(_mm_srai_epi16(samples, 6), bias);
+
+        // Combine pairs of words into 20 bits, then pairs of those into 40
+        const __m128i pairs = _mm_madd_epi16(words, pairMultipliers);
+        const __m128i groups = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(pairs, low32Mask), 20),
+                                            _mm_srli_epi64(pairs, 32));
+
+        // Store the low 5 bytes of each group, most significant first
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (group * LDS_GROUP_BYTES)),
+                         _mm_shuffle_epi8(groups, swapBytes));
+    }
+
+    return group;
+}
+#endif
+
+void packLds(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    qint64 group = 0;
+
+#if defined(LDS_HAVE_SSSE3)
+    if (cpuHasSsse3())
+        group = packGroupsSsse3(input, output, numGroups);
+#endif
+
+    for (; group < numGroups; group++) {
+        const qint16 *in = input + (group * LDS_GROUP_SAMPLES);
+        const quint64 value = (reduceSample(in[0]) << 30) | (reduceSample(in[1]) << 20)
+                              | (reduceSample(in[2]) << 10) | reduceSample(in[3]);
+
+        // Store the 40-bit value big-endian
+        const quint64 bigEndian = qToBigEndian(value << 24);
+        std::memcpy(output + (group * LDS_GROUP_BYTES), &bigEndian, LDS_GROUP_BYTES);
+    }
+}
+
+// Expand a 10-bit word back to a 16-bit sample
+static inline qint16 expandWord(quint64 word)
+{
+    return static_cast<qint16>((static_cast<qint32>(word & 0x3FF) - 512) * 64);
+}
+
+#if defined(LDS_HAVE_SSSE3)
+// Unpack as many groups as possible, 10 bytes into 8 samples at a time.
+// Returns the number of groups unpacked.
+LDS_SSSE3_TARGET static qint64 unpackGroupsSsse3(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    qint64 group = 0;
+
+    const __m128i swapBytes = _mm_set_epi8(-1, -1, -1, 5, 6, 7, 8, 9, -1, -1, -1, 0, 1, 2, 3, 4);
+    const __m128i word1Mask = _mm_set1_epi64x(0x3FFLL << 16);
+    const __m128i word2Mask = _mm_set1_epi64x(0x3FFLL << 32);
+    const __m128i bias = _mm_set1_epi16(512);
+
+    // Each iteration loads 16 bytes, so stop while there's still room for
+    // the extra 6
+    for (; group + 4 <= numGroups; group += 2) {
+        // Load each group as a 40-bit number in a 64-bit lane
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + (group * LDS_GROUP_BYTES)));
+        const __m128i groups = _mm_shuffle_epi8(packed, swapBytes);
+
+        // Move each 10-bit word into its own 16-bit lane
+        __m128i words = _mm_srli_epi64(groups, 30);
+        words = _mm_or_si128(words, _mm_and_si128(_mm_srli_epi64(groups, 4), word1Mask));
+        words = _mm_or_si128(words, _mm_and_si128(_mm_slli_epi64(groups, 22), word2Mask));
+        words = _mm_or_si128(words, _mm_slli_epi64(groups, 48));
+        words = _mm_and_si128(words, _mm_set1_epi16(0x3FF));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (group * LDS_GROUP_SAMPLES)),
+                         _mm_slli_epi16(_mm_sub_epi16(words, bias), 6));
+    }
+
+    return group;
+}
+#endif
+
+void unpackLds(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    qint64 group = 0;
+
+#if defined(LDS_HAVE_SSSE3)
+    if (cpuHasSsse3())
+        group = unpackGroupsSsse3(input, output, numGroups);
+#endif
+
+    for (; group < numGroups; group++) {
+        // Load the 40-bit value big-endian
+        quint64 bigEndian = 0;
+        std::memcpy(&bigEndian, input + (group * LDS_GROUP_BYTES), LDS_GROUP_BYTES);
+        const quint64 value = qFromBigEndian(bigEndian) >> 24;
+
+        qint16 *out = output + (group * LDS_GROUP_SAMPLES);
+        out[0] = expandWord(value >> 30);
+        out[1] = expandWord(value >> 20);
+        out[2] = expandWord(value >> 10);
+        out[3] = expandWord(value);
+    }
+}
@@ -0,0 +1,54 @@
+/************************************************************************
+
+    ldspacking.h
+
+    ld-lds-converter - 10-bit to 16-bit .lds converter for ld-decode
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-lds-converter is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef LDSPACKING_H
+#define LDSPACKING_H
+
+#include <QtGlobal>
+
+// Conversion between 16-bit signed samples and the packed 10-bit .lds format.
+//
+// Each group of four samples is reduced to 10 bits (by dividing by 64 and
+// adding 512), and the four 10-bit words are stored as 5 bytes, most
+// significant bit first:
+//
+// Unpacked:                 Packed:
+// 0: xxxx xx00 0000 0000    0: 0000 0000 0011 1111
+// 1: xxxx xx11 1111 1111    2: 1111 2222 2222 2233
+// 2: xxxx xx22 2222 2222    4: 3333 3333
+// 3: xxxx xx33 3333 3333
+
+// Number of bytes in a packed group of four samples
+static constexpr qint32 LDS_GROUP_BYTES = 5;
+
+// Number of samples in a group
+static constexpr qint32 LDS_GROUP_SAMPLES = 4;
+
+// Pack numGroups groups of 16-bit samples from input into output
+void packLds(const qint16 *input, quint8 *output, qint64 numGroups);
+
+// Unpack numGroups groups of packed samples from input into output
+void unpackLds(const quint8 *input, qint16 *output, qint64 numGroups);
+
+#endif // LDSPACKING_H
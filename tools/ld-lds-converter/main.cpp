@@ -122,7 +122,9 @@ int main(int argc, char *argv[])
     DataConverter dataConverter(inputFileName, outputFileName, !modeUnpack, modeRIFF);
 
     // Process the data conversion
-    dataConverter.process();
+    if (!dataConverter.process()) {
+        return -1;
+    }
 
     // Quit with success
     return 0;
@@ -0,0 +1,149 @@
+/************************************************************************
+
+    testldspacking.cpp
+
+    Unit tests for .lds packing and unpacking
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using std::cerr;
+
+#include "ldspacking.h"
+
+// These are the original per-group loops from DataConverter, used as a
+// reference for the optimised versions.
+
+static void referencePack(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    for (qint64 group = 0; group < numGroups; group++) {
+        const qint16 *in = input + (group * 4);
+        quint8 *out = output + (group * 5);
+
+        const qint32 word0 = (in[0] / 64) + 512;
+        const qint32 word1 = (in[1] / 64) + 512;
+        const qint32 word2 = (in[2] / 64) + 512;
+        const qint32 word3 = (in[3] / 64) + 512;
+
+        out[0] = static_cast<quint8>((word0 & 0x03FC) >> 2);
+        out[1] = static_cast<quint8>(((word0 & 0x0003) << 6) + ((word1 & 0x03F0) >> 4));
+        out[2] = static_cast<quint8>(((word1 & 0x000F) << 4) + ((word2 & 0x03C0) >> 6));
+        out[3] = static_cast<quint8>(((word2 & 0x003F) << 2) + ((word3 & 0x0300) >> 8));
+        out[4] = static_cast<quint8>(word3 & 0x00FF);
+    }
+}
+
+static void referenceUnpack(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    for (qint64 group = 0; group < numGroups; group++) {
+        const quint8 *in = input + (group * 5);
+        qint16 *out = output + (group * 4);
+
+        const qint32 word0 = ((in[0] & 0xFF) *   4) + ((in[1] & 0xC0) >> 6);
+        const qint32 word1 = ((in[1] & 0x3F) *  16) + ((in[2] & 0xF0) >> 4);
+        const qint32 word2 = ((in[2] & 0x0F) *  64) + ((in[3] & 0xFC) >> 2);
+        const qint32 word3 = ((in[3] & 0x03) * 256) + ((in[4] & 0xFF)     );
+
+        out[0] = static_cast<qint16>((word0 - 512) * 64);
+        out[1] = static_cast<qint16>((word1 - 512) * 64);
+        out[2] = static_cast<qint16>((word2 - 512) * 64);
+        out[3] = static_cast<qint16>((word3 - 512) * 64);
+    }
+}
+
+// Pack and unpack samples, comparing against the reference code. The
+// buffers have a guard byte/sample after the end, which shouldn't be written.
+static void testSamples(const char *name, const std::vector<qint16> &samples)
+{
+    const qint64 numGroups = static_cast<qint64>(samples.size()) / LDS_GROUP_SAMPLES;
+    cerr << "Testing " << name << " (" << numGroups << " groups)\n";
+
+    std::vector<quint8> expectedPacked(numGroups * LDS_GROUP_BYTES + 1, 0xAA);
+    std::vector<quint8> packed(numGroups * LDS_GROUP_BYTES + 1, 0xAA);
+    referencePack(samples.data(), expectedPacked.data(), numGroups);
+    packLds(samples.data(), packed.data(), numGroups);
+    if (packed != expectedPacked) {
+        for (size_t i = 0; i < packed.size(); i++) {
+            if (packed[i] != expectedPacked[i]) {
+                cerr << "Packed byte " << i << " is " << int(packed[i]) << ", expected " << int(expectedPacked[i]) << "\n";
+                break;
+            }
+        }
+        exit(1);
+    }
+
+    std::vector<qint16> expectedUnpacked(numGroups * LDS_GROUP_SAMPLES + 1, 0x5555);
+    std::vector<qint16> unpacked(numGroups * LDS_GROUP_SAMPLES + 1, 0x5555);
+    referenceUnpack(packed.data(), expectedUnpacked.data(), numGroups);
+    unpackLds(packed.data(), unpacked.data(), numGroups);
+    if (unpacked != expectedUnpacked) {
+        for (size_t i = 0; i < unpacked.size(); i++) {
+            if (unpacked[i] != expectedUnpacked[i]) {
+                cerr << "Unpacked sample " << i << " is " << unpacked[i] << ", expected " << expectedUnpacked[i] << "\n";
+                break;
+            }
+        }
+        exit(1);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> sample(-32768, 32767);
+
+    // Random samples, with every group count from 0 to 20 so the vector
+    // loops leave each possible number of trailing groups
+    for (qint64 numGroups = 0; numGroups <= 20; numGroups++) {
+        std::vector<qint16> samples(numGroups * LDS_GROUP_SAMPLES);
+        for (auto &s: samples) s = static_cast<qint16>(sample(rng));
+        testSamples("random", samples);
+    }
+
+    // A larger random buffer
+    std::vector<qint16> samples(100003 * LDS_GROUP_SAMPLES);
+    for (auto &s: samples) s = static_cast<qint16>(sample(rng));
+    testSamples("large random", samples);
+
+    // Extremes, and negative values where dividing by 64 rounds towards zero
+    // rather than down
+    const std::vector<qint16> edges {
+        -32768, -32767, -32705, -32704, -129, -128, -127, -65, -64, -63, -1, 0,
+        1, 63, 64, 65, 127, 128, 32703, 32704, 32766, 32767,
+    };
+    samples.clear();
+    for (qint16 a: edges)
+        for (qint16 b: edges)
+            samples.push_back((samples.size() % 2) ? a : b);
+    samples.resize(samples.size() - (samples.size() % LDS_GROUP_SAMPLES));
+    testSamples("edge cases", samples);
+
+    // Every 10-bit word in every position when unpacking
+    std::vector<qint16> allWords;
+    for (qint32 word = 0; word < 1024; word++)
+        for (qint32 i = 0; i < LDS_GROUP_SAMPLES; i++)
+            allWords.push_back(static_cast<qint16>((word - 512) * 64 + i));
+    testSamples("all words", allWords);
+
+    return 0;
+}
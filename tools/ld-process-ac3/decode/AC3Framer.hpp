@@ -41,7 +41,7 @@ struct StreamBuffer {
     // automatically gets the next block as needed, allows for treating the stream as a contiguous array
     auto operator[](unsigned long pos) {
         if (pos >= buffer_pos) {
-            auto frame = source.next();
+            const auto &frame = source.next();
             auto remaining_before_loop = buffer_size - (buffer_pos % buffer_size);
             if (frame.size() <= remaining_before_loop) { // no need to wrap
                 std::memcpy(buffer + (buffer_pos % buffer_size), frame.data(), frame.size());
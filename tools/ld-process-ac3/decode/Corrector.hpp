@@ -26,16 +26,79 @@
 
 #pragma once
 
+#include <cstring>
+
 #include "Blocker.hpp"
 #include "ezpwd/rs"
 
 
-// FCR = First consecutive root
+// Galois field and generator polynomial parameters of the AC3-RF codes
+static constexpr int AC3RS_POLY = 0x187;
+static constexpr int AC3RS_FCR = 120; // FCR = First consecutive root
+static constexpr int AC3RS_PRIM = 1;
+
 template<size_t SYMBOLS, size_t PAYLOAD>
 struct AC3RS;
 
 
-template<size_t PAYLOAD> struct AC3RS<255, PAYLOAD> : public __RS(AC3RS, uint8_t, 255, PAYLOAD, 0x187, 120, 1, false);
+template<size_t PAYLOAD> struct AC3RS<255, PAYLOAD> : public __RS(AC3RS, uint8_t, 255, PAYLOAD, AC3RS_POLY, AC3RS_FCR, AC3RS_PRIM, false);
+
+
+// Computes the syndromes of an AC3RS codeword with NROOTS parity symbols.
+// This is much cheaper than a full decode, and most codewords have no errors,
+// so they can be checked first and only decoded if any syndrome is non-zero.
+template<size_t NROOTS>
+struct SyndromeChecker {
+    SyndromeChecker() {
+        // Build log/antilog tables for the field
+        uint8_t alphaTo[255];
+        int indexOf[256];
+        int x = 1;
+        for (int i = 0; i < 255; ++i) {
+            alphaTo[i] = (uint8_t) x;
+            indexOf[x] = i;
+            x <<= 1;
+            if (x & 0x100)
+                x ^= AC3RS_POLY;
+        }
+
+        // Syndrome i is the codeword evaluated at alpha^((FCR + i) * PRIM)
+        for (size_t i = 0; i < NROOTS; ++i) {
+            const int root = ((AC3RS_FCR + (int) i) * AC3RS_PRIM) % 255;
+            mulRoot[i][0] = 0;
+            for (int v = 1; v < 256; ++v)
+                mulRoot[i][v] = alphaTo[(indexOf[v] + root) % 255];
+        }
+    }
+
+    // Returns true if all the syndromes are zero, i.e. the codeword is valid
+    bool isClean(const uint8_t *codeword, int length) const {
+        uint8_t syn[NROOTS] = {0};
+        for (int j = 0; j < length; ++j)
+            for (size_t i = 0; i < NROOTS; ++i)
+                syn[i] = mulRoot[i][syn[i]] ^ codeword[j];
+
+        uint8_t synError = 0;
+        for (size_t i = 0; i < NROOTS; ++i)
+            synError |= syn[i];
+        return synError == 0;
+    }
+
+    // Multiplication by each root of the generator polynomial
+    uint8_t mulRoot[NROOTS][256];
+};
+
+
+// The corrected data from one QPSK block, with padding removed
+struct CorrectedBlock {
+    static constexpr int maxSize = 66 * 32;
+
+    uint8_t bytes[maxSize];
+    size_t length = 0;
+
+    const uint8_t *data() const { return bytes; }
+    size_t size() const { return length; }
+};
 
 
 template<class DATA_SRC>
@@ -45,96 +108,125 @@ struct Corrector {
     DATA_SRC &source;
     AC3RS<255, 255 - (36 - 32)> RS; // RS(36,32)
     AC3RS<255, 255 - (37 - 33)> RS2; // RS(37,33)
+    SyndromeChecker<4> syndromes;
 
-    std::map<int, int> stats;
-    std::map<int, int> total_stats;
+    // Check the syndromes of each codeword before decoding it, skipping the
+    // full decode for those with no errors. This gives the same results, so
+    // it's only worth turning off to compare against the plain decoder.
+    bool checkSyndromesFirst = true;
 
-    // Applies reed-solomon error correction and removes padding. return value is variable-length
-    auto next() {
-        QPSKBlock block = source.next();
-        std::vector<uint8_t> data; // 'correctedDataBuffer' in scala
-        data.reserve(36 * 66);
+    // Results of RS decoding (-1 for failure, or the number of symbols
+    // corrected) for the current block and in total, indexed by result + 1
+    static constexpr int maxResult = 4;
+    long stats[maxResult + 2]{};
+    long total_stats[maxResult + 2]{};
+
+    long totalStats(int result) const {
+        return total_stats[result + 1];
+    }
 
-        bool erasures[72 * 37] = {false};
+    // Working buffers, reused for each block
+    QPSKBlock block{};
+    bool erasures[36 * 74]{};
+    uint8_t c1Codewords[72][37]{};
+    CorrectedBlock corrected;
+
+    // Applies reed-solomon error correction and removes padding. return value is variable-length
+    const CorrectedBlock &next() {
+        block = source.next();
+        corrected.length = 0;
 
         // C1
+        // Separate all the rows into odd and even codewords first, then decode them together
         for (int rowI = 0; rowI < 36; ++rowI) { // 36 rows of 74
             for (int odd = 0; odd < 2; ++odd) { // odd vs even bytes
-                uint8_t codeword[37];
+                uint8_t *codeword = c1Codewords[rowI * 2 + odd];
                 for (int i = 0; i < 37; ++i)
                     codeword[i] = block.bytes[rowI * 74 + i * 2 + odd];
-                auto r = RS2.decode(codeword, 37);
-                stats[r]++;
+            }
+        }
+        for (int rowI = 0; rowI < 36; ++rowI) {
+            for (int odd = 0; odd < 2; ++odd) {
+                uint8_t *codeword = c1Codewords[rowI * 2 + odd];
+                int r;
+                if (checkSyndromesFirst && syndromes.isClean(codeword, 37))
+                    r = 0;
+                else
+                    r = RS2.decode(codeword, 37);
+                stats[r + 1]++;
+
+                // if the row can't be corrected, mark all its bytes as erasures for C2
+                for (int i = 0; i < 37; ++i)
+                    erasures[rowI * 74 + i * 2 + odd] = (r == -1);
 
-                if (r == -1)
+                // put the word back if it's changed
+                if (r != 0)
                     for (int i = 0; i < 37; ++i)
-                        erasures[rowI * 72 + i * 2 + odd] = true;
-
-                // todo; if (r == -1) mark all bytes in frame as erasures for C2
-
-                // put the word back; todo improved method
-                for (int i = 0; i < 37; ++i)
-                    block.bytes[rowI * 74 + i * 2 + odd] = codeword[i];
+                        block.bytes[rowI * 74 + i * 2 + odd] = codeword[i];
             }
         }
         // print & clear stats
-        auto *logger = new Logger(INFO, "C1");
-        for (int i = -1; i < 3; ++i)
-            *logger << stats[i] << "\t";
-        *logger << "-\t-\t";
-        delete logger;
-
-        for (auto p: stats)
-            total_stats[p.first] += p.second;
-        stats.clear();
+        if (Logger::isEnabled(INFO)) {
+            Logger logger(INFO, "C1");
+            for (int i = -1; i < 3; ++i)
+                logger << stats[i + 1] << "\t";
+            logger << "-\t-\t";
+        }
+        addStats();
 
-        // bool c2_erasures[72 * 37] = {false};
         // C2
         for (int k = 0; k < 66; ++k) {
             uint8_t codeword[36];
-            std::vector<unsigned> codeword_erasures{4};
+            unsigned codewordErasures[36]; // ezpwd also stores the corrected positions here
+            unsigned numErasures = 0;
 
             for (int i = 0; i < 36; ++i) {
                 codeword[i] = block.bytes[k + i * 74];
                 if (erasures[k + i * 74])
-                    codeword_erasures.emplace_back(i);
+                    codewordErasures[numErasures++] = i;
             }
 
-            // auto r1 = RS.decode(codeword, 36);
             int r;
-            if (codeword_erasures.size() > RS.nroots())
+            if (numErasures > RS.nroots())
                 r = -1;
+            else if (checkSyndromesFirst && numErasures == 0 && syndromes.isClean(codeword, 36))
+                r = 0;
             else
-                r = RS.decode(codeword, 32, codeword + 32, codeword_erasures.data(), codeword_erasures.size());
-            stats[r]++;
+                r = RS.decode(codeword, 32, codeword + 32, codewordErasures, numErasures);
+            stats[r + 1]++;
 
             // todo what to do with dead blocks?
-            // if (r == -1)
-            //     for (int i = 0; i<36; i++)
-            //         c2_erasures[k+i*74] = true;
 
             if (k == 0) {
                 if (codeword[0] != 0x10 || codeword[1] != 0x00) {
                     fprintf(stderr, "Block does not start with 0x10\n");
                 } else // copy skipping first two bytes
-                    // data.insert(data.end(), codeword.begin() + 2, codeword.end());
-                    data.insert(data.end(), &codeword[2], &codeword[32]);
+                    append(&codeword[2], 30);
             } else // just copy
-                // data.insert(data.end(), codeword.begin(), codeword.end());
-                data.insert(data.end(), &codeword[0], &codeword[32]);
+                append(&codeword[0], 32);
         }
 
         // print & clear stats
-        logger = new Logger(INFO, "C2");
-        for (int i = -1; i < 5; ++i)
-            *logger << stats[i] << "\t";
-        delete logger;
-        for (auto p: stats)
-            total_stats[p.first] += p.second;
-        stats.clear();
-        // }
-
-        data.shrink_to_fit();
-        return data; // max size 66 * 36 = 2376
+        if (Logger::isEnabled(INFO)) {
+            Logger logger(INFO, "C2");
+            for (int i = -1; i < 5; ++i)
+                logger << stats[i + 1] << "\t";
+        }
+        addStats();
+
+        return corrected; // max size 66 * 32 - 2 = 2110
+    }
+
+private:
+    void append(const uint8_t *data, int size) {
+        std::memcpy(corrected.bytes + corrected.length, data, size);
+        corrected.length += size;
+    }
+
+    void addStats() {
+        for (int i = 0; i < maxResult + 2; ++i) {
+            total_stats[i] += stats[i];
+            stats[i] = 0;
+        }
     }
 };
@@ -157,12 +157,12 @@ int main(int argc, char *argv[]) {
 
     // print final / overall stats
     Logger(INFO, "RS Totals")
-        << corrector.total_stats[-1] << "\t"
-        << corrector.total_stats[+0] << "\t"
-        << corrector.total_stats[+1] << "\t"
-        << corrector.total_stats[+2] << "\t"
-        << corrector.total_stats[+3] << "\t"
-        << corrector.total_stats[+4];
+        << corrector.totalStats(-1) << "\t"
+        << corrector.totalStats(+0) << "\t"
+        << corrector.totalStats(+1) << "\t"
+        << corrector.totalStats(+2) << "\t"
+        << corrector.totalStats(+3) << "\t"
+        << corrector.totalStats(+4);
     Logger(INFO, "QPSK Frame Total") << framer.n_frames;
     Logger(INFO, "AC3 Frame Total") << ac3_frames;
 
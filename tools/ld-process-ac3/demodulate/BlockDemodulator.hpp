@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * BlockDemodulator.hpp
+ *
+ * ld-process-ac3 - AC3-RF decoder
+ * Copyright (C) 2026 ld-decode-tools contributors
+ *
+ * This file is part of ld-decode-tools.
+ *
+ * ld-process-ac3 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Demodulator.hpp"
+
+// Does the same job as OneBitADC followed by Demodulator, producing exactly
+// the same symbols, but works on large blocks of input at a time rather than
+// pulling one sample at a time through the chain.
+//
+// For each block:
+// - The rolling average is computed from a prefix sum of the samples, and
+//   each sample is compared against it, giving 64 one-bit samples per word.
+// - For each phase, the bit stream is XORed with a delayed copy of itself a
+//   whole word (64 sample positions) at a time. Demodulator's correlation
+//   sums count the 1 bits in a window of compareIntervalSize positions.
+// - Rather than counting the bits in each window, the symbol is looked up
+//   from the differences between the sums, which are kept as a running
+//   total: moving the window along one position adds the bit entering the
+//   window and subtracts the bit leaving it.
+// next() then returns the demodulated symbols one at a time.
+struct BlockDemodulator {
+    static constexpr int compareIntervalSize = Demodulator<BlockDemodulator>::compareIntervalSize;
+    static constexpr int samplesBetweenSymbols = Demodulator<BlockDemodulator>::samplesBetweenSymbols;
+    static constexpr int phaseShift = Demodulator<BlockDemodulator>::phaseShift;
+    static constexpr int bufferPreload = Demodulator<BlockDemodulator>::bufferPreload;
+
+    // Default number of samples to process at once (must be a multiple of 64)
+    static constexpr int defaultBlockSize = 1 << 20;
+
+    // The furthest back in the bit stream the correlation needs to look, and
+    // so how many words of history to keep
+    static constexpr int maxDelay = samplesBetweenSymbols + (3 * phaseShift) + compareIntervalSize;
+    static constexpr int historyWords = (maxDelay / 64) + 2;
+
+    explicit BlockDemodulator(int avgLength, std::istream &source, int blockSize = defaultBlockSize)
+        : source(source), avgLength(avgLength), blockSize(blockSize),
+          samples(avgLength + blockSize), prefixSums(avgLength + blockSize + 1),
+          bits(historyWords + (blockSize / 64)), symbols(blockSize) {
+        if (avgLength < 1 || blockSize <= 0 || (blockSize % 64) != 0)
+            throw std::invalid_argument("Bad BlockDemodulator parameters");
+
+        // Before the start of the input, OneBitADC's history is full of 128s,
+        // and Demodulator's history is full of 0 bits
+        std::memset(samples.data(), 128, avgLength);
+        for (int i = 0; i < historyWords; i++)
+            bits[i] = 0;
+        for (int ph = 0; ph < 4; ph++)
+            lastWindow[ph] = 0;
+
+        // Work out the symbol for each combination of correlation sums,
+        // indexed by the differences used in Demodulator::next
+        for (int a = -compareIntervalSize; a <= compareIntervalSize; a++) {
+            for (int b = -compareIntervalSize; b <= compareIntervalSize; b++) {
+                const char winner = (abs(a) > abs(b)) ? (a > 0 ? 0 : 3) : (b > 0 ? 1 : 2);
+                winners[((a + compareIntervalSize) * winnerStride) + b + compareIntervalSize] = winner;
+            }
+        }
+
+        // All the sums start at 0
+        winnerIndex = (compareIntervalSize * winnerStride) + compareIntervalSize;
+
+        // Demodulator discards the symbols while it fills its buffer
+        toSkip = bufferPreload;
+    }
+
+    // Returns the symbol for the next input sample
+    inline char next() {
+        if (symbolPos == symbolCount)
+            readBlock();
+        return symbols[symbolPos++];
+    }
+
+private:
+    static constexpr int winnerStride = (2 * compareIntervalSize) + 1;
+
+    std::istream &source;
+    int avgLength;
+    int blockSize;
+
+    // avgLength samples of history, followed by the current block
+    std::vector<uint8_t> samples;
+    std::vector<uint32_t> prefixSums;
+
+    // historyWords of history, followed by the current block, one bit per
+    // sample, with the earliest sample in each word in the LSB
+    std::vector<uint64_t> bits;
+
+    // The last window of XORed bits for each phase, which are leaving the
+    // window as the next ones enter it
+    static_assert(compareIntervalSize == 16, "Windows must be 16 bits");
+    uint16_t lastWindow[4];
+
+    // The symbol for each pair of differences between the correlation sums,
+    // and the index into this for the current differences
+    char winners[winnerStride * winnerStride];
+    int winnerIndex;
+
+    std::vector<char> symbols;
+    int symbolPos = 0;
+    int symbolCount = 0;
+    int toSkip = 0;
+
+    // Read and demodulate the next block of input
+    void readBlock() {
+        do {
+            source.read(reinterpret_cast<char *>(samples.data() + avgLength), blockSize);
+            const int count = static_cast<int>(source.gcount());
+            if (count == 0)
+                throw std::range_error("EOF");
+
+            thresholdBlock(count);
+            demodulateBlock(count);
+
+            // Keep the end of this block as history for the next one
+            std::memmove(samples.data(), samples.data() + count, avgLength);
+            const int blockWords = (count + 63) / 64;
+            std::memmove(bits.data(), bits.data() + blockWords, historyWords * sizeof(uint64_t));
+
+            // Skip the symbols Demodulator would have discarded
+            const int skip = (toSkip < count) ? toSkip : count;
+            toSkip -= skip;
+            symbolPos = skip;
+            symbolCount = count;
+        } while (symbolPos == symbolCount);
+    }
+
+    // Compare each sample in the block against the average of the last
+    // avgLength samples, producing one bit per sample
+    void thresholdBlock(int count) {
+        const int total = avgLength + count;
+        const uint8_t *in = samples.data();
+
+        // Compute the prefix sums of the samples, so the sum of samples
+        // [i - avgLength + 1, i] is prefixSums[i + 1] - prefixSums[i + 1 - avgLength].
+        // These may wrap around, but the differences will still be correct.
+        uint32_t *prefix = prefixSums.data();
+        prefix[0] = 0;
+        for (int i = 0; i < total; i++)
+            prefix[i + 1] = prefix[i] + in[i];
+
+        // OneBitADC's test of (sample > sum / avgLength) is the same as
+        // (sample * avgLength > sum), since sample is an integer
+        uint64_t *out = bits.data() + historyWords;
+        const uint32_t n = static_cast<uint32_t>(avgLength);
+        int i = 0;
+#if defined(__SSE2__)
+        // The multiply is done with 16-bit operands
+        if (avgLength < 32768) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i nV = _mm_set1_epi32(avgLength);
+            for (; i + 64 <= count; i += 64) {
+                uint64_t word = 0;
+                for (int group = 0; group < 64; group += 16) {
+                    const int pos = avgLength + i + group;
+                    const __m128i x8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + pos));
+                    const __m128i x16[2] = {_mm_unpacklo_epi8(x8, zero), _mm_unpackhi_epi8(x8, zero)};
+
+                    __m128i greater[4];
+                    for (int j = 0; j < 4; j++) {
+                        const __m128i x32 = (j % 2) == 0 ? _mm_unpacklo_epi16(x16[j / 2], zero)
+                                                         : _mm_unpackhi_epi16(x16[j / 2], zero);
+                        const __m128i xn = _mm_madd_epi16(x32, nV);
+
+                        const int p = pos + (4 * j) + 1;
+                        const __m128i sum = _mm_sub_epi32(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(prefix + p)),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(prefix + p - avgLength)));
+                        greater[j] = _mm_cmpgt_epi32(xn, sum);
+                    }
+
+                    const __m128i packed = _mm_packs_epi16(_mm_packs_epi32(greater[0], greater[1]),
+                                                           _mm_packs_epi32(greater[2], greater[3]));
+                    word |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(packed))) << group;
+                }
+                out[i / 64] = word;
+            }
+        }
+#endif
+        for (; i < count; i += 64) {
+            uint64_t word = 0;
+            for (int j = 0; j < 64 && i + j < count; j++) {
+                const int pos = avgLength + i + j;
+                const uint32_t sum = prefix[pos + 1] - prefix[pos + 1 - avgLength];
+                word |= static_cast<uint64_t>(static_cast<uint32_t>(in[pos]) * n > sum) << j;
+            }
+            out[i / 64] = word;
+        }
+    }
+
+    // Get the word of bits starting delay samples before word w
+    inline uint64_t delayedWord(int w, int delay) const {
+        const int shift = delay % 64;
+        const uint64_t *word = bits.data() + w - (delay / 64);
+        if (shift == 0)
+            return word[0];
+        return (word[0] << shift) | (word[-1] >> (64 - shift));
+    }
+
+    // Find how the differences between the correlation sums change at each
+    // of the 16 positions in the window starting at pos in diff, given the
+    // previous window
+    inline void windowDeltas(const uint64_t diff[4], int pos, int8_t aDelta[16], int8_t bDelta[16]) {
+        uint16_t window[4];
+        for (int ph = 0; ph < 4; ph++)
+            window[ph] = static_cast<uint16_t>(diff[ph] >> pos);
+
+#if defined(__SSE2__)
+        // Expand each bit into a byte of 0 or 1
+        const __m128i masks = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m128i one = _mm_set1_epi8(1);
+        auto expand = [&](uint16_t value) {
+            const __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8(static_cast<char>(value & 0xFF)),
+                                                 _mm_set1_epi8(static_cast<char>(value >> 8)));
+            return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, masks), masks), one);
+        };
+        __m128i in[4], out[4];
+        for (int ph = 0; ph < 4; ph++) {
+            in[ph] = expand(window[ph]);
+            out[ph] = expand(lastWindow[ph]);
+        }
+
+        // a = sums[2] - sums[0], b = sums[3] - sums[1]
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDelta),
+                         _mm_sub_epi8(_mm_add_epi8(in[2], out[0]), _mm_add_epi8(out[2], in[0])));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(bDelta),
+                         _mm_sub_epi8(_mm_add_epi8(in[3], out[1]), _mm_add_epi8(out[3], in[1])));
+#else
+        for (int i = 0; i < 16; i++) {
+            int delta[4];
+            for (int ph = 0; ph < 4; ph++)
+                delta[ph] = ((window[ph] >> i) & 1) - ((lastWindow[ph] >> i) & 1);
+            aDelta[i] = static_cast<int8_t>(delta[2] - delta[0]);
+            bDelta[i] = static_cast<int8_t>(delta[3] - delta[1]);
+        }
+#endif
+
+        for (int ph = 0; ph < 4; ph++)
+            lastWindow[ph] = window[ph];
+    }
+
+    // Demodulate each sample in the block, using the bits produced by thresholdBlock
+    void demodulateBlock(int count) {
+        char *out = symbols.data();
+        for (int i = 0; i < count; i += 64) {
+            const int w = historyWords + (i / 64);
+
+            // XOR the samples with those samplesBetweenSymbols + (0..3) *
+            // phaseShift earlier, for 64 positions at once
+            uint64_t diff[4];
+            for (int ph = 0; ph < 4; ph++)
+                diff[ph] = bits[w] ^ delayedWord(w, samplesBetweenSymbols + (ph * phaseShift));
+
+            const int wordEnd = (count - i < 64) ? count - i : 64;
+            for (int pos = 0; pos < wordEnd; pos += 16) {
+                alignas(16) int8_t aDelta[16], bDelta[16];
+                windowDeltas(diff, pos, aDelta, bDelta);
+
+                // Update the differences, and look up the symbol for each position
+                const int windowEnd = (wordEnd - pos < 16) ? wordEnd - pos : 16;
+                for (int j = 0; j < windowEnd; j++) {
+                    winnerIndex += (aDelta[j] * winnerStride) + bDelta[j];
+                    out[i + pos + j] = winners[winnerIndex];
+                }
+            }
+        }
+    }
+};
@@ -35,7 +35,7 @@
 #endif
 
 #include "../logger.hpp"
-#include "OneBitADC.hpp"
+#include "BlockDemodulator.hpp"
 #include "Reclocker.hpp"
 
 
@@ -110,8 +110,6 @@ int main(int argc, char *argv[]) {
     std::ifstream inputFile;
     if (std::strcmp(posArgv[0], "-") != 0) {
         fprintf(stderr, "using input file: %s\n", posArgv[0]);
-        char fileBuffer[8196]; // 8K
-        inputFile.rdbuf()->pubsetbuf(fileBuffer, sizeof fileBuffer);
         inputFile.open(posArgv[0], std::ostream::binary);
         assert(inputFile.good());
         input = &inputFile;
@@ -137,9 +135,9 @@ int main(int argc, char *argv[]) {
 
     assert(input->good());
     // auto ac3_filter = AC3Filter(*input, sampleFrequency); // now done with sox
-    auto adc = OneBitADC(slidingAvgLength, *input); // 1,000 samples sliding average
     // auto resampler = Resampler(sampleFrequency, adc); // 40MHz  // now done with sox
-    auto demodulator = Demodulator(adc);
+    // equivalent to Demodulator(OneBitADC(slidingAvgLength, *input)), reading large blocks at a time
+    auto demodulator = BlockDemodulator(slidingAvgLength, *input); // 1,000 samples sliding average
     auto reclocker = Reclocker(demodulator);
 
     long qpskSymbols = 0;
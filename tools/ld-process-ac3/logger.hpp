@@ -31,6 +31,7 @@
 #include <iomanip>
 #include <chrono>
 #include <map>
+#include <mutex>
 #include <sstream>
 
 enum LogLevel {
@@ -58,8 +59,9 @@ public:
     static int GLOBAL_LOG_LEVEL;
     static std::ostream *LOG_STREAM;
     static const TimePoint GLOBAL_START;
+    static std::mutex LOG_MUTEX; // stops lines from different threads being interleaved
 
-    const std::string &logLabel;
+    const std::string logLabel;
 
     explicit Logger(const LogLevel &level, const std::string &label) : logLabel(label), logLevel(level) {}
 
@@ -70,9 +72,15 @@ public:
             Clock::now() - GLOBAL_START);
 
         // if (logLabel == "CRC1" || logLabel == "CRC2")
+        std::lock_guard<std::mutex> lock(LOG_MUTEX);
         *LOG_STREAM << "[" << logLabel << "]\t" << duration.count() << "ms\t" << _buffer.str() << "\n";
     }
 
+    // Returns true if messages at this level will be printed
+    static bool isEnabled(const LogLevel &level) {
+        return level >= GLOBAL_LOG_LEVEL;
+    }
+
     template<typename T>
     Logger &operator<<(T const &value) {
         _buffer << value;
@@ -91,3 +99,5 @@ int Logger::GLOBAL_LOG_LEVEL = INFO;
 std::ostream *Logger::LOG_STREAM = &std::cerr; // todo; fix this warning (set as stderr in main.cpp?)
 
 const Logger::TimePoint Logger::GLOBAL_START = Logger::Clock::now();
+
+std::mutex Logger::LOG_MUTEX;
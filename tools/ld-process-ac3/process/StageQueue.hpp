@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * StageQueue.hpp
+ *
+ * ld-process-ac3 - AC3-RF decoder
+ * Copyright (C) 2026 ld-decode-tools contributors
+ *
+ * This file is part of ld-decode-tools.
+ *
+ * ld-process-ac3 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+
+// A queue between two pipeline stages running on different threads.
+// The producer waits while the queue is full, so a slow stage holds back the
+// ones before it rather than letting data pile up in memory.
+// The slots are allocated up front, so passing fixed-size items through the
+// queue doesn't allocate.
+template<class T>
+struct StageQueue {
+    explicit StageQueue(size_t capacity) : slots(capacity) {}
+
+    // Add an item, waiting while the queue is full.
+    // Returns false, dropping the item, if the queue has been aborted.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&] { return count < slots.size() || aborted; });
+        if (aborted)
+            return false;
+        slots[(head + count) % slots.size()] = std::move(item);
+        count++;
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Remove the oldest item, waiting while the queue is empty.
+    // Returns false if the queue has been closed and there are no items left,
+    // or if it has been aborted.
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&] { return count != 0 || closed; });
+        if (count == 0 || aborted)
+            return false;
+        item = std::move(slots[head]);
+        head = (head + 1) % slots.size();
+        count--;
+        notFull.notify_one();
+        return true;
+    }
+
+    // Called by the producer when it has reached the end of its input
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    // Called when a stage fails: wakes the stages on both sides, and makes
+    // every push and pop from now on fail, so they stop
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        aborted = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+    bool closed = false;
+    bool aborted = false;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+
+// Lets a stage pull items from a StageQueue with next(), in the same way as
+// from the previous stage in a single-threaded chain
+template<class T>
+struct QueueSource {
+    explicit QueueSource(StageQueue<T> &queue) : queue(queue) {}
+
+    StageQueue<T> &queue;
+
+    T next() {
+        T item;
+        if (!queue.pop(item))
+            throw std::range_error("EOF");
+        return item;
+    }
+};
+
+
+// Lets QPSKFramer read symbols from a StageQueue of chunks of symbols with
+// get(), in the same way as from the output of ld-ac3-demodulate.
+// Each chunk is handed back through freeQueue once it has been read, so the
+// producer can refill it rather than allocating a new one.
+struct SymbolQueueSource {
+    SymbolQueueSource(StageQueue<std::vector<char>> &queue, StageQueue<std::vector<char>> &freeQueue)
+        : queue(queue), freeQueue(freeQueue) {}
+
+    StageQueue<std::vector<char>> &queue;
+    StageQueue<std::vector<char>> &freeQueue;
+    std::vector<char> chunk;
+    bool haveChunk = false;
+    size_t chunkPos = 0;
+
+    int get() {
+        while (chunkPos == chunk.size()) {
+            if (haveChunk) {
+                chunk.clear();
+                freeQueue.push(std::move(chunk));
+                chunk.clear();
+                haveChunk = false;
+            }
+            chunkPos = 0;
+            if (!queue.pop(chunk))
+                return EOF;
+            haveChunk = true;
+        }
+        return chunk[chunkPos++];
+    }
+};
@@ -0,0 +1,297 @@
+/*******************************************************************************
+ * main.cpp
+ *
+ * ld-process-ac3 - AC3-RF decoder
+ * Copyright (C) 2026 ld-decode-tools contributors
+ *
+ * This file is part of ld-decode-tools.
+ *
+ * ld-process-ac3 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <cassert>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+#include "../logger.hpp"
+#include "BlockDemodulator.hpp"
+#include "Reclocker.hpp"
+#include "AC3Framer.hpp"
+#include "ac3_parsing.hpp" // mostly for debug & stats
+#include "StageQueue.hpp"
+
+
+// Number of QPSK symbols passed between threads at once
+static constexpr size_t symbolChunkSize = 1 << 16;
+
+// Number of items each queue can hold before the stage feeding it waits
+static constexpr size_t symbolQueueSize = 8;  // chunks of symbols
+static constexpr size_t blockQueueSize = 16;  // QPSK blocks
+static constexpr size_t dataQueueSize = 16;   // corrected blocks
+
+
+void doHelp(const std::string &app) {
+    std::cout << "Usage: " << app << " [options] source_file output_file [log_file]"
+              << "\n  If source_file is '-', stdin  is used."
+              << "\n  If output_file is '-', stdout is used."
+              << "\n  If log_file    is omitted, stderr is used."
+              << "\n"
+              << "\n  Does the same as ld-ac3-demodulate piped into ld-ac3-decode, in one process."
+              << "\n  source_file is expected to provide a stream of 46.08MHz 8-bit unsigned samples."
+              << "\n  output_file be overwritten / created with a stream of AC3 frames."
+              << "\n  log_file be overwritten / created with any logging or error messages."
+              << "\n  Options:"
+              << "\n    -v (int)    Set the logging level. Must be 0-3, representing DEBUG, INFO, WARN and ERR."
+              << "\n    -s (int)    Set the sliding average window's size."
+              << "\n    -h          Print this help."
+              << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    #ifdef _WIN32
+    _setmode(_fileno(stdout), O_BINARY);
+    _setmode(_fileno(stdin), O_BINARY);
+    #endif
+    int slidingAvgLength = 1e3;
+
+    while (true) {
+        switch (getopt(argc, argv, "v:s:h?")) {
+            case 'v':
+                Logger::GLOBAL_LOG_LEVEL = std::stoi(optarg);
+                assert(Logger::GLOBAL_LOG_LEVEL >= 0 && Logger::GLOBAL_LOG_LEVEL <= MAX_LOGLEVEL);
+                continue;
+            case 's': // sliding average window size
+                slidingAvgLength = std::stoi(optarg);
+                fprintf(stderr, "set sliding avg size: %s\n", optarg);
+                continue;
+            case '?':
+            case 'h':
+            default:
+                doHelp(argv[0]);
+                return -1;
+            case -1:
+                break;
+        }
+        break;
+    }
+    int posArgc = argc - optind; // number of positional args
+    char **posArgv = &argv[optind]; // array of positional args
+
+    if (posArgc < 2 || posArgc > 3) {
+        doHelp(argv[0]);
+        return -1;
+    }
+
+    std::istream *input = &std::cin;
+    std::ostream *output = &std::cout;
+    Logger::LOG_STREAM = &std::cerr;
+
+    // Don't force a .flush() on cout when reading from cin
+    std::cin.tie(nullptr);
+
+    // prep input file (if not piped)
+    std::ifstream inputFile;
+    if (std::strcmp(posArgv[0], "-") != 0) {
+        fprintf(stderr, "using input file: %s\n", posArgv[0]);
+        inputFile.open(posArgv[0], std::ifstream::binary);
+        assert(inputFile.good());
+        input = &inputFile;
+    }
+
+    // prep output file (if not piped)
+    std::ofstream outputFile;
+    if (std::strcmp(posArgv[1], "-") != 0) {
+        fprintf(stderr, "using output file: %s\n", posArgv[1]);
+        outputFile.open(posArgv[1], std::ofstream::binary);
+        assert(outputFile.good());
+        output = &outputFile;
+    }
+
+    // prep logger file (if not piped)
+    std::ofstream loggerFile;
+    if (posArgc > 2 && std::strcmp(posArgv[2], "-") != 0) {
+        fprintf(stderr, "using logger file: %s\n", posArgv[2]);
+        loggerFile.open(posArgv[2], std::ofstream::binary);
+        assert(loggerFile.good());
+        Logger::LOG_STREAM = &loggerFile;
+    }
+
+    // headers for error correction (helpful if filtering log output)
+    Logger(INFO, "C1") << "erasures\tok\tone-error\ttwo-error";
+    Logger(INFO, "C2") << "erasures\tok\tone-error\ttwo-error\tthree-error\tfour-error";
+
+    // Each stage runs on its own thread, pulling from the queue filled by the
+    // previous one, so demodulation, framing and error correction overlap:
+    //   demodulate -> symbolQueue -> frame -> blockQueue -> correct -> dataQueue -> AC3 framing (this thread)
+    StageQueue<std::vector<char>> symbolQueue(symbolQueueSize);
+    StageQueue<QPSKBlock> blockQueue(blockQueueSize);
+    StageQueue<CorrectedBlock> dataQueue(dataQueueSize);
+
+    // Symbol chunks go round in a loop, so they're only allocated once: one
+    // for each slot in symbolQueue, plus the ones being filled and read
+    StageQueue<std::vector<char>> freeChunks(symbolQueueSize + 2);
+    for (size_t i = 0; i < symbolQueueSize + 2; i++) {
+        std::vector<char> chunk;
+        chunk.reserve(symbolChunkSize);
+        freeChunks.push(std::move(chunk));
+    }
+
+    // If any stage fails, remember the first error and abort every queue, so
+    // the other stages wake up and stop rather than waiting forever
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto fail = [&](std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure)
+                failure = error;
+        }
+        symbolQueue.abort();
+        freeChunks.abort();
+        blockQueue.abort();
+        dataQueue.abort();
+    };
+
+    auto demodulator = BlockDemodulator(slidingAvgLength, *input); // 1,000 samples sliding average
+    auto reclocker = Reclocker(demodulator);
+
+    auto symbolSource = SymbolQueueSource(symbolQueue, freeChunks);
+    auto framer = QPSKFramer(symbolSource);
+    auto blocker = Blocker(framer);
+
+    auto blockSource = QueueSource(blockQueue);
+    auto corrector = Corrector(blockSource);
+
+    auto dataSource = QueueSource(dataQueue);
+    auto _buffer = StreamBuffer(dataSource);
+    auto ac3Framer = AC3Framer(_buffer);
+
+    long qpskSymbols = 0;
+    std::thread demodulateThread([&] {
+        std::vector<char> chunk;
+        try {
+            // Stop early if the queues have been aborted
+            bool running = freeChunks.pop(chunk);
+            while (running) {
+                // the same text symbols ld-ac3-demodulate writes
+                chunk.push_back(char(48 + reclocker.next()));
+                if (chunk.size() == symbolChunkSize) {
+                    qpskSymbols += chunk.size();
+                    running = symbolQueue.push(std::move(chunk)) && freeChunks.pop(chunk);
+                }
+            }
+        } catch (std::range_error &e) { // catch EOF
+            qpskSymbols += chunk.size();
+            if (!chunk.empty())
+                symbolQueue.push(std::move(chunk));
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        symbolQueue.close();
+    });
+
+    std::thread frameThread([&] {
+        try {
+            while (blockQueue.push(blocker.next())) {}
+        } catch (std::range_error &e) { // catch EOF
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        blockQueue.close();
+    });
+
+    std::thread correctThread([&] {
+        try {
+            while (dataQueue.push(corrector.next())) {}
+        } catch (std::range_error &e) { // catch EOF
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        dataQueue.close();
+    });
+
+    long ac3_frames = 0;
+    try {
+        while (true) {
+            auto frame = ac3Framer.next();
+
+            try {
+                // partial decode of AC3 frame
+                auto sf = SyncFrame(frame);
+                auto crc_status = sf.check_crc();
+
+                if (!(crc_status & 1))
+                    Logger(INFO, "CRC1") << "frame " << ac3_frames;
+                if (!(crc_status >> 1)) // note; data covered by crc2 is useless without crc1
+                    Logger(INFO, "CRC2") << "frame " << ac3_frames;
+            } catch (InvalidFrameError &e) {
+                // Frame data is not valid enough to check the CRCs
+                Logger(INFO, "SyncFrame") << "frame " << ac3_frames;
+            }
+
+            for (auto &b: frame)
+                *output << b;
+            ac3_frames++;
+        }
+    } catch (std::range_error &e) { // catch EOF
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    // The AC3 framer only reaches EOF once every earlier stage has finished,
+    // or once the queues have been aborted after an error
+    demodulateThread.join();
+    frameThread.join();
+    correctThread.join();
+
+    if (failure) {
+        try {
+            std::rethrow_exception(failure);
+        } catch (std::exception &e) {
+            Logger(ERRR, "Error") << e.what();
+        } catch (...) {
+            Logger(ERRR, "Error") << "unknown exception";
+        }
+        return -1;
+    }
+
+    // print final / overall stats
+    Logger(INFO, "QPSK Symbols Total") << qpskSymbols;
+    Logger(INFO, "RS Totals")
+        << corrector.totalStats(-1) << "\t"
+        << corrector.totalStats(+0) << "\t"
+        << corrector.totalStats(+1) << "\t"
+        << corrector.totalStats(+2) << "\t"
+        << corrector.totalStats(+3) << "\t"
+        << corrector.totalStats(+4);
+    Logger(INFO, "QPSK Frame Total") << framer.n_frames;
+    Logger(INFO, "AC3 Frame Total") << ac3_frames;
+
+    // cleanup files nicely
+    if (inputFile.is_open())
+        inputFile.close();
+    if (outputFile.is_open())
+        outputFile.close();
+    if (loggerFile.is_open())
+        loggerFile.close();
+    return 0;
+}
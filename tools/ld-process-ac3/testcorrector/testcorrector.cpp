@@ -0,0 +1,204 @@
+/*******************************************************************************
+ * testcorrector.cpp
+ *
+ * ld-process-ac3 - AC3-RF decoder
+ * Copyright (C) 2026 ld-decode-tools contributors
+ *
+ * This file is part of ld-decode-tools.
+ *
+ * ld-process-ac3 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using std::cerr;
+
+#include "../logger.hpp"
+#include "Corrector.hpp"
+
+// A QPSK block, and the data it should decode to
+struct TestBlock {
+    QPSKBlock block;
+    std::vector<uint8_t> data;
+};
+
+// Supplies a list of blocks to Corrector
+struct BlockSource {
+    explicit BlockSource(const std::vector<TestBlock> &blocks) : blocks(blocks) {}
+
+    const std::vector<TestBlock> &blocks;
+    size_t pos = 0;
+
+    QPSKBlock next() {
+        if (pos == blocks.size())
+            throw std::range_error("EOF");
+        return blocks[pos++].block;
+    }
+};
+
+// Encode random data into a block: 66 columns of RS(36,32), then 36 rows of
+// two interleaved RS(37,33) codewords
+static TestBlock makeBlock(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    AC3RS<255, 255 - (36 - 32)> c2;
+    AC3RS<255, 255 - (37 - 33)> c1;
+
+    TestBlock test;
+    for (int k = 0; k < 66; k++) {
+        std::vector<uint8_t> column(32);
+        for (int i = 0; i < 32; i++)
+            column[i] = static_cast<uint8_t>(byte(rng));
+        if (k == 0) {
+            column[0] = 0x10;
+            column[1] = 0x00;
+        }
+        test.data.insert(test.data.end(), column.begin() + (k == 0 ? 2 : 0), column.end());
+
+        c2.encode(column);
+        for (int i = 0; i < 36; i++)
+            test.block.bytes[k + i * 74] = column[i];
+    }
+    for (int rowI = 0; rowI < 36; rowI++) {
+        for (int odd = 0; odd < 2; odd++) {
+            std::vector<uint8_t> row(33);
+            for (int i = 0; i < 33; i++)
+                row[i] = test.block.bytes[rowI * 74 + i * 2 + odd];
+            c1.encode(row);
+            for (int i = 33; i < 37; i++)
+                test.block.bytes[rowI * 74 + i * 2 + odd] = row[i];
+        }
+    }
+    return test;
+}
+
+// Run blocks through Corrector. If correctable is true, check the output is
+// the expected data.
+static std::vector<uint8_t> runCorrector(const std::vector<TestBlock> &blocks, bool checkSyndromesFirst,
+                                         bool correctable, long totals[6])
+{
+    BlockSource source(blocks);
+    Corrector<BlockSource> corrector(source);
+    corrector.checkSyndromesFirst = checkSyndromesFirst;
+
+    std::vector<uint8_t> output;
+    try {
+        for (size_t i = 0; ; i++) {
+            const CorrectedBlock &corrected = corrector.next();
+            if (correctable && (corrected.size() != blocks[i].data.size()
+                                || std::memcmp(corrected.data(), blocks[i].data.data(), corrected.size()) != 0)) {
+                cerr << "Block " << i << " was not corrected\n";
+                exit(1);
+            }
+            output.insert(output.end(), corrected.data(), corrected.data() + corrected.size());
+        }
+    } catch (std::range_error &e) {}
+
+    for (int r = -1; r <= 4; r++)
+        totals[r + 1] = corrector.totalStats(r);
+    return output;
+}
+
+// Check correction with both decoding paths, which should give identical results
+static void testCorrect(const char *name, const std::vector<TestBlock> &blocks, bool correctable)
+{
+    cerr << "Testing " << name << "\n";
+
+    long fastTotals[6], plainTotals[6];
+    const std::vector<uint8_t> fast = runCorrector(blocks, true, correctable, fastTotals);
+    const std::vector<uint8_t> plain = runCorrector(blocks, false, correctable, plainTotals);
+
+    if (fast != plain || std::memcmp(fastTotals, plainTotals, sizeof fastTotals) != 0) {
+        cerr << "Checking syndromes first changed the results\n";
+        exit(1);
+    }
+}
+
+static std::vector<TestBlock> makeBlocks(int count)
+{
+    std::mt19937 rng(42);
+    std::vector<TestBlock> blocks;
+    for (int i = 0; i < count; i++)
+        blocks.push_back(makeBlock(rng));
+    return blocks;
+}
+
+// Time Corrector on clean blocks, with and without the syndrome check
+static void benchmark()
+{
+    const std::vector<TestBlock> blocks = makeBlocks(2000);
+
+    for (int checkSyndromesFirst = 0; checkSyndromesFirst < 2; checkSyndromesFirst++) {
+        long totals[6];
+        const auto start = std::chrono::steady_clock::now();
+        runCorrector(blocks, checkSyndromesFirst, true, totals);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        cerr << (checkSyndromesFirst ? "With" : "Without") << " syndrome check: "
+             << (blocks.size() / elapsed.count()) << " blocks/s\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Don't print the per-block stats
+    Logger::GLOBAL_LOG_LEVEL = WARN;
+
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> row(0, 35);
+    std::uniform_int_distribution<int> position(0, 72 * 37 - 1);
+
+    const std::vector<TestBlock> clean = makeBlocks(20);
+    testCorrect("clean blocks", clean, true);
+
+    // A few scattered errors, which C1 can correct
+    std::vector<TestBlock> scattered = clean;
+    for (auto &test: scattered)
+        for (int i = 0; i < 20; i++)
+            test.block.bytes[position(rng)] ^= static_cast<uint8_t>(1 + byte(rng) % 255);
+    testCorrect("scattered errors", scattered, true);
+
+    // Two rows too damaged for C1, which C2 can correct as erasures (even if
+    // C1 miscorrects one of them)
+    std::vector<TestBlock> damagedRows = clean;
+    for (auto &test: damagedRows) {
+        const int first = row(rng);
+        for (int i = 0; i < 2; i++) {
+            const int r = (first + (i * 17)) % 36;
+            for (int j = 0; j < 74; j++)
+                test.block.bytes[r * 74 + j] ^= static_cast<uint8_t>(1 + byte(rng) % 255);
+        }
+    }
+    testCorrect("damaged rows", damagedRows, true);
+
+    // Random data, which mostly can't be corrected
+    std::vector<TestBlock> noise = clean;
+    for (auto &test: noise)
+        for (auto &b: test.block.bytes)
+            b = static_cast<uint8_t>(byte(rng));
+    testCorrect("noise", noise, false);
+
+    return 0;
+}
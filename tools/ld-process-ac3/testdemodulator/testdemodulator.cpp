@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * testdemodulator.cpp
+ *
+ * ld-process-ac3 - AC3-RF decoder
+ * Copyright (C) 2026 ld-decode-tools contributors
+ *
+ * This file is part of ld-decode-tools.
+ *
+ * ld-process-ac3 is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::cerr;
+
+#include "BlockDemodulator.hpp"
+#include "OneBitADC.hpp"
+#include "Reclocker.hpp"
+
+// Generate a QPSK-like test signal: a carrier at a quarter of the symbol
+// rate, with its phase changing at roughly the symbol rate, plus noise and a
+// slowly-varying DC offset for the rolling average to follow
+static std::string makeSignal(long numSamples)
+{
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 12.0);
+    std::uniform_int_distribution<int> symbol(0, 3);
+
+    std::string signal(numSamples, '\0');
+    double phase = 0.0;
+    long nextSymbol = 0;
+    for (long i = 0; i < numSamples; i++) {
+        if (i >= nextSymbol) {
+            phase = symbol(rng) * M_PI / 2.0;
+            nextSymbol = static_cast<long>(((i / 160) + 1) * 160 * 1.0001);
+        }
+        double value = 128.0 + (60.0 * sin((2.0 * M_PI * i / 16.0) + phase))
+                       + (20.0 * sin(2.0 * M_PI * i / 50000.0)) + noise(rng);
+        if (value < 0.0) value = 0.0;
+        if (value > 255.0) value = 255.0;
+        signal[i] = static_cast<char>(static_cast<uint8_t>(value));
+    }
+    return signal;
+}
+
+// Read symbols from a demodulator until the end of the input
+template <typename Source>
+static std::vector<uint8_t> readAll(Source &source)
+{
+    std::vector<uint8_t> symbols;
+    try {
+        while (true) {
+            symbols.push_back(source.next());
+        }
+    } catch (std::range_error &e) {}
+    return symbols;
+}
+
+// Demodulate the signal with OneBitADC and Demodulator
+static std::vector<uint8_t> referenceSymbols(const std::string &signal, int avgLength)
+{
+    std::istringstream input(signal);
+    auto adc = OneBitADC(avgLength, input);
+    auto demodulator = Demodulator(adc);
+    return readAll(demodulator);
+}
+
+// Demodulate the signal with BlockDemodulator
+static std::vector<uint8_t> blockSymbols(const std::string &signal, int avgLength, int blockSize)
+{
+    std::istringstream input(signal);
+    BlockDemodulator demodulator(avgLength, input, blockSize);
+    std::vector<uint8_t> symbols;
+    try {
+        while (true) {
+            symbols.push_back(static_cast<uint8_t>(demodulator.next()));
+        }
+    } catch (std::range_error &e) {}
+    return symbols;
+}
+
+// Check BlockDemodulator gives the same symbols as the reference, with
+// different rolling average lengths and block sizes (including blocks
+// smaller than Demodulator's preload)
+static void testDemodulate(const std::string &signal, int avgLength, int blockSize)
+{
+    cerr << "Testing avgLength " << avgLength << " blockSize " << blockSize << "\n";
+
+    const std::vector<uint8_t> expected = referenceSymbols(signal, avgLength);
+    const std::vector<uint8_t> actual = blockSymbols(signal, avgLength, blockSize);
+
+    if (actual.size() != expected.size()) {
+        cerr << "Got " << actual.size() << " symbols, expected " << expected.size() << "\n";
+        exit(1);
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (actual[i] != expected[i]) {
+            cerr << "Symbol " << i << " is " << int(actual[i]) << ", expected " << int(expected[i]) << "\n";
+            exit(1);
+        }
+    }
+}
+
+// Check the reclocked output is the same too
+static void testReclock(const std::string &signal)
+{
+    cerr << "Testing reclocked output\n";
+
+    std::istringstream referenceInput(signal);
+    auto adc = OneBitADC(1000, referenceInput);
+    auto referenceDemodulator = Demodulator(adc);
+    auto referenceReclocker = Reclocker(referenceDemodulator);
+    const std::vector<uint8_t> expected = readAll(referenceReclocker);
+
+    std::istringstream blockInput(signal);
+    auto blockDemodulator = BlockDemodulator(1000, blockInput);
+    auto blockReclocker = Reclocker(blockDemodulator);
+    const std::vector<uint8_t> actual = readAll(blockReclocker);
+
+    if (expected.empty() || actual != expected) {
+        cerr << "Reclocked output differs\n";
+        exit(1);
+    }
+}
+
+// Time both demodulators on one second of input
+static void benchmark()
+{
+    const std::string signal = makeSignal(46080000);
+
+    for (int useBlock = 0; useBlock < 2; useBlock++) {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t count = useBlock ? blockSymbols(signal, 1000, BlockDemodulator::defaultBlockSize).size()
+                                      : referenceSymbols(signal, 1000).size();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        cerr << (useBlock ? "BlockDemodulator: " : "OneBitADC + Demodulator: ")
+             << (count / elapsed.count() / 1e6) << " Msamples/s\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    const std::string signal = makeSignal(200000);
+    for (int avgLength : {1, 37, 1000, 40000}) {
+        for (int blockSize : {64, 320, 4096, BlockDemodulator::defaultBlockSize}) {
+            testDemodulate(signal, avgLength, blockSize);
+        }
+    }
+    testReclock(signal);
+
+    return 0;
+}
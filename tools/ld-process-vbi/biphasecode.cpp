@@ -27,8 +27,8 @@
 
 // Decode the three biphase code lines, writing the result into fieldMetadata.
 // Return true if any line was decoded successfully, false if none were.
-bool BiphaseCode::decodeLines(const SourceVideo::Data& line16Data, const SourceVideo::Data& line17Data,
-                              const SourceVideo::Data& line18Data,
+bool BiphaseCode::decodeLines(SourceVideo::DataView line16Data, SourceVideo::DataView line17Data,
+                              SourceVideo::DataView line18Data,
                               const LdDecodeMetaData::VideoParameters& videoParameters,
                               LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -49,7 +49,7 @@ bool BiphaseCode::decodeLines(const SourceVideo::Data& line16Data, const SourceV
 
 // Decode one of the three biphase code lines, writing the result into fieldMetadata.
 // Return true if decoding was successful, false otherwise.
-bool BiphaseCode::decodeLine(qint32 lineIndex, const SourceVideo::Data& lineData,
+bool BiphaseCode::decodeLine(qint32 lineIndex, SourceVideo::DataView lineData,
                                 const LdDecodeMetaData::VideoParameters& videoParameters,
                                 LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -62,11 +62,11 @@ bool BiphaseCode::decodeLine(qint32 lineIndex, const SourceVideo::Data& lineData
 }
 
 // Private method to read a 24-bit biphase coded signal (manchester code) from a field line
-qint32 BiphaseCode::manchesterDecoder(const SourceVideo::Data &lineData, qint32 zcPoint,
+qint32 BiphaseCode::manchesterDecoder(SourceVideo::DataView lineData, qint32 zcPoint,
                                          LdDecodeMetaData::VideoParameters videoParameters)
 {
     qint32 result = 0;
-    QVector<bool> manchesterData = getTransitionMap(lineData, zcPoint);
+    transitionMap.build(lineData, zcPoint);
 
     // Get the number of samples for 1.5us
     double fJumpSamples = (videoParameters.sampleRate / 1000000) * 1.5;
@@ -76,35 +76,29 @@ qint32 BiphaseCode::manchesterDecoder(const SourceVideo::Data &lineData, qint32
     qint32 decodeCount = 0;
 
     // Find the first transition
-    qint32 x = videoParameters.activeVideoStart;
-    while (x < manchesterData.size() && manchesterData[x] == false) {
-        x++;
-    }
+    qint32 x = transitionMap.findNext(videoParameters.activeVideoStart, true);
 
-    if (x < manchesterData.size()) {
+    if (x < transitionMap.size()) {
         // Plot the first transition (which is always 01)
         result++;
         decodeCount++;
 
         // Find the rest of the transitions based on the expected clock rate of 2us per cell window
-        while (x < manchesterData.size()) {
+        while (x < transitionMap.size()) {
             x += jumpSamples;
 
             // Ensure we don't go out of bounds
-            if (x >= manchesterData.size()) break;
+            if (x >= transitionMap.size()) break;
 
-            bool startState = manchesterData[x];
-            while (x < manchesterData.size() && manchesterData[x] == startState)
-            {
-                x++;
-            }
+            bool startState = transitionMap[x];
+            x = transitionMap.findNext(x, !startState);
 
-            if (x < manchesterData.size()) {
-                if (manchesterData[x - 1] == false && manchesterData[x] == true) {
+            if (x < transitionMap.size()) {
+                if (transitionMap[x - 1] == false && transitionMap[x] == true) {
                     // 01 transition
                     result = (result << 1) + 1;
                 }
-                if (manchesterData[x - 1] == true && manchesterData[x] == false) {
+                if (transitionMap[x - 1] == true && transitionMap[x] == false) {
                     // 10 transition
                     result = result << 1;
                 }
@@ -27,6 +27,7 @@
 
 #include "lddecodemetadata.h"
 #include "sourcevideo.h"
+#include "vbiutilities.h"
 
 #include <QVector>
 
@@ -34,17 +35,19 @@
 // Specified in IEC 60586-1986 section 10.1 (PAL) and IEC 60587-1986 section 10.1 (NTSC).
 class BiphaseCode {
 public:
-    bool decodeLines(const SourceVideo::Data& line16Data, const SourceVideo::Data& line17Data,
-                     const SourceVideo::Data& line18Data,
+    bool decodeLines(SourceVideo::DataView line16Data, SourceVideo::DataView line17Data,
+                     SourceVideo::DataView line18Data,
                      const LdDecodeMetaData::VideoParameters& videoParameters,
                      LdDecodeMetaData::Field& fieldMetadata);
-    bool decodeLine(qint32 lineIndex, const SourceVideo::Data& lineData,
+    bool decodeLine(qint32 lineIndex, SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
 
 private:
-    qint32 manchesterDecoder(const SourceVideo::Data& lineData, qint32 zcPoint,
+    qint32 manchesterDecoder(SourceVideo::DataView lineData, qint32 zcPoint,
                              LdDecodeMetaData::VideoParameters videoParameters);
+
+    TransitionMap transitionMap;
 };
 
 #endif // BIPHASECODE_H
@@ -40,7 +40,7 @@
 
 // Public method to read CEA-608 Closed Captioning data.
 // Return true if CC data was decoded successfully, false otherwise.
-bool ClosedCaption::decodeLine(const SourceVideo::Data& lineData,
+bool ClosedCaption::decodeLine(SourceVideo::DataView lineData,
                                const LdDecodeMetaData::VideoParameters& videoParameters,
                                LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -53,7 +53,7 @@ bool ClosedCaption::decodeLine(const SourceVideo::Data& lineData,
     qint32 zcPoint = ((videoParameters.white16bIre - videoParameters.black16bIre) / 4) + videoParameters.black16bIre;
 
     // Get the transition map for the line
-    QVector<bool> transitionMap = getTransitionMap(lineData, zcPoint);
+    transitionMap.build(lineData, zcPoint);
 
     // Bit clock is 32 x fH [CTA p14, note 1]
     double samplesPerBit = static_cast<double>(videoParameters.fieldWidth) / 32.0;
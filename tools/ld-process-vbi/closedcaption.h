@@ -27,13 +27,17 @@
 
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "vbiutilities.h"
 
 class ClosedCaption
 {
 public:
-    bool decodeLine(const SourceVideo::Data& lineData,
+    bool decodeLine(SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
+
+private:
+    TransitionMap transitionMap;
 };
 
 #endif // CLOSEDCAPTION_H
@@ -23,11 +23,17 @@
 ************************************************************************/
 
 #include "decoderpool.h"
+#include "vitsmeasurement.h"
+
+#include <QFile>
+#include <QTextStream>
 
 DecoderPool::DecoderPool(QString _inputFilename, QString _outputJsonFilename,
-                         qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData)
+                         qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData,
+                         bool _measureVits, QString _dropoutStatsFilename, bool _resume)
     : inputFilename(_inputFilename), outputJsonFilename(_outputJsonFilename),
-      maxThreads(_maxThreads), ldDecodeMetaData(_ldDecodeMetaData)
+      maxThreads(_maxThreads), measureVits(_measureVits), dropoutStatsFilename(_dropoutStatsFilename),
+      resume(_resume), ldDecodeMetaData(_ldDecodeMetaData)
 {
 }
 
@@ -55,10 +61,52 @@ bool DecoderPool::process()
     // Show some information for the user
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData.getNumberOfFields() << "fields";
 
+    // Work out which field lines are needed. The VBI decoders need a single
+    // range of lines; if VITS measurement is enabled, add any other lines it
+    // needs, so both can be done from a single read of each field.
+    lineRanges = {{VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine}};
+    if (measureVits) {
+        qInfo() << "VITS metrics will be measured in the same pass";
+        for (const SourceVideo::LineRange &range : VitsMeasurement::getLineRanges(videoParameters.system)) {
+            if (range.startFieldLine < VbiLineDecoder::startFieldLine || range.endFieldLine > VbiLineDecoder::endFieldLine) {
+                lineRanges.push_back(range);
+            }
+        }
+    }
+
+    // Periodically save a checkpoint when the metadata updates are being
+    // journalled, so an interrupted run can be resumed
+    useCheckpoints = ldDecodeMetaData.isJournalOpen();
+    checkpointFileName = Checkpoint::getCheckpointFileName(outputJsonFilename);
+    qint32 firstFieldNumber = 1;
+    if (resume && QFile::exists(checkpointFileName)) {
+        Checkpoint checkpoint;
+        if (!checkpoint.read(checkpointFileName)) {
+            sourceVideo.close();
+            return false;
+        }
+        if (checkpoint.job != getCheckpointJob()) {
+            qCritical() << "Checkpoint" << checkpointFileName << "is for a different job - cannot resume";
+            sourceVideo.close();
+            return false;
+        }
+        firstFieldNumber = checkpoint.nextNumber;
+        qInfo() << "Resuming from field" << firstFieldNumber;
+    } else if (resume) {
+        qInfo() << "No checkpoint found, starting from the beginning";
+    }
+
     // Initialise processing state
-    inputFieldNumber = 1;
+    inputFieldNumber = firstFieldNumber;
+    outputFieldNumber = firstFieldNumber;
+    pendingOutputFields.clear();
     lastFieldNumber = ldDecodeMetaData.getNumberOfFields();
+    if (getCollectDropoutStats()) {
+        fieldDropoutStats.clear();
+        fieldDropoutStats.resize(lastFieldNumber);
+    }
     totalTimer.start();
+    checkpointTimer.start();
 
     // Start a vector of decoding threads to process the video
     QVector<QThread *> threads;
@@ -85,14 +133,31 @@ bool DecoderPool::process()
     qInfo() << "VBI Processing complete -" << lastFieldNumber << "fields in" << totalSecs << "seconds (" <<
                lastFieldNumber / totalSecs << "FPS )";
 
-    // Write the JSON metadata file
-    qInfo() << "Writing JSON metadata file...";
-    ldDecodeMetaData.write(outputJsonFilename);
+    // Write the JSON metadata file, or just finish the journal if one is in use
+    if (ldDecodeMetaData.isJournalOpen()) {
+        qInfo() << "Writing metadata journal...";
+        if (!ldDecodeMetaData.closeJournal()) {
+            sourceVideo.close();
+            return false;
+        }
+    } else {
+        qInfo() << "Writing JSON metadata file...";
+        ldDecodeMetaData.write(outputJsonFilename);
+    }
     qInfo() << "VBI processing complete";
 
     // Close the source video
     sourceVideo.close();
 
+    // The metadata is complete, so the checkpoint is no longer needed
+    if (useCheckpoints && !Checkpoint::remove(checkpointFileName)) return false;
+
+    // Write the dropout statistics
+    if (getCollectDropoutStats() && !writeDropoutStats()) {
+        qCritical() << "Unable to write dropout statistics file";
+        return false;
+    }
+
     return true;
 }
 
@@ -117,7 +182,7 @@ bool DecoderPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVid
     qDebug() << "DecoderPool::process(): Processing field number" << fieldNumber;
 
     // Fetch the input data
-    fieldVideoData = sourceVideo.getVideoField(fieldNumber, VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine);
+    fieldVideoData = sourceVideo.getVideoFieldRanges(fieldNumber, 1, lineRanges);
     fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
     videoParameters = ldDecodeMetaData.getVideoParameters();
 
@@ -127,7 +192,8 @@ bool DecoderPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVid
 // Put a decoded frame into the output stream.
 //
 // Returns true on success, false on failure.
-bool DecoderPool::setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Field& fieldMetadata)
+bool DecoderPool::setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Field& fieldMetadata,
+                                 const DropoutStats &dropoutStats)
 {
     QMutexLocker locker(&outputMutex);
 
@@ -136,6 +202,99 @@ bool DecoderPool::setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Fie
     ldDecodeMetaData.updateFieldNtsc(fieldMetadata.ntsc, fieldNumber);
     ldDecodeMetaData.updateFieldVitc(fieldMetadata.vitc, fieldNumber);
     ldDecodeMetaData.updateFieldClosedCaption(fieldMetadata.closedCaption, fieldNumber);
+    if (measureVits) ldDecodeMetaData.updateFieldVitsMetrics(fieldMetadata.vitsMetrics, fieldNumber);
+
+    if (getCollectDropoutStats()) fieldDropoutStats[fieldNumber - 1] = dropoutStats;
+
+    // Advance past the fields that have all been completed
+    pendingOutputFields.insert(fieldNumber);
+    while (pendingOutputFields.remove(outputFieldNumber)) outputFieldNumber++;
+
+    // Save a checkpoint if it's time for another one
+    if (useCheckpoints && checkpointTimer.hasExpired(Checkpoint::INTERVAL)) {
+        if (!writeCheckpoint()) return false;
+    }
+
+    return true;
+}
+
+// Return a description of the job, to check a checkpoint belongs to it
+QString DecoderPool::getCheckpointJob() const
+{
+    return QString("ld-process-vbi %1 fields %2 vits %3").arg(inputFilename).arg(ldDecodeMetaData.getNumberOfFields()).arg(static_cast<int>(measureVits));
+}
+
+// Save a checkpoint of the fields that have been completed so far. You must
+// hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool DecoderPool::writeCheckpoint()
+{
+    if (!ldDecodeMetaData.flushJournal()) return false;
+
+    Checkpoint checkpoint;
+    checkpoint.job = getCheckpointJob();
+    checkpoint.nextNumber = outputFieldNumber;
+    if (!checkpoint.write(checkpointFileName)) return false;
+
+    checkpointTimer.restart();
+    return true;
+}
+
+// Get the field lines that are read from the input for each field (as passed
+// to SourceVideo::getVideoFieldRanges)
+const std::vector<SourceVideo::LineRange> &DecoderPool::getLineRanges() const
+{
+    return lineRanges;
+}
+
+// Return true if VITS metrics should be measured
+bool DecoderPool::getMeasureVits() const
+{
+    return measureVits;
+}
+
+// Return true if per-frame dropout statistics should be collected
+bool DecoderPool::getCollectDropoutStats() const
+{
+    return !dropoutStatsFilename.isEmpty();
+}
+
+// Write the per-frame dropout statistics as a CSV file.
+//
+// Returns true on success, false on failure.
+bool DecoderPool::writeDropoutStats()
+{
+    qInfo().nospace().noquote() << "Writing dropout statistics to " << dropoutStatsFilename;
+
+    QFile csvFile(dropoutStatsFilename);
+    if (!csvFile.open(QFile::WriteOnly | QFile::Text)) {
+        qDebug() << "DecoderPool::writeDropoutStats(): Could not open CSV file for output!";
+        return false;
+    }
+
+    QTextStream outStream(&csvFile);
+    outStream << "frameNo,dropouts,dropoutLength,dropoutLines\n";
+
+    for (qint32 frameNumber = 1; frameNumber <= ldDecodeMetaData.getNumberOfFrames(); frameNumber++) {
+        qint32 firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(frameNumber);
+        qint32 secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(frameNumber);
+
+        // Sum the statistics for the two fields of the frame
+        DropoutStats frameStats;
+        for (qint32 fieldNumber : {firstFieldNumber, secondFieldNumber}) {
+            if (fieldNumber < 1 || fieldNumber > fieldDropoutStats.size()) continue;
+            const DropoutStats &fieldStats = fieldDropoutStats[fieldNumber - 1];
+            frameStats.dropouts += fieldStats.dropouts;
+            frameStats.dropoutLength += fieldStats.dropoutLength;
+            frameStats.dropoutLines += fieldStats.dropoutLines;
+        }
+
+        outStream << frameNumber << "," << frameStats.dropouts << ","
+                  << frameStats.dropoutLength << "," << frameStats.dropoutLines << "\n";
+    }
+
+    csvFile.close();
 
     return true;
 }
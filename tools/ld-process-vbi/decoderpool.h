@@ -28,8 +28,12 @@
 #include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QMutex>
+#include <QSet>
 #include <QThread>
 
+#include <vector>
+
+#include "checkpoint.h"
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
 #include "vbilinedecoder.h"
@@ -39,19 +43,37 @@ class DecoderPool
 public:
     // Public methods
     explicit DecoderPool(QString _inputFilename, QString _outputJsonFilename,
-                        qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData);
+                        qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData,
+                        bool _measureVits = false, QString _dropoutStatsFilename = QString(),
+                        bool _resume = false);
     bool process();
 
+    // Summary of the dropouts in a field
+    struct DropoutStats {
+        qint32 dropouts = 0;
+        qint32 dropoutLength = 0;
+        qint32 dropoutLines = 0;
+    };
+
     // Member functions used by worker threads
     bool getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVideoData, LdDecodeMetaData::Field &fieldMetadata, LdDecodeMetaData::VideoParameters &videoParameters);
-    bool setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Field& fieldMetadata);
+    bool setOutputField(qint32 fieldNumber, const LdDecodeMetaData::Field& fieldMetadata, const DropoutStats &dropoutStats);
+    const std::vector<SourceVideo::LineRange> &getLineRanges() const;
+    bool getMeasureVits() const;
+    bool getCollectDropoutStats() const;
 
 private:
     QString inputFilename;
     QString outputJsonFilename;
     qint32 maxThreads;
+    bool measureVits;
+    QString dropoutStatsFilename;
+    bool resume;
     QElapsedTimer totalTimer;
 
+    // The field lines read from the input file for each field
+    std::vector<SourceVideo::LineRange> lineRanges;
+
     // Atomic abort flag shared by worker threads; workers watch this, and shut
     // down as soon as possible if it becomes true
     QAtomicInt abort;
@@ -66,6 +88,18 @@ private:
     // Output stream information (all guarded by outputMutex while threads are running)
     QMutex outputMutex;
     QFile targetJson;
+    QVector<DropoutStats> fieldDropoutStats;
+    qint32 outputFieldNumber;
+    QSet<qint32> pendingOutputFields;
+
+    // Checkpoint information (guarded by outputMutex while threads are running)
+    bool useCheckpoints;
+    QString checkpointFileName;
+    QElapsedTimer checkpointTimer;
+
+    bool writeDropoutStats();
+    QString getCheckpointJob() const;
+    bool writeCheckpoint();
 };
 
 #endif // DECODERPOOL_H
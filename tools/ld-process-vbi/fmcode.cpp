@@ -27,7 +27,7 @@
 
 // Public method to read a 40-bit FM coded signal from a field line.
 // Return true if decoding was successful, false otherwise.
-bool FmCode::decodeLine(const SourceVideo::Data &lineData,
+bool FmCode::decodeLine(SourceVideo::DataView lineData,
                         const LdDecodeMetaData::VideoParameters& videoParameters,
                         LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -48,7 +48,7 @@ bool FmCode::decodeLine(const SourceVideo::Data &lineData,
     // Determine the 16-bit zero-crossing point
     qint32 zcPoint = (videoParameters.white16bIre + videoParameters.black16bIre) / 2;
 
-    QVector<bool> fmData = getTransitionMap(lineData, zcPoint);
+    transitionMap.build(lineData, zcPoint);
 
     // Get the number of samples for 0.75us
     double fSamples = (videoParameters.sampleRate / 1000000) * 0.75;
@@ -58,24 +58,18 @@ bool FmCode::decodeLine(const SourceVideo::Data &lineData,
     qint32 decodeCount = 0;
 
     // Find the first transition
-    qint32 x = videoParameters.activeVideoStart;
-    while (x < fmData.size() && fmData[x] == false) {
-        x++;
-    }
+    qint32 x = transitionMap.findNext(videoParameters.activeVideoStart, true);
 
-    if (x < fmData.size()) {
+    if (x < transitionMap.size()) {
         qint32 lastTransitionX = x;
-        bool lastState = fmData[x];
+        bool lastState = transitionMap[x];
 
         // Find the rest of the bits
-        while (x < fmData.size() && decodeCount < 40) {
+        while (x < transitionMap.size() && decodeCount < 40) {
             // Find the next transition
-            while (x < fmData.size() && fmData[x] == lastState)
-            {
-                x++;
-            }
+            x = transitionMap.findNext(x, !lastState);
 
-            lastState = fmData[x];
+            lastState = transitionMap[x];
 
             // Was the transition in the middle of the cell?
             if (x - lastTransitionX < samples) {
@@ -84,12 +78,9 @@ bool FmCode::decodeLine(const SourceVideo::Data &lineData,
                 decodeCount++;
 
                 // Find the end of the cell
-                while (x < fmData.size() && fmData[x] == lastState)
-                {
-                    x++;
-                }
-                if (x >= fmData.size()) break; // Check for overflow
-                lastState = fmData[x];
+                x = transitionMap.findNext(x, !lastState);
+                if (x >= transitionMap.size()) break; // Check for overflow
+                lastState = transitionMap[x];
                 lastTransitionX = x;
             } else {
                 decodedBytes = (decodedBytes << 1);
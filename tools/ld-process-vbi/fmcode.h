@@ -27,15 +27,19 @@
 
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "vbiutilities.h"
 
 // Decoder for NTSC LaserDisc FM code lines.
 // Specified in IEC 60587-1986 section 10.2.
 class FmCode
 {
 public:
-    bool decodeLine(const SourceVideo::Data &lineData,
+    bool decodeLine(SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
+
+private:
+    TransitionMap transitionMap;
 };
 
 #endif // FMCODE_H
@@ -76,12 +76,33 @@ int main(int argc, char *argv[])
                                        QCoreApplication::translate("main", "Do not create a backup of the input JSON metadata"));
     parser.addOption(showNoBackupOption);
 
+    // Option to record metadata updates in a journal (--journal)
+    QCommandLineOption journalOption(QStringList() << "journal",
+                                     QCoreApplication::translate("main", "Record metadata updates in a journal next to the input metadata, rather than rewriting it"));
+    parser.addOption(journalOption);
+
+    // Option to resume from the last checkpoint (--resume)
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Resume an interrupted run from its checkpoint (implies --journal)"));
+    parser.addOption(resumeOption);
+
     // Option to select the number of threads (-t)
     QCommandLineOption threadsOption(QStringList() << "t" << "threads",
                                         QCoreApplication::translate("main", "Specify the number of concurrent threads (default is the number of logical CPUs)"),
                                         QCoreApplication::translate("main", "number"));
     parser.addOption(threadsOption);
 
+    // Option to measure VITS metrics in the same pass (--vits)
+    QCommandLineOption vitsOption(QStringList() << "vits",
+                                  QCoreApplication::translate("main", "Also measure VITS metrics (as ld-process-vits does) in the same pass"));
+    parser.addOption(vitsOption);
+
+    // Option to write per-frame dropout statistics (--dropout-stats)
+    QCommandLineOption dropoutStatsOption(QStringList() << "dropout-stats",
+                                          QCoreApplication::translate("main", "Also write per-frame dropout statistics to a CSV file"),
+                                          QCoreApplication::translate("main", "filename"));
+    parser.addOption(dropoutStatsOption);
+
     // Positional argument to specify input TBC file
     parser.addPositionalArgument("input", QCoreApplication::translate("main", "Specify input TBC file"));
 
@@ -93,6 +114,17 @@ int main(int argc, char *argv[])
 
     // Get the options from the parser
     bool noBackup = parser.isSet(showNoBackupOption);
+    bool resume = parser.isSet(resumeOption);
+    bool useJournal = parser.isSet(journalOption) || resume;
+    bool measureVits = parser.isSet(vitsOption);
+    QString dropoutStatsFilename;
+    if (parser.isSet(dropoutStatsOption)) dropoutStatsFilename = parser.value(dropoutStatsOption);
+
+    // Dropout statistics are only held in memory, so can't be resumed
+    if (resume && !dropoutStatsFilename.isEmpty()) {
+        qCritical("The --resume option can't be used with --dropout-stats");
+        return -1;
+    }
 
     qint32 maxThreads = QThread::idealThreadCount();
     if (parser.isSet(threadsOption)) {
@@ -126,6 +158,12 @@ int main(int argc, char *argv[])
         outputJsonFilename = parser.value(outputJsonOption);
     }
 
+    // The journal belongs to the input metadata, which must be updated in place
+    if (useJournal && inputJsonFilename != outputJsonFilename) {
+        qCritical("The --journal and --resume options can't be used with a different output JSON file");
+        return -1;
+    }
+
     // Open the source video metadata
     LdDecodeMetaData metaData;
     qInfo().nospace().noquote() << "Reading JSON metadata from " << inputJsonFilename;
@@ -135,7 +173,7 @@ int main(int argc, char *argv[])
     }
 
     // If we're overwriting the input JSON file, back it up first
-    if (inputJsonFilename == outputJsonFilename && !noBackup) {
+    if (inputJsonFilename == outputJsonFilename && !noBackup && !useJournal) {
         qInfo().nospace().noquote() << "Backing up JSON metadata to " << inputJsonFilename << ".bup";
         if (!QFile::copy(inputJsonFilename, inputJsonFilename + ".bup")) {
             qCritical() << "Unable to back-up input JSON metadata file - back-up already exists?";
@@ -143,9 +181,19 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Start the journal (any updates from an earlier run have already been applied)
+    if (useJournal) {
+        qInfo().nospace().noquote() << "Recording metadata updates in a journal for " << outputJsonFilename;
+        if (!metaData.openJournal(outputJsonFilename)) {
+            qCritical() << "Unable to open metadata journal";
+            return 1;
+        }
+    }
+
     // Perform the processing
     qInfo() << "Beginning VBI processing...";
-    DecoderPool decoderPool(inputFilename, outputJsonFilename, maxThreads, metaData);
+    DecoderPool decoderPool(inputFilename, outputJsonFilename, maxThreads, metaData,
+                            measureVits, dropoutStatsFilename, resume);
     if (!decoderPool.process()) return 1;
 
     // Quit with success
@@ -29,8 +29,11 @@
 #include "fmcode.h"
 #include "videoid.h"
 #include "vitccode.h"
+#include "vitsmeasurement.h"
 #include "whiteflag.h"
 
+#include <QSet>
+
 VbiLineDecoder::VbiLineDecoder(QAtomicInt& _abort, DecoderPool& _decoderPool, QObject *parent)
     : QThread(parent), abort(_abort), decoderPool(_decoderPool)
 {
@@ -47,6 +50,15 @@ void VbiLineDecoder::run()
     LdDecodeMetaData::Field fieldMetadata;
     LdDecodeMetaData::VideoParameters videoParameters;
 
+    // Line decoders (kept between fields so their buffers can be reused)
+    BiphaseCode biphaseCode;
+    FmCode fmCode;
+    WhiteFlag whiteFlag;
+    VideoID videoID;
+    VitcCode vitcCode;
+    ClosedCaption closedCaption;
+    VitsMeasurement vitsMeasurement;
+
     while (!abort) {
         // Get the next field to process from the input file
         if (!decoderPool.getInputField(fieldNumber, sourceFieldData, fieldMetadata, videoParameters)) {
@@ -63,7 +75,6 @@ void VbiLineDecoder::run()
         else qDebug() << "VbiLineDecoder::process(): Getting metadata for field" << fieldNumber << "(second)";
 
         // Get the 24-bit biphase-coded data from field lines 16-18
-        BiphaseCode biphaseCode;
         biphaseCode.decodeLines(getFieldLine(sourceFieldData, 16, videoParameters),
                                 getFieldLine(sourceFieldData, 17, videoParameters),
                                 getFieldLine(sourceFieldData, 18, videoParameters),
@@ -72,22 +83,18 @@ void VbiLineDecoder::run()
         // Process NTSC specific data if source type is NTSC
         if (videoParameters.system == NTSC) {
             // Get the 40-bit FM coded data from field line 10
-            FmCode fmCode;
             fmCode.decodeLine(getFieldLine(sourceFieldData, 10, videoParameters), videoParameters, fieldMetadata);
 
             // Get the white flag from field line 11
-            WhiteFlag whiteFlag;
             whiteFlag.decodeLine(getFieldLine(sourceFieldData, 11, videoParameters), videoParameters, fieldMetadata);
 
             // Get IEC 61880 data from field line 20
-            VideoID videoID;
             videoID.decodeLine(getFieldLine(sourceFieldData, 20, videoParameters), videoParameters, fieldMetadata);
 
             fieldMetadata.ntsc.inUse = true;
         }
 
         // Get VITC data, trying each possible line and stopping when we find a valid one
-        VitcCode vitcCode;
         for (qint32 lineNumber: vitcCode.getLineNumbers(videoParameters)) {
             if (vitcCode.decodeLine(getFieldLine(sourceFieldData, lineNumber, videoParameters),
                                     videoParameters, fieldMetadata)) {
@@ -96,28 +103,44 @@ void VbiLineDecoder::run()
         }
 
         // Get Closed Caption data from line 21 (525-line) or 22 (625-line)
-        ClosedCaption closedCaption;
         closedCaption.decodeLine(getFieldLine(sourceFieldData, (videoParameters.system == PAL) ? 22 : 21, videoParameters),
                                  videoParameters, fieldMetadata);
 
+        // Measure the VITS metrics, if required
+        if (decoderPool.getMeasureVits()) {
+            vitsMeasurement.measureField(sourceFieldData, decoderPool.getLineRanges(), videoParameters,
+                                         fieldMetadata.vitsMetrics);
+        }
+
+        // Summarise the field's dropouts, if required
+        DecoderPool::DropoutStats dropoutStats;
+        if (decoderPool.getCollectDropoutStats()) {
+            QSet<qint32> dropoutLines;
+            for (qint32 i = 0; i < fieldMetadata.dropOuts.size(); i++) {
+                dropoutStats.dropoutLength += fieldMetadata.dropOuts.endx(i) - fieldMetadata.dropOuts.startx(i);
+                dropoutLines.insert(fieldMetadata.dropOuts.fieldLine(i));
+            }
+            dropoutStats.dropouts = fieldMetadata.dropOuts.size();
+            dropoutStats.dropoutLines = dropoutLines.size();
+        }
+
         // Write the result to the output metadata
-        if (!decoderPool.setOutputField(fieldNumber, fieldMetadata)) {
+        if (!decoderPool.setOutputField(fieldNumber, fieldMetadata, dropoutStats)) {
             abort = true;
             break;
         }
     }
 }
 
-// Private method to get a single scanline of greyscale data
-SourceVideo::Data VbiLineDecoder::getFieldLine(const SourceVideo::Data &sourceField, qint32 fieldLine,
-                                               const LdDecodeMetaData::VideoParameters& videoParameters)
+// Private method to get a view of a single scanline of greyscale data
+SourceVideo::DataView VbiLineDecoder::getFieldLine(const SourceVideo::Data &sourceField, qint32 fieldLine,
+                                                   const LdDecodeMetaData::VideoParameters& videoParameters)
 {
     // Range-check the field line
     if (fieldLine < startFieldLine || fieldLine > endFieldLine) {
         qWarning() << "Cannot generate field-line data, line number is out of bounds! Scan line =" << fieldLine;
-        return SourceVideo::Data();
+        return SourceVideo::DataView();
     }
 
-    qint32 startPointer = (fieldLine - startFieldLine) * videoParameters.fieldWidth;
-    return sourceField.mid(startPointer, videoParameters.fieldWidth);
+    return SourceVideo::getRangeLine(sourceField, decoderPool.getLineRanges(), fieldLine, videoParameters.fieldWidth);
 }
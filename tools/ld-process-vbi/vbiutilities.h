@@ -29,61 +29,168 @@
 // Common utility functions for VBI line decoders
 
 #include <QtGlobal>
-#include <QVector>
+#include <QtAlgorithms>
+
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "sourcevideo.h"
 
 // Check data for even parity
 template <typename Unsigned>
 static inline bool isEvenParity(Unsigned data)
 {
-    qint32 count = 0;
-
-    // Count non-zero bits
-    // XXX In C++20, we can use std::popcount
-    while (data != 0) {
-        if ((data & 1) != 0) count++;
-        data >>= 1;
-    }
-
-    return (count % 2) == 0;
+    return (qPopulationCount(data) % 2) == 0;
 }
 
-// Convert input samples into a vector of binary values
-template <typename InputData>
-static inline QVector<bool> getTransitionMap(const InputData &lineData, qint32 zcPoint)
+// A map of the binary values of the samples in a line, packed 64 samples per
+// word. Decoders should keep one of these and reuse it for each line, so that
+// no allocation is needed once the buffer has grown to the line width.
+class TransitionMap
 {
-    // Read the data into a boolean array using debounce to remove transition noise
-    bool previousState = false;
-    bool currentState = false;
-    qint32 debounce = 0;
-    QVector<bool> transitionMap;
+public:
+    // Convert input samples into binary values, using debounce to remove
+    // transition noise
+    void build(SourceVideo::DataView lineData, qint32 zcPoint)
+    {
+        numSamples = lineData.size();
+        numWords = (numSamples + 63) / 64;
+        if (static_cast<qint32>(words.size()) < numWords) words.resize(numWords);
+
+        bool previousState = false;
+        qint32 debounce = 0;
+
+        for (qint32 wordIndex = 0; wordIndex < numWords; wordIndex++) {
+            const qint32 base = wordIndex * 64;
+            const qint32 count = qMin(64, numSamples - base);
+            const quint64 raw = threshold(lineData.data() + base, count, zcPoint);
+
+            // The state only changes once four samples have differed from it,
+            // so rather than visiting every sample, skip between the samples
+            // that differ from the current state
+            quint64 output = 0;
+            qint32 position = 0;
+            while (position < count) {
+                const quint64 stateMask = previousState ? ~quint64(0) : 0;
+                const quint64 differ = (raw ^ stateMask) & bitRange(position, count);
+
+                if (differ == 0) {
+                    // No more changes in this word
+                    output |= stateMask & bitRange(position, count);
+                    break;
+                }
+
+                const qint32 changePosition = qCountTrailingZeroBits(differ);
+                output |= stateMask & bitRange(position, changePosition);
+
+                debounce++;
+                if (debounce > 3) {
+                    debounce = 0;
+                    previousState = !previousState;
+                }
+                if (previousState) output |= quint64(1) << changePosition;
+
+                position = changePosition + 1;
+            }
+
+            words[wordIndex] = output;
+        }
+    }
 
-    // Each value is 2 bytes (16-bit greyscale data)
-    for (qint32 xPoint = 0; xPoint < lineData.size(); xPoint++) {
-        if (lineData[xPoint] > zcPoint) currentState = true; else currentState = false;
+    // Return the number of samples in the map
+    qint32 size() const
+    {
+        return numSamples;
+    }
 
-        if (currentState != previousState) debounce++;
+    // Return the value of a sample (false if out of range)
+    bool operator[](qint32 x) const
+    {
+        if (x < 0 || x >= numSamples) return false;
+        return ((words[x / 64] >> (x % 64)) & 1) != 0;
+    }
 
-        if (debounce > 3) {
-            debounce = 0;
-            previousState = currentState;
+    // Return the position of the first sample at or after x with a given
+    // value, or size() if there isn't one
+    qint32 findNext(qint32 x, bool wantValue) const
+    {
+        if (x < 0) x = 0;
+        if (x >= numSamples) return numSamples;
+
+        qint32 wordIndex = x / 64;
+        quint64 word = (wantValue ? words[wordIndex] : ~words[wordIndex]) & (~quint64(0) << (x % 64));
+        while (word == 0) {
+            wordIndex++;
+            if (wordIndex >= numWords) return numSamples;
+            word = wantValue ? words[wordIndex] : ~words[wordIndex];
         }
 
-        transitionMap.append(previousState);
+        return qMin((wordIndex * 64) + static_cast<qint32>(qCountTrailingZeroBits(word)), numSamples);
     }
 
-    return transitionMap;
-}
+private:
+    std::vector<quint64> words;
+    qint32 numWords = 0;
+    qint32 numSamples = 0;
+
+    // Return a mask with bits [start, end) set, where 0 <= start <= end <= 64
+    static quint64 bitRange(qint32 start, qint32 end)
+    {
+        if (start >= end) return 0;
+        const quint64 endMask = (end == 64) ? ~quint64(0) : ((quint64(1) << end) - 1);
+        return endMask & (~quint64(0) << start);
+    }
+
+    // Compare up to 64 samples against the zero-crossing point, returning a
+    // bitmask with bit n set if sample n is above it
+    static quint64 threshold(const quint16 *samples, qint32 count, qint32 zcPoint)
+    {
+        quint64 result = 0;
+        qint32 i = 0;
+
+        // Samples above 65535 can't exist, and every sample is above a
+        // negative zero-crossing point; handle those cases here so the
+        // comparisons below can be done in 16 bits
+        if (zcPoint >= 65535) return 0;
+        if (zcPoint < 0) return bitRange(0, count);
+
+#if defined(__SSE2__)
+        // SSE2 only has a signed 16-bit comparison, so flip the sign bits of
+        // both sides to compare them as unsigned
+        const __m128i signBit = _mm_set1_epi16(static_cast<short>(0x8000));
+        const __m128i zc = _mm_set1_epi16(static_cast<short>(zcPoint ^ 0x8000));
+        for (; i + 16 <= count; i += 16) {
+            const __m128i a = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i)), signBit);
+            const __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8)), signBit);
+            const __m128i packed = _mm_packs_epi16(_mm_cmpgt_epi16(a, zc), _mm_cmpgt_epi16(b, zc));
+            result |= static_cast<quint64>(static_cast<quint16>(_mm_movemask_epi8(packed))) << i;
+        }
+#endif
+
+        for (; i < count; i++) {
+            if (samples[i] > zcPoint) result |= quint64(1) << i;
+        }
 
-// Find the next sample with a given value in the output of getTransitionMap.
+        return result;
+    }
+};
+
+// Find the next sample with a given value in a TransitionMap.
 // Return true if found before the limit, false if not found.
-static inline bool findTransition(const QVector<bool> &transitionMap, bool wantValue,
+static inline bool findTransition(const TransitionMap &transitionMap, bool wantValue,
                                   double &position, double positionLimit)
 {
-    while (position < positionLimit) {
-        if (transitionMap[static_cast<qint32>(position)] == wantValue) return true;
-        position += 1.0;
-    }
-    return false;
+    if (position >= positionLimit) return false;
+
+    const qint32 startX = static_cast<qint32>(position);
+    const qint32 foundX = transitionMap.findNext(startX, wantValue);
+    if (foundX >= transitionMap.size()) return false;
+
+    position += static_cast<double>(foundX - startX);
+    return position < positionLimit;
 }
 
 #endif
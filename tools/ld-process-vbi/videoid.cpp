@@ -42,7 +42,7 @@
 
 // Public method to read IEC 61880 data.
 // Return true if data was decoded successfully, false otherwise.
-bool VideoID::decodeLine(const SourceVideo::Data& lineData,
+bool VideoID::decodeLine(SourceVideo::DataView lineData,
                       const LdDecodeMetaData::VideoParameters& videoParameters,
                       LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -63,7 +63,7 @@ bool VideoID::decodeLine(const SourceVideo::Data& lineData,
     qint32 zcPoint = ((videoParameters.white16bIre - videoParameters.black16bIre) * 35 / 100 ) + videoParameters.black16bIre;
 
     // Get the transition map for the line
-    QVector<bool> transitionMap = getTransitionMap(lineData, zcPoint);
+    transitionMap.build(lineData, zcPoint);
 
     // Bit clock is fSC / 8, i.e. 455/16 * fH [IEC p9]
     double samplesPerBit = static_cast<double>(videoParameters.fieldWidth) * 16 / 455;
@@ -27,13 +27,17 @@
 
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "vbiutilities.h"
 
 class VideoID
 {
 public:
-    bool decodeLine(const SourceVideo::Data& lineData,
+    bool decodeLine(SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
+
+private:
+    TransitionMap transitionMap;
 };
 
 #endif // VIDEOID_H
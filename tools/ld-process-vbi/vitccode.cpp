@@ -45,7 +45,7 @@
 
 // Read a VITC signal from a scanline.
 // Return true if a signal was found and successfully decoded, false otherwise.
-bool VitcCode::decodeLine(const SourceVideo::Data &lineData,
+bool VitcCode::decodeLine(SourceVideo::DataView lineData,
                           const LdDecodeMetaData::VideoParameters& videoParameters,
                           LdDecodeMetaData::Field& fieldMetadata)
 {
@@ -57,7 +57,7 @@ bool VitcCode::decodeLine(const SourceVideo::Data &lineData,
     // For NTSC, 40 IRE is halfway between the 0 and 1 limits; PAL is very close to this. [ITU 6.18.1]
     const qint32 zcPoint = videoParameters.black16bIre
                            + ((40 * (videoParameters.white16bIre - videoParameters.black16bIre)) / 100);
-    QVector<bool> dataBits = getTransitionMap(lineData, zcPoint);
+    transitionMap.build(lineData, zcPoint);
 
     // Number of samples per bit [ITU 6.18]
     const double bitSamples = videoParameters.fieldWidth / 115.0;
@@ -82,11 +82,11 @@ bool VitcCode::decodeLine(const SourceVideo::Data &lineData,
     // next sync pulse.
     double byteStart = videoParameters.colourBurstEnd;
     double byteStartLimit = static_cast<double>(lineData.size()) - (90 * bitSamples);
-    if (!findTransition(dataBits, false, byteStart, byteStartLimit)) {
+    if (!findTransition(transitionMap, false, byteStart, byteStartLimit)) {
         qDebug() << "VitcCode::decodeLine(): No leading zero found";
         return false;
     }
-    if (!findTransition(dataBits, true, byteStart, byteStartLimit)) {
+    if (!findTransition(transitionMap, true, byteStart, byteStartLimit)) {
         qDebug() << "VitcCode::decodeLine(): No leading edge found";
         return false;
     }
@@ -97,7 +97,7 @@ bool VitcCode::decodeLine(const SourceVideo::Data &lineData,
         // Resynchronise by finding the 1-0 transition in the synchronisation sequence
         byteStart += bitSamples * 0.5;
         byteStartLimit += 10 * bitSamples;
-        if (!findTransition(dataBits, false, byteStart, byteStartLimit)) {
+        if (!findTransition(transitionMap, false, byteStart, byteStartLimit)) {
             qDebug() << "VitcCode::decodeLine(): No transition found for byte" << byteNum;
             return false;
         }
@@ -105,7 +105,7 @@ bool VitcCode::decodeLine(const SourceVideo::Data &lineData,
 
         // Extract 10 bits by sampling the centre of each bit, LSB first
         for (qint32 i = 0; i < 10; i++) {
-            const qint32 bit = dataBits[static_cast<qint32>(byteStart + ((i + 0.5) * bitSamples))] ? 1 : 0;
+            const qint32 bit = transitionMap[static_cast<qint32>(byteStart + ((i + 0.5) * bitSamples))] ? 1 : 0;
             vitcData[byteNum] |= bit << i;
 
             // Accumulate bits for the CRC as well
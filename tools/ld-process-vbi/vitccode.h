@@ -27,17 +27,21 @@
 
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "vbiutilities.h"
 
 #include <vector>
 
 class VitcCode
 {
 public:
-    bool decodeLine(const SourceVideo::Data &lineData,
+    bool decodeLine(SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
 
     std::vector<qint32> getLineNumbers(const LdDecodeMetaData::VideoParameters& videoParameters);
+
+private:
+    TransitionMap transitionMap;
 };
 
 #endif // VITCCODE_H
@@ -26,7 +26,7 @@
 
 // Public method to read the white flag status from a field-line.
 // Return true if the flag is detected, false otherwise.
-bool WhiteFlag::decodeLine(const SourceVideo::Data& lineData,
+bool WhiteFlag::decodeLine(SourceVideo::DataView lineData,
                            const LdDecodeMetaData::VideoParameters& videoParameters,
                            LdDecodeMetaData::Field& fieldMetadata)
 {
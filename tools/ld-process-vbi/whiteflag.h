@@ -33,7 +33,7 @@
 class WhiteFlag
 {
 public:
-    bool decodeLine(const SourceVideo::Data& lineData,
+    bool decodeLine(SourceVideo::DataView lineData,
                     const LdDecodeMetaData::VideoParameters& videoParameters,
                     LdDecodeMetaData::Field& fieldMetadata);
 };
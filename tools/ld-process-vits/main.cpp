@@ -80,6 +80,16 @@ int main(int argc, char *argv[])
                                        QCoreApplication::translate("main", "Do not create a backup of the input JSON metadata"));
     parser.addOption(showNoBackupOption);
 
+    // Option to record metadata updates in a journal (--journal)
+    QCommandLineOption journalOption(QStringList() << "journal",
+                                     QCoreApplication::translate("main", "Record metadata updates in a journal next to the input metadata, rather than rewriting it"));
+    parser.addOption(journalOption);
+
+    // Option to resume from the last checkpoint (--resume)
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Resume an interrupted run from its checkpoint (implies --journal)"));
+    parser.addOption(resumeOption);
+
     // Option to select the number of threads (-t)
     QCommandLineOption threadsOption(QStringList() << "t" << "threads",
                                         QCoreApplication::translate("main", "Specify the number of concurrent threads (default is the number of logical CPUs)"),
@@ -97,6 +107,8 @@ int main(int argc, char *argv[])
 
     // Get the options from the parser
     bool noBackup = parser.isSet(showNoBackupOption);
+    bool resume = parser.isSet(resumeOption);
+    bool useJournal = parser.isSet(journalOption) || resume;
 
     qint32 maxThreads = QThread::idealThreadCount();
     if (parser.isSet(threadsOption)) {
@@ -130,6 +142,12 @@ int main(int argc, char *argv[])
         outputJsonFilename = parser.value(outputJsonOption);
     }
 
+    // The journal belongs to the input metadata, which must be updated in place
+    if (useJournal && inputJsonFilename != outputJsonFilename) {
+        qCritical("The --journal and --resume options can't be used with a different output JSON file");
+        return -1;
+    }
+
     // Open the source video metadata
     LdDecodeMetaData metaData;
     qInfo().nospace().noquote() << "Reading JSON metadata from " << inputJsonFilename;
@@ -139,7 +157,7 @@ int main(int argc, char *argv[])
     }
 
     // If we're overwriting the input JSON file, back it up first
-    if (inputJsonFilename == outputJsonFilename && !noBackup) {
+    if (inputJsonFilename == outputJsonFilename && !noBackup && !useJournal) {
         qInfo().nospace().noquote() << "Backing up JSON metadata to " << inputJsonFilename << ".vbup";
         if (!QFile::copy(inputJsonFilename, inputJsonFilename + ".vbup")) {
             qCritical() << "Unable to back-up input JSON metadata file - back-up already exists?";
@@ -147,9 +165,18 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Start the journal (any updates from an earlier run have already been applied)
+    if (useJournal) {
+        qInfo().nospace().noquote() << "Recording metadata updates in a journal for " << outputJsonFilename;
+        if (!metaData.openJournal(outputJsonFilename)) {
+            qCritical() << "Unable to open metadata journal";
+            return 1;
+        }
+    }
+
     // Perform the processing
     qInfo() << "Beginning VITS processing...";
-    ProcessingPool processingPool(inputFilename, outputJsonFilename, maxThreads, metaData);
+    ProcessingPool processingPool(inputFilename, outputJsonFilename, maxThreads, metaData, resume);
     if (!processingPool.process()) return 1;
 
     // Quit with success
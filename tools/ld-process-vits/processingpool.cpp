@@ -25,9 +25,9 @@
 #include "processingpool.h"
 
 ProcessingPool::ProcessingPool(QString _inputFilename, QString _outputJsonFilename,
-                         qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData)
+                         qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData, bool _resume)
     : inputFilename(_inputFilename), outputJsonFilename(_outputJsonFilename),
-      maxThreads(_maxThreads), ldDecodeMetaData(_ldDecodeMetaData)
+      maxThreads(_maxThreads), resume(_resume), ldDecodeMetaData(_ldDecodeMetaData)
 {
 }
 
@@ -55,10 +55,35 @@ bool ProcessingPool::process()
     // Show some information for the user
     qInfo() << "Using" << maxThreads << "threads to process" << ldDecodeMetaData.getNumberOfFields() << "fields";
 
+    // Periodically save a checkpoint when the metadata updates are being
+    // journalled, so an interrupted run can be resumed
+    useCheckpoints = ldDecodeMetaData.isJournalOpen();
+    checkpointFileName = Checkpoint::getCheckpointFileName(outputJsonFilename);
+    qint32 firstFieldNumber = 1;
+    if (resume && QFile::exists(checkpointFileName)) {
+        Checkpoint checkpoint;
+        if (!checkpoint.read(checkpointFileName)) {
+            sourceVideo.close();
+            return false;
+        }
+        if (checkpoint.job != getCheckpointJob()) {
+            qCritical() << "Checkpoint" << checkpointFileName << "is for a different job - cannot resume";
+            sourceVideo.close();
+            return false;
+        }
+        firstFieldNumber = checkpoint.nextNumber;
+        qInfo() << "Resuming from field" << firstFieldNumber;
+    } else if (resume) {
+        qInfo() << "No checkpoint found, starting from the beginning";
+    }
+
     // Initialise processing state
-    inputFieldNumber = 1;
+    inputFieldNumber = firstFieldNumber;
+    outputFieldNumber = firstFieldNumber;
+    pendingOutputFields.clear();
     lastFieldNumber = ldDecodeMetaData.getNumberOfFields();
     totalTimer.start();
+    checkpointTimer.start();
 
     // Start a vector of decoding threads to process the video
     QVector<QThread *> threads;
@@ -85,14 +110,25 @@ bool ProcessingPool::process()
     qInfo() << "VITS Processing complete -" << lastFieldNumber << "fields in" << totalSecs << "seconds (" <<
                lastFieldNumber / totalSecs << "FPS )";
 
-    // Write the JSON metadata file
-    qInfo() << "Writing JSON metadata file...";
-    ldDecodeMetaData.write(outputJsonFilename);
+    // Write the JSON metadata file, or just finish the journal if one is in use
+    if (ldDecodeMetaData.isJournalOpen()) {
+        qInfo() << "Writing metadata journal...";
+        if (!ldDecodeMetaData.closeJournal()) {
+            sourceVideo.close();
+            return false;
+        }
+    } else {
+        qInfo() << "Writing JSON metadata file...";
+        ldDecodeMetaData.write(outputJsonFilename);
+    }
     qInfo() << "VITS processing complete";
 
     // Close the source video
     sourceVideo.close();
 
+    // The metadata is complete, so the checkpoint is no longer needed
+    if (useCheckpoints && !Checkpoint::remove(checkpointFileName)) return false;
+
     return true;
 }
 
@@ -115,10 +151,10 @@ bool ProcessingPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &field
     // Show what we are about to process
     //qDebug() << "Processing field number" << fieldNumber;
 
-    // Fetch the input data
-    fieldVideoData = sourceVideo.getVideoField(fieldNumber);
-    fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
+    // Fetch the input data (only the lines the analyser needs)
     videoParameters = ldDecodeMetaData.getVideoParameters();
+    fieldVideoData = sourceVideo.getVideoFieldRanges(fieldNumber, 1, VitsMeasurement::getLineRanges(videoParameters.system));
+    fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
 
     return true;
 }
@@ -133,5 +169,37 @@ bool ProcessingPool::setOutputField(qint32 fieldNumber, LdDecodeMetaData::Field
     // Save the field data to the metadata (only VITS metrics metadata is affected)
     ldDecodeMetaData.updateFieldVitsMetrics(fieldMetadata.vitsMetrics, fieldNumber);
 
+    // Advance past the fields that have all been completed
+    pendingOutputFields.insert(fieldNumber);
+    while (pendingOutputFields.remove(outputFieldNumber)) outputFieldNumber++;
+
+    // Save a checkpoint if it's time for another one
+    if (useCheckpoints && checkpointTimer.hasExpired(Checkpoint::INTERVAL)) {
+        if (!writeCheckpoint()) return false;
+    }
+
+    return true;
+}
+
+// Return a description of the job, to check a checkpoint belongs to it
+QString ProcessingPool::getCheckpointJob() const
+{
+    return QString("ld-process-vits %1 fields %2").arg(inputFilename).arg(ldDecodeMetaData.getNumberOfFields());
+}
+
+// Save a checkpoint of the fields that have been completed so far. You must
+// hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool ProcessingPool::writeCheckpoint()
+{
+    if (!ldDecodeMetaData.flushJournal()) return false;
+
+    Checkpoint checkpoint;
+    checkpoint.job = getCheckpointJob();
+    checkpoint.nextNumber = outputFieldNumber;
+    if (!checkpoint.write(checkpointFileName)) return false;
+
+    checkpointTimer.restart();
     return true;
 }
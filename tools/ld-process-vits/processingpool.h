@@ -28,8 +28,10 @@
 #include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QMutex>
+#include <QSet>
 #include <QThread>
 
+#include "checkpoint.h"
 #include "sourcevideo.h"
 #include "lddecodemetadata.h"
 #include "vitsanalyser.h"
@@ -38,7 +40,7 @@ class ProcessingPool
 {
 public:
     explicit ProcessingPool(QString _inputFilename, QString _outputJsonFilename,
-                        qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData);
+                        qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData, bool _resume = false);
     bool process();
 
     // Member functions used by worker threads
@@ -49,6 +51,7 @@ private:
     QString inputFilename;
     QString outputJsonFilename;
     qint32 maxThreads;
+    bool resume;
     QElapsedTimer totalTimer;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
@@ -65,6 +68,16 @@ private:
     // Output stream information (all guarded by outputMutex while threads are running)
     QMutex outputMutex;
     QFile targetJson;
+    qint32 outputFieldNumber;
+    QSet<qint32> pendingOutputFields;
+
+    // Checkpoint information (guarded by outputMutex while threads are running)
+    bool useCheckpoints;
+    QString checkpointFileName;
+    QElapsedTimer checkpointTimer;
+
+    QString getCheckpointJob() const;
+    bool writeCheckpoint();
 };
 
 #endif // PROCESSINGPOOL_H
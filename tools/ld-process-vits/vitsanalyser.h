@@ -30,10 +30,9 @@
 #include <QThread>
 #include <QDebug>
 
-#include <cmath>
-
 #include "lddecodemetadata.h"
 #include "sourcevideo.h"
+#include "vitsmeasurement.h"
 
 class ProcessingPool;
 
@@ -51,17 +50,8 @@ private:
     QAtomicInt& abort;
     ProcessingPool& processingPool;
 
-    // Temporary output buffer
-    LdDecodeMetaData::Field outputData;
-
     // Other settings
     LdDecodeMetaData::VideoParameters videoParameters;
-
-    QVector<double> getFieldLineSlice(const SourceVideo::Data &sourceField, qint32 fieldLine, qint32 startUs, qint32 lengthUs);
-    double calculateSnr(QVector<double> &data, bool usePsnr);
-    double calcMean(QVector<double> &data);
-    double calcStd(QVector<double> &data);
-    double roundDouble(double in, qint32 decimalPlaces);
 };
 
 #endif // VITSANALYSER_H
@@ -0,0 +1,129 @@
+/************************************************************************
+
+    coringfilter.h
+
+    ld-decode-tools filter library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef CORINGFILTER_H
+#define CORINGFILTER_H
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// A noise-reducing coring filter, as used by LaserDisc players.
+//
+// The signal is passed through a high-pass FIR filter; the result is clipped
+// to +/- a coring level, and subtracted from the original signal. This
+// removes small amounts of high-frequency noise while leaving larger
+// high-frequency detail mostly intact.
+//
+// Coeffs must be a std::array of doubles with an odd number of taps; they are
+// applied in the same way as FIRFilter's.
+template <typename Coeffs>
+class CoringFilter
+{
+public:
+    constexpr CoringFilter(const Coeffs &coeffs_)
+        : coeffs(coeffs_)
+    {
+    }
+
+    // Apply the filter in place to numSamples samples from data, with the
+    // given coring level.
+    //
+    // Samples outside the range of the input are assumed to be 0.
+    void apply(double *data, int numSamples, double level) const
+    {
+        // The input is processed in blocks. window holds the unmodified input
+        // for the current block, with overlap samples of context either side.
+        // As data is modified in place, the context on the left is carried
+        // over from the previous block's window.
+        double window[BLOCK_SIZE + (2 * OVERLAP)];
+
+        // Fill the initial context: zeros to the left, and the first samples
+        // of the input to the right
+        for (int i = 0; i < OVERLAP; i++) {
+            window[i] = 0.0;
+            window[OVERLAP + i] = (i < numSamples) ? data[i] : 0.0;
+        }
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += BLOCK_SIZE) {
+            const int blockSize = std::min(BLOCK_SIZE, numSamples - blockStart);
+
+            // Read the rest of the input the block needs
+            for (int i = 0; i < blockSize; i++) {
+                const int pos = blockStart + OVERLAP + i;
+                window[(2 * OVERLAP) + i] = (pos < numSamples) ? data[pos] : 0.0;
+            }
+
+            double *out = data + blockStart;
+            int i = 0;
+#if defined(__SSE2__)
+            // Filter and core two samples at a time
+            const __m128d maxLevel = _mm_set1_pd(level);
+            const __m128d minLevel = _mm_set1_pd(-level);
+            for (; i + 2 <= blockSize; i += 2) {
+                __m128d acc = _mm_setzero_pd();
+                for (int j = 0; j < NUM_TAPS; j++) {
+                    acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(coeffs[j]), _mm_loadu_pd(&window[i + j])));
+                }
+                acc = _mm_min_pd(_mm_max_pd(acc, minLevel), maxLevel);
+                _mm_storeu_pd(&out[i], _mm_sub_pd(_mm_loadu_pd(&out[i]), acc));
+            }
+#endif
+            for (; i < blockSize; i++) {
+                double acc = 0.0;
+                for (int j = 0; j < NUM_TAPS; j++) {
+                    acc += coeffs[j] * window[i + j];
+                }
+                out[i] -= std::min(std::max(acc, -level), level);
+            }
+
+            // Carry the context over to the next block
+            std::memmove(window, window + blockSize, sizeof(double) * 2 * OVERLAP);
+        }
+    }
+
+private:
+    static constexpr int NUM_TAPS = std::tuple_size<Coeffs>::value;
+    static constexpr int OVERLAP = NUM_TAPS / 2;
+    static_assert((NUM_TAPS % 2) == 1, "CoringFilter must have an odd number of taps");
+
+    // Number of samples to process at once
+    static constexpr int BLOCK_SIZE = 256;
+
+    const Coeffs &coeffs;
+};
+
+// Helper for declaring CoringFilter instances with auto.
+// e.g. constexpr auto myFilter = makeCoringFilter(myFilterCoeffs);
+template <typename Coeffs>
+constexpr CoringFilter<Coeffs> makeCoringFilter(const Coeffs &coeffs)
+{
+    return CoringFilter<Coeffs>(coeffs);
+}
+
+#endif
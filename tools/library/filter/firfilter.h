@@ -27,11 +27,20 @@
 
 #include <algorithm>
 #include <cassert>
+#include <tuple>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // A FIR filter with arbitrary coefficients. The number of taps must be odd.
 //
-// Coeffs::value_type will be used to accumulate the results, so if you provide
-// float coefficients, the filter will work at float precision internally.
+// Coeffs must be a std::array, so the number of taps is known at compile
+// time. Coeffs::value_type will be used to accumulate the results, so if you
+// provide float coefficients, the filter will work at float precision
+// internally. Filtering double data with double coefficients, or float data
+// with float coefficients, uses SIMD where available.
 template <typename Coeffs>
 class FIRFilter
 {
@@ -51,20 +60,14 @@ public:
         // To minimise tests in the loops below, we divide the data into
         // three parts, based on how far we might need to read outside the
         // input data.
-        const int numTaps = coeffs.size();
-        const int overlap = numTaps / 2;
-
-        // Check that the number of taps is odd. (If it was even, then the
-        // output would be delayed by half a sample.)
-        assert((numTaps % 2) == 1);
 
         // At the left end of the input, we definitely overlap to the left.
         // We might overlap to the right too if numSamples < numTaps, in which
         // case this loop will handle all the samples.
-        const int leftPos = std::min(overlap, numSamples);
+        const int leftPos = std::min(OVERLAP, numSamples);
         for (int i = 0; i < leftPos; i++) {
             typename Coeffs::value_type v = 0;
-            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
+            for (int j = 0, k = i - OVERLAP; j < NUM_TAPS; j++, k++) {
                 if (k >= 0 && k < numSamples) {
                     v += coeffs[j] * inputData[k];
                 }
@@ -74,19 +77,13 @@ public:
 
         // In the middle of the input, we definitely don't overlap -- and for
         // typical input this is where we do most of the work.
-        const int rightPos = std::max(numSamples - overlap, leftPos);
-        for (int i = leftPos; i < rightPos; i++) {
-            typename Coeffs::value_type v = 0;
-            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
-                v += coeffs[j] * inputData[k];
-            }
-            outputData[i] = v;
-        }
+        const int rightPos = std::max(numSamples - OVERLAP, leftPos);
+        filterBlock(inputData + leftPos - OVERLAP, outputData + leftPos, rightPos - leftPos);
 
         // At the right end of the input, we definitely overlap to the right.
         for (int i = rightPos; i < numSamples; i++) {
             typename Coeffs::value_type v = 0;
-            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
+            for (int j = 0, k = i - OVERLAP; j < NUM_TAPS; j++, k++) {
                 if (k < numSamples) {
                     v += coeffs[j] * inputData[k];
                 }
@@ -95,6 +92,41 @@ public:
         }
     }
 
+    // Apply the filter in place to numSamples samples from data.
+    //
+    // Samples outside the range of the input are assumed to be 0.
+    template <typename Sample>
+    void apply(Sample *data, int numSamples) const
+    {
+        // The input is processed in blocks. window holds the unmodified input
+        // for the current block, with OVERLAP samples of context either side.
+        // As data is modified in place, the context on the left is carried
+        // over from the previous block's window.
+        Sample window[BLOCK_SIZE + (2 * OVERLAP)];
+
+        // Fill the initial context: zeros to the left, and the first samples
+        // of the input to the right
+        for (int i = 0; i < OVERLAP; i++) {
+            window[i] = 0;
+            window[OVERLAP + i] = (i < numSamples) ? data[i] : 0;
+        }
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += BLOCK_SIZE) {
+            const int blockSize = std::min(BLOCK_SIZE, numSamples - blockStart);
+
+            // Read the rest of the input the block needs
+            for (int i = 0; i < blockSize; i++) {
+                const int pos = blockStart + OVERLAP + i;
+                window[(2 * OVERLAP) + i] = (pos < numSamples) ? data[pos] : 0;
+            }
+
+            filterBlock(window, data + blockStart, blockSize);
+
+            // Carry the context over to the next block
+            std::copy(window + blockSize, window + blockSize + (2 * OVERLAP), window);
+        }
+    }
+
     // Apply the filter to samples from container inputData, writing the result
     // into container outputData. The two containers must be the same size.
     template <typename InputContainer, typename OutputContainer>
@@ -109,13 +141,78 @@ public:
     template <typename Container>
     void apply(Container &data) const
     {
-        Container tmp(data.size());
-        apply(data, tmp);
-        data = tmp;
+        apply(data.data(), static_cast<int>(data.size()));
     }
 
 private:
+    static constexpr int NUM_TAPS = std::tuple_size<Coeffs>::value;
+    static constexpr int OVERLAP = NUM_TAPS / 2;
+
+    // Check that the number of taps is odd. (If it was even, then the
+    // output would be delayed by half a sample.)
+    static_assert((NUM_TAPS % 2) == 1, "FIRFilter must have an odd number of taps");
+
+    // Number of samples to process at once when filtering in place
+    static constexpr int BLOCK_SIZE = 256;
+
     const Coeffs &coeffs;
+
+    // Filter numSamples samples, reading from inputData[0] to
+    // inputData[numSamples + NUM_TAPS - 2] (i.e. inputData points OVERLAP
+    // samples to the left of the first output sample).
+    template <typename InputSample, typename OutputSample>
+    void filterBlock(const InputSample *inputData, OutputSample *outputData, int numSamples) const
+    {
+        filterScalar(inputData, outputData, 0, numSamples);
+    }
+
+    void filterBlock(const double *inputData, double *outputData, int numSamples) const
+    {
+        int i = 0;
+#if defined(__SSE2__)
+        if (std::is_same<typename Coeffs::value_type, double>::value) {
+            // Filter two samples at a time
+            for (; i + 2 <= numSamples; i += 2) {
+                __m128d v = _mm_setzero_pd();
+                for (int j = 0; j < NUM_TAPS; j++) {
+                    v = _mm_add_pd(v, _mm_mul_pd(_mm_set1_pd(coeffs[j]), _mm_loadu_pd(&inputData[i + j])));
+                }
+                _mm_storeu_pd(&outputData[i], v);
+            }
+        }
+#endif
+        filterScalar(inputData, outputData, i, numSamples);
+    }
+
+    void filterBlock(const float *inputData, float *outputData, int numSamples) const
+    {
+        int i = 0;
+#if defined(__SSE2__)
+        if (std::is_same<typename Coeffs::value_type, float>::value) {
+            // Filter four samples at a time
+            for (; i + 4 <= numSamples; i += 4) {
+                __m128 v = _mm_setzero_ps();
+                for (int j = 0; j < NUM_TAPS; j++) {
+                    v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(static_cast<float>(coeffs[j])), _mm_loadu_ps(&inputData[i + j])));
+                }
+                _mm_storeu_ps(&outputData[i], v);
+            }
+        }
+#endif
+        filterScalar(inputData, outputData, i, numSamples);
+    }
+
+    template <typename InputSample, typename OutputSample>
+    void filterScalar(const InputSample *inputData, OutputSample *outputData, int start, int end) const
+    {
+        for (int i = start; i < end; i++) {
+            typename Coeffs::value_type v = 0;
+            for (int j = 0; j < NUM_TAPS; j++) {
+                v += coeffs[j] * inputData[i + j];
+            }
+            outputData[i] = v;
+        }
+    }
 };
 
 // Helper for declaring FIRFilter instances with auto.
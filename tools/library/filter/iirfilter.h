@@ -62,22 +62,45 @@ public:
     void clear(double val = 0) {
         x.fill(val);
         y.fill(val);
+        xPos = 0;
+        yPos = 0;
     }
 
     // Feed a new input value into the filter, returning the new output value
     double feed(double val) {
+        // Add val to the input history
+        xPos = (xPos == 0) ? bOrder - 1 : xPos - 1;
+        x[xPos] = val;
+        x[xPos + bOrder] = val;
+
+        // The history for the previous sample, i.e. xh[i] is the input from
+        // i + 1 samples ago
+        const double *xh = &x[xPos + 1];
+        const double *yh = &y[yPos];
+
         double y0 = b[0] * val;
         for (int i = bOrder - 1; i >= 1; i--) {
-            x[i] = x[i - 1];
-            y0 += b[i] * x[i];
+            y0 += b[i] * xh[i - 1];
         }
-        x[0] = val;
         for (int i = aOrder - 1; i >= 1; i--) {
-            y[i] = y[i - 1];
-            y0 -= a[i] * y[i];
+            y0 -= a[i] * yh[i - 1];
+        }
+
+        // Add y0 to the output history
+        yPos = (yPos == 0) ? aOrder - 1 : yPos - 1;
+        y[yPos] = y0;
+        y[yPos + aOrder] = y0;
+
+        return y0;
+    }
+
+    // Feed numSamples input values from inputData into the filter, writing
+    // the output values into outputData. The two may be the same array.
+    template <typename InputSample, typename OutputSample>
+    void process(const InputSample *inputData, OutputSample *outputData, int numSamples) {
+        for (int i = 0; i < numSamples; i++) {
+            outputData[i] = feed(inputData[i]);
         }
-        y[0] = y0;
-        return y[0];
     }
 
 private:
@@ -85,10 +108,15 @@ private:
     std::array<double, bOrder> b;
     // Feedback (output) coefficients
     std::array<double, aOrder> a;
-    // History of input values
-    std::array<double, bOrder> x;
-    // History of output values
-    std::array<double, aOrder> y;
+
+    // History of input and output values. These are ring buffers, most
+    // recent value first, starting at xPos/yPos. Each value is stored twice,
+    // so the history can always be read as a contiguous array without
+    // wrapping around or shifting values along.
+    std::array<double, 2 * bOrder> x;
+    std::array<double, 2 * aOrder> y;
+    unsigned xPos;
+    unsigned yPos;
 };
 
 #endif // IIRFILTER_H
@@ -25,12 +25,14 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 using std::array;
@@ -40,6 +42,7 @@ using std::string;
 using std::to_string;
 using std::vector;
 
+#include "coringfilter.h"
 #include "deemp.h"
 #include "firfilter.h"
 
@@ -106,14 +109,26 @@ void testIIRFilter(const char *name, FN& fn, FO& fo)
 {
     cerr << "Testing IIRFilter: " << name << "\n";
 
+    // Process the same input as a block with a copy of the filter
+    FN fp(fn);
+    vector<double> inputs, outputs(100);
     for (int i = 0; i < 100; ++i) {
-        double input = i - 40;
+        inputs.push_back(i - 40);
+    }
+    fp.process(inputs.data(), outputs.data(), inputs.size());
+
+    for (int i = 0; i < 100; ++i) {
+        double input = inputs[i];
         double out_n = fn.feed(input);
         double out_o = fo.feed(input);
         if (fabs(out_n - out_o) > 0.000001) {
             cerr << "Mismatch on " << name << " at " << i << ": " << input << " -> " << out_n << ", " << out_o << "\n";
             exit(1);
         }
+        if (outputs[i] != out_n) {
+            cerr << "Mismatch on " << name << " process at " << i << ": " << input << " -> " << outputs[i] << ", " << out_n << "\n";
+            exit(1);
+        }
     }
 }
 
@@ -235,6 +250,34 @@ void testFIRCoeffs(const string &name, const Coeffs &coeffs)
     fill(output.begin(), output.end(), 0);
     f.apply(input16, output);
     testFIRFilter(name + " int16_t->double", input16, output, coeffs);
+
+    // Vectors longer than the block size for in-place filtering
+
+    vector<double> longInput, longOutput(1000);
+    for (int i = 0; i < 1000; i++) {
+        longInput.push_back(((i * 37) % 101) - 50);
+    }
+
+    f.apply(longInput, longOutput);
+    testFIRFilter(name + " long double separate", longInput, longOutput, coeffs);
+
+    longOutput = longInput;
+    f.apply(longOutput.data(), longOutput.size());
+    testFIRFilter(name + " long double in-place", longInput, longOutput, coeffs);
+
+    // float vectors, with float coefficients
+
+    array<float, std::tuple_size<Coeffs>::value> floatCoeffs;
+    std::copy(coeffs.begin(), coeffs.end(), floatCoeffs.begin());
+    const auto ff = makeFIRFilter(floatCoeffs);
+
+    vector<float> inputF(longInput.begin(), longInput.end()), outputF(longInput.size());
+    ff.apply(inputF, outputF);
+    testFIRFilter(name + " float separate", inputF, outputF, floatCoeffs, 0.001);
+
+    outputF = inputF;
+    ff.apply(outputF);
+    testFIRFilter(name + " float in-place", inputF, outputF, floatCoeffs, 0.001);
 }
 
 // Test FIRFilter
@@ -253,10 +296,138 @@ void testFIRFilters()
     testFIRCoeffs("a500_44k", c_a500_44k_b);
 }
 
-int main()
+// Check that CoringFilter's output matches the original implementation of
+// coring using IIRFilter, for a set of coefficients
+template <typename Coeffs, typename Filter>
+void testCoringCoeffs(const string &name, const Coeffs &coeffs, const Filter &refFilterProto)
+{
+    const auto f = makeCoringFilter(coeffs);
+    const int delay = coeffs.size() / 2;
+
+    // Lengths around the block size, and a typical line length
+    for (int length : {0, 1, 2, 3, delay, delay + 1, 2 * delay + 1, 100, 255, 256, 257, 511, 512, 513, 922}) {
+        cerr << "Testing CoringFilter: " << name << " length " << length << "\n";
+
+        // A mixture of small and large high-frequency detail
+        vector<double> input(length);
+        for (int i = 0; i < length; i++) {
+            input[i] = 1000.0 + (((i * 7919) % 200) - 100) * ((i % 37) < 18 ? 0.1 : 10.0);
+        }
+        const double level = 5.0;
+
+        vector<double> output = input;
+        f.apply(output.data(), length, level);
+
+        // Reference: feed zeros either side, and compensate for the delay
+        auto refFilter(refFilterProto);
+        vector<double> hp(length + delay);
+        for (int i = 0; i < delay; i++) {
+            refFilter.feed(0.0);
+        }
+        for (int i = 0; i < length; i++) {
+            hp[i] = refFilter.feed(input[i]);
+        }
+        for (int i = length; i < length + delay; i++) {
+            hp[i] = refFilter.feed(0.0);
+        }
+
+        for (int i = 0; i < length; i++) {
+            double a = hp[i + delay];
+            if (fabs(a) > level) {
+                a = (a > 0) ? level : -level;
+            }
+            const double expected = input[i] - a;
+
+            if (fabs(output[i] - expected) > 0.000001) {
+                cerr << "Mismatch on " << name << " at " << i << ": " << input[i] << " -> " << output[i] << ", " << expected << "\n";
+                exit(1);
+            }
+        }
+    }
+}
+
+// Test CoringFilter for the sets of coefficients used in the code
+void testCoringFilters()
+{
+    testCoringCoeffs("nr", c_nr_b, f_nr);
+    testCoringCoeffs("nrc", c_nrc_b, f_nrc);
+    testCoringCoeffs("nrpal", c_nrpal_b, f_nrpal);
+}
+
+// Report how fast a filter function runs over a typical line
+template <typename Func>
+void benchmark(const string &name, Func func)
+{
+    using std::chrono::steady_clock;
+
+    const int lineLength = 1135;
+    const int numLines = 20000;
+
+    const auto startTime = steady_clock::now();
+    for (int i = 0; i < numLines; i++) {
+        func(lineLength);
+    }
+    const double seconds = std::chrono::duration<double>(steady_clock::now() - startTime).count();
+
+    cerr << name << ": " << (lineLength * static_cast<double>(numLines) / seconds / 1e6) << " Msamples/sec\n";
+}
+
+// Measure the throughput of the filters
+void benchmarkFilters()
+{
+    vector<double> input(1135), output(1135);
+    for (unsigned i = 0; i < input.size(); i++) {
+        input[i] = ((i * 37) % 101) - 50;
+    }
+    vector<float> inputF(input.begin(), input.end()), outputF(input.size());
+    vector<uint16_t> input16(input.size()), output16(input.size());
+    for (unsigned i = 0; i < input.size(); i++) {
+        input16[i] = 32768 + (i * 37) % 1001;
+    }
+
+    const auto colorlp = makeFIRFilter(c_colorlp_b);
+    benchmark("FIRFilter colorlp double separate", [&](int n) {
+        colorlp.apply(input.data(), output.data(), n);
+    });
+    benchmark("FIRFilter colorlp double in-place", [&](int n) {
+        colorlp.apply(output.data(), n);
+    });
+    benchmark("FIRFilter colorlp uint16_t in-place", [&](int n) {
+        colorlp.apply(output16.data(), n);
+    });
+
+    array<float, 17> colorlpFloatCoeffs;
+    std::copy(c_colorlp_b.begin(), c_colorlp_b.end(), colorlpFloatCoeffs.begin());
+    const auto colorlpFloat = makeFIRFilter(colorlpFloatCoeffs);
+    benchmark("FIRFilter colorlp float separate", [&](int n) {
+        colorlpFloat.apply(inputF.data(), outputF.data(), n);
+    });
+
+    auto nrIIR(f_nr);
+    benchmark("IIRFilter nr process", [&](int n) {
+        nrIIR.process(input.data(), output.data(), n);
+    });
+    auto a500IIR(f_a500_48k);
+    benchmark("IIRFilter a500_48k process", [&](int n) {
+        a500IIR.process(input.data(), output.data(), n);
+    });
+
+    const auto nrCoring = makeCoringFilter(c_nr_b);
+    benchmark("CoringFilter nr", [&](int n) {
+        nrCoring.apply(output.data(), n, 5.0);
+    });
+}
+
+int main(int argc, char *argv[])
 {
     testIIRFilters();
     testFIRFilters();
+    testCoringFilters();
+
+    // Run the benchmarks if asked to
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        benchmarkFilters();
+    }
 
     return 0;
 }
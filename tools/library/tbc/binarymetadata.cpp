@@ -0,0 +1,715 @@
+/************************************************************************
+
+    binarymetadata.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "binarymetadata.h"
+
+#include "jsonio.h"
+
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using Field = LdDecodeMetaData::Field;
+
+// File layout constants
+static const char FILE_MAGIC[8] = { 'L', 'D', 'M', 'E', 'T', 'A', '\x1a', '\n' };
+static constexpr quint32 FILE_VERSION = 1;
+static constexpr qint64 HEADER_SIZE = 64;
+static constexpr qint64 DIRECTORY_ENTRY_SIZE = 24;
+static constexpr qint32 MIN_PARAMETERS_CAPACITY = 4096;
+
+// Offsets of the header members
+static constexpr qint64 HEADER_VERSION = 8;
+static constexpr qint64 HEADER_NUMBER_OF_COLUMNS = 12;
+static constexpr qint64 HEADER_NUMBER_OF_FIELDS = 16;
+static constexpr qint64 HEADER_NUMBER_OF_DROPOUTS = 24;
+static constexpr qint64 HEADER_PARAMETERS_OFFSET = 32;
+static constexpr qint64 HEADER_PARAMETERS_LENGTH = 40;
+static constexpr qint64 HEADER_PARAMETERS_CAPACITY = 44;
+
+// Sizes of the drop-out records
+static constexpr quint32 DROPOUT_INDEX_SIZE = 8;
+static constexpr quint32 DROPOUT_TABLE_SIZE = 12;
+
+// Little-endian encoding helpers
+static inline void putBool(uchar *out, bool value) { *out = value ? 1 : 0; }
+static inline bool getBool(const uchar *in) { return *in != 0; }
+static inline void putInt32(uchar *out, qint32 value) { qToLittleEndian<qint32>(value, out); }
+static inline qint32 getInt32(const uchar *in) { return qFromLittleEndian<qint32>(in); }
+static inline void putInt64(uchar *out, qint64 value) { qToLittleEndian<qint64>(value, out); }
+static inline qint64 getInt64(const uchar *in) { return qFromLittleEndian<qint64>(in); }
+
+static inline void putDouble(uchar *out, double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, out);
+}
+
+static inline double getDouble(const uchar *in)
+{
+    const quint64 bits = qFromLittleEndian<quint64>(in);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static constexpr qint64 alignSize(qint64 size)
+{
+    return (size + 7) & ~static_cast<qint64>(7);
+}
+
+// Encoder and decoder for one fixed-size per-field column
+struct FieldCodec {
+    quint32 elementSize;
+    void (*encode)(uchar *out, const Field &field);
+    void (*decode)(const uchar *in, Field &field);
+};
+
+// Codecs for the per-field columns, indexed by Column
+static const FieldCodec FIELD_CODECS[BinaryMetaData::DROPOUT_INDEX] = {
+    // SEQ_NO
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.seqNo); },
+         [](const uchar *in, Field &field) { field.seqNo = getInt32(in); } },
+    // IS_FIRST_FIELD
+    { 1, [](uchar *out, const Field &field) { putBool(out, field.isFirstField); },
+         [](const uchar *in, Field &field) { field.isFirstField = getBool(in); } },
+    // SYNC_CONF
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.syncConf); },
+         [](const uchar *in, Field &field) { field.syncConf = getInt32(in); } },
+    // MEDIAN_BURST_IRE
+    { 8, [](uchar *out, const Field &field) { putDouble(out, field.medianBurstIRE); },
+         [](const uchar *in, Field &field) { field.medianBurstIRE = getDouble(in); } },
+    // FIELD_PHASE_ID
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.fieldPhaseID); },
+         [](const uchar *in, Field &field) { field.fieldPhaseID = getInt32(in); } },
+    // AUDIO_SAMPLES
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.audioSamples); },
+         [](const uchar *in, Field &field) { field.audioSamples = getInt32(in); } },
+    // PAD
+    { 1, [](uchar *out, const Field &field) { putBool(out, field.pad); },
+         [](const uchar *in, Field &field) { field.pad = getBool(in); } },
+    // DISK_LOC
+    { 8, [](uchar *out, const Field &field) { putDouble(out, field.diskLoc); },
+         [](const uchar *in, Field &field) { field.diskLoc = getDouble(in); } },
+    // FILE_LOC
+    { 8, [](uchar *out, const Field &field) { putInt64(out, field.fileLoc); },
+         [](const uchar *in, Field &field) { field.fileLoc = getInt64(in); } },
+    // DECODE_FAULTS
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.decodeFaults); },
+         [](const uchar *in, Field &field) { field.decodeFaults = getInt32(in); } },
+    // EFM_T_VALUES
+    { 4, [](uchar *out, const Field &field) { putInt32(out, field.efmTValues); },
+         [](const uchar *in, Field &field) { field.efmTValues = getInt32(in); } },
+    // VITS_METRICS: inUse, wSNR, bPSNR
+    { 17, [](uchar *out, const Field &field) {
+              putBool(out, field.vitsMetrics.inUse);
+              putDouble(out + 1, field.vitsMetrics.wSNR);
+              putDouble(out + 9, field.vitsMetrics.bPSNR);
+          },
+          [](const uchar *in, Field &field) {
+              field.vitsMetrics.inUse = getBool(in);
+              field.vitsMetrics.wSNR = getDouble(in + 1);
+              field.vitsMetrics.bPSNR = getDouble(in + 9);
+          } },
+    // VBI: inUse, vbiData[3]
+    { 13, [](uchar *out, const Field &field) {
+              putBool(out, field.vbi.inUse);
+              for (qint32 i = 0; i < 3; i++) putInt32(out + 1 + (4 * i), field.vbi.vbiData[i]);
+          },
+          [](const uchar *in, Field &field) {
+              field.vbi.inUse = getBool(in);
+              for (qint32 i = 0; i < 3; i++) field.vbi.vbiData[i] = getInt32(in + 1 + (4 * i));
+          } },
+    // NTSC: flags (inUse, isFmCodeDataValid, fieldFlag, isVideoIdDataValid, whiteFlag), fmCodeData, videoIdData
+    { 9, [](uchar *out, const Field &field) {
+             const LdDecodeMetaData::Ntsc &ntsc = field.ntsc;
+             *out = (ntsc.inUse ? 0x01 : 0) | (ntsc.isFmCodeDataValid ? 0x02 : 0) | (ntsc.fieldFlag ? 0x04 : 0)
+                    | (ntsc.isVideoIdDataValid ? 0x08 : 0) | (ntsc.whiteFlag ? 0x10 : 0);
+             putInt32(out + 1, ntsc.fmCodeData);
+             putInt32(out + 5, ntsc.videoIdData);
+         },
+         [](const uchar *in, Field &field) {
+             LdDecodeMetaData::Ntsc &ntsc = field.ntsc;
+             ntsc.inUse = (*in & 0x01) != 0;
+             ntsc.isFmCodeDataValid = (*in & 0x02) != 0;
+             ntsc.fieldFlag = (*in & 0x04) != 0;
+             ntsc.isVideoIdDataValid = (*in & 0x08) != 0;
+             ntsc.whiteFlag = (*in & 0x10) != 0;
+             ntsc.fmCodeData = getInt32(in + 1);
+             ntsc.videoIdData = getInt32(in + 5);
+         } },
+    // VITC: inUse, vitcData[8] (zero when not in use)
+    { 33, [](uchar *out, const Field &field) {
+              putBool(out, field.vitc.inUse);
+              for (qint32 i = 0; i < 8; i++) putInt32(out + 1 + (4 * i), field.vitc.inUse ? field.vitc.vitcData[i] : 0);
+          },
+          [](const uchar *in, Field &field) {
+              field.vitc.inUse = getBool(in);
+              for (qint32 i = 0; i < 8; i++) field.vitc.vitcData[i] = getInt32(in + 1 + (4 * i));
+          } },
+    // CLOSED_CAPTION: inUse, data0, data1
+    { 9, [](uchar *out, const Field &field) {
+             putBool(out, field.closedCaption.inUse);
+             putInt32(out + 1, field.closedCaption.data0);
+             putInt32(out + 5, field.closedCaption.data1);
+         },
+         [](const uchar *in, Field &field) {
+             field.closedCaption.inUse = getBool(in);
+             field.closedCaption.data0 = getInt32(in + 1);
+             field.closedCaption.data1 = getInt32(in + 5);
+         } },
+};
+
+// Return the size of one record in a column
+static quint32 getElementSize(quint32 column)
+{
+    if (column < BinaryMetaData::DROPOUT_INDEX) return FIELD_CODECS[column].elementSize;
+    if (column == BinaryMetaData::DROPOUT_INDEX) return DROPOUT_INDEX_SIZE;
+    return DROPOUT_TABLE_SIZE;
+}
+
+// Return the number of records in a column
+static qint64 getElementCount(quint32 column, qint64 numberOfFields, qint64 numberOfDropOuts)
+{
+    if (column < BinaryMetaData::DROPOUT_INDEX) return numberOfFields;
+    if (column == BinaryMetaData::DROPOUT_INDEX) return numberOfFields + 1;
+    return numberOfDropOuts;
+}
+
+// Encode the video and PCM audio parameters as a JSON object
+static QByteArray encodeParameters(const LdDecodeMetaData::VideoParameters &videoParameters,
+                                   const LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters)
+{
+    std::ostringstream stream;
+    {
+        JsonWriter writer(stream);
+
+        writer.beginObject();
+
+        // Keep members in alphabetical order
+        if (pcmAudioParameters.isValid) {
+            writer.writeMember("pcmAudioParameters");
+            pcmAudioParameters.write(writer);
+        }
+        writer.writeMember("videoParameters");
+        videoParameters.write(writer);
+
+        writer.endObject();
+    }
+
+    return QByteArray::fromStdString(stream.str());
+}
+
+namespace {
+
+// Collects encoded records and writes them to a file in large blocks,
+// keeping track of the file position so columns can be aligned
+class BlockWriter
+{
+public:
+    BlockWriter(QFileDevice &_file, qint64 _position)
+        : file(_file), position(_position), buffer(BLOCK_SIZE), used(0), ok(true) {}
+
+    // Return space for the next size bytes
+    uchar *reserve(qint32 size) {
+        if (used + size > BLOCK_SIZE) flush();
+        uchar *out = buffer.data() + used;
+        used += size;
+        position += size;
+        return out;
+    }
+
+    void write(const char *data, qint64 size) {
+        while (size > 0) {
+            const qint32 chunk = static_cast<qint32>(qMin<qint64>(size, BLOCK_SIZE));
+            memcpy(reserve(chunk), data, chunk);
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    // Zero-fill up to the given file position
+    void padTo(qint64 target) {
+        while (position < target) {
+            const qint32 chunk = static_cast<qint32>(qMin<qint64>(target - position, BLOCK_SIZE));
+            memset(reserve(chunk), 0, chunk);
+        }
+    }
+
+    bool flush() {
+        if (used > 0 && file.write(reinterpret_cast<const char *>(buffer.data()), used) != used) ok = false;
+        used = 0;
+        return ok;
+    }
+
+    static constexpr qint32 BLOCK_SIZE = 1024 * 1024;
+
+private:
+    QFileDevice &file;
+    qint64 position;
+    std::vector<uchar> buffer;
+    qint32 used;
+    bool ok;
+};
+
+}
+
+// Encode one column of the fields, padded to an 8-byte boundary
+static void writeColumn(BlockWriter &writer, qint64 columnOffset, quint32 column, const QVector<Field> &fields)
+{
+    qint64 count = 0;
+
+    if (column < BinaryMetaData::DROPOUT_INDEX) {
+        const FieldCodec &codec = FIELD_CODECS[column];
+        for (const Field &field : fields) codec.encode(writer.reserve(codec.elementSize), field);
+        count = fields.size();
+    } else if (column == BinaryMetaData::DROPOUT_INDEX) {
+        // Offset of each field's first drop-out in the table, plus the end of the table
+        qint64 index = 0;
+        putInt64(writer.reserve(DROPOUT_INDEX_SIZE), index);
+        for (const Field &field : fields) {
+            index += field.dropOuts.size();
+            putInt64(writer.reserve(DROPOUT_INDEX_SIZE), index);
+        }
+        count = fields.size() + 1;
+    } else {
+        for (const Field &field : fields) {
+            const DropOuts &dropOuts = field.dropOuts;
+            for (qint32 i = 0; i < dropOuts.size(); i++) {
+                uchar *out = writer.reserve(DROPOUT_TABLE_SIZE);
+                putInt32(out, dropOuts.startx(i));
+                putInt32(out + 4, dropOuts.endx(i));
+                putInt32(out + 8, dropOuts.fieldLine(i));
+            }
+            count += dropOuts.size();
+        }
+    }
+
+    writer.padTo(columnOffset + alignSize(count * getElementSize(column)));
+}
+
+BinaryMetaData::~BinaryMetaData()
+{
+    close();
+}
+
+// Return the size of one record in a per-field column
+quint32 BinaryMetaData::getRecordSize(Column column)
+{
+    return FIELD_CODECS[column].elementSize;
+}
+
+// Encode a field's record for a per-field column
+void BinaryMetaData::encodeRecord(Column column, const LdDecodeMetaData::Field &field, uchar *out)
+{
+    FIELD_CODECS[column].encode(out, field);
+}
+
+// Decode a field's record for a per-field column
+void BinaryMetaData::decodeRecord(Column column, const uchar *in, LdDecodeMetaData::Field &field)
+{
+    FIELD_CODECS[column].decode(in, field);
+}
+
+// Return true if the file starts with the binary metadata magic number
+bool BinaryMetaData::isBinaryFile(const QString &fileName)
+{
+    QFile inputFile(fileName);
+    if (!inputFile.open(QIODevice::ReadOnly)) return false;
+
+    char magic[sizeof(FILE_MAGIC)];
+    return inputFile.read(magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Return true if the file name indicates the binary format should be used
+bool BinaryMetaData::isBinaryFileName(const QString &fileName)
+{
+    return fileName.endsWith(".ldmeta", Qt::CaseInsensitive);
+}
+
+// Open a binary metadata file for reading
+bool BinaryMetaData::open(const QString &fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Opening binary metadata file failed:" << fileName;
+        return false;
+    }
+
+    // Map the file if possible, otherwise read it into memory
+    dataSize = file.size();
+    if (dataSize > 0) mappedData = file.map(0, dataSize);
+    if (mappedData != nullptr) {
+        data = mappedData;
+    } else {
+        fileData = file.readAll();
+        dataSize = fileData.size();
+        data = reinterpret_cast<const uchar *>(fileData.constData());
+    }
+
+    if (!parseHeader()) {
+        qCritical() << "Binary metadata file is invalid:" << fileName;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+// Close the file and release the data
+void BinaryMetaData::close()
+{
+    if (mappedData != nullptr) file.unmap(mappedData);
+    mappedData = nullptr;
+    file.close();
+    fileData.clear();
+    data = nullptr;
+    dataSize = 0;
+
+    numberOfFields = 0;
+    numberOfDropOuts = 0;
+    parametersOffset = 0;
+    parametersLength = 0;
+    for (ColumnEntry &entry : columns) entry = ColumnEntry();
+}
+
+// Check the header and locate the columns
+bool BinaryMetaData::parseHeader()
+{
+    if (dataSize < HEADER_SIZE || memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return false;
+
+    const quint32 version = qFromLittleEndian<quint32>(data + HEADER_VERSION);
+    if (version != FILE_VERSION) {
+        qCritical() << "Unsupported binary metadata version" << version;
+        return false;
+    }
+
+    const quint32 numberOfDirectoryEntries = qFromLittleEndian<quint32>(data + HEADER_NUMBER_OF_COLUMNS);
+    numberOfFields = getInt64(data + HEADER_NUMBER_OF_FIELDS);
+    numberOfDropOuts = getInt64(data + HEADER_NUMBER_OF_DROPOUTS);
+    parametersOffset = getInt64(data + HEADER_PARAMETERS_OFFSET);
+    parametersLength = qFromLittleEndian<quint32>(data + HEADER_PARAMETERS_LENGTH);
+
+    if (numberOfFields < 0 || numberOfFields > std::numeric_limits<qint32>::max()) return false;
+    if (numberOfDropOuts < 0) return false;
+    if (parametersOffset < HEADER_SIZE || parametersOffset > dataSize - parametersLength) return false;
+    if (numberOfDirectoryEntries > (dataSize - HEADER_SIZE) / DIRECTORY_ENTRY_SIZE) return false;
+
+    for (quint32 i = 0; i < numberOfDirectoryEntries; i++) {
+        const uchar *entry = data + HEADER_SIZE + (i * DIRECTORY_ENTRY_SIZE);
+        const quint32 column = qFromLittleEndian<quint32>(entry);
+        const quint32 elementSize = qFromLittleEndian<quint32>(entry + 4);
+        const qint64 offset = getInt64(entry + 8);
+        const qint64 count = getInt64(entry + 16);
+
+        // Ignore columns from newer versions of the format
+        if (column >= NUMBER_OF_COLUMNS) continue;
+
+        if (elementSize != getElementSize(column) || count != getElementCount(column, numberOfFields, numberOfDropOuts)) {
+            qWarning() << "Ignoring binary metadata column" << column << "with unexpected size";
+            continue;
+        }
+        if (offset < HEADER_SIZE || offset > dataSize || count > (dataSize - offset) / elementSize) return false;
+
+        columns[column].data = data + offset;
+        columns[column].count = count;
+    }
+
+    // The drop-out index is no use without the table, and vice versa
+    if (columns[DROPOUT_INDEX].data == nullptr || columns[DROPOUT_TABLE].data == nullptr) {
+        columns[DROPOUT_INDEX] = ColumnEntry();
+        columns[DROPOUT_TABLE] = ColumnEntry();
+    }
+
+    return true;
+}
+
+// Return the number of fields in the file
+qint32 BinaryMetaData::getNumberOfFields() const
+{
+    return static_cast<qint32>(numberOfFields);
+}
+
+// Read the video and PCM audio parameters
+bool BinaryMetaData::readParameters(LdDecodeMetaData::VideoParameters &videoParameters,
+                                    LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters) const
+{
+    if (data == nullptr || parametersLength == 0) return false;
+
+    try {
+        JsonReader reader(reinterpret_cast<const char *>(data + parametersOffset), static_cast<size_t>(parametersLength));
+
+        reader.beginObject();
+
+        std::string member;
+        while (reader.readMember(member)) {
+            if (member == "pcmAudioParameters") pcmAudioParameters.read(reader);
+            else if (member == "videoParameters") videoParameters.read(reader);
+            else reader.discard();
+        }
+
+        reader.endObject();
+    } catch (JsonReader::Error &error) {
+        qCritical() << "Parsing binary metadata parameters failed:" << error.what();
+        return false;
+    }
+
+    return true;
+}
+
+// Decode the drop-outs for a field
+void BinaryMetaData::readDropOuts(qint64 fieldIndex, DropOuts &dropOuts) const
+{
+    dropOuts.clear();
+    if (columns[DROPOUT_INDEX].data == nullptr) return;
+
+    const uchar *index = columns[DROPOUT_INDEX].data + (fieldIndex * DROPOUT_INDEX_SIZE);
+    const qint64 first = getInt64(index);
+    const qint64 last = getInt64(index + DROPOUT_INDEX_SIZE);
+    if (first < 0 || last < first || last > numberOfDropOuts) {
+        qWarning() << "Ignoring invalid drop-out index for field" << (fieldIndex + 1);
+        return;
+    }
+
+    dropOuts.reserve(static_cast<int>(last - first));
+    const uchar *in = columns[DROPOUT_TABLE].data + (first * DROPOUT_TABLE_SIZE);
+    for (qint64 i = first; i < last; i++) {
+        dropOuts.append(getInt32(in), getInt32(in + 4), getInt32(in + 8));
+        in += DROPOUT_TABLE_SIZE;
+    }
+}
+
+// Decode the metadata for a single field
+LdDecodeMetaData::Field BinaryMetaData::getField(qint32 sequentialFieldNumber) const
+{
+    Field field;
+
+    const qint64 fieldIndex = sequentialFieldNumber - 1;
+    if (fieldIndex < 0 || fieldIndex >= numberOfFields) {
+        qCritical() << "BinaryMetaData::getField(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        return field;
+    }
+
+    for (quint32 column = 0; column < DROPOUT_INDEX; column++) {
+        if (columns[column].data == nullptr) continue;
+        const FieldCodec &codec = FIELD_CODECS[column];
+        codec.decode(columns[column].data + (fieldIndex * codec.elementSize), field);
+    }
+    readDropOuts(fieldIndex, field.dropOuts);
+
+    return field;
+}
+
+// Decode the metadata for all fields, from the selected columns only
+void BinaryMetaData::readFields(QVector<LdDecodeMetaData::Field> &fields, quint32 columnsToRead) const
+{
+    fields.clear();
+    fields.resize(static_cast<qint32>(numberOfFields));
+
+    // Work through one column at a time
+    for (quint32 column = 0; column < DROPOUT_INDEX; column++) {
+        if (columns[column].data == nullptr || (columnsToRead & columnMask(static_cast<Column>(column))) == 0) continue;
+        const FieldCodec &codec = FIELD_CODECS[column];
+        const uchar *in = columns[column].data;
+        for (Field &field : fields) {
+            codec.decode(in, field);
+            in += codec.elementSize;
+        }
+    }
+
+    if ((columnsToRead & DROPOUT_COLUMNS) == 0) return;
+    for (qint32 fieldIndex = 0; fieldIndex < fields.size(); fieldIndex++) {
+        readDropOuts(fieldIndex, fields[fieldIndex].dropOuts);
+    }
+}
+
+// Write a complete binary metadata file
+bool BinaryMetaData::write(const QString &fileName,
+                           const LdDecodeMetaData::VideoParameters &videoParameters,
+                           const LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters,
+                           const QVector<LdDecodeMetaData::Field> &fields)
+{
+    const qint64 fieldCount = fields.size();
+    qint64 dropOutCount = 0;
+    for (const Field &field : fields) dropOutCount += field.dropOuts.size();
+
+    // Leave room in the parameters region for them to grow
+    const QByteArray parameters = encodeParameters(videoParameters, pcmAudioParameters);
+    const qint64 parametersCapacity = alignSize(qMax<qint64>(MIN_PARAMETERS_CAPACITY, 2 * parameters.size()));
+
+    // Lay out the parameters and columns after the header and directory
+    const qint64 parametersOffset = HEADER_SIZE + (NUMBER_OF_COLUMNS * DIRECTORY_ENTRY_SIZE);
+    qint64 columnOffsets[NUMBER_OF_COLUMNS];
+    qint64 offset = parametersOffset + parametersCapacity;
+    for (quint32 column = 0; column < NUMBER_OF_COLUMNS; column++) {
+        columnOffsets[column] = offset;
+        offset += alignSize(getElementCount(column, fieldCount, dropOutCount) * getElementSize(column));
+    }
+
+    QSaveFile outputFile(fileName);
+    if (!outputFile.open(QIODevice::WriteOnly)) {
+        qCritical() << "Opening binary metadata output file failed:" << fileName;
+        return false;
+    }
+
+    BlockWriter writer(outputFile, 0);
+
+    // Header
+    uchar *header = writer.reserve(HEADER_SIZE);
+    memset(header, 0, HEADER_SIZE);
+    memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    qToLittleEndian<quint32>(FILE_VERSION, header + HEADER_VERSION);
+    qToLittleEndian<quint32>(NUMBER_OF_COLUMNS, header + HEADER_NUMBER_OF_COLUMNS);
+    putInt64(header + HEADER_NUMBER_OF_FIELDS, fieldCount);
+    putInt64(header + HEADER_NUMBER_OF_DROPOUTS, dropOutCount);
+    putInt64(header + HEADER_PARAMETERS_OFFSET, parametersOffset);
+    qToLittleEndian<quint32>(parameters.size(), header + HEADER_PARAMETERS_LENGTH);
+    qToLittleEndian<quint32>(static_cast<quint32>(parametersCapacity), header + HEADER_PARAMETERS_CAPACITY);
+
+    // Column directory
+    for (quint32 column = 0; column < NUMBER_OF_COLUMNS; column++) {
+        uchar *entry = writer.reserve(DIRECTORY_ENTRY_SIZE);
+        qToLittleEndian<quint32>(column, entry);
+        qToLittleEndian<quint32>(getElementSize(column), entry + 4);
+        putInt64(entry + 8, columnOffsets[column]);
+        putInt64(entry + 16, getElementCount(column, fieldCount, dropOutCount));
+    }
+
+    // Parameters
+    writer.write(parameters.constData(), parameters.size());
+    writer.padTo(parametersOffset + parametersCapacity);
+
+    // Columns
+    for (quint32 column = 0; column < NUMBER_OF_COLUMNS; column++) {
+        writeColumn(writer, columnOffsets[column], column, fields);
+    }
+
+    if (!writer.flush() || !outputFile.commit()) {
+        qCritical() << "Writing binary metadata output file failed:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+// Rewrite selected per-field columns (and optionally the parameters) of an
+// existing file.  This only works if the file has the same number of fields
+// and the drop-outs haven't changed; returns false without modifying the file
+// if it can't be done, in which case the caller should use write().
+//
+// The rest of the file is copied as it is, which is much quicker than
+// encoding all the columns again.  The columns are patched in the copy, which
+// then replaces the original, so the file never has a mixture of old and new
+// columns.
+bool BinaryMetaData::updateColumns(const QString &fileName,
+                                   const LdDecodeMetaData::VideoParameters &videoParameters,
+                                   const LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters,
+                                   const QVector<LdDecodeMetaData::Field> &fields,
+                                   quint32 columnsToUpdate, bool updateParameters)
+{
+    if ((columnsToUpdate & DROPOUT_COLUMNS) != 0) return false;
+
+    QFile inputFile(fileName);
+    if (!inputFile.open(QIODevice::ReadOnly)) return false;
+
+    // Check the header matches
+    const QByteArray headerData = inputFile.read(HEADER_SIZE);
+    if (headerData.size() != HEADER_SIZE || memcmp(headerData.constData(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return false;
+    const uchar *header = reinterpret_cast<const uchar *>(headerData.constData());
+    if (qFromLittleEndian<quint32>(header + HEADER_VERSION) != FILE_VERSION) return false;
+    if (getInt64(header + HEADER_NUMBER_OF_FIELDS) != fields.size()) return false;
+
+    const quint32 numberOfDirectoryEntries = qFromLittleEndian<quint32>(header + HEADER_NUMBER_OF_COLUMNS);
+    const qint64 parametersOffset = getInt64(header + HEADER_PARAMETERS_OFFSET);
+    const quint32 parametersCapacity = qFromLittleEndian<quint32>(header + HEADER_PARAMETERS_CAPACITY);
+
+    // Find all the columns to be rewritten
+    const QByteArray directoryData = inputFile.read(numberOfDirectoryEntries * DIRECTORY_ENTRY_SIZE);
+    if (directoryData.size() != static_cast<qint64>(numberOfDirectoryEntries) * DIRECTORY_ENTRY_SIZE) return false;
+    qint64 columnOffsets[NUMBER_OF_COLUMNS];
+    quint32 columnsFound = 0;
+    for (quint32 i = 0; i < numberOfDirectoryEntries; i++) {
+        const uchar *entry = reinterpret_cast<const uchar *>(directoryData.constData()) + (i * DIRECTORY_ENTRY_SIZE);
+        const quint32 column = qFromLittleEndian<quint32>(entry);
+        if (column >= DROPOUT_INDEX || (columnsToUpdate & columnMask(static_cast<Column>(column))) == 0) continue;
+        if (qFromLittleEndian<quint32>(entry + 4) != getElementSize(column) || getInt64(entry + 16) != fields.size()) return false;
+
+        columnOffsets[column] = getInt64(entry + 8);
+        columnsFound |= columnMask(static_cast<Column>(column));
+    }
+    if (columnsFound != columnsToUpdate) return false;
+
+    // Check the parameters still fit
+    QByteArray parameters;
+    if (updateParameters) {
+        parameters = encodeParameters(videoParameters, pcmAudioParameters);
+        if (parameters.size() > static_cast<qint64>(parametersCapacity)) return false;
+    }
+
+    // Everything's OK -- copy the file
+    QSaveFile outputFile(fileName);
+    bool ok = inputFile.seek(0) && outputFile.open(QIODevice::WriteOnly);
+    QByteArray buffer;
+    while (ok && !inputFile.atEnd()) {
+        buffer = inputFile.read(BlockWriter::BLOCK_SIZE);
+        ok = !buffer.isEmpty() && outputFile.write(buffer) == buffer.size();
+    }
+    inputFile.close();
+
+    // Rewrite the columns in the copy
+    for (quint32 column = 0; column < DROPOUT_INDEX && ok; column++) {
+        if ((columnsToUpdate & columnMask(static_cast<Column>(column))) == 0) continue;
+
+        if (!outputFile.seek(columnOffsets[column])) {
+            ok = false;
+            break;
+        }
+        BlockWriter writer(outputFile, columnOffsets[column]);
+        writeColumn(writer, columnOffsets[column], column, fields);
+        ok = writer.flush();
+    }
+
+    if (ok && updateParameters) {
+        uchar length[4];
+        qToLittleEndian<quint32>(parameters.size(), length);
+        ok = outputFile.seek(parametersOffset)
+             && outputFile.write(parameters) == parameters.size()
+             && outputFile.seek(HEADER_PARAMETERS_LENGTH)
+             && outputFile.write(reinterpret_cast<const char *>(length), sizeof(length)) == sizeof(length);
+    }
+
+    // Replace the original file
+    if (!ok || !outputFile.commit()) {
+        qCritical() << "Updating binary metadata file failed:" << fileName;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,139 @@
+/************************************************************************
+
+    binarymetadata.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef BINARYMETADATA_H
+#define BINARYMETADATA_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "lddecodemetadata.h"
+
+// Column-oriented binary form of the TBC metadata.
+//
+// The file starts with a fixed header and a directory of columns.  Each
+// per-field column holds one fixed-size little-endian record per field, so
+// any field can be decoded straight from its field number, and a column can
+// be rewritten in place without touching the rest of the file.  Drop-outs
+// are variable-length, so they live in a separate table with a column of
+// offsets into it.  The video and PCM audio parameters are kept as JSON in a
+// reserved region after the directory.
+//
+// Files are always written as a new file that replaces the old one once it's
+// complete (with QSaveFile), so an interrupted write or update leaves the
+// previous version intact.
+class BinaryMetaData
+{
+public:
+    // Column identifiers -- these are stored in the file, so don't renumber
+    enum Column : quint32 {
+        SEQ_NO = 0,
+        IS_FIRST_FIELD,
+        SYNC_CONF,
+        MEDIAN_BURST_IRE,
+        FIELD_PHASE_ID,
+        AUDIO_SAMPLES,
+        PAD,
+        DISK_LOC,
+        FILE_LOC,
+        DECODE_FAULTS,
+        EFM_T_VALUES,
+        VITS_METRICS,
+        VBI,
+        NTSC,
+        VITC,
+        CLOSED_CAPTION,
+        DROPOUT_INDEX,
+        DROPOUT_TABLE,
+        NUMBER_OF_COLUMNS
+    };
+
+    // Masks for selecting sets of columns (one bit per Column)
+    static constexpr quint32 columnMask(Column column) {
+        return 1u << column;
+    }
+    static constexpr quint32 DROPOUT_COLUMNS = (1u << DROPOUT_INDEX) | (1u << DROPOUT_TABLE);
+    static constexpr quint32 ALL_COLUMNS = (1u << NUMBER_OF_COLUMNS) - 1;
+
+    BinaryMetaData() = default;
+    ~BinaryMetaData();
+
+    // Prevent copying
+    BinaryMetaData(const BinaryMetaData &) = delete;
+    BinaryMetaData& operator=(const BinaryMetaData &) = delete;
+
+    static bool isBinaryFile(const QString &fileName);
+    static bool isBinaryFileName(const QString &fileName);
+
+    // Random-access reading
+    bool open(const QString &fileName);
+    void close();
+    qint32 getNumberOfFields() const;
+    bool readParameters(LdDecodeMetaData::VideoParameters &videoParameters,
+                        LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters) const;
+    LdDecodeMetaData::Field getField(qint32 sequentialFieldNumber) const;
+    void readFields(QVector<LdDecodeMetaData::Field> &fields, quint32 columnsToRead = ALL_COLUMNS) const;
+
+    // Encoding of single records for the per-field columns (those before DROPOUT_INDEX)
+    static quint32 getRecordSize(Column column);
+    static void encodeRecord(Column column, const LdDecodeMetaData::Field &field, uchar *out);
+    static void decodeRecord(Column column, const uchar *in, LdDecodeMetaData::Field &field);
+
+    // Writing
+    static bool write(const QString &fileName,
+                      const LdDecodeMetaData::VideoParameters &videoParameters,
+                      const LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters,
+                      const QVector<LdDecodeMetaData::Field> &fields);
+    static bool updateColumns(const QString &fileName,
+                              const LdDecodeMetaData::VideoParameters &videoParameters,
+                              const LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters,
+                              const QVector<LdDecodeMetaData::Field> &fields,
+                              quint32 columns, bool updateParameters);
+
+private:
+    struct ColumnEntry {
+        const uchar *data = nullptr;
+        qint64 count = 0;
+    };
+
+    QFile file;
+    uchar *mappedData = nullptr;
+    QByteArray fileData;
+    const uchar *data = nullptr;
+    qint64 dataSize = 0;
+
+    qint64 numberOfFields = 0;
+    qint64 numberOfDropOuts = 0;
+    qint64 parametersOffset = 0;
+    qint64 parametersLength = 0;
+    ColumnEntry columns[NUMBER_OF_COLUMNS];
+
+    bool parseHeader();
+    void readDropOuts(qint64 fieldIndex, DropOuts &dropOuts) const;
+};
+
+#endif // BINARYMETADATA_H
@@ -0,0 +1,170 @@
+/************************************************************************
+
+    checkpoint.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "checkpoint.h"
+
+#include "jsonio.h"
+
+#include <QDebug>
+#include <QSaveFile>
+#include <sstream>
+
+// Version of the checkpoint format
+static constexpr int CHECKPOINT_VERSION = 1;
+
+// Return the name of the checkpoint for an output file
+QString Checkpoint::getCheckpointFileName(const QString &outputFileName)
+{
+    return outputFileName + ".checkpoint";
+}
+
+// Read a checkpoint.
+//
+// Returns true on success; on failure, prints a message and returns false.
+bool Checkpoint::read(const QString &fileName)
+{
+    QFile inputFile(fileName);
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        qCritical() << "Opening checkpoint file failed:" << fileName;
+        return false;
+    }
+    const QByteArray data = inputFile.readAll();
+    inputFile.close();
+
+    *this = Checkpoint();
+
+    int version = 0;
+    try {
+        JsonReader reader(data.constData(), static_cast<size_t>(data.size()));
+
+        reader.beginObject();
+
+        std::string member;
+        while (reader.readMember(member)) {
+            if (member == "counters") {
+                reader.beginObject();
+                std::string name;
+                while (reader.readMember(name)) {
+                    qint64 value;
+                    reader.read(value);
+                    counters.insert(QString::fromStdString(name), value);
+                }
+                reader.endObject();
+            }
+            else if (member == "job") reader.read(job);
+            else if (member == "nextNumber") reader.read(nextNumber);
+            else if (member == "outputSize") reader.read(outputSize);
+            else if (member == "version") reader.read(version);
+            else reader.discard();
+        }
+
+        reader.endObject();
+    } catch (JsonReader::Error &error) {
+        qCritical() << "Parsing checkpoint file failed:" << error.what();
+        return false;
+    }
+
+    if (version != CHECKPOINT_VERSION) {
+        qCritical() << "Checkpoint file has an unsupported version:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+// Write a checkpoint. The file is replaced atomically, so there is always a
+// complete checkpoint even if the process is killed while writing it.
+//
+// Returns true on success; on failure, prints a message and returns false.
+bool Checkpoint::write(const QString &fileName) const
+{
+    std::ostringstream output;
+    {
+        JsonWriter writer(output);
+
+        // Keep members in alphabetical order
+        writer.beginObject();
+        writer.writeMember("counters");
+        writer.beginObject();
+        for (auto it = counters.constBegin(); it != counters.constEnd(); ++it) {
+            writer.writeMember(it.key().toUtf8().constData(), it.value());
+        }
+        writer.endObject();
+        writer.writeMember("job", job);
+        writer.writeMember("nextNumber", nextNumber);
+        writer.writeMember("outputSize", outputSize);
+        writer.writeMember("version", CHECKPOINT_VERSION);
+        writer.endObject();
+    }
+    const std::string data = output.str();
+
+    QSaveFile outputFile(fileName);
+    if (!outputFile.open(QIODevice::WriteOnly)
+        || outputFile.write(data.data(), static_cast<qint64>(data.size())) != static_cast<qint64>(data.size())
+        || !outputFile.commit()) {
+        qCritical() << "Writing checkpoint file failed:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+// Remove a checkpoint, once the job it belongs to has finished
+bool Checkpoint::remove(const QString &fileName)
+{
+    if (QFile::exists(fileName) && !QFile::remove(fileName)) {
+        qCritical() << "Removing checkpoint file failed:" << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+// Open an output file to continue writing it from the checkpoint, discarding
+// anything that was written after the checkpoint.
+//
+// Returns true on success; on failure, prints a message and returns false.
+bool Checkpoint::openOutput(QFile &file) const
+{
+    if (!file.open(QIODevice::ReadWrite)) {
+        qCritical() << "Could not open" << file.fileName() << "to resume output";
+        return false;
+    }
+
+    // If the output is shorter than the checkpoint says, the data it refers
+    // to was never written, so there's nothing to resume from
+    if (file.size() < outputSize) {
+        qCritical() << "Output file" << file.fileName() << "is shorter than its checkpoint - cannot resume";
+        file.close();
+        return false;
+    }
+
+    if (!file.resize(outputSize) || !file.seek(outputSize)) {
+        qCritical() << "Could not truncate" << file.fileName() << "to resume output";
+        file.close();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+/************************************************************************
+
+    checkpoint.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QtGlobal>
+
+// The progress of a long-running processing tool, saved periodically so that
+// an interrupted run can be resumed.
+//
+// A checkpoint records the first frame (or field) that hasn't been completely
+// processed -- everything before it has been written -- and the length of
+// the output file at that point. Any partial metadata is kept in a
+// MetaDataJournal alongside the output metadata, which must be flushed before
+// the checkpoint is written.
+class Checkpoint
+{
+public:
+    // Minimum time between checkpoints, in milliseconds
+    static constexpr qint64 INTERVAL = 30000;
+
+    // Description of the job; a checkpoint can only be resumed by the same job
+    QString job;
+
+    // The first frame or field number that hasn't been processed
+    qint32 nextNumber = 1;
+
+    // The length of the output file, in bytes
+    qint64 outputSize = 0;
+
+    // Other state the tool needs to restore (e.g. statistics)
+    QMap<QString, qint64> counters;
+
+    static QString getCheckpointFileName(const QString &outputFileName);
+
+    bool read(const QString &fileName);
+    bool write(const QString &fileName) const;
+    static bool remove(const QString &fileName);
+
+    bool openOutput(QFile &file) const;
+};
+
+#endif // CHECKPOINT_H
@@ -24,10 +24,15 @@
 
 #include "jsonio.h"
 
-#include <limits>
+#include <QtAlgorithms>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
 #include <charconv>
 #else
+#include <cstdio>
 #include <sstream>
 #endif
 
@@ -43,8 +48,60 @@ static bool isAsciiDigit(char c)
     return c >= '0' && c <= '9';
 }
 
+// Skip JSON space characters, returning a pointer to the first non-space (or end)
+static const char *skipSpaces(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    // Test 16 characters at a time for the four space characters
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    while (end - p >= 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i isSpace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, space), _mm_cmpeq_epi8(chars, tab)),
+                                             _mm_or_si128(_mm_cmpeq_epi8(chars, newline), _mm_cmpeq_epi8(chars, carriageReturn)));
+        const unsigned int notSpace = ~static_cast<unsigned int>(_mm_movemask_epi8(isSpace)) & 0xFFFF;
+        if (notSpace != 0) return p + qCountTrailingZeroBits(notSpace);
+        p += 16;
+    }
+#endif
+
+    while (p != end && isAsciiSpace(*p)) ++p;
+    return p;
+}
+
+// Find the next " or \ in a string, returning a pointer to it (or end)
+static const char *findStringSpecial(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const unsigned int special = static_cast<unsigned int>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash))));
+        if (special != 0) return p + qCountTrailingZeroBits(special);
+        p += 16;
+    }
+#endif
+
+    while (p != end && *p != '"' && *p != '\\') ++p;
+    return p;
+}
+
+// Size of the blocks read from an input stream
+static constexpr size_t INPUT_BLOCK_SIZE = 1024 * 1024;
+
 JsonReader::JsonReader(std::istream &_input)
-    : input(_input), position(0), atStart(true)
+    : input(&_input), position(0), cur(nullptr), end(nullptr), pastEnd(0), atStart(true)
+{
+}
+
+// Read directly from memory (e.g. a mapped file). The data must remain valid
+// while the reader is in use.
+JsonReader::JsonReader(const char *data, size_t size)
+    : input(nullptr), position(0), cur(data), end(data + size), pastEnd(0), atStart(true)
 {
 }
 
@@ -201,30 +258,74 @@ void JsonReader::discard()
 // Get the next input character, returning 0 on EOF or error
 char JsonReader::get()
 {
-    char c;
-    input.get(c);
-    if (!input.good()) return 0;
+    if (cur == end && !fill()) {
+        ++pastEnd;
+        return 0;
+    }
     ++position;
-    return c;
+    return *cur++;
 }
 
 // Get the next input character, discarding spaces before it
 char JsonReader::spaceGet()
 {
-    char c;
-    do {
-        c = get();
-    } while (isAsciiSpace(c));
-    return c;
+    while (true) {
+        const char *p = skipSpaces(cur, end);
+        position += p - cur;
+        cur = p;
+
+        if (cur != end) break;
+        if (!fill()) {
+            ++pastEnd;
+            return 0;
+        }
+    }
+
+    ++position;
+    return *cur++;
 }
 
 // Put back an input character to be read again
 void JsonReader::unget()
 {
-    // We assume the input stream supports unget.
-    // (If this becomes a problem in the future, we could simulate it.)
-    input.unget();
-    --position;
+    if (pastEnd > 0) {
+        --pastEnd;
+    } else {
+        --cur;
+        --position;
+    }
+}
+
+// Read the next block of the input stream into the buffer, keeping any
+// unconsumed input and the last character consumed (so it can be ungot).
+// Returns false if there's no more input.
+bool JsonReader::fill()
+{
+    if (input == nullptr) return false;
+
+    size_t keepOffset = 0;
+    size_t keep = 0;
+    size_t ungetLength = 0;
+    if (cur != nullptr) {
+        keepOffset = cur - inputBuffer.data();
+        keep = end - cur;
+        if (keepOffset > 0) {
+            --keepOffset;
+            ++keep;
+            ungetLength = 1;
+        }
+    }
+
+    if (inputBuffer.size() < keep + INPUT_BLOCK_SIZE) inputBuffer.resize(keep + INPUT_BLOCK_SIZE);
+    if (keep != 0) std::memmove(inputBuffer.data(), inputBuffer.data() + keepOffset, keep);
+
+    // Read through the stream buffer, so the stream's state isn't changed at EOF
+    std::streamsize count = input->rdbuf()->sgetn(inputBuffer.data() + keep, INPUT_BLOCK_SIZE);
+    if (count < 0) count = 0;
+
+    cur = inputBuffer.data() + ungetLength;
+    end = inputBuffer.data() + keep + count;
+    return count > 0;
 }
 
 // Read a JSON string. The result is unescaped and doesn't include the quotes.
@@ -236,6 +337,12 @@ void JsonReader::readString(std::string &value)
     value.clear();
 
     while (true) {
+        // Copy everything up to the next " or \ in one go
+        const char *p = findStringSpecial(cur, end);
+        value.append(cur, p);
+        position += p - cur;
+        cur = p;
+
         c = get();
         switch (c) {
         case 0:
@@ -274,107 +381,163 @@ void JsonReader::readString(std::string &value)
             }
             break;
         default:
+            // The scan stopped at the end of the buffer
             value.push_back(c);
             break;
         }
     }
 }
-
-// Read a JSON number
-void JsonReader::readNumber(double &value)
+// Find the length of the JSON number at the current position, without
+// consuming it. isInteger is set if it has no fraction or exponent part.
+size_t JsonReader::scanNumber(bool &isInteger)
 {
     // JSON only has "numbers"; it doesn't distinguish between floating point
-    // and integers. This means we have to parse as a double, since a value
-    // we're expecting to use as an integer might be written as 1.234e3 or
-    // similar.
+    // and integers. A value we're expecting to use as an integer might be
+    // written as 1.234e3 or similar, so we note whether we only saw the int part.
 
     // Check that the number matches JSON's number syntax, which is more
     // restrictive than the C/C++ parsers accept.
 
-    // XXX could track if we only saw the int part, and parse straight to int
+    spaceGet();
+    unget();
 
-    buf.clear();
+    while (true) {
+        const char *p = cur;
+        auto peek = [&]() { return p != end ? *p : '\0'; };
+        auto fail = [&](const char *message) {
+            // Report the position after the unexpected character, as get() would
+            position += (p - cur) + (p != end ? 1 : 0);
+            throwError(message);
+        };
+
+        isInteger = true;
+
+        if (peek() == '-') ++p;
+        if (!isAsciiDigit(peek())) fail("expected - or digit");
+        ++p;
+        while (isAsciiDigit(peek())) ++p;
+
+        if (peek() == '.') {
+            isInteger = false;
+            ++p;
+            if (!isAsciiDigit(peek())) fail("expected digit after .");
+            while (isAsciiDigit(peek())) ++p;
+        }
 
-    char c = spaceGet();
-    if (c == '-') {
-        buf.push_back(c);
-        c = get();
-    }
-    if (!isAsciiDigit(c)) throwError("expected - or digit");
-    buf.push_back(c);
-    c = get();
+        if (peek() == 'e') {
+            isInteger = false;
+            ++p;
+            if (peek() == '-' || peek() == '+') ++p;
+            if (!isAsciiDigit(peek())) fail("expected digit after e");
+            while (isAsciiDigit(peek())) ++p;
+        }
 
-    while (isAsciiDigit(c)) {
-        buf.push_back(c);
-        c = get();
-    }
+        // If the number runs up to the end of the buffer, there may be more of
+        // it to come - read more input and scan it again. (fill moves the
+        // unconsumed input, so p isn't valid afterwards.)
+        const size_t length = p - cur;
+        if (p == end && fill()) continue;
 
-    if (c == '.') {
-        buf.push_back(c);
-        c = get();
-        if (!isAsciiDigit(c)) throwError("expected digit after .");
-        buf.push_back(c);
-        while (true) {
-            c = get();
-            if (!isAsciiDigit(c)) break;
-            buf.push_back(c);
-        }
+        return length;
     }
+}
 
-    if (c == 'e') {
-        buf.push_back(c);
-        c = get();
-        if (c == '-' || c == '+') {
-            buf.push_back(c);
-            c = get();
-        }
-        if (!isAsciiDigit(c)) throwError("expected digit after e");
-        buf.push_back(c);
-        while (true) {
-            c = get();
-            if (!isAsciiDigit(c)) break;
-            buf.push_back(c);
-        }
-    }
+// Read a JSON number
+void JsonReader::readNumber(double &value)
+{
+    bool isInteger;
+    const size_t length = scanNumber(isInteger);
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
     // Use the faster C++17 method if available.
-    std::from_chars(buf.data(), buf.data() + buf.size(), value);
+    std::from_chars(cur, cur + length, value);
 #else
-    std::istringstream(buf) >> value;
+    std::istringstream(std::string(cur, length)) >> value;
 #endif
 
+    cur += length;
+    position += length;
+}
+
+// Read a JSON number that's expected to be an integer
+void JsonReader::readInteger(qint64 &value)
+{
+    bool isInteger;
+    const size_t length = scanNumber(isInteger);
 
-    // We've read one character beyond the end of the number (there's no way to
-    // tell where the end is otherwise), so we must unget the last char
-    unget();
+    if (isInteger) {
+        // Parse integers directly, unless they're out of range
+#if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+        if (std::from_chars(cur, cur + length, value).ec == std::errc()) {
+#else
+        if (std::istringstream(std::string(cur, length)) >> value) {
+#endif
+            cur += length;
+            position += length;
+            return;
+        }
+    }
+
+    // Parse as a double, and round to the nearest integer
+    double d;
+    readNumber(d);
+    value = static_cast<qint64>(std::llround(d));
 }
 
+// Size of the blocks written to the output stream
+static constexpr size_t OUTPUT_BLOCK_SIZE = 1024 * 1024;
+
 JsonWriter::JsonWriter(std::ostream &_output)
     : output(_output), atStart(true)
 {
-    // Use maximum double precision for floating-point output
-    output.precision(std::numeric_limits<double>::digits10 + 1);
+    outputBuffer.reserve(OUTPUT_BLOCK_SIZE + 64);
+}
+
+JsonWriter::~JsonWriter()
+{
+    flush();
+}
+
+void JsonWriter::flush()
+{
+    if (outputBuffer.empty()) return;
+
+    output.write(outputBuffer.data(), outputBuffer.size());
+    outputBuffer.clear();
 }
 
 void JsonWriter::write(int value)
 {
-    output << value;
+    write(static_cast<qint64>(value));
 }
 
 void JsonWriter::write(qint64 value)
 {
-    output << value;
+    char number[24];
+#if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+    const char *numberEnd = std::to_chars(number, number + sizeof(number), value).ptr;
+#else
+    const char *numberEnd = number + std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+#endif
+    put(number, numberEnd - number);
 }
 
 void JsonWriter::write(double value)
 {
-    output << value;
+    // Write the shortest representation that reads back as the same value
+    char number[32];
+#if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+    const char *numberEnd = std::to_chars(number, number + sizeof(number), value).ptr;
+#else
+    const char *numberEnd = number + std::snprintf(number, sizeof(number), "%.17g", value);
+#endif
+    put(number, numberEnd - number);
 }
 
 void JsonWriter::write(bool value)
 {
-    output << (value ? "true" : "false");
+    if (value) put("true", 4);
+    else put("false", 5);
 }
 
 void JsonWriter::write(const char *value)
@@ -389,7 +552,7 @@ void JsonWriter::write(const QString &value)
 
 void JsonWriter::beginObject()
 {
-    output.put('{');
+    put('{');
 
     atStarts.push(atStart);
     atStart = true;
@@ -397,17 +560,17 @@ void JsonWriter::beginObject()
 
 void JsonWriter::writeMember(const char *member)
 {
-    if (!atStart) output.put(',');
+    if (!atStart) put(',');
 
     writeString(member);
-    output << ":";
+    put(':');
 
     atStart = false;
 }
 
 void JsonWriter::endObject()
 {
-    output.put('}');
+    put('}');
 
     atStart = atStarts.top();
     atStarts.pop();
@@ -415,7 +578,7 @@ void JsonWriter::endObject()
 
 void JsonWriter::beginArray()
 {
-    output.put('[');
+    put('[');
 
     atStarts.push(atStart);
     atStart = true;
@@ -423,50 +586,69 @@ void JsonWriter::beginArray()
 
 void JsonWriter::writeElement()
 {
-    if (!atStart) output.put(',');
+    if (!atStart) put(',');
 
     atStart = false;
 }
 
 void JsonWriter::endArray()
 {
-    output.put(']');
+    put(']');
 
     atStart = atStarts.top();
     atStarts.pop();
 }
 
+// Append a character to the output
+void JsonWriter::put(char c)
+{
+    outputBuffer.push_back(c);
+    if (outputBuffer.size() >= OUTPUT_BLOCK_SIZE) flush();
+}
+
+// Append a run of characters to the output
+void JsonWriter::put(const char *str, size_t length)
+{
+    outputBuffer.append(str, length);
+    if (outputBuffer.size() >= OUTPUT_BLOCK_SIZE) flush();
+}
+
 void JsonWriter::writeString(const char *str)
 {
-    output.put('"');
+    put('"');
 
-    while (char c = *str++) {
+    while (true) {
+        // Copy characters that don't need escaping in one go
+        const char *run = str;
+        while (*str != '\0' && *str != '"' && *str != '\\' && *str != '\b' &&
+               *str != '\f' && *str != '\n' && *str != '\r' && *str != '\t') ++str;
+        if (str != run) put(run, str - run);
+
+        const char c = *str++;
         switch (c) {
+        case '\0':
+            put('"');
+            return;
         case '"':
         case '\\':
-            output.put('\\');
-            output.put(c);
+            put('\\');
+            put(c);
             break;
         case '\b':
-            output << "\\b";
+            put("\\b", 2);
             break;
         case '\f':
-            output << "\\f";
+            put("\\f", 2);
             break;
         case '\n':
-            output << "\\n";
+            put("\\n", 2);
             break;
         case '\r':
-            output << "\\r";
+            put("\\r", 2);
             break;
         case '\t':
-            output << "\\t";
-            break;
-        default:
-            output.put(c);
+            put("\\t", 2);
             break;
         }
     }
-
-    output.put('"');
 }
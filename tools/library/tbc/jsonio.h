@@ -32,12 +32,14 @@
 #include <stdexcept>
 #include <string>
 #include <stack>
+#include <vector>
 #include <cmath>
 
 class JsonReader
 {
 public:
     JsonReader(std::istream &_input);
+    JsonReader(const char *data, size_t size);
 
     // Exception class to be thrown when parsing fails
     class Error : public std::runtime_error
@@ -80,20 +82,31 @@ private:
     char get();
     char spaceGet();
     void unget();
+    bool fill();
 
     void readString(std::string &value);
+    size_t scanNumber(bool &isInteger);
     void readNumber(double &value);
+    void readInteger(qint64 &value);
     template <typename T> void readSignedInteger(T& value) {
-        // Round to the nearest integer
-        double d;
-        readNumber(d);
-        value = static_cast<T>(std::llround(d));
+        qint64 i;
+        readInteger(i);
+        value = static_cast<T>(i);
     }
 
-    // The input stream
-    std::istream &input;
+    // The input stream (or nullptr if reading from memory)
+    std::istream *input;
     unsigned long position;
 
+    // The input is scanned from a buffer: either the caller's memory, or a
+    // block read from the input stream
+    std::vector<char> inputBuffer;
+    const char *cur;
+    const char *end;
+
+    // Number of reads past the end of the input that haven't been ungot
+    unsigned long pastEnd;
+
     // True if we're at the start of a { or [ construct
     bool atStart;
     std::stack<bool> atStarts;
@@ -106,6 +119,10 @@ class JsonWriter
 {
 public:
     JsonWriter(std::ostream &_output);
+    ~JsonWriter();
+
+    // Write any buffered output to the stream
+    void flush();
 
     // Numbers
     void write(int value);
@@ -135,11 +152,16 @@ public:
     void endArray();
 
 private:
+    void put(char c);
+    void put(const char *str, size_t length);
     void writeString(const char *str);
 
     // The output stream
     std::ostream &output;
 
+    // Output is collected here and written to the stream in large blocks
+    std::string outputBuffer;
+
     // True if we're at the start of a [ or { construct
     bool atStart;
     std::stack<bool> atStarts;
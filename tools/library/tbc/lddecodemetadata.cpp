@@ -26,8 +26,12 @@
 
 #include "lddecodemetadata.h"
 
+#include "binarymetadata.h"
 #include "jsonio.h"
+#include "metadatajournal.h"
 
+#include <QFile>
+#include <QFileInfo>
 #include <cassert>
 #include <fstream>
 
@@ -530,6 +534,11 @@ LdDecodeMetaData::LdDecodeMetaData()
     clear();
 }
 
+LdDecodeMetaData::~LdDecodeMetaData()
+{
+    closeJournal();
+}
+
 // Reset the metadata to the defaults
 void LdDecodeMetaData::clear()
 {
@@ -541,39 +550,26 @@ void LdDecodeMetaData::clear()
     pcmAudioParameters = PcmAudioParameters();
 
     fields.clear();
+    isFieldLoaded.clear();
+    binarySource.reset();
+
+    // Nothing has been read from a binary file yet
+    binaryFileName.clear();
+    modifiedColumns = 0;
+    isParametersModified = false;
 }
 
-// Read all metadata from a JSON file
+// Read all metadata from a JSON or binary file
 bool LdDecodeMetaData::read(QString fileName)
 {
-    std::ifstream jsonFile(fileName.toStdString());
-    if (jsonFile.fail()) {
-        qCritical("Opening JSON input file failed: JSON file cannot be opened/does not exist");
-        return false;
-    }
-
-    clear();
-
-    JsonReader reader(jsonFile);
-
-    try {
-        reader.beginObject();
-
-        std::string member;
-        while (reader.readMember(member)) {
-            if (member == "fields") readFields(reader);
-            else if (member == "pcmAudioParameters") pcmAudioParameters.read(reader);
-            else if (member == "videoParameters") videoParameters.read(reader);
-            else reader.discard();
-        }
-
-        reader.endObject();
-    } catch (JsonReader::Error &error) {
-        qCritical() << "Parsing JSON file failed:" << error.what();
-        return false;
+    if (BinaryMetaData::isBinaryFile(fileName)) {
+        if (!readBinary(fileName)) return false;
+    } else {
+        if (!readJson(fileName)) return false;
     }
 
-    jsonFile.close();
+    // Apply any updates that have been journalled since the file was written
+    if (!applyJournal(fileName)) return false;
 
     // Check we saw VideoParameters - if not, we can't do anything useful!
     if (!videoParameters.isValid) {
@@ -596,8 +592,155 @@ bool LdDecodeMetaData::read(QString fileName)
     return true;
 }
 
-// Write all metadata out to a JSON file
+// Read all metadata from a JSON file
+bool LdDecodeMetaData::readJson(QString fileName)
+{
+    // Parse regular files straight from a memory mapping; anything else
+    // (or a file that can't be mapped) is read as a stream
+    QFile mappedFile(fileName);
+    uchar *mappedData = nullptr;
+    qint64 mappedSize = 0;
+    if (QFileInfo(fileName).isFile() && mappedFile.open(QIODevice::ReadOnly)) {
+        mappedSize = mappedFile.size();
+        if (mappedSize > 0) mappedData = mappedFile.map(0, mappedSize);
+    }
+
+    std::ifstream jsonFile;
+    if (mappedData == nullptr) {
+        jsonFile.open(fileName.toStdString());
+        if (jsonFile.fail()) {
+            qCritical("Opening JSON input file failed: JSON file cannot be opened/does not exist");
+            return false;
+        }
+    }
+
+    clear();
+
+    try {
+        if (mappedData != nullptr) {
+            JsonReader reader(reinterpret_cast<const char *>(mappedData), static_cast<size_t>(mappedSize));
+            readMetaData(reader);
+        } else {
+            JsonReader reader(jsonFile);
+            readMetaData(reader);
+        }
+    } catch (JsonReader::Error &error) {
+        qCritical() << "Parsing JSON file failed:" << error.what();
+        return false;
+    }
+
+    if (mappedData != nullptr) mappedFile.unmap(mappedData);
+    mappedFile.close();
+    jsonFile.close();
+
+    return true;
+}
+
+// Read all metadata from a binary file.
+//
+// The file is kept open, and each field is only decoded when it's first
+// used. The exception is the audio sample counts, which are needed for every
+// field to build the PCM audio map.
+bool LdDecodeMetaData::readBinary(QString fileName)
+{
+    std::unique_ptr<BinaryMetaData> binaryMetaData(new BinaryMetaData);
+    if (!binaryMetaData->open(fileName)) return false;
+
+    clear();
+
+    if (!binaryMetaData->readParameters(videoParameters, pcmAudioParameters)) return false;
+    binaryMetaData->readFields(fields, BinaryMetaData::columnMask(BinaryMetaData::AUDIO_SAMPLES));
+    isFieldLoaded.fill(false, fields.size());
+    binarySource = std::move(binaryMetaData);
+
+    // Remember where the metadata came from, so changes can be written back in place
+    binaryFileName = fileName;
+
+    return true;
+}
+
+// Decode a field from the binary file, if it hasn't been already
+void LdDecodeMetaData::loadField(qint32 fieldIndex) const
+{
+    QMutexLocker locker(&loadMutex);
+
+    if (!binarySource || fieldIndex < 0 || fieldIndex >= isFieldLoaded.size() || isFieldLoaded[fieldIndex]) return;
+
+    fields[fieldIndex] = binarySource->getField(fieldIndex + 1);
+    isFieldLoaded[fieldIndex] = true;
+}
+
+// Decode all the fields that haven't been loaded yet, and close the binary
+// file (so it can be replaced)
+void LdDecodeMetaData::loadAllFields() const
+{
+    QMutexLocker locker(&loadMutex);
+
+    if (!binarySource) return;
+
+    for (qint32 fieldIndex = 0; fieldIndex < fields.size(); fieldIndex++) {
+        if (!isFieldLoaded[fieldIndex]) fields[fieldIndex] = binarySource->getField(fieldIndex + 1);
+    }
+
+    binarySource.reset();
+    isFieldLoaded.clear();
+}
+
+// Read the top-level metadata object from JSON
+void LdDecodeMetaData::readMetaData(JsonReader &reader)
+{
+    reader.beginObject();
+
+    std::string member;
+    while (reader.readMember(member)) {
+        if (member == "fields") readFields(reader);
+        else if (member == "pcmAudioParameters") pcmAudioParameters.read(reader);
+        else if (member == "videoParameters") videoParameters.read(reader);
+        else reader.discard();
+    }
+
+    reader.endObject();
+}
+
+// Write all metadata out to a file -- binary if the name ends in .ldmeta, otherwise JSON
 bool LdDecodeMetaData::write(QString fileName) const
+{
+    const bool success = BinaryMetaData::isBinaryFileName(fileName) ? writeBinary(fileName) : writeJson(fileName);
+    if (!success) return false;
+
+    // The file is now up to date, so any journal for it must be discarded
+    const QString journalFileName = MetaDataJournal::getJournalFileName(fileName);
+    if (journal && journal->getFileName() == journalFileName) {
+        if (!journal->truncate()) {
+            qCritical() << "Truncating metadata journal failed:" << journalFileName;
+            return false;
+        }
+    } else if (QFile::exists(journalFileName) && !QFile::remove(journalFileName)) {
+        qCritical() << "Removing metadata journal failed:" << journalFileName;
+        return false;
+    }
+
+    return true;
+}
+
+// Write all metadata out to a binary file
+bool LdDecodeMetaData::writeBinary(QString fileName) const
+{
+    loadAllFields();
+
+    // If this is the file the metadata was read from, and only fixed-size
+    // columns have changed, just rewrite those columns
+    if (fileName == binaryFileName && (modifiedColumns & BinaryMetaData::DROPOUT_COLUMNS) == 0
+        && BinaryMetaData::updateColumns(fileName, videoParameters, pcmAudioParameters, fields,
+                                         modifiedColumns, isParametersModified)) {
+        return true;
+    }
+
+    return BinaryMetaData::write(fileName, videoParameters, pcmAudioParameters, fields);
+}
+
+// Write all metadata out to a JSON file
+bool LdDecodeMetaData::writeJson(QString fileName) const
 {
     std::ofstream jsonFile(fileName.toStdString());
     if (jsonFile.fail()) {
@@ -620,8 +763,13 @@ bool LdDecodeMetaData::write(QString fileName) const
     videoParameters.write(writer);
 
     writer.endObject();
+    writer.flush();
 
     jsonFile.close();
+    if (jsonFile.fail()) {
+        qCritical("Writing JSON output file failed");
+        return false;
+    }
 
     return true;
 }
@@ -643,6 +791,8 @@ void LdDecodeMetaData::readFields(JsonReader &reader)
 // Write array of Fields to JSON
 void LdDecodeMetaData::writeFields(JsonWriter &writer) const
 {
+    loadAllFields();
+
     writer.beginArray();
 
     for (const Field &field : fields) {
@@ -665,6 +815,7 @@ void LdDecodeMetaData::setVideoParameters(const LdDecodeMetaData::VideoParameter
 {
     videoParameters = _videoParameters;
     videoParameters.isValid = true;
+    isParametersModified = true;
 }
 
 // This method returns the pcmAudioParameters metadata
@@ -679,6 +830,7 @@ void LdDecodeMetaData::setPcmAudioParameters(const LdDecodeMetaData::PcmAudioPar
 {
     pcmAudioParameters = _pcmAudioParameters;
     pcmAudioParameters.isValid = true;
+    isParametersModified = true;
 }
 
 // Based on the video system selected, set default values for the members of
@@ -780,6 +932,7 @@ const LdDecodeMetaData::Field &LdDecodeMetaData::getField(qint32 sequentialField
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getField(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber];
 }
@@ -791,6 +944,7 @@ const LdDecodeMetaData::VitsMetrics &LdDecodeMetaData::getFieldVitsMetrics(qint3
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].vitsMetrics;
 }
@@ -802,6 +956,7 @@ const LdDecodeMetaData::Vbi &LdDecodeMetaData::getFieldVbi(qint32 sequentialFiel
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldVbi(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].vbi;
 }
@@ -813,6 +968,7 @@ const LdDecodeMetaData::Ntsc &LdDecodeMetaData::getFieldNtsc(qint32 sequentialFi
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldNtsc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].ntsc;
 }
@@ -824,6 +980,7 @@ const LdDecodeMetaData::Vitc &LdDecodeMetaData::getFieldVitc(qint32 sequentialFi
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldVitc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].vitc;
 }
@@ -835,6 +992,7 @@ const LdDecodeMetaData::ClosedCaption &LdDecodeMetaData::getFieldClosedCaption(q
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldClosedCaption(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].closedCaption;
 }
@@ -846,6 +1004,7 @@ const DropOuts &LdDecodeMetaData::getFieldDropOuts(qint32 sequentialFieldNumber)
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::getFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     return fields[fieldNumber].dropOuts;
 }
@@ -857,8 +1016,10 @@ void LdDecodeMetaData::updateField(const LdDecodeMetaData::Field &field, qint32
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber] = field;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::ALL_COLUMNS);
 }
 
 // This method sets the field VBI metadata for a field
@@ -868,8 +1029,10 @@ void LdDecodeMetaData::updateFieldVitsMetrics(const LdDecodeMetaData::VitsMetric
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].vitsMetrics = vitsMetrics;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::columnMask(BinaryMetaData::VITS_METRICS));
 }
 
 // This method sets the field VBI metadata for a field
@@ -879,8 +1042,10 @@ void LdDecodeMetaData::updateFieldVbi(const LdDecodeMetaData::Vbi &vbi, qint32 s
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldVbi(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].vbi = vbi;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::columnMask(BinaryMetaData::VBI));
 }
 
 // This method sets the field NTSC metadata for a field
@@ -890,8 +1055,10 @@ void LdDecodeMetaData::updateFieldNtsc(const LdDecodeMetaData::Ntsc &ntsc, qint3
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldNtsc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].ntsc = ntsc;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::columnMask(BinaryMetaData::NTSC));
 }
 
 // This method sets the VITC metadata for a field
@@ -901,8 +1068,10 @@ void LdDecodeMetaData::updateFieldVitc(const LdDecodeMetaData::Vitc &vitc, qint3
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldVitc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].vitc = vitc;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::columnMask(BinaryMetaData::VITC));
 }
 
 // This method sets the Closed Caption metadata for a field
@@ -912,8 +1081,10 @@ void LdDecodeMetaData::updateFieldClosedCaption(const LdDecodeMetaData::ClosedCa
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldClosedCaption(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].closedCaption = closedCaption;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::columnMask(BinaryMetaData::CLOSED_CAPTION));
 }
 
 // This method sets the field dropout metadata for a field
@@ -923,8 +1094,10 @@ void LdDecodeMetaData::updateFieldDropOuts(const DropOuts &dropOuts, qint32 sequ
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::updateFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].dropOuts = dropOuts;
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::DROPOUT_COLUMNS);
 }
 
 // This method clears the field dropout metadata for a field
@@ -934,16 +1107,103 @@ void LdDecodeMetaData::clearFieldDropOuts(qint32 sequentialFieldNumber)
     if (fieldNumber < 0 || fieldNumber >= getNumberOfFields()) {
         qCritical() << "LdDecodeMetaData::clearFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
+    loadField(fieldNumber);
 
     fields[fieldNumber].dropOuts.clear();
+    fieldUpdated(sequentialFieldNumber, BinaryMetaData::DROPOUT_COLUMNS);
+}
+
+// Record that some columns of a field have been updated
+void LdDecodeMetaData::fieldUpdated(qint32 sequentialFieldNumber, quint32 columns)
+{
+    modifiedColumns |= columns;
+
+    if (journal) {
+        for (quint32 column = 0; column < BinaryMetaData::DROPOUT_INDEX; column++) {
+            if ((columns & BinaryMetaData::columnMask(static_cast<BinaryMetaData::Column>(column))) == 0) continue;
+            journal->append(sequentialFieldNumber, static_cast<BinaryMetaData::Column>(column), fields[sequentialFieldNumber - 1]);
+        }
+        if ((columns & BinaryMetaData::DROPOUT_COLUMNS) != 0) {
+            journal->append(sequentialFieldNumber, BinaryMetaData::DROPOUT_TABLE, fields[sequentialFieldNumber - 1]);
+        }
+    }
+}
+
+// Start recording updates to existing fields in the journal for a metadata
+// file, rather than having to write the whole file out again.  The journal
+// is applied when the file is next read, and discarded when the file is
+// written.
+bool LdDecodeMetaData::openJournal(QString fileName)
+{
+    closeJournal();
+
+    journal.reset(new MetaDataJournal);
+    if (!journal->open(MetaDataJournal::getJournalFileName(fileName))) {
+        journal.reset();
+        return false;
+    }
+
+    return true;
+}
+
+// Apply the updates recorded in the journal for a metadata file, if there is one
+bool LdDecodeMetaData::applyJournal(QString fileName)
+{
+    const QString journalFileName = MetaDataJournal::getJournalFileName(fileName);
+    if (!QFile::exists(journalFileName)) return true;
+
+    // The journal updates individual columns, so the rest of each field must
+    // be loaded first
+    loadAllFields();
+
+    quint32 journalColumns = 0;
+    qint64 numberOfRecords = 0;
+    if (!MetaDataJournal::replay(journalFileName, fields, journalColumns, numberOfRecords)) return false;
+    qInfo() << "Applied" << numberOfRecords << "updates from metadata journal" << journalFileName;
+    modifiedColumns |= journalColumns;
+
+    return true;
+}
+
+// Return true if updates are being recorded in a journal
+bool LdDecodeMetaData::isJournalOpen() const
+{
+    return static_cast<bool>(journal);
+}
+
+// Write any buffered updates out to the journal
+bool LdDecodeMetaData::flushJournal()
+{
+    if (!journal) return true;
+
+    if (!journal->flush()) {
+        qCritical() << "Writing metadata journal failed:" << journal->getFileName();
+        return false;
+    }
+
+    return true;
+}
+
+// Finish recording updates in the journal
+bool LdDecodeMetaData::closeJournal()
+{
+    if (!journal) return true;
+
+    const bool success = journal->close();
+    journal.reset();
+
+    return success;
 }
 
 // This method appends a new field to the existing metadata
 void LdDecodeMetaData::appendField(const LdDecodeMetaData::Field &field)
 {
     fields.append(field);
+    if (binarySource) isFieldLoaded.append(true);
+    modifiedColumns |= BinaryMetaData::ALL_COLUMNS;
 
     videoParameters.numberOfSequentialFields = fields.size();
+    isParametersModified = true;
 }
 
 // Method to get the available number of fields (according to the metadata)
@@ -957,6 +1217,7 @@ qint32 LdDecodeMetaData::getNumberOfFields()
 void LdDecodeMetaData::setNumberOfFields(qint32 numberOfFields)
 {
     videoParameters.numberOfSequentialFields = numberOfFields;
+    isParametersModified = true;
 }
 
 // A note about fields, frames and still-frames:
@@ -1218,7 +1479,8 @@ void LdDecodeMetaData::generatePcmAudioMap()
 
     for (qint32 fieldNo = 0; fieldNo < numberOfFields; fieldNo++) {
         // Each audio sample is 16 bit - and there are 2 samples per stereo pair
-        pcmAudioFieldLengthMap[fieldNo] = static_cast<qint32>(getField(fieldNo+1).audioSamples);
+        // (audioSamples is available without loading the whole field)
+        pcmAudioFieldLengthMap[fieldNo] = static_cast<qint32>(fields[fieldNo].audioSamples);
 
         if (fieldNo == 0) {
             // First field starts at 0 units
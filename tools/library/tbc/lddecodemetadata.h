@@ -27,16 +27,20 @@
 #ifndef LDDECODEMETADATA_H
 #define LDDECODEMETADATA_H
 
+#include <QMutex>
 #include <QString>
 #include <QVector>
 #include <QTemporaryFile>
 #include <QDebug>
 #include <array>
+#include <memory>
 
 #include "dropouts.h"
 
+class BinaryMetaData;
 class JsonReader;
 class JsonWriter;
+class MetaDataJournal;
 
 // The video system (combination of a line standard and a colour standard)
 // Note: If you update this, be sure to update VIDEO_SYSTEM_DEFAULTS also
@@ -219,6 +223,7 @@ public:
     };
 
     LdDecodeMetaData();
+    ~LdDecodeMetaData();
 
     // Prevent copying or assignment
     LdDecodeMetaData(const LdDecodeMetaData &) = delete;
@@ -227,6 +232,8 @@ public:
     void clear();
     bool read(QString fileName);
     bool write(QString fileName) const;
+    bool writeJson(QString fileName) const;
+    bool writeBinary(QString fileName) const;
     void readFields(JsonReader &reader);
     void writeFields(JsonWriter &writer) const;
 
@@ -260,6 +267,13 @@ public:
 
     void appendField(const Field &field);
 
+    // Journalling of field updates
+    bool applyJournal(QString fileName);
+    bool openJournal(QString fileName);
+    bool isJournalOpen() const;
+    bool flushJournal();
+    bool closeJournal();
+
     void setNumberOfFields(qint32 numberOfFields);
     qint32 getNumberOfFields();
     qint32 getNumberOfFrames();
@@ -283,10 +297,29 @@ private:
     bool isFirstFieldFirst;
     VideoParameters videoParameters;
     PcmAudioParameters pcmAudioParameters;
-    QVector<Field> fields;
+    // Fields read from a binary file are decoded from it when they're first
+    // used, so only fields that are needed are loaded.  Loading holds
+    // loadMutex, so threads can still read fields concurrently.
+    mutable QVector<Field> fields;
+    mutable QVector<bool> isFieldLoaded;
+    mutable std::unique_ptr<BinaryMetaData> binarySource;
+    mutable QMutex loadMutex;
     QVector<qint32> pcmAudioFieldStartSampleMap;
     QVector<qint32> pcmAudioFieldLengthMap;
 
+    // Changes since the metadata was read from a binary file (BinaryMetaData column mask)
+    QString binaryFileName;
+    quint32 modifiedColumns;
+    bool isParametersModified;
+
+    std::unique_ptr<MetaDataJournal> journal;
+
+    bool readJson(QString fileName);
+    bool readBinary(QString fileName);
+    void loadField(qint32 fieldIndex) const;
+    void loadAllFields() const;
+    void fieldUpdated(qint32 sequentialFieldNumber, quint32 columns);
+    void readMetaData(JsonReader &reader);
     void initialiseVideoSystemParameters();
     qint32 getFieldNumber(qint32 frameNumber, qint32 field);
     void generatePcmAudioMap();
@@ -0,0 +1,365 @@
+/************************************************************************
+
+    metadatajournal.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "metadatajournal.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QtEndian>
+#include <array>
+#include <cstring>
+
+using Field = LdDecodeMetaData::Field;
+
+// File layout constants
+static const char FILE_MAGIC[8] = { 'L', 'D', 'J', 'R', 'N', 'L', '\x1a', '\n' };
+static constexpr quint32 FILE_VERSION = 2;
+static constexpr qint64 HEADER_SIZE = 32;
+static constexpr qint64 BASE_SIZE_OFFSET = 16;
+static constexpr qint64 BASE_MODIFIED_OFFSET = 24;
+static constexpr qint64 RECORD_HEADER_SIZE = 8;
+static constexpr qint64 RECORD_CRC_SIZE = 4;
+static constexpr qint64 DROPOUT_SIZE = 12;
+
+// Buffered records are written out when the buffer reaches this size
+static constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+// CRC-32 (as used by zlib) of a block of data
+static quint32 crc32(const uchar *data, qint64 size)
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t {};
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 c = i;
+            for (qint32 bit = 0; bit < 8; bit++) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFF;
+    for (qint64 i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFF;
+}
+
+// Get the size and modification time of the metadata file a journal belongs
+// to, so the journal can't be applied to a different version of it.  If the
+// file doesn't exist yet (e.g. an output file that will be written at the
+// end of a run), the size is -1.
+static void getBaseFileInfo(const QString &journalFileName, qint64 &size, qint64 &modified)
+{
+    const QString baseFileName = journalFileName.left(journalFileName.size() - QString(".journal").size());
+    const QFileInfo info(baseFileName);
+    if (info.exists()) {
+        size = info.size();
+        modified = info.lastModified().toMSecsSinceEpoch();
+    } else {
+        size = -1;
+        modified = 0;
+    }
+}
+
+// Fill in a journal header for the current state of the metadata file
+static void makeHeader(const QString &journalFileName, uchar *header)
+{
+    qint64 baseSize, baseModified;
+    getBaseFileInfo(journalFileName, baseSize, baseModified);
+
+    memset(header, 0, HEADER_SIZE);
+    memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    qToLittleEndian<quint32>(FILE_VERSION, header + sizeof(FILE_MAGIC));
+    qToLittleEndian<qint64>(baseSize, header + BASE_SIZE_OFFSET);
+    qToLittleEndian<qint64>(baseModified, header + BASE_MODIFIED_OFFSET);
+}
+
+// Check that a journal was written against the metadata file as it is now
+static bool checkBaseFile(const QString &journalFileName, const uchar *data, qint64 size)
+{
+    if (size < HEADER_SIZE) return true;
+
+    qint64 baseSize, baseModified;
+    getBaseFileInfo(journalFileName, baseSize, baseModified);
+    if (qFromLittleEndian<qint64>(data + BASE_SIZE_OFFSET) != baseSize
+        || qFromLittleEndian<qint64>(data + BASE_MODIFIED_OFFSET) != baseModified) {
+        qCritical() << "Metadata journal" << journalFileName
+                    << "was written for a different version of the metadata file - remove the journal to continue";
+        return false;
+    }
+
+    return true;
+}
+
+MetaDataJournal::~MetaDataJournal()
+{
+    close();
+}
+
+// Return the name of the journal for a metadata file
+QString MetaDataJournal::getJournalFileName(const QString &metaDataFileName)
+{
+    return metaDataFileName + ".journal";
+}
+
+// Open a journal for appending, creating it if it doesn't exist.  Any
+// incomplete record at the end of an existing journal is discarded.
+bool MetaDataJournal::open(const QString &fileName)
+{
+    close();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qCritical() << "Opening metadata journal failed:" << fileName;
+        return false;
+    }
+
+    if (file.size() == 0) {
+        // New journal -- write the header
+        uchar header[HEADER_SIZE];
+        makeHeader(fileName, header);
+        if (file.write(reinterpret_cast<const char *>(header), HEADER_SIZE) != HEADER_SIZE) {
+            qCritical() << "Writing metadata journal failed:" << fileName;
+            file.close();
+            return false;
+        }
+    } else {
+        // Existing journal -- find the end of the last complete record
+        const QByteArray data = file.readAll();
+        quint32 columns = 0;
+        qint64 numberOfRecords = 0;
+        qint64 validSize = 0;
+        if (!parse(reinterpret_cast<const uchar *>(data.constData()), data.size(), nullptr,
+                   columns, numberOfRecords, validSize)) {
+            qCritical() << "Metadata journal is invalid:" << fileName;
+            file.close();
+            return false;
+        }
+        if (!checkBaseFile(fileName, reinterpret_cast<const uchar *>(data.constData()), data.size())) {
+            file.close();
+            return false;
+        }
+        if (validSize != data.size() && !file.resize(validSize)) {
+            qCritical() << "Truncating metadata journal failed:" << fileName;
+            file.close();
+            return false;
+        }
+        if (!file.seek(validSize)) {
+            qCritical() << "Seeking in metadata journal failed:" << fileName;
+            file.close();
+            return false;
+        }
+    }
+
+    buffer.clear();
+    ok = true;
+
+    return true;
+}
+
+// Return the name of the open journal
+QString MetaDataJournal::getFileName() const
+{
+    return file.fileName();
+}
+
+// Record the value of one column of a field.  DROPOUT_TABLE records the
+// field's complete drop-out list.
+void MetaDataJournal::append(qint32 sequentialFieldNumber, BinaryMetaData::Column column, const Field &field)
+{
+    const size_t start = buffer.size();
+
+    if (column == BinaryMetaData::DROPOUT_TABLE) {
+        const DropOuts &dropOuts = field.dropOuts;
+        buffer.resize(start + RECORD_HEADER_SIZE + 4 + (dropOuts.size() * DROPOUT_SIZE) + RECORD_CRC_SIZE);
+        uchar *out = buffer.data() + start + RECORD_HEADER_SIZE;
+        qToLittleEndian<qint32>(dropOuts.size(), out);
+        out += 4;
+        for (qint32 i = 0; i < dropOuts.size(); i++) {
+            qToLittleEndian<qint32>(dropOuts.startx(i), out);
+            qToLittleEndian<qint32>(dropOuts.endx(i), out + 4);
+            qToLittleEndian<qint32>(dropOuts.fieldLine(i), out + 8);
+            out += DROPOUT_SIZE;
+        }
+    } else {
+        buffer.resize(start + RECORD_HEADER_SIZE + BinaryMetaData::getRecordSize(column) + RECORD_CRC_SIZE);
+        BinaryMetaData::encodeRecord(column, field, buffer.data() + start + RECORD_HEADER_SIZE);
+    }
+
+    qToLittleEndian<qint32>(sequentialFieldNumber, buffer.data() + start);
+    qToLittleEndian<quint32>(column, buffer.data() + start + 4);
+
+    // Each record ends with a CRC, so damage can be detected when it's replayed
+    const qint64 crcPosition = static_cast<qint64>(buffer.size()) - RECORD_CRC_SIZE;
+    qToLittleEndian<quint32>(crc32(buffer.data() + start, crcPosition - start), buffer.data() + crcPosition);
+
+    if (buffer.size() >= FLUSH_SIZE) flush();
+}
+
+// Write any buffered records to the file
+bool MetaDataJournal::flush()
+{
+    if (!file.isOpen()) return false;
+
+    if (!buffer.empty()) {
+        const qint64 size = static_cast<qint64>(buffer.size());
+        if (file.write(reinterpret_cast<const char *>(buffer.data()), size) != size) ok = false;
+        buffer.clear();
+    }
+    if (!file.flush()) ok = false;
+
+    return ok;
+}
+
+// Discard all the records in the journal (once they have been merged into
+// the metadata file)
+bool MetaDataJournal::truncate()
+{
+    if (!file.isOpen()) return false;
+
+    buffer.clear();
+    if (!file.flush() || !file.resize(HEADER_SIZE) || !file.seek(0)) {
+        ok = false;
+        return ok;
+    }
+
+    // The metadata file has just been rewritten, so the records that follow
+    // will apply to its new version
+    uchar header[HEADER_SIZE];
+    makeHeader(file.fileName(), header);
+    if (file.write(reinterpret_cast<const char *>(header), HEADER_SIZE) != HEADER_SIZE || !file.flush()) ok = false;
+
+    return ok;
+}
+
+// Flush and close the journal
+bool MetaDataJournal::close()
+{
+    if (!file.isOpen()) return true;
+
+    const bool success = flush();
+    file.close();
+    buffer.clear();
+    if (!success) qCritical() << "Writing metadata journal failed:" << file.fileName();
+
+    return success;
+}
+
+// Apply the records in a journal to a set of fields.  columns is set to the
+// BinaryMetaData columns that were changed.
+bool MetaDataJournal::replay(const QString &fileName, QVector<Field> &fields,
+                             quint32 &columns, qint64 &numberOfRecords)
+{
+    QFile inputFile(fileName);
+    if (!inputFile.open(QIODevice::ReadOnly)) {
+        qCritical() << "Opening metadata journal failed:" << fileName;
+        return false;
+    }
+    const QByteArray data = inputFile.readAll();
+    inputFile.close();
+
+    if (!checkBaseFile(fileName, reinterpret_cast<const uchar *>(data.constData()), data.size())) return false;
+
+    qint64 validSize = 0;
+    if (!parse(reinterpret_cast<const uchar *>(data.constData()), data.size(), &fields,
+               columns, numberOfRecords, validSize)) {
+        qCritical() << "Metadata journal is invalid:" << fileName;
+        return false;
+    }
+    if (validSize != data.size()) {
+        qWarning() << "Ignoring incomplete or damaged records at the end of metadata journal" << fileName;
+    }
+
+    return true;
+}
+
+// Parse a journal, applying the records to fields if it isn't null.
+// validSize is set to the length of the complete records.
+bool MetaDataJournal::parse(const uchar *data, qint64 size, QVector<Field> *fields,
+                            quint32 &columns, qint64 &numberOfRecords, qint64 &validSize)
+{
+    columns = 0;
+    numberOfRecords = 0;
+    validSize = 0;
+
+    if (size < HEADER_SIZE || memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return false;
+    if (qFromLittleEndian<quint32>(data + sizeof(FILE_MAGIC)) != FILE_VERSION) return false;
+
+    qint64 position = HEADER_SIZE;
+    qint32 numberOfIgnoredRecords = 0;
+    while (size - position >= RECORD_HEADER_SIZE) {
+        const qint32 sequentialFieldNumber = qFromLittleEndian<qint32>(data + position);
+        const quint32 column = qFromLittleEndian<quint32>(data + position + 4);
+        const uchar *in = data + position + RECORD_HEADER_SIZE;
+        const qint64 available = size - position - RECORD_HEADER_SIZE;
+
+        // Work out the record's length
+        qint64 length;
+        if (column < BinaryMetaData::DROPOUT_INDEX) {
+            length = BinaryMetaData::getRecordSize(static_cast<BinaryMetaData::Column>(column));
+        } else if (column == BinaryMetaData::DROPOUT_TABLE) {
+            if (available < 4) break;
+            const qint32 count = qFromLittleEndian<qint32>(in);
+            if (count < 0) return false;
+            length = 4 + (count * DROPOUT_SIZE);
+        } else {
+            // Unknown column, so the rest of the journal can't be parsed
+            return false;
+        }
+        if (available < length + RECORD_CRC_SIZE) break;
+
+        // Stop at the first damaged record, as nothing after it can be trusted
+        if (qFromLittleEndian<quint32>(in + length) != crc32(data + position, RECORD_HEADER_SIZE + length)) break;
+
+        if (fields != nullptr) {
+            if (sequentialFieldNumber < 1 || sequentialFieldNumber > fields->size()) {
+                numberOfIgnoredRecords++;
+            } else {
+                Field &field = (*fields)[sequentialFieldNumber - 1];
+                if (column == BinaryMetaData::DROPOUT_TABLE) {
+                    const qint32 count = qFromLittleEndian<qint32>(in);
+                    field.dropOuts.clear();
+                    field.dropOuts.reserve(count);
+                    for (qint32 i = 0; i < count; i++) {
+                        const uchar *dropOut = in + 4 + (i * DROPOUT_SIZE);
+                        field.dropOuts.append(qFromLittleEndian<qint32>(dropOut), qFromLittleEndian<qint32>(dropOut + 4),
+                                              qFromLittleEndian<qint32>(dropOut + 8));
+                    }
+                    columns |= BinaryMetaData::DROPOUT_COLUMNS;
+                } else {
+                    BinaryMetaData::decodeRecord(static_cast<BinaryMetaData::Column>(column), in, field);
+                    columns |= BinaryMetaData::columnMask(static_cast<BinaryMetaData::Column>(column));
+                }
+            }
+        }
+
+        position += RECORD_HEADER_SIZE + length + RECORD_CRC_SIZE;
+        numberOfRecords++;
+    }
+    validSize = position;
+
+    if (numberOfIgnoredRecords > 0) {
+        qWarning() << "Ignored" << numberOfIgnoredRecords << "metadata journal records for fields that don't exist";
+    }
+
+    return true;
+}
@@ -0,0 +1,79 @@
+/************************************************************************
+
+    metadatajournal.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2026 ld-decode-tools contributors
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef METADATAJOURNAL_H
+#define METADATAJOURNAL_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <vector>
+
+#include "binarymetadata.h"
+#include "lddecodemetadata.h"
+
+// Append-only journal of changes to field metadata.
+//
+// Each record holds one column (in the BinaryMetaData encoding) of one field,
+// so tools that only update a few members of each field can save their
+// results without rewriting the whole metadata file.  Replaying the journal
+// over the metadata it belongs to brings that up to date; records are applied
+// in order, so later records take precedence.  An incomplete or damaged
+// record (e.g. from a crash), and everything after it, is ignored; each
+// record carries a CRC to detect damage.  The header records the size and
+// modification time of the metadata file, and a journal that doesn't match
+// the file is refused rather than applied to a different version of it.
+class MetaDataJournal
+{
+public:
+    MetaDataJournal() = default;
+    ~MetaDataJournal();
+
+    // Prevent copying
+    MetaDataJournal(const MetaDataJournal &) = delete;
+    MetaDataJournal& operator=(const MetaDataJournal &) = delete;
+
+    static QString getJournalFileName(const QString &metaDataFileName);
+
+    bool open(const QString &fileName);
+    QString getFileName() const;
+    void append(qint32 sequentialFieldNumber, BinaryMetaData::Column column, const LdDecodeMetaData::Field &field);
+    bool flush();
+    bool truncate();
+    bool close();
+
+    static bool replay(const QString &fileName, QVector<LdDecodeMetaData::Field> &fields,
+                       quint32 &columns, qint64 &numberOfRecords);
+
+private:
+    QFile file;
+    std::vector<uchar> buffer;
+    bool ok = true;
+
+    static bool parse(const uchar *data, qint64 size, QVector<LdDecodeMetaData::Field> *fields,
+                      quint32 &columns, qint64 &numberOfRecords, qint64 &validSize);
+};
+
+#endif // METADATAJOURNAL_H
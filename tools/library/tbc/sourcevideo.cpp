@@ -25,6 +25,7 @@
 #include "sourcevideo.h"
 
 #include <cstdio>
+#include <cstring>
 
 // Class constructor
 SourceVideo::SourceVideo()
@@ -36,6 +37,8 @@ SourceVideo::SourceVideo()
     fieldLength = -1;
     fieldByteLength = -1;
     fieldLineLength = -1;
+    mappedFile = nullptr;
+    mapAttempted = false;
 
     // Set up the cache
     fieldCache.setMaxCost(100);
@@ -43,7 +46,7 @@ SourceVideo::SourceVideo()
 
 SourceVideo::~SourceVideo()
 {
-    if (isSourceVideoOpen) inputFile.close();
+    if (isSourceVideoOpen) close();
 }
 
 // Source Video file manipulation methods -----------------------------------------------------------------------------
@@ -94,6 +97,8 @@ bool SourceVideo::open(QString filename, qint32 _fieldLength, qint32 _fieldLineL
 
     isSourceVideoOpen = true;
     inputFilePos = 0;
+    mappedFile = nullptr;
+    mapAttempted = false;
 
     return true;
 }
@@ -107,6 +112,10 @@ void SourceVideo::close()
     }
 
     qDebug() << "SourceVideo::close(): Called, closing the source video file and emptying the frame cache";
+    if (mappedFile != nullptr) {
+        inputFile.unmap(const_cast<uchar *>(mappedFile));
+        mappedFile = nullptr;
+    }
     inputFile.close();
     isSourceVideoOpen = false;
     inputFilePos = -1;
@@ -242,3 +251,106 @@ SourceVideo::Data SourceVideo::getVideoField(qint32 fieldNumber, qint32 startFie
 
 
 
+
+// Method to retrieve several ranges of field lines from a run of consecutive
+// video fields, e.g. just the VBI lines for a block of fields.
+//
+// The result contains the requested line ranges for the first field, in the
+// order given, followed by the same ranges for the next field, and so on.
+//
+// Where possible, the lines are copied directly from a memory mapping of the
+// input file, so only the pages containing the requested lines are read from
+// disk. Otherwise (e.g. when reading from stdin), this falls back to reading
+// each range in turn.
+SourceVideo::Data SourceVideo::getVideoFieldRanges(qint32 firstFieldNumber, qint32 numberOfFields,
+                                                   const std::vector<LineRange> &lineRanges)
+{
+    // Ensure source video is open
+    if (!isSourceVideoOpen) qFatal("Application requested TBC field before opening TBC file - Fatal error");
+    if (fieldLineLength == -1) qFatal("Application did not set field line length when opening TBC file");
+
+    // Work out the size of the output, and check the requested ranges are valid
+    qint64 linesPerField = 0;
+    for (const LineRange &range : lineRanges) {
+        if (range.startFieldLine < 1 || range.endFieldLine < range.startFieldLine
+            || static_cast<qint64>(range.endFieldLine) * fieldLineLength > fieldByteLength) {
+            qFatal("Application requested out-of-bounds field line");
+        }
+        linesPerField += range.endFieldLine - range.startFieldLine + 1;
+    }
+    const qint32 lineSamples = fieldLineLength / 2;
+
+    Data outputData;
+    outputData.resize(static_cast<qint32>(linesPerField * lineSamples * numberOfFields));
+
+    if (!mapInputFile()) {
+        // No mapping available - read each range in turn
+        quint16 *outputPointer = outputData.data();
+        for (qint32 field = 0; field < numberOfFields; field++) {
+            for (const LineRange &range : lineRanges) {
+                const Data rangeData = getVideoField(firstFieldNumber + field, range.startFieldLine, range.endFieldLine);
+                memcpy(outputPointer, rangeData.constData(), rangeData.size() * sizeof(quint16));
+                outputPointer += rangeData.size();
+            }
+        }
+
+        return outputData;
+    }
+
+    // Check the requested fields are valid
+    if (firstFieldNumber < 1 || firstFieldNumber + numberOfFields - 1 > availableFields) {
+        qFatal("Application requested field line range that exceeds the boundaries of the input TBC file");
+    }
+
+    // Copy the line ranges from the mapping
+    uchar *outputPointer = reinterpret_cast<uchar *>(outputData.data());
+    for (qint32 field = 0; field < numberOfFields; field++) {
+        const uchar *fieldPointer = mappedFile
+                                    + static_cast<qint64>(fieldByteLength) * (firstFieldNumber + field - 1);
+        for (const LineRange &range : lineRanges) {
+            const qint64 rangeBytes = static_cast<qint64>(range.endFieldLine - range.startFieldLine + 1) * fieldLineLength;
+            memcpy(outputPointer, fieldPointer + static_cast<qint64>(range.startFieldLine - 1) * fieldLineLength,
+                   rangeBytes);
+            outputPointer += rangeBytes;
+        }
+    }
+
+    return outputData;
+}
+
+// Find a single field line within the data returned by getVideoFieldRanges
+// for one field. Returns an empty view if the line wasn't in the ranges.
+SourceVideo::DataView SourceVideo::getRangeLine(const Data &rangeData, const std::vector<LineRange> &lineRanges,
+                                                qint32 fieldLine, qint32 fieldWidth)
+{
+    qint32 linesBefore = 0;
+    for (const LineRange &range : lineRanges) {
+        if (fieldLine >= range.startFieldLine && fieldLine <= range.endFieldLine) {
+            const qint32 linePosition = linesBefore + (fieldLine - range.startFieldLine);
+            return DataView(rangeData).mid(linePosition * fieldWidth, fieldWidth);
+        }
+        linesBefore += range.endFieldLine - range.startFieldLine + 1;
+    }
+
+    return DataView();
+}
+
+// Map the input file into memory, if this hasn't already been tried.
+// Returns true if the mapping is available.
+bool SourceVideo::mapInputFile()
+{
+    if (mapAttempted) return mappedFile != nullptr;
+    mapAttempted = true;
+
+    // Can't map stdin, or a file with no complete fields
+    if (availableFields <= 0) return false;
+
+    mappedFile = inputFile.map(0, static_cast<qint64>(fieldByteLength) * availableFields);
+    if (mappedFile == nullptr) {
+        qDebug() << "SourceVideo::mapInputFile(): Could not map input file, using sequential reads";
+        return false;
+    }
+
+    qDebug() << "SourceVideo::mapInputFile(): Input file mapped for partial reads";
+    return true;
+}
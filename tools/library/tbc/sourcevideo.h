@@ -30,6 +30,8 @@
 #include <QDebug>
 #include <QVector>
 
+#include <vector>
+
 class SourceVideo
 {
 public:
@@ -39,6 +41,40 @@ public:
     // yourself).
     using Data = QVector<quint16>;
 
+    // A non-owning view of a run of samples within a Data (e.g. a single
+    // field line), used to avoid copying. The view is only valid while the
+    // Data it refers to is alive and unmodified.
+    class DataView
+    {
+    public:
+        DataView() : viewData(nullptr), viewSize(0) {}
+        DataView(const quint16 *_viewData, qint32 _viewSize) : viewData(_viewData), viewSize(_viewSize) {}
+        DataView(const Data &data) : viewData(data.constData()), viewSize(data.size()) {}
+
+        const quint16 *data() const { return viewData; }
+        qint32 size() const { return viewSize; }
+        bool isEmpty() const { return viewSize == 0; }
+        const quint16 &operator[](qint32 i) const { return viewData[i]; }
+        const quint16 *begin() const { return viewData; }
+        const quint16 *end() const { return viewData + viewSize; }
+
+        // Return a view of part of this view (clipped to its bounds)
+        DataView mid(qint32 pos, qint32 length) const {
+            if (pos < 0 || pos >= viewSize) return DataView();
+            return DataView(viewData + pos, qMin(length, viewSize - pos));
+        }
+
+    private:
+        const quint16 *viewData;
+        qint32 viewSize;
+    };
+
+    // A range of field lines to read (1-based, inclusive)
+    struct LineRange {
+        qint32 startFieldLine;
+        qint32 endFieldLine;
+    };
+
     SourceVideo();
     ~SourceVideo();
 
@@ -52,6 +88,9 @@ public:
 
     // Field handling methods
     Data getVideoField(qint32 fieldNumber, qint32 startFieldLine = -1, qint32 endFieldLine = -1);
+    Data getVideoFieldRanges(qint32 firstFieldNumber, qint32 numberOfFields, const std::vector<LineRange> &lineRanges);
+    static DataView getRangeLine(const Data &rangeData, const std::vector<LineRange> &lineRanges,
+                                 qint32 fieldLine, qint32 fieldWidth);
 
     // Get and set methods
     bool isSourceValid();
@@ -70,6 +109,13 @@ private:
 
     Data outputFieldData;
 
+    // Memory-mapped view of the input file, used for partial reads (or
+    // nullptr if the file hasn't been mapped, or can't be)
+    const uchar *mappedFile;
+    bool mapAttempted;
+
+    bool mapInputFile();
+
     // Field caching
     QCache<qint32, Data> fieldCache;
 };
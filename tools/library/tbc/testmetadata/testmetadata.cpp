@@ -24,13 +24,19 @@
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
+#include "binarymetadata.h"
 #include "jsonio.h"
 #include "lddecodemetadata.h"
+#include "metadatajournal.h"
 
 // Run unit tests for the JSON parser
 void testJsonReader()
@@ -203,6 +209,509 @@ void testJsonReader()
         }
         assert(got_exception);
     }
+
+    std::cerr << "Integer values\n";
+    {
+        // Integers written in floating-point form are rounded to the nearest integer
+        const char *json = "[ 42, -7, 1.5e3, 2.5, -2.5, 1e2, 9007199254740993, 123456789012345678901234 ]";
+        std::istringstream input(json);
+        JsonReader reader(input);
+        qint64 value;
+
+        reader.beginArray();
+        for (qint64 expected : { 42LL, -7LL, 1500LL, 3LL, -3LL, 100LL, 9007199254740993LL }) {
+            assert(reader.readElement());
+            reader.read(value);
+            assert(value == expected);
+        }
+        assert(reader.readElement());
+        double d;
+        reader.read(d);
+        assert(fabs(d - 1.23456789012345678901234e23) < 1e9);
+        assert(!reader.readElement());
+        reader.endArray();
+    }
+
+    std::cerr << "Large input\n";
+    {
+        // Large enough that tokens cross the reader's internal block boundaries
+        const int count = 400000;
+        std::string json = "[";
+        for (int i = 0; i < count; i++) {
+            if (i != 0) json += (i % 7 == 0) ? " ,\n  " : ",";
+            json += (i % 3 == 0) ? "{\"n\":" + std::to_string(i * 37 - 5000) + ",\"s\":\"x\\\"" + std::to_string(i) + "\"}"
+                                 : std::to_string(i * 37 - 5000);
+        }
+        json += "]";
+
+        // Check both the stream and in-memory readers
+        for (int pass = 0; pass < 2; pass++) {
+            std::istringstream input(json);
+            JsonReader streamReader(input);
+            JsonReader memoryReader(json.data(), json.size());
+            JsonReader &reader = (pass == 0) ? streamReader : memoryReader;
+
+            std::string s;
+            int value;
+            reader.beginArray();
+            for (int i = 0; i < count; i++) {
+                assert(reader.readElement());
+                if (i % 3 == 0) {
+                    reader.beginObject();
+                    assert(reader.readMember(s) && s == "n");
+                    reader.read(value);
+                    assert(value == i * 37 - 5000);
+                    assert(reader.readMember(s) && s == "s");
+                    reader.read(s);
+                    assert(s == "x\"" + std::to_string(i));
+                    assert(!reader.readMember(s));
+                    reader.endObject();
+                } else {
+                    reader.read(value);
+                    assert(value == i * 37 - 5000);
+                }
+            }
+            assert(!reader.readElement());
+            reader.endArray();
+        }
+    }
+}
+
+// Run unit tests for the JSON writer
+void testJsonWriter()
+{
+    std::cerr << "Testing JsonWriter\n";
+
+    std::cerr << "Output syntax\n";
+    {
+        std::ostringstream output;
+        {
+            JsonWriter writer(output);
+            writer.beginObject();
+            writer.writeMember("emptyArray");
+            writer.beginArray();
+            writer.endArray();
+            writer.writeMember("array");
+            writer.beginArray();
+            for (int value : { 1, -2, 300000 }) {
+                writer.writeElement();
+                writer.write(value);
+            }
+            writer.endArray();
+            writer.writeMember("bigNumber", static_cast<qint64>(-9007199254740993LL));
+            writer.writeMember("floatNumber", 0.1);
+            writer.writeMember("exponentNumber", -123.456e-78);
+            writer.writeMember("escapedString", " \\ / \" \b \f \n \r \t ");
+            writer.writeMember("qString", QString("hello world"));
+            writer.writeMember("trueBool", true);
+            writer.writeMember("falseBool", false);
+            writer.endObject();
+        }
+
+        // Output is compact, with numbers in their shortest form
+        const std::string expected =
+            "{\"emptyArray\":[],\"array\":[1,-2,300000],\"bigNumber\":-9007199254740993,"
+            "\"floatNumber\":0.1,\"exponentNumber\":-1.23456e-76,"
+            "\"escapedString\":\" \\\\ / \\\" \\b \\f \\n \\r \\t \","
+            "\"qString\":\"hello world\",\"trueBool\":true,\"falseBool\":false}";
+        assert(output.str() == expected);
+    }
+
+    std::cerr << "Round trip\n";
+    {
+        // Doubles should read back exactly, and output should be complete across
+        // the writer's internal block boundaries
+        const int count = 300000;
+        std::vector<double> values;
+        for (int i = 0; i < count; i++) values.push_back((i - 150000) / 7.0 * std::pow(10.0, (i % 41) - 20));
+
+        std::ostringstream output;
+        JsonWriter writer(output);
+        writer.beginArray();
+        for (double value : values) {
+            writer.writeElement();
+            writer.write(value);
+        }
+        writer.endArray();
+        writer.flush();
+
+        std::istringstream input(output.str());
+        JsonReader reader(input);
+        double d;
+        reader.beginArray();
+        for (double value : values) {
+            assert(reader.readElement());
+            reader.read(d);
+            assert(d == value);
+        }
+        assert(!reader.readElement());
+        reader.endArray();
+    }
+}
+
+// Return a field's metadata as JSON, for comparison
+static std::string fieldToJson(const LdDecodeMetaData::Field &field)
+{
+    std::ostringstream output;
+    {
+        JsonWriter writer(output);
+        field.write(writer);
+    }
+    return output.str();
+}
+
+// Return the contents of a file
+static QByteArray readFileContents(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    return file.readAll();
+}
+
+// Run unit tests for BinaryMetaData
+void testBinaryMetaData()
+{
+    std::cerr << "Testing BinaryMetaData\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    const QString jsonFileName = tempDir.filePath("test.tbc.json");
+    const QString binaryFileName = tempDir.filePath("test.tbc.ldmeta");
+
+    // Generate metadata that uses every column
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = NTSC;
+    videoParameters.fieldWidth = 910;
+    videoParameters.fieldHeight = 263;
+    videoParameters.sampleRate = 14318181.0;
+    videoParameters.isMapped = true;
+    videoParameters.gitBranch = "test";
+    LdDecodeMetaData::PcmAudioParameters pcmAudioParameters;
+    pcmAudioParameters.sampleRate = 44100.0;
+    pcmAudioParameters.isLittleEndian = true;
+    pcmAudioParameters.isSigned = true;
+    pcmAudioParameters.bits = 16;
+
+    const qint32 numFields = 1000;
+    QVector<LdDecodeMetaData::Field> fields;
+    for (qint32 i = 0; i < numFields; i++) {
+        LdDecodeMetaData::Field field;
+        field.seqNo = i + 1;
+        field.isFirstField = (i % 2) == 0;
+        field.syncConf = i % 100;
+        field.medianBurstIRE = i / 3.0;
+        field.fieldPhaseID = (i % 4) + 1;
+        field.audioSamples = 735 + (i % 2);
+        field.pad = (i % 50) == 0;
+        field.diskLoc = i * 0.5;
+        field.fileLoc = i * 3000000000LL;
+        field.decodeFaults = i % 3;
+        field.efmTValues = i * 7;
+        field.vitsMetrics.inUse = (i % 3) != 0;
+        field.vitsMetrics.wSNR = 40.0 + (i / 100.0);
+        field.vitsMetrics.bPSNR = 45.0 - (i / 300.0);
+        field.vbi.inUse = (i % 2) != 0;
+        field.vbi.vbiData = { i, -i, 0x8BA000 + i };
+        field.ntsc.inUse = (i % 5) == 0;
+        field.ntsc.isFmCodeDataValid = (i % 10) == 0;
+        field.ntsc.fmCodeData = i * 3;
+        field.ntsc.fieldFlag = (i % 15) == 0;
+        field.ntsc.isVideoIdDataValid = (i % 20) == 0;
+        field.ntsc.videoIdData = i * 5;
+        field.ntsc.whiteFlag = (i % 25) == 0;
+        field.vitc.inUse = (i % 7) == 0;
+        for (qint32 j = 0; j < 8; j++) field.vitc.vitcData[j] = (i + j) & 0xFF;
+        field.closedCaption.inUse = (i % 11) == 0;
+        field.closedCaption.data0 = i & 0x7F;
+        field.closedCaption.data1 = (i + 1) & 0x7F;
+        for (qint32 j = 0; j < i % 4; j++) field.dropOuts.append(i, i + 10 + j, j + 20);
+        fields.push_back(field);
+    }
+
+    LdDecodeMetaData metaData;
+    metaData.setVideoParameters(videoParameters);
+    metaData.setPcmAudioParameters(pcmAudioParameters);
+    for (const LdDecodeMetaData::Field &field : fields) metaData.appendField(field);
+
+    std::cerr << "Round trip\n";
+    {
+        bool b = metaData.write(jsonFileName);
+        assert(b);
+        b = metaData.write(binaryFileName);
+        assert(b);
+        assert(BinaryMetaData::isBinaryFile(binaryFileName));
+        assert(!BinaryMetaData::isBinaryFile(jsonFileName));
+
+        // Reading the binary file should give the same JSON as reading the JSON file
+        LdDecodeMetaData fromJson, fromBinary;
+        b = fromJson.read(jsonFileName);
+        assert(b);
+        b = fromBinary.read(binaryFileName);
+        assert(b);
+
+        const QString jsonOutput1 = tempDir.filePath("output1.tbc.json");
+        const QString jsonOutput2 = tempDir.filePath("output2.tbc.json");
+        b = fromJson.write(jsonOutput1);
+        assert(b);
+        b = fromBinary.writeJson(jsonOutput2);
+        assert(b);
+        if (readFileContents(jsonOutput1) != readFileContents(jsonOutput2)) {
+            std::cerr << "Binary metadata round trip doesn't match JSON\n";
+            exit(1);
+        }
+    }
+
+    std::cerr << "Random access\n";
+    {
+        BinaryMetaData binaryMetaData;
+        bool b = binaryMetaData.open(binaryFileName);
+        assert(b);
+        assert(binaryMetaData.getNumberOfFields() == numFields);
+
+        for (qint32 fieldNumber : { numFields, 1, 500, 2, 999 }) {
+            if (fieldToJson(binaryMetaData.getField(fieldNumber)) != fieldToJson(fields[fieldNumber - 1])) {
+                std::cerr << "Binary metadata field " << fieldNumber << " doesn't match\n";
+                exit(1);
+            }
+        }
+
+        // LdDecodeMetaData only decodes fields when they're used, but should
+        // still have the audio map for all of them
+        LdDecodeMetaData fromBinary;
+        b = fromBinary.read(binaryFileName);
+        assert(b);
+        assert(fromBinary.getFieldPcmAudioLength(numFields) == fields[numFields - 1].audioSamples);
+        assert(fromBinary.getFieldPcmAudioStart(3) == fields[0].audioSamples + fields[1].audioSamples);
+        for (qint32 fieldNumber : { 999, 2, 500, 1, numFields }) {
+            if (fieldToJson(fromBinary.getField(fieldNumber)) != fieldToJson(fields[fieldNumber - 1])) {
+                std::cerr << "Lazily loaded binary metadata field " << fieldNumber << " doesn't match\n";
+                exit(1);
+            }
+        }
+    }
+
+    std::cerr << "Partial update\n";
+    {
+        // Update one column in place
+        LdDecodeMetaData::VitsMetrics vitsMetrics;
+        vitsMetrics.inUse = true;
+        vitsMetrics.wSNR = 12.5;
+        vitsMetrics.bPSNR = 25.0;
+        fields[99].vitsMetrics = vitsMetrics;
+        bool b = BinaryMetaData::updateColumns(binaryFileName, videoParameters, pcmAudioParameters, fields,
+                                               BinaryMetaData::columnMask(BinaryMetaData::VITS_METRICS), false);
+        assert(b);
+
+        // Updates that change the layout should be refused
+        b = BinaryMetaData::updateColumns(binaryFileName, videoParameters, pcmAudioParameters, fields,
+                                          BinaryMetaData::DROPOUT_COLUMNS, false);
+        assert(!b);
+        QVector<LdDecodeMetaData::Field> shortFields = fields.mid(0, numFields - 1);
+        b = BinaryMetaData::updateColumns(binaryFileName, videoParameters, pcmAudioParameters, shortFields,
+                                          BinaryMetaData::columnMask(BinaryMetaData::VITS_METRICS), false);
+        assert(!b);
+
+        // Update through LdDecodeMetaData, which should also happen in place
+        LdDecodeMetaData fromBinary;
+        b = fromBinary.read(binaryFileName);
+        assert(b);
+        fields[199].vbi.inUse = true;
+        fields[199].vbi.vbiData = { 1, 2, 3 };
+        fromBinary.updateFieldVbi(fields[199].vbi, 200);
+        const qint64 sizeBefore = QFileInfo(binaryFileName).size();
+        b = fromBinary.write(binaryFileName);
+        assert(b);
+        assert(QFileInfo(binaryFileName).size() == sizeBefore);
+
+        // Changing drop-outs needs a full rewrite
+        fields[299].dropOuts.append(1, 2, 3);
+        fromBinary.updateFieldDropOuts(fields[299].dropOuts, 300);
+        b = fromBinary.write(binaryFileName);
+        assert(b);
+        assert(QFileInfo(binaryFileName).size() > sizeBefore);
+
+        BinaryMetaData binaryMetaData;
+        b = binaryMetaData.open(binaryFileName);
+        assert(b);
+        for (qint32 fieldNumber = 1; fieldNumber <= numFields; fieldNumber++) {
+            if (fieldToJson(binaryMetaData.getField(fieldNumber)) != fieldToJson(fields[fieldNumber - 1])) {
+                std::cerr << "Updated binary metadata field " << fieldNumber << " doesn't match\n";
+                exit(1);
+            }
+        }
+    }
+}
+
+// Run unit tests for MetaDataJournal
+void testMetaDataJournal()
+{
+    std::cerr << "Testing MetaDataJournal\n";
+
+    QTemporaryDir tempDir;
+    assert(tempDir.isValid());
+    const QString jsonFileName = tempDir.filePath("test.tbc.json");
+    const QString journalFileName = MetaDataJournal::getJournalFileName(jsonFileName);
+
+    LdDecodeMetaData::VideoParameters videoParameters;
+    videoParameters.system = PAL;
+    videoParameters.fieldWidth = 1135;
+    videoParameters.fieldHeight = 313;
+    videoParameters.sampleRate = 17734375.0;
+
+    const qint32 numFields = 100;
+    QVector<LdDecodeMetaData::Field> fields;
+    {
+        LdDecodeMetaData metaData;
+        metaData.setVideoParameters(videoParameters);
+        for (qint32 i = 0; i < numFields; i++) {
+            LdDecodeMetaData::Field field;
+            field.seqNo = i + 1;
+            field.isFirstField = (i % 2) == 0;
+            metaData.appendField(field);
+            fields.push_back(field);
+        }
+        bool b = metaData.write(jsonFileName);
+        assert(b);
+    }
+    const QByteArray originalJson = readFileContents(jsonFileName);
+
+    std::cerr << "Journalled updates\n";
+    {
+        LdDecodeMetaData metaData;
+        bool b = metaData.read(jsonFileName);
+        assert(b);
+        b = metaData.openJournal(jsonFileName);
+        assert(b);
+        assert(metaData.isJournalOpen());
+
+        for (qint32 i = 0; i < numFields; i += 3) {
+            fields[i].vitsMetrics.inUse = true;
+            fields[i].vitsMetrics.wSNR = 30.0 + i;
+            fields[i].vitsMetrics.bPSNR = 40.0 - i;
+            metaData.updateFieldVitsMetrics(fields[i].vitsMetrics, i + 1);
+            fields[i].vbi.inUse = true;
+            fields[i].vbi.vbiData = { i, 0x8BA000 + i, -1 };
+            metaData.updateFieldVbi(fields[i].vbi, i + 1);
+        }
+        fields[41].dropOuts.append(10, 20, 30);
+        fields[41].dropOuts.append(40, 50, 60);
+        metaData.updateFieldDropOuts(fields[41].dropOuts, 42);
+
+        b = metaData.closeJournal();
+        assert(b);
+        assert(!metaData.isJournalOpen());
+    }
+
+    // The metadata file itself should be untouched, but reading it should apply the journal
+    assert(readFileContents(jsonFileName) == originalJson);
+    assert(QFile::exists(journalFileName));
+    {
+        LdDecodeMetaData metaData;
+        bool b = metaData.read(jsonFileName);
+        assert(b);
+        for (qint32 fieldNumber = 1; fieldNumber <= numFields; fieldNumber++) {
+            if (fieldToJson(metaData.getField(fieldNumber)) != fieldToJson(fields[fieldNumber - 1])) {
+                std::cerr << "Journalled field " << fieldNumber << " doesn't match\n";
+                exit(1);
+            }
+        }
+    }
+
+    std::cerr << "Incomplete record\n";
+    {
+        // Appending a partial record (as if a run had crashed) shouldn't stop the journal being read
+        QFile journalFile(journalFileName);
+        bool b = journalFile.open(QIODevice::Append);
+        assert(b);
+        journalFile.write("\x01\x00\x00", 3);
+        journalFile.close();
+
+        LdDecodeMetaData metaData;
+        b = metaData.read(jsonFileName);
+        assert(b);
+        assert(fieldToJson(metaData.getField(1)) == fieldToJson(fields[0]));
+
+        // Reopening the journal should discard the partial record
+        const qint64 sizeWithPartial = QFileInfo(journalFileName).size();
+        b = metaData.openJournal(jsonFileName);
+        assert(b);
+        b = metaData.closeJournal();
+        assert(b);
+        assert(QFileInfo(journalFileName).size() == sizeWithPartial - 3);
+    }
+
+    std::cerr << "Damaged record\n";
+    {
+        // Corrupt the CRC of the last record (field 42's drop-outs); the
+        // records before it should still be applied, but not that one
+        QFile journalFile(journalFileName);
+        bool b = journalFile.open(QIODevice::ReadWrite);
+        assert(b);
+        const qint64 lastByte = journalFile.size() - 1;
+        char original;
+        b = journalFile.seek(lastByte) && journalFile.getChar(&original);
+        assert(b);
+        b = journalFile.seek(lastByte) && journalFile.putChar(static_cast<char>(original ^ 0x55));
+        assert(b);
+        journalFile.close();
+
+        LdDecodeMetaData metaData;
+        b = metaData.read(jsonFileName);
+        assert(b);
+        assert(fieldToJson(metaData.getField(1)) == fieldToJson(fields[0]));
+        assert(metaData.getField(42).dropOuts.size() == 0);
+
+        // Put it back for the next test
+        b = journalFile.open(QIODevice::ReadWrite) && journalFile.seek(lastByte) && journalFile.putChar(original);
+        assert(b);
+        journalFile.close();
+    }
+
+    std::cerr << "Compaction\n";
+    {
+        LdDecodeMetaData metaData;
+        bool b = metaData.read(jsonFileName);
+        assert(b);
+        b = metaData.write(jsonFileName);
+        assert(b);
+        assert(!QFile::exists(journalFileName));
+
+        LdDecodeMetaData compacted;
+        b = compacted.read(jsonFileName);
+        assert(b);
+        for (qint32 fieldNumber = 1; fieldNumber <= numFields; fieldNumber++) {
+            if (fieldToJson(compacted.getField(fieldNumber)) != fieldToJson(fields[fieldNumber - 1])) {
+                std::cerr << "Compacted field " << fieldNumber << " doesn't match\n";
+                exit(1);
+            }
+        }
+    }
+
+    std::cerr << "Journal for a different metadata file\n";
+    {
+        LdDecodeMetaData metaData;
+        bool b = metaData.read(jsonFileName);
+        assert(b);
+        b = metaData.openJournal(jsonFileName);
+        assert(b);
+        metaData.updateFieldDropOuts(fields[41].dropOuts, 43);
+        b = metaData.closeJournal();
+        assert(b);
+
+        // Regenerating the metadata file must stop the old journal being
+        // applied to it, or reopened
+        QFile jsonFile(jsonFileName);
+        b = jsonFile.open(QIODevice::Append);
+        assert(b);
+        jsonFile.write("\n");
+        jsonFile.close();
+
+        LdDecodeMetaData regenerated;
+        b = regenerated.read(jsonFileName);
+        assert(!b);
+        b = regenerated.openJournal(jsonFileName);
+        assert(!b);
+    }
 }
 
 // Run unit tests for VideoSystem
@@ -249,10 +758,10 @@ int main(int argc, char *argv[])
     parser.addOption(exitOption);
 
     // Positional argument to specify input video file
-    parser.addPositionalArgument("input", "Input JSON file (omit to run unit tests)");
+    parser.addPositionalArgument("input", "Input JSON or binary metadata file (omit to run unit tests)");
 
     // Positional argument to specify output video file
-    parser.addPositionalArgument("output", "Output JSON file (omit to only read input)");
+    parser.addPositionalArgument("output", "Output JSON or .ldmeta file (omit to only read input)");
 
     // Parse the command line
     parser.process(app);
@@ -262,6 +771,9 @@ int main(int argc, char *argv[])
     if (positionalArguments.count() == 0) {
         // Run unit tests
         testJsonReader();
+        testJsonWriter();
+        testBinaryMetaData();
+        testMetaDataJournal();
         testVideoSystem();
         return 0;
     }
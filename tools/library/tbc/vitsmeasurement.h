@@ -0,0 +1,60 @@
+/************************************************************************
+
+    vitsmeasurement.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef VITSMEASUREMENT_H
+#define VITSMEASUREMENT_H
+
+#include <QVector>
+#include <QDebug>
+
+#include <vector>
+
+#include "lddecodemetadata.h"
+#include "sourcevideo.h"
+
+// Measurement of the white SNR and black PSNR of a field from its vertical
+// interval test signals. This is shared by ld-process-vits and the combined
+// analysis mode of ld-process-vbi.
+class VitsMeasurement
+{
+public:
+    // The field lines containing the measurement points (1-based, inclusive)
+    static std::vector<SourceVideo::LineRange> getLineRanges(VideoSystem system);
+
+    void measureField(const SourceVideo::Data &rangeData, const std::vector<SourceVideo::LineRange> &lineRanges,
+                      const LdDecodeMetaData::VideoParameters &videoParameters,
+                      LdDecodeMetaData::VitsMetrics &vitsMetrics);
+
+private:
+    QVector<double> getFieldLineSlice(const SourceVideo::Data &rangeData,
+                                      const std::vector<SourceVideo::LineRange> &lineRanges,
+                                      const LdDecodeMetaData::VideoParameters &videoParameters,
+                                      qint32 fieldLine, qint32 startUs, qint32 lengthUs);
+    double calculateSnr(QVector<double> &data, bool usePsnr);
+    double calcMean(QVector<double> &data);
+    double calcStd(QVector<double> &data);
+    double roundDouble(double in, qint32 decimalPlaces);
+};
+
+#endif // VITSMEASUREMENT_H